@@ -0,0 +1,82 @@
+// Copyright 2021 The Goma Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/strings/str_format.h"
+#include "arfile_reader.h"
+#include "benchmark/benchmark.h"
+#include "file_reader.h"
+#include "glog/logging.h"
+#include "unittest_util.h"
+
+namespace devtools_goma {
+
+namespace {
+
+// Returns a normal (non thin) archive with |num_entries| entries of
+// |entry_size| bytes. Entry names are short enough to not need the long
+// name table.
+std::string MakeArchive(int num_entries, int entry_size) {
+  std::string archive = "!<arch>\n";
+  for (int i = 0; i < num_entries; ++i) {
+    archive += absl::StrFormat("%-16s%-12d%-6d%-6d%-8o%-10d`\n",
+                               absl::StrFormat("obj%05d.o/", i), 1600000000 + i,
+                               1000, 1000, 0100644, entry_size);
+    archive.append(entry_size, static_cast<char>('a' + i % 26));
+    if (entry_size % 2 != 0) {
+      archive += '\n';
+    }
+  }
+  return archive;
+}
+
+void BM_ArFileReaderRead(benchmark::State& state) {
+  ArFileReader::Register();
+
+  TmpdirUtil tmpdir("arfile_reader_benchmark");
+  const int num_entries = state.range(0);
+  const int entry_size = state.range(1);
+  ArFile::SetUseMmap(state.range(2) != 0);
+  const std::string archive = MakeArchive(num_entries, entry_size);
+  tmpdir.CreateTmpFile("libbench.a", archive);
+  const std::string path = tmpdir.FullPath("libbench.a");
+
+  // Same as the chunk size used to upload file blobs.
+  std::vector<char> buf(2 * 1024 * 1024);
+  for (auto _ : state) {
+    (void)_;
+    std::unique_ptr<FileReader> reader(
+        FileReaderFactory::GetInstance()->NewFileReader(path));
+    CHECK(reader->valid());
+    // Like the uploader, reads the file size bytes. Normalization does not
+    // change the size.
+    size_t remaining = archive.size();
+    while (remaining > 0) {
+      ssize_t n = reader->Read(buf.data(), std::min(remaining, buf.size()));
+      CHECK_GT(n, 0);
+      remaining -= n;
+    }
+  }
+
+  state.SetBytesProcessed(state.iterations() * archive.size());
+  ArFile::SetUseMmap(false);
+}
+
+// Args are the number of entries, entry size and whether to use mmap.
+BENCHMARK(BM_ArFileReaderRead)
+    ->Args({1000, 64 * 1024, 0})
+    ->Args({1000, 64 * 1024, 1})
+    ->Args({10000, 4 * 1024 + 1, 0})
+    ->Args({10000, 4 * 1024 + 1, 1})
+    ->Unit(benchmark::kMillisecond);
+
+}  // namespace
+
+}  // namespace devtools_goma
+
+BENCHMARK_MAIN();
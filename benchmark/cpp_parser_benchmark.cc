@@ -2,14 +2,99 @@
 // Use of this source code is governed by a BSD-style license that can be
 // found in the LICENSE file.
 
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <memory>
+#include <new>
 #include <string>
 
 #include "benchmark/benchmark.h"
+#include "content.h"
+#include "cxx/include_processor/cpp_directive_arena.h"
+#include "cxx/include_processor/cpp_directive_parser.h"
 #include "cxx/include_processor/cpp_parser.h"
 #include "glog/logging.h"
 
+namespace {
+
+// Live heap usage, to compare memory used by directive representations.
+std::atomic<int64_t> g_live_allocs;
+std::atomic<int64_t> g_live_bytes;
+
+// Each allocation has a header to remember its size.
+constexpr size_t kHeaderSize = alignof(std::max_align_t);
+
+}  // namespace
+
+void* operator new(size_t size) {
+  void* p = std::malloc(size + kHeaderSize);
+  if (p == nullptr) {
+    throw std::bad_alloc();
+  }
+  *static_cast<size_t*>(p) = size;
+  g_live_allocs.fetch_add(1, std::memory_order_relaxed);
+  g_live_bytes.fetch_add(size, std::memory_order_relaxed);
+  return static_cast<char*>(p) + kHeaderSize;
+}
+
+void operator delete(void* p) noexcept {
+  if (p == nullptr) {
+    return;
+  }
+  void* block = static_cast<char*>(p) - kHeaderSize;
+  g_live_allocs.fetch_sub(1, std::memory_order_relaxed);
+  g_live_bytes.fetch_sub(*static_cast<size_t*>(block),
+                         std::memory_order_relaxed);
+  std::free(block);
+}
+
 namespace devtools_goma {
 
+namespace {
+
+// Returns a header like content, having an include guard, includes,
+// macro definitions and conditions.
+std::string MakeHeader(int n) {
+  std::string header =
+      "#ifndef DEVTOOLS_GOMA_BENCHMARK_HEADER_H_\n"
+      "#define DEVTOOLS_GOMA_BENCHMARK_HEADER_H_\n";
+  for (int i = 0; i < n; ++i) {
+    const std::string s = std::to_string(i);
+    header += "#include \"path/to/some/header_" + s + ".h\"\n";
+    header += "#if defined(HAS_FEATURE_" + s + ") && FEATURE_LEVEL > " + s +
+              "\n"
+              "#define FEATURE_VALUE_" +
+              s + " (FEATURE_LEVEL + " + s +
+              ")\n"
+              "#elif defined(OTHER_FEATURE)\n"
+              "#define FEATURE_VALUE_" +
+              s +
+              "(x, y) ((x) * (y))\n"
+              "#else\n"
+              "#undef FEATURE_VALUE_" +
+              s +
+              "\n"
+              "#endif\n";
+    header += "#ifdef USE_MACRO_INCLUDE_" + s + "\n#include MACRO_INCLUDE_" +
+              s + "\n#endif\n";
+  }
+  header += "#endif  // DEVTOOLS_GOMA_BENCHMARK_HEADER_H_\n";
+  return header;
+}
+
+SharedCppDirectives ParseDirectives(const std::string& header, bool compact) {
+  std::unique_ptr<Content> content(Content::CreateFromString(header));
+  CppDirectiveList directives;
+  CHECK(CppDirectiveParser().Parse(*content, "header.h", &directives));
+  if (compact) {
+    return CppDirectiveArena::Compact(directives, nullptr);
+  }
+  return std::make_shared<CppDirectiveList>(std::move(directives));
+}
+
+}  // namespace
+
 void BM_ReadObjectMacro(benchmark::State& state) {
   std::string long_expr;
 
@@ -60,6 +145,147 @@ void BM_ReadFunctionMacro(benchmark::State& state) {
 
 BENCHMARK(BM_ReadFunctionMacro)->RangeMultiplier(2)->Range(1, 32);
 
+void BM_DefineAndLookupMacros(benchmark::State& state) {
+  std::string directives;
+  for (int i = 0; i < state.range(0); ++i) {
+    directives += "#define long_long_macro_" + std::to_string(i) + " 1\n";
+  }
+  for (int i = 0; i < state.range(0); ++i) {
+    directives += "#ifdef long_long_macro_" + std::to_string(i) +
+                  "\n#undef long_long_macro_" + std::to_string(i) +
+                  "\n#endif\n";
+  }
+
+  for (auto _ : state) {
+    (void)_;
+    CppParser cpp_parser;
+    cpp_parser.AddStringInput(directives, "a.cc");
+    CHECK(cpp_parser.ProcessDirectives());
+  }
+
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+BENCHMARK(BM_DefineAndLookupMacros)->RangeMultiplier(8)->Range(8, 8 << 9);
+
+void BM_RestoreSnapshot(benchmark::State& state) {
+  std::string directives;
+  for (int i = 0; i < state.range(0); ++i) {
+    directives += "#define long_long_macro_" + std::to_string(i) + " 1\n";
+  }
+  CppParser preamble_parser;
+  preamble_parser.AddStringInput(directives, "preamble.h");
+  CHECK(preamble_parser.ProcessDirectives());
+  std::shared_ptr<const CppParser::Snapshot> snapshot =
+      preamble_parser.CreateSnapshot();
+  CHECK(snapshot);
+
+  for (auto _ : state) {
+    (void)_;
+    CppParser cpp_parser;
+    cpp_parser.RestoreSnapshot(*snapshot, nullptr);
+    cpp_parser.AddStringInput("#define long_long_macro_0 2\n", "a.cc");
+    CHECK(cpp_parser.ProcessDirectives());
+  }
+
+  state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK(BM_RestoreSnapshot)->RangeMultiplier(8)->Range(8, 8 << 9);
+
+// Compares heap usage of parsed directives (arg 0) and the directives
+// compacted in CppDirectiveArena (arg 1), as kept in IncludeCache.
+void BM_DirectivesMemory(benchmark::State& state) {
+  const std::string header = MakeHeader(state.range(0));
+  const bool compact = state.range(1) != 0;
+
+  int64_t allocs = 0;
+  int64_t bytes = 0;
+  for (auto _ : state) {
+    (void)_;
+    const int64_t allocs_before = g_live_allocs.load();
+    const int64_t bytes_before = g_live_bytes.load();
+    SharedCppDirectives directives = ParseDirectives(header, compact);
+    allocs = g_live_allocs.load() - allocs_before;
+    bytes = g_live_bytes.load() - bytes_before;
+    benchmark::DoNotOptimize(directives);
+  }
+
+  state.counters["live_allocs"] = allocs;
+  state.counters["live_bytes"] = bytes;
+}
+
+BENCHMARK(BM_DirectivesMemory)
+    ->ArgPair(16, 0)
+    ->ArgPair(16, 1)
+    ->ArgPair(256, 0)
+    ->ArgPair(256, 1);
+
+// Compares CppParser processing parsed directives (arg 0) and compacted
+// directives (arg 1).
+void BM_ProcessDirectives(benchmark::State& state) {
+  SharedCppDirectives directives =
+      ParseDirectives(MakeHeader(state.range(0)), state.range(1) != 0);
+
+  for (auto _ : state) {
+    (void)_;
+    CppParser cpp_parser;
+    cpp_parser.AddPreparsedDirectivesInput(directives);
+    CHECK(cpp_parser.ProcessDirectives());
+  }
+
+  state.SetItemsProcessed(state.iterations() * directives->size());
+}
+
+BENCHMARK(BM_ProcessDirectives)
+    ->ArgPair(16, 0)
+    ->ArgPair(16, 1)
+    ->ArgPair(256, 0)
+    ->ArgPair(256, 1);
+
+// Compares evaluating #if conditions of cached directives with condition
+// memo (arg 1) and without it (arg 0), i.e. on newly parsed directives.
+void BM_EvalCondition(benchmark::State& state) {
+  const std::string macros =
+      "#define __cplusplus 201703L\n"
+      "#define __GNUC__ 10\n"
+      "#define __GNUC_MINOR__ 2\n"
+      "#define GNUC_PREREQ(maj, min) \\\n"
+      "  ((__GNUC__ << 16) + __GNUC_MINOR__ >= ((maj) << 16) + (min))\n";
+  std::string header;
+  for (int i = 0; i < state.range(0); ++i) {
+    header +=
+        "#if defined(__cplusplus) && __cplusplus >= 201103L && "
+        "GNUC_PREREQ(4, " + std::to_string(i % 10) + ")\n"
+        "#endif\n";
+  }
+  const bool use_memo = state.range(1) != 0;
+  SharedCppDirectives directives(
+      CppDirectiveParser::ParseFromString(header, "header.h"));
+
+  for (auto _ : state) {
+    (void)_;
+    if (!use_memo) {
+      state.PauseTiming();
+      directives = CppDirectiveParser::ParseFromString(header, "header.h");
+      state.ResumeTiming();
+    }
+    CppParser cpp_parser;
+    cpp_parser.AddStringInput(macros, "macros.h");
+    CHECK(cpp_parser.ProcessDirectives());
+    cpp_parser.AddPreparsedDirectivesInput(directives);
+    CHECK(cpp_parser.ProcessDirectives());
+  }
+
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+BENCHMARK(BM_EvalCondition)
+    ->ArgPair(16, 0)
+    ->ArgPair(16, 1)
+    ->ArgPair(256, 0)
+    ->ArgPair(256, 1);
+
 }  // namespace devtools_goma
 
 BENCHMARK_MAIN();
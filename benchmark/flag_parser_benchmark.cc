@@ -0,0 +1,157 @@
+// Copyright 2021 The Goma Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <string>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "absl/strings/str_split.h"
+#include "gcc_flags.h"
+#include "glog/logging.h"
+#include "vc_flags.h"
+
+namespace devtools_goma {
+
+namespace {
+
+// Compile commands taken from chromium builds.
+const std::vector<std::string> kGCCCommands = {
+    "../../third_party/llvm-build/Release+Asserts/bin/clang++ -MMD "
+    "-MF obj/base/base/file_path.o.d -DUSE_UDEV -DUSE_AURA=1 -DUSE_GLIB=1 "
+    "-DUSE_NSS_CERTS=1 -DUSE_OZONE=1 -DUSE_X11=1 -D_FILE_OFFSET_BITS=64 "
+    "-D_LARGEFILE_SOURCE -D_LARGEFILE64_SOURCE -D__STDC_CONSTANT_MACROS "
+    "-D__STDC_FORMAT_MACROS -DCOMPONENT_BUILD -D_LIBCPP_ABI_UNSTABLE "
+    "-D_LIBCPP_ENABLE_NODISCARD -DCR_LIBCXX_REVISION=375504 "
+    "-D_LIBCPP_DEBUG=0 -DCR_SYSROOT_HASH=95051d95804a77144986255f534acb920 "
+    "-D_DEBUG -DDYNAMIC_ANNOTATIONS_ENABLED=1 -DBASE_IMPLEMENTATION "
+    "-I../.. -Igen -I../../third_party/boringssl/src/include "
+    "-fno-delete-null-pointer-checks -fno-ident -fno-strict-aliasing "
+    "--param=ssp-buffer-size=4 -fstack-protector -funwind-tables -fPIC "
+    "-pthread -fcolor-diagnostics -fmerge-all-constants "
+    "-fcrash-diagnostics-dir=../../tools/clang/crashreports "
+    "-Xclang -mllvm -Xclang -instcombine-lower-dbg-declare=0 "
+    "-fcomplete-member-pointers -m64 -march=x86-64 -msse3 "
+    "-Wno-builtin-macro-redefined -D__DATE__= -D__TIME__= "
+    "-D__TIMESTAMP__= -Xclang -fdebug-compilation-dir -Xclang . "
+    "-no-canonical-prefixes -Wall -Werror -Wextra -Wimplicit-fallthrough "
+    "-Wunreachable-code -Wthread-safety -Wextra-semi "
+    "-Wno-missing-field-initializers -Wno-unused-parameter "
+    "-Wno-c++11-narrowing -Wno-unneeded-internal-declaration "
+    "-fno-omit-frame-pointer -g2 -gsplit-dwarf -ggnu-pubnames "
+    "-fvisibility=hidden -Wheader-hygiene -Wstring-conversion "
+    "-Wtautological-overlap-compare -Wexit-time-destructors -O0 "
+    "-fno-exceptions -fno-rtti -nostdinc++ "
+    "-isystem../../buildtools/third_party/libc++/trunk/include "
+    "-isystem../../buildtools/third_party/libc++abi/trunk/include "
+    "--sysroot=../../build/linux/debian_sid_amd64-sysroot "
+    "-fvisibility-inlines-hidden -std=c++14 "
+    "-c ../../base/files/file_path.cc -o obj/base/base/file_path.o",
+
+    "/usr/bin/gcc -MMD -MF obj/third_party/zlib/zlib/deflate.o.d "
+    "-DZLIB_IMPLEMENTATION -DHAVE_HIDDEN -DX86_NOT_WINDOWS -DUSE_FILE32API "
+    "-I../../third_party/zlib -Igen -fno-strict-aliasing -fPIC -pthread "
+    "-m64 -march=x86-64 -msse2 -msse3 -mssse3 -msse4.2 -mpclmul "
+    "-Wall -Wno-unused-function -O2 -fdata-sections -ffunction-sections "
+    "-fno-omit-frame-pointer -g0 -fvisibility=hidden -std=c11 "
+    "-c ../../third_party/zlib/deflate.c "
+    "-o obj/third_party/zlib/zlib/deflate.o",
+
+    "../../third_party/android_ndk/toolchains/llvm/prebuilt/linux-x86_64/"
+    "bin/clang++ -MMD -MF obj/content/renderer/renderer/render_frame_impl.o.d "
+    "--target=aarch64-linux-android21 -DANDROID -DHAVE_SYS_UIO_H "
+    "-DANDROID_NDK_VERSION_ROLL=r20_1 -DNDEBUG -DNVALGRIND "
+    "-I../.. -Igen -I../../third_party/perfetto/include "
+    "-I../../third_party/skia/include/core -Wp,-MD,foo.d "
+    "-include ../../build/precompile.h -ffunction-sections -fno-short-enums "
+    "-isystem ../../third_party/android_ndk/sources/android/cpufeatures "
+    "-Oz -fomit-frame-pointer -gdwarf-4 -g1 -Wl,--gc-sections "
+    "-mllvm -enable-machine-outliner=never -std=c++14 -fno-exceptions "
+    "-fno-rtti -c ../../content/renderer/render_frame_impl.cc "
+    "-o obj/content/renderer/renderer/render_frame_impl.o",
+};
+
+const std::vector<std::string> kVCCommands = {
+    "..\\..\\third_party\\llvm-build\\Release+Asserts\\bin\\clang-cl.exe "
+    "/nologo /showIncludes:user -imsvc..\\..\\third_party\\depot_tools\\"
+    "win_toolchain\\vs_files\\VC\\Tools\\MSVC\\14.16.27023\\include "
+    "-DUSE_AURA=1 -D_HAS_EXCEPTIONS=0 -DCOMPONENT_BUILD -D__STD_C "
+    "-D_CRT_RAND_S -D_CRT_SECURE_NO_DEPRECATE -D_SCL_SECURE_NO_DEPRECATE "
+    "-D_ATL_NO_OPENGL -D_WINDOWS -DCERT_CHAIN_PARA_HAS_EXTRA_FIELDS "
+    "-DPSAPI_VERSION=2 -DWIN32 -D_SECURE_ATL -D_USING_V110_SDK71_ "
+    "-DWINAPI_FAMILY=WINAPI_FAMILY_DESKTOP_APP -DWIN32_LEAN_AND_MEAN "
+    "-DNOMINMAX -D_UNICODE -DUNICODE -DNTDDI_VERSION=NTDDI_WIN10_RS2 "
+    "-D_WIN32_WINNT=0x0A00 -DWINVER=0x0A00 -D_DEBUG "
+    "-DDYNAMIC_ANNOTATIONS_ENABLED=1 -DBASE_IMPLEMENTATION -I../.. -Igen "
+    "/Gy /FS /bigobj /utf-8 /Zc:twoPhase /Zc:sizedDealloc- /X "
+    "-fcolor-diagnostics -fmerge-all-constants "
+    "-fcrash-diagnostics-dir=..\\..\\tools\\clang\\crashreports "
+    "-Xclang -mllvm -Xclang -instcombine-lower-dbg-declare=0 "
+    "-fcomplete-member-pointers /Gw -m64 /Brepro -Wno-builtin-macro-redefined "
+    "-D__DATE__= -D__TIME__= -D__TIMESTAMP__= -Xclang -fdebug-compilation-dir "
+    "-Xclang . /W4 -Wimplicit-fallthrough -Wunreachable-code "
+    "-Wthread-safety -Wextra-semi /WX /wd4091 /wd4127 /wd4251 /wd4275 "
+    "/wd4312 /wd4324 /wd4351 /wd4355 /wd4503 /wd4589 /wd4611 /wd4100 "
+    "/wd4121 /wd4244 /wd4505 /wd4510 /wd4512 /wd4610 /wd4838 /wd4995 "
+    "/wd4996 /wd4456 /wd4457 /wd4458 /wd4459 /wd4200 /wd4201 /wd4204 "
+    "/wd4221 /wd4245 /wd4267 /wd4305 /wd4389 /wd4702 /wd4701 /wd4703 "
+    "/wd4661 /wd4706 /wd4715 /Od /Ob0 /GF /Z7 /MDd "
+    "/TP /wd4577 /GR- /c ../../base/files/file_path.cc "
+    "/Foobj/base/base/file_path.obj /Fd\"obj/base/base_cc.pdb\"",
+};
+
+std::vector<std::vector<std::string>> SplitCommands(
+    const std::vector<std::string>& commands) {
+  std::vector<std::vector<std::string>> result;
+  for (const auto& command : commands) {
+    result.push_back(absl::StrSplit(command, ' ', absl::SkipEmpty()));
+  }
+  return result;
+}
+
+}  // anonymous namespace
+
+void BM_ParseGCCFlags(benchmark::State& state) {
+  const std::vector<std::vector<std::string>> corpus =
+      SplitCommands(kGCCCommands);
+  for (const auto& args : corpus) {
+    GCCFlags flags(args, "/home/goma/chromium/src/out/Release");
+    CHECK(flags.is_successful()) << flags.fail_message();
+  }
+
+  for (auto _ : state) {
+    (void)_;
+    for (const auto& args : corpus) {
+      GCCFlags flags(args, "/home/goma/chromium/src/out/Release");
+      benchmark::DoNotOptimize(flags.is_successful());
+    }
+  }
+
+  state.SetItemsProcessed(state.iterations() * corpus.size());
+}
+BENCHMARK(BM_ParseGCCFlags);
+
+void BM_ParseVCFlags(benchmark::State& state) {
+  const std::vector<std::vector<std::string>> corpus =
+      SplitCommands(kVCCommands);
+  for (const auto& args : corpus) {
+    VCFlags flags(args, "C:\\src\\chromium\\src\\out\\Release");
+    CHECK(flags.is_successful()) << flags.fail_message();
+  }
+
+  for (auto _ : state) {
+    (void)_;
+    for (const auto& args : corpus) {
+      VCFlags flags(args, "C:\\src\\chromium\\src\\out\\Release");
+      benchmark::DoNotOptimize(flags.is_successful());
+    }
+  }
+
+  state.SetItemsProcessed(state.iterations() * corpus.size());
+}
+BENCHMARK(BM_ParseVCFlags);
+
+}  // namespace devtools_goma
+
+BENCHMARK_MAIN();
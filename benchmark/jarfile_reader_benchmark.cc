@@ -0,0 +1,165 @@
+// Copyright 2021 The Goma Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <algorithm>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "absl/strings/str_format.h"
+#include "benchmark/benchmark.h"
+#include "file_reader.h"
+#include "glog/logging.h"
+#include "jarfile_reader.h"
+#include "scoped_fd.h"
+#include "unittest_util.h"
+
+namespace devtools_goma {
+
+namespace {
+
+void PutUInt16(uint16_t v, std::string* s) {
+  s->push_back(static_cast<char>(v & 0xff));
+  s->push_back(static_cast<char>(v >> 8));
+}
+
+void PutUInt32(uint32_t v, std::string* s) {
+  PutUInt16(static_cast<uint16_t>(v & 0xffff), s);
+  PutUInt16(static_cast<uint16_t>(v >> 16), s);
+}
+
+// Appends a local file header (if |local_offset| < 0) or a central
+// directory file header of a stored entry to |s|.
+void PutHeader(const std::string& name,
+               const std::string& extra,
+               uint32_t size,
+               int64_t local_offset,
+               std::string* s) {
+  const bool is_local = local_offset < 0;
+  PutUInt32(is_local ? 0x04034b50 : 0x02014b50, s);
+  if (!is_local) {
+    PutUInt16(20, s);  // version made by
+  }
+  PutUInt16(20, s);      // version needed to extract
+  PutUInt16(0, s);       // flags
+  PutUInt16(0, s);       // compression method: stored
+  PutUInt16(0x6000, s);  // last mod file time
+  PutUInt16(0x5234, s);  // last mod file date
+  PutUInt32(0, s);       // crc-32
+  PutUInt32(size, s);    // compressed size
+  PutUInt32(size, s);    // uncompressed size
+  PutUInt16(static_cast<uint16_t>(name.size()), s);
+  PutUInt16(static_cast<uint16_t>(extra.size()), s);
+  if (!is_local) {
+    PutUInt16(0, s);  // file comment length
+    PutUInt16(0, s);  // disk number start
+    PutUInt16(0, s);  // internal file attributes
+    PutUInt32(0, s);  // external file attributes
+    PutUInt32(static_cast<uint32_t>(local_offset), s);
+  }
+  s->append(name);
+  s->append(extra);
+}
+
+// Creates a jar file of about |total_size| bytes at |path|, which has
+// stored entries of |entry_size| bytes.
+// Returns the file size.
+size_t CreateJarFile(const std::string& path,
+                     size_t total_size,
+                     size_t entry_size) {
+  ScopedFd fd(ScopedFd::Create(path, 0644));
+  CHECK(fd.valid()) << path;
+
+  std::mt19937 gen(0);
+  std::string body(entry_size, '\0');
+  for (auto& c : body) {
+    c = static_cast<char>(gen());
+  }
+
+  struct Entry {
+    std::string name;
+    std::string extra;
+    uint32_t offset;
+  };
+  std::vector<Entry> entries;
+  // The first entry has the jar file magic (0xcafe) in its extra field.
+  entries.push_back(Entry{"META-INF/", std::string("\xfe\xca\0\0", 4), 0});
+  for (size_t i = 0; entries.size() * entry_size < total_size; ++i) {
+    entries.push_back(Entry{absl::StrFormat("com/example/C%d.class", i), "",
+                            0});
+  }
+
+  size_t offset = 0;
+  std::string buf;
+  for (auto& entry : entries) {
+    const uint32_t size =
+        entry.name.back() == '/' ? 0 : static_cast<uint32_t>(body.size());
+    entry.offset = static_cast<uint32_t>(offset);
+    buf.clear();
+    PutHeader(entry.name, entry.extra, size, -1, &buf);
+    buf.append(body, 0, size);
+    CHECK_EQ(static_cast<ssize_t>(buf.size()),
+             fd.Write(buf.data(), buf.size()));
+    offset += buf.size();
+  }
+
+  const size_t central_directory_offset = offset;
+  buf.clear();
+  for (const auto& entry : entries) {
+    const uint32_t size =
+        entry.name.back() == '/' ? 0 : static_cast<uint32_t>(body.size());
+    PutHeader(entry.name, entry.extra, size, entry.offset, &buf);
+  }
+  // End of central directory record.
+  PutUInt32(0x06054b50, &buf);
+  PutUInt16(0, &buf);
+  PutUInt16(0, &buf);
+  PutUInt16(static_cast<uint16_t>(entries.size()), &buf);
+  PutUInt16(static_cast<uint16_t>(entries.size()), &buf);
+  PutUInt32(static_cast<uint32_t>(buf.size() - 12), &buf);
+  PutUInt32(static_cast<uint32_t>(central_directory_offset), &buf);
+  PutUInt16(0, &buf);
+  CHECK_EQ(static_cast<ssize_t>(buf.size()),
+           fd.Write(buf.data(), buf.size()));
+  return offset + buf.size();
+}
+
+void BM_JarFileReaderRead(benchmark::State& state) {
+  JarFileReader::Register();
+
+  TmpdirUtil tmpdir("jarfile_reader_benchmark");
+  tmpdir.SetCwd("");
+  const std::string path = tmpdir.FullPath("bench.jar");
+  const size_t file_size =
+      CreateJarFile(path, state.range(0) * 1024 * 1024, 64 * 1024);
+
+  // Same as the chunk size used to upload file blobs.
+  std::vector<char> buf(2 * 1024 * 1024);
+  for (auto _ : state) {
+    (void)_;
+    std::unique_ptr<FileReader> reader(
+        FileReaderFactory::GetInstance()->NewFileReader(path));
+    CHECK(reader->valid());
+    size_t remaining = file_size;
+    while (remaining > 0) {
+      ssize_t n = reader->Read(buf.data(), std::min(remaining, buf.size()));
+      CHECK_GT(n, 0);
+      remaining -= n;
+    }
+  }
+
+  state.SetBytesProcessed(state.iterations() * file_size);
+}
+
+BENCHMARK(BM_JarFileReaderRead)
+    ->Arg(16)
+    ->Arg(500)
+    ->Unit(benchmark::kMillisecond);
+
+}  // namespace
+
+}  // namespace devtools_goma
+
+BENCHMARK_MAIN();
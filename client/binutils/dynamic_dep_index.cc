@@ -0,0 +1,166 @@
+// Copyright 2021 The Goma Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "dynamic_dep_index.h"
+
+#include <utility>
+
+#include "compiler_proxy_info.h"
+#include "compiler_specific.h"
+#include "counterz.h"
+#include "glog/logging.h"
+#include "proto_util.h"
+
+#ifdef __linux__
+#include "client/binutils/elf_parser.h"
+#endif
+
+MSVC_PUSH_DISABLE_WARNING_FOR_PROTO()
+#include "client/dynamic_dep_index_data.pb.h"
+MSVC_POP_WARNING()
+
+namespace devtools_goma {
+
+DynamicDepIndex* DynamicDepIndex::instance_;
+
+// static
+void DynamicDepIndex::Init(size_t max_entries, std::string cache_filename) {
+  instance_ = new DynamicDepIndex(max_entries, std::move(cache_filename));
+}
+
+// static
+void DynamicDepIndex::LoadIfEnabled() {
+  if (instance_ != nullptr && instance_->cache_file_.Enabled()) {
+    instance_->Load();
+  }
+}
+
+// static
+void DynamicDepIndex::Quit() {
+  delete instance_;
+  instance_ = nullptr;
+}
+
+// static
+bool DynamicDepIndex::ReadElfDynamicNeededAndRpath(
+    const std::string& abs_path,
+    std::vector<std::string>* needed,
+    std::vector<std::string>* rpaths) {
+#ifdef __linux__
+  FileStat file_stat;
+  if (IsEnabled()) {
+    file_stat = FileStat(abs_path);
+    Deps deps;
+    if (instance()->Lookup(abs_path, file_stat, &deps)) {
+      *needed = std::move(deps.needed);
+      *rpaths = std::move(deps.rpaths);
+      return true;
+    }
+  }
+
+  std::unique_ptr<ElfParser> elf(ElfParser::NewElfParser(abs_path));
+  if (elf == nullptr) {
+    return false;
+  }
+  if (!elf->ReadDynamicNeededAndRpath(needed, rpaths)) {
+    return false;
+  }
+  if (IsEnabled()) {
+    instance()->Insert(abs_path, file_stat, Deps{*needed, *rpaths});
+  }
+  return true;
+#else
+  LOG(ERROR) << "ELF is not supported on this platform: " << abs_path;
+  return false;
+#endif
+}
+
+DynamicDepIndex::DynamicDepIndex(size_t max_entries,
+                                 std::string cache_filename)
+    : cache_file_(std::move(cache_filename)),
+      entries_("dynamic deps", max_entries) {}
+
+DynamicDepIndex::~DynamicDepIndex() {
+  if (cache_file_.Enabled()) {
+    Save();
+  }
+}
+
+bool DynamicDepIndex::Lookup(const std::string& key,
+                             const FileStat& file_stat,
+                             Deps* deps) {
+  GOMA_COUNTERZ("DynamicDepIndex::Lookup");
+  return entries_.Lookup(key, file_stat, deps);
+}
+
+bool DynamicDepIndex::Insert(const std::string& key,
+                             const FileStat& file_stat,
+                             Deps deps) {
+  return entries_.Insert(key, file_stat, std::move(deps));
+}
+
+bool DynamicDepIndex::Load() {
+  LOG(INFO) << "loading from " << cache_file_.filename();
+
+  DynamicDepIndexData data;
+  if (!cache_file_.Load(&data)) {
+    LOG(ERROR) << "failed to load cache file " << cache_file_.filename();
+    return false;
+  }
+  if (data.built_revision() != kBuiltRevisionString) {
+    LOG(WARNING) << "loaded from " << cache_file_.filename()
+                 << " mismatch built_revision: got=" << data.built_revision()
+                 << " want=" << kBuiltRevisionString;
+    return false;
+  }
+
+  for (auto& data_entry : *data.mutable_entries()) {
+    FileStat file_stat;
+    file_stat.mtime = ProtoToTime(data_entry.mtime());
+    file_stat.size = data_entry.size();
+    Deps deps;
+    deps.needed.assign(
+        std::make_move_iterator(data_entry.mutable_needed()->begin()),
+        std::make_move_iterator(data_entry.mutable_needed()->end()));
+    deps.rpaths.assign(
+        std::make_move_iterator(data_entry.mutable_rpaths()->begin()),
+        std::make_move_iterator(data_entry.mutable_rpaths()->end()));
+    entries_.InsertUnchecked(data_entry.key(), file_stat, std::move(deps));
+  }
+  LOG(INFO) << "loaded from " << cache_file_.filename()
+            << " entries=" << entries_.size();
+  return true;
+}
+
+bool DynamicDepIndex::Save() const {
+  LOG(INFO) << "saving to " << cache_file_.filename();
+
+  DynamicDepIndexData data;
+  data.set_built_revision(kBuiltRevisionString);
+  // Entries are saved from the least recently used, so that Load keeps
+  // the order.
+  entries_.ForEach([&data](const std::string& key, const FileStat& file_stat,
+                           const Deps& deps) {
+    DynamicDepIndexData::Entry* data_entry = data.add_entries();
+    data_entry->set_key(key);
+    *data_entry->mutable_mtime() = TimeToProto(*file_stat.mtime);
+    data_entry->set_size(file_stat.size);
+    for (const auto& needed : deps.needed) {
+      data_entry->add_needed(needed);
+    }
+    for (const auto& rpath : deps.rpaths) {
+      data_entry->add_rpaths(rpath);
+    }
+  });
+
+  if (!cache_file_.Save(data)) {
+    LOG(ERROR) << "failed to save cache file " << cache_file_.filename();
+    return false;
+  }
+  LOG(INFO) << "saved to " << cache_file_.filename()
+            << " entries=" << data.entries_size();
+  return true;
+}
+
+}  // namespace devtools_goma
@@ -0,0 +1,89 @@
+// Copyright 2021 The Goma Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef DEVTOOLS_GOMA_CLIENT_BINUTILS_DYNAMIC_DEP_INDEX_H_
+#define DEVTOOLS_GOMA_CLIENT_BINUTILS_DYNAMIC_DEP_INDEX_H_
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "basictypes.h"
+#include "cache_file.h"
+#include "file_stat.h"
+#include "file_stat_lru_cache.h"
+
+namespace devtools_goma {
+
+class DynamicDepIndexData;
+
+// DynamicDepIndex keeps dynamic dependencies of binaries, i.e. libraries
+// needed by ELF or Mach-O files, so that computing the dependency closure of
+// a linker input or a compiler doesn't need to parse the same shared
+// libraries again.
+//
+// An entry is identified by a key, which is the absolute path of the binary
+// (prefixed by the architecture for Mach-O), and is validated by FileStat of
+// the binary. The index is optionally saved in a cache file, and loaded by
+// the next compiler_proxy.
+class DynamicDepIndex {
+ public:
+  struct Deps {
+    // Libraries needed by the binary, e.g. DT_NEEDED of ELF.
+    std::vector<std::string> needed;
+    // Library search paths embedded in the binary, e.g. DT_RUNPATH or
+    // DT_RPATH of ELF.
+    std::vector<std::string> rpaths;
+  };
+
+  static DynamicDepIndex* instance() { return instance_; }
+  static bool IsEnabled() { return instance_ != nullptr; }
+
+  // Initializes DynamicDepIndex.
+  // If the number of entries exceeds |max_entries|, the least recently used
+  // entry will be evicted.
+  // If |cache_filename| is not empty, the index is loaded from it by
+  // LoadIfEnabled, and saved to it in Quit.
+  static void Init(size_t max_entries, std::string cache_filename);
+  static void LoadIfEnabled();
+  static void Quit();
+
+  // Reads needed libraries and rpaths of ELF |abs_path|.
+  // Uses DynamicDepIndex if it is enabled.
+  // Returns false if |abs_path| is not a valid ELF file.
+  static bool ReadElfDynamicNeededAndRpath(const std::string& abs_path,
+                                           std::vector<std::string>* needed,
+                                           std::vector<std::string>* rpaths);
+
+  // Returns true and sets |deps| if |key| is in the index and
+  // |file_stat| is the same as when the entry was inserted.
+  bool Lookup(const std::string& key, const FileStat& file_stat, Deps* deps);
+
+  // Stores |deps| for |key|.
+  // Returns false if |file_stat| is not cacheable, e.g. the file might be
+  // modified while parsing.
+  bool Insert(const std::string& key, const FileStat& file_stat, Deps deps);
+
+  bool Load();
+  bool Save() const;
+
+  size_t size() const { return entries_.size(); }
+  int64_t hit() const { return entries_.hit(); }
+  int64_t miss() const { return entries_.miss(); }
+
+ private:
+  DynamicDepIndex(size_t max_entries, std::string cache_filename);
+  ~DynamicDepIndex();
+
+  static DynamicDepIndex* instance_;
+
+  const CacheFile cache_file_;
+  FileStatLruCache<Deps> entries_;
+
+  DISALLOW_COPY_AND_ASSIGN(DynamicDepIndex);
+};
+
+}  // namespace devtools_goma
+
+#endif  // DEVTOOLS_GOMA_CLIENT_BINUTILS_DYNAMIC_DEP_INDEX_H_
@@ -0,0 +1,79 @@
+// Copyright 2021 The Goma Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "dynamic_dep_index.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "client/unittest_util.h"
+#include "gtest/gtest.h"
+#include "path.h"
+
+namespace devtools_goma {
+
+class DynamicDepIndexTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    tmpdir_util_ = absl::make_unique<TmpdirUtil>("dynamic_dep_index");
+  }
+
+  void TearDown() override { DynamicDepIndex::Quit(); }
+
+  static DynamicDepIndex::Deps MakeDeps() {
+    DynamicDepIndex::Deps deps;
+    deps.needed = {"libfoo.so", "libc.so.6"};
+    deps.rpaths = {"$ORIGIN/../lib"};
+    return deps;
+  }
+
+  std::unique_ptr<TmpdirUtil> tmpdir_util_;
+};
+
+TEST_F(DynamicDepIndexTest, SaveAndLoad) {
+  const std::string index_file =
+      file::JoinPath(tmpdir_util_->tmpdir(), "dynamic_dep_index");
+  const std::string lib =
+      tmpdir_util_->CreateTmpFileWithOldMtime("libbar.so", "bar");
+
+  DynamicDepIndex::Init(10, index_file);
+  EXPECT_TRUE(
+      DynamicDepIndex::instance()->Insert(lib, FileStat(lib), MakeDeps()));
+  // Saved in Quit.
+  DynamicDepIndex::Quit();
+
+  DynamicDepIndex::Init(10, index_file);
+  DynamicDepIndex::LoadIfEnabled();
+  DynamicDepIndex* index = DynamicDepIndex::instance();
+  EXPECT_EQ(1U, index->size());
+  DynamicDepIndex::Deps deps;
+  ASSERT_TRUE(index->Lookup(lib, FileStat(lib), &deps));
+  EXPECT_EQ(std::vector<std::string>({"libfoo.so", "libc.so.6"}),
+            deps.needed);
+  EXPECT_EQ(std::vector<std::string>({"$ORIGIN/../lib"}), deps.rpaths);
+}
+
+#ifdef __linux__
+TEST_F(DynamicDepIndexTest, ReadElfDynamicNeededAndRpath) {
+  // Reads /proc/self/exe, which is this test binary.
+  std::vector<std::string> needed;
+  std::vector<std::string> rpaths;
+  ASSERT_TRUE(DynamicDepIndex::ReadElfDynamicNeededAndRpath(
+      "/proc/self/exe", &needed, &rpaths));
+  EXPECT_FALSE(needed.empty());
+
+  // The result should be the same with the index.
+  DynamicDepIndex::Init(10, "");
+  std::vector<std::string> indexed_needed;
+  std::vector<std::string> indexed_rpaths;
+  ASSERT_TRUE(DynamicDepIndex::ReadElfDynamicNeededAndRpath(
+      "/proc/self/exe", &indexed_needed, &indexed_rpaths));
+  EXPECT_EQ(needed, indexed_needed);
+  EXPECT_EQ(rpaths, indexed_rpaths);
+}
+#endif
+
+}  // namespace devtools_goma
@@ -10,6 +10,7 @@
 #include "absl/strings/match.h"
 #include "absl/strings/str_replace.h"
 #include "base/path.h"
+#include "client/binutils/dynamic_dep_index.h"
 #include "client/binutils/elf_parser.h"
 #include "glog/logging.h"
 #include "glog/stl_logging.h"
@@ -23,15 +24,15 @@ bool ElfDepParser::GetDeps(const absl::string_view cmd_or_lib,
                            absl::flat_hash_set<std::string>* deps) {
   const std::string abs_cmd_or_lib =
       file::JoinPathRespectAbsolute(cwd_, cmd_or_lib);
-  std::unique_ptr<ElfParser> ep = ElfParser::NewElfParser(abs_cmd_or_lib);
-  if (ep == nullptr) {
-    LOG(ERROR) << "failed to open ELF file."
-               << " abs_cmd_or_lib=" << abs_cmd_or_lib;
-    return false;
-  }
   std::vector<std::string> libs;
   std::vector<std::string> rpaths;
-  if (!ep->ReadDynamicNeededAndRpath(&libs, &rpaths)) {
+  if (!DynamicDepIndex::ReadElfDynamicNeededAndRpath(abs_cmd_or_lib, &libs,
+                                                     &rpaths)) {
+    if (!ElfParser::IsElf(abs_cmd_or_lib)) {
+      LOG(ERROR) << "failed to open ELF file."
+                 << " abs_cmd_or_lib=" << abs_cmd_or_lib;
+      return false;
+    }
     LOG(ERROR) << "failed to get libs and rpaths."
                << " abs_cmd_or_lib=" << abs_cmd_or_lib;
     return false;
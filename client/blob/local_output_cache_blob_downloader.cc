@@ -0,0 +1,46 @@
+// Copyright 2021 The Goma Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "blob/local_output_cache_blob_downloader.h"
+
+#include <utility>
+
+#include "file_helper.h"
+#include "glog/logging.h"
+#include "local_output_cache.h"
+
+namespace devtools_goma {
+
+LocalOutputCacheBlobDownloader::LocalOutputCacheBlobDownloader(
+    std::string content_file,
+    std::string trace_id)
+    : content_file_(std::move(content_file)),
+      trace_id_(std::move(trace_id)) {}
+
+bool LocalOutputCacheBlobDownloader::Download(const ExecResult_Output& output,
+                                              OutputFileInfo* info) {
+  if (!LocalOutputCache::IsEnabled()) {
+    LOG(ERROR) << trace_id_ << " LocalOutputCache is not enabled";
+    return false;
+  }
+  if (info->tmp_filename.empty()) {
+    // in-memory output.
+    if (!ReadFileToString(content_file_, &info->content)) {
+      return false;
+    }
+    if (static_cast<std::int64_t>(info->content.size()) !=
+        output.blob().file_size()) {
+      LOG(ERROR) << trace_id_ << " unexpected content size:"
+                 << " path=" << content_file_
+                 << " size=" << info->content.size()
+                 << " want=" << output.blob().file_size();
+      return false;
+    }
+    return true;
+  }
+  return LocalOutputCache::instance()->MaterializeOutput(
+      content_file_, info->tmp_filename, info->mode, trace_id_);
+}
+
+}  // namespace devtools_goma
@@ -0,0 +1,39 @@
+// Copyright 2021 The Goma Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef DEVTOOLS_GOMA_CLIENT_BLOB_LOCAL_OUTPUT_CACHE_BLOB_DOWNLOADER_H_
+#define DEVTOOLS_GOMA_CLIENT_BLOB_LOCAL_OUTPUT_CACHE_BLOB_DOWNLOADER_H_
+
+#include <string>
+
+#include "goma_blob.h"
+
+namespace devtools_goma {
+
+// LocalOutputCacheBlobDownloader materializes an output found by
+// LocalOutputCache::Lookup() from its content file, without network access.
+// The content file is cloned to the output file if possible.
+class LocalOutputCacheBlobDownloader : public BlobClient::Downloader {
+ public:
+  LocalOutputCacheBlobDownloader(std::string content_file,
+                                 std::string trace_id);
+  ~LocalOutputCacheBlobDownloader() override = default;
+
+  bool Download(const ExecResult_Output& output, OutputFileInfo* info) override;
+
+  int num_rpc() const override { return 0; }
+
+  const HttpClient::Status& http_status() const override {
+    return http_status_;
+  }
+
+ private:
+  const std::string content_file_;
+  const std::string trace_id_;
+  HttpClient::Status http_status_;
+};
+
+}  // namespace devtools_goma
+
+#endif  // DEVTOOLS_GOMA_CLIENT_BLOB_LOCAL_OUTPUT_CACHE_BLOB_DOWNLOADER_H_
@@ -15,10 +15,17 @@ namespace modulemap {
 Cache* Cache::instance_;
 
 // static
-void Cache::Init(size_t cache_size) {
+void Cache::Init(size_t cache_size, std::string cache_filename) {
   CHECK(instance_ == nullptr)
       << "modulemap::Cache has already been initialized?";
-  instance_ = new Cache(cache_size);
+  instance_ = new Cache(cache_size, std::move(cache_filename));
+}
+
+// static
+void Cache::LoadIfEnabled() {
+  if (instance_ != nullptr && instance_->parsed_cache_.cache_file().Enabled()) {
+    instance_->parsed_cache_.Load();
+  }
 }
 
 // static
@@ -28,6 +35,16 @@ void Cache::Quit() {
   instance_ = nullptr;
 }
 
+Cache::Cache(size_t max_cache_entries, std::string cache_filename)
+    : max_cache_entries_(max_cache_entries),
+      parsed_cache_(max_cache_entries, std::move(cache_filename)) {}
+
+Cache::~Cache() {
+  if (parsed_cache_.cache_file().Enabled()) {
+    parsed_cache_.Save();
+  }
+}
+
 size_t Cache::size() const {
   AUTO_SHARED_LOCK(lock, &mu_);
   return cache_.size();
@@ -81,7 +98,7 @@ bool Cache::AddModuleMapFileAndDependents(const std::string& module_map_file,
 
   // If cache is not found or invalidated, we just run the processor, and keep
   // the result.
-  Processor processor(cwd, file_stat_cache);
+  Processor processor(cwd, file_stat_cache, &parsed_cache_);
   if (!processor.AddModuleMapFile(module_map_file)) {
     return false;
   }
@@ -14,16 +14,23 @@
 #include "client/file_stat.h"
 #include "client/linked_unordered_map.h"
 #include "lockhelper.h"
+#include "parsed_module_map_cache.h"
 #include "processor.h"
 
 namespace devtools_goma {
 namespace modulemap {
 
 // Cache is a module map cache.
+// It also has ParsedModuleMapCache, so that a module map file is not parsed
+// again when it is used from another cwd, or by the next compiler_proxy if
+// the cache file is given.
 // Thread-safe.
 class Cache {
  public:
-  static void Init(size_t max_cache_entries);
+  // If |cache_filename| is not empty, parsed module map files are loaded
+  // from it by LoadIfEnabled, and saved to it in Quit.
+  static void Init(size_t max_cache_entries, std::string cache_filename);
+  static void LoadIfEnabled();
   static void Quit();
   static Cache* instance() { return instance_; }
 
@@ -48,6 +55,8 @@ class Cache {
   // Stat. Returns cache evicted count.
   std::int64_t cache_evicted() const { return cache_evicted_.value(); }
 
+  const ParsedModuleMapCache& parsed_cache() const { return parsed_cache_; }
+
  private:
   // Cache Key. Since a relative path is collected, we have to keep
   // cwd besides abs_module_map_file.
@@ -74,8 +83,8 @@ class Cache {
     std::string abs_module_map_file;
   };
 
-  explicit Cache(size_t max_cache_entries)
-      : max_cache_entries_(max_cache_entries) {}
+  Cache(size_t max_cache_entries, std::string cache_filename);
+  ~Cache();
 
   Cache(const Cache&) = delete;
   void operator=(const Cache&) = delete;
@@ -83,6 +92,7 @@ class Cache {
   static Cache* instance_;
 
   const size_t max_cache_entries_;
+  ParsedModuleMapCache parsed_cache_;
 
   mutable ReadWriteLock mu_;
   LinkedUnorderedMap<CacheKey, std::vector<CollectedModuleMapFile>> cache_
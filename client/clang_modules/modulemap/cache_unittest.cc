@@ -7,11 +7,10 @@
 #include <set>
 #include <string>
 
-#include "absl/time/clock.h"
-#include "absl/time/time.h"
 #include "autolock_timer.h"
 #include "client/unittest_util.h"
 #include "gtest/gtest.h"
+#include "path.h"
 
 namespace devtools_goma {
 namespace modulemap {
@@ -19,7 +18,7 @@ namespace modulemap {
 class ModuleMapCacheTest : public testing::Test {
  public:
   ModuleMapCacheTest() {
-    modulemap::Cache::Init(10);
+    modulemap::Cache::Init(10, "");
 
     tmpdir_util_ = absl::make_unique<TmpdirUtil>("modulemap-cache-unittest");
   }
@@ -27,32 +26,18 @@ class ModuleMapCacheTest : public testing::Test {
   ~ModuleMapCacheTest() { modulemap::Cache::Quit(); }
 
  protected:
-  std::string CreateTmpFileWithOldMtime(const std::string& content,
-                                        const std::string& name) {
-    tmpdir_util_->CreateTmpFile(name, content);
-
-    std::string path = tmpdir_util_->FullPath(name);
-
-    // Set old timestamp.
-    UpdateMtime(path.c_str(), absl::Now() - absl::Seconds(2));
-
-    return path;
-  }
-
   std::unique_ptr<TmpdirUtil> tmpdir_util_;
 };
 
 TEST_F(ModuleMapCacheTest, Basic) {
-  CreateTmpFileWithOldMtime(R"(
+  tmpdir_util_->CreateTmpFileWithOldMtime("foo.modulemap", R"(
 module foo {
   extern module bar "bar.modulemap"
-})",
-                            "foo.modulemap");
-  CreateTmpFileWithOldMtime(R"(
+})");
+  tmpdir_util_->CreateTmpFileWithOldMtime("bar.modulemap", R"(
 module bar {
   header "a.h"
-})",
-                            "bar.modulemap");
+})");
 
   EXPECT_EQ(0U, modulemap::Cache::instance()->cache_hit());
   EXPECT_EQ(0U, modulemap::Cache::instance()->cache_miss());
@@ -83,11 +68,10 @@ module bar {
   EXPECT_EQ(1U, modulemap::Cache::instance()->cache_miss());
 
   // Update bar.modulemap
-  CreateTmpFileWithOldMtime(R"(
+  tmpdir_util_->CreateTmpFileWithOldMtime("bar.modulemap", R"(
 module bar {
   header "ab.h"
-})",
-                            "bar.modulemap");
+})");
 
   {
     std::set<std::string> include_files;
@@ -105,23 +89,20 @@ module bar {
 TEST_F(ModuleMapCacheTest, Spill) {
   // Re-init with size 2.
   modulemap::Cache::Quit();
-  modulemap::Cache::Init(2);
+  modulemap::Cache::Init(2, "");
 
-  CreateTmpFileWithOldMtime(R"(
+  tmpdir_util_->CreateTmpFileWithOldMtime("foo.modulemap", R"(
 module foo {
   header "a.h"
-})",
-                            "foo.modulemap");
-  CreateTmpFileWithOldMtime(R"(
+})");
+  tmpdir_util_->CreateTmpFileWithOldMtime("bar.modulemap", R"(
 module bar {
   header "a.h"
-})",
-                            "bar.modulemap");
-  CreateTmpFileWithOldMtime(R"(
+})");
+  tmpdir_util_->CreateTmpFileWithOldMtime("baz.modulemap", R"(
 module baz {
   header "a.h"
-})",
-                            "baz.modulemap");
+})");
 
   EXPECT_EQ(0U, modulemap::Cache::instance()->cache_hit());
   EXPECT_EQ(0U, modulemap::Cache::instance()->cache_miss());
@@ -187,5 +168,87 @@ module baz {
   EXPECT_EQ(2U, modulemap::Cache::instance()->cache_evicted());
 }
 
+TEST_F(ModuleMapCacheTest, ParsedCacheIsSharedAcrossCwd) {
+  tmpdir_util_->CreateTmpFileWithOldMtime("mm/foo.modulemap", R"(
+module foo {
+  extern module bar "bar.modulemap"
+})");
+  tmpdir_util_->CreateTmpFileWithOldMtime("mm/bar.modulemap", R"(
+module bar {
+  header "a.h"
+})");
+
+  modulemap::Cache* cache = modulemap::Cache::instance();
+  {
+    std::set<std::string> include_files;
+    FileStatCache file_stat_cache;
+    EXPECT_TRUE(cache->AddModuleMapFileAndDependents(
+        "mm/foo.modulemap", tmpdir_util_->realcwd(), &include_files,
+        &file_stat_cache));
+    EXPECT_EQ(std::set<std::string>({"mm/foo.modulemap", "mm/bar.modulemap"}),
+              include_files);
+  }
+  EXPECT_EQ(0, cache->parsed_cache().hit());
+  EXPECT_EQ(2U, cache->parsed_cache().size());
+
+  // The same files from another cwd.
+  {
+    std::set<std::string> include_files;
+    FileStatCache file_stat_cache;
+    EXPECT_TRUE(cache->AddModuleMapFileAndDependents(
+        "../mm/foo.modulemap",
+        file::JoinPath(tmpdir_util_->realcwd(), "sub"), &include_files,
+        &file_stat_cache));
+    EXPECT_EQ(std::set<std::string>(
+                  {"../mm/foo.modulemap", "../mm/bar.modulemap"}),
+              include_files);
+  }
+  EXPECT_EQ(0U, cache->cache_hit());
+  EXPECT_EQ(2U, cache->cache_miss());
+  // Not parsed again.
+  EXPECT_EQ(2, cache->parsed_cache().hit());
+}
+
+TEST_F(ModuleMapCacheTest, SaveAndLoadParsedCache) {
+  const std::string cache_file =
+      file::JoinPath(tmpdir_util_->tmpdir(), "modulemap_cache");
+  tmpdir_util_->CreateTmpFileWithOldMtime("foo.modulemap", R"(
+module foo {
+  extern module bar "bar.modulemap"
+})");
+  tmpdir_util_->CreateTmpFileWithOldMtime("bar.modulemap", R"(
+module bar {
+  header "a.h"
+})");
+
+  modulemap::Cache::Quit();
+  modulemap::Cache::Init(10, cache_file);
+  {
+    std::set<std::string> include_files;
+    FileStatCache file_stat_cache;
+    EXPECT_TRUE(modulemap::Cache::instance()->AddModuleMapFileAndDependents(
+        "foo.modulemap", tmpdir_util_->realcwd(), &include_files,
+        &file_stat_cache));
+  }
+  // Saved in Quit.
+  modulemap::Cache::Quit();
+
+  modulemap::Cache::Init(10, cache_file);
+  modulemap::Cache::LoadIfEnabled();
+  modulemap::Cache* cache = modulemap::Cache::instance();
+  EXPECT_EQ(2U, cache->parsed_cache().size());
+  {
+    std::set<std::string> include_files;
+    FileStatCache file_stat_cache;
+    EXPECT_TRUE(cache->AddModuleMapFileAndDependents(
+        "foo.modulemap", tmpdir_util_->realcwd(), &include_files,
+        &file_stat_cache));
+    EXPECT_EQ(std::set<std::string>({"foo.modulemap", "bar.modulemap"}),
+              include_files);
+  }
+  EXPECT_EQ(1U, cache->cache_miss());
+  EXPECT_EQ(2, cache->parsed_cache().hit());
+}
+
 }  // namespace modulemap
 }  // namespace devtools_goma
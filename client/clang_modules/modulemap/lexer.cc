@@ -16,6 +16,9 @@ namespace modulemap {
 // static
 bool Lexer::Run(const Content& content, std::vector<Token>* tokens) {
   Lexer lexer(&content);
+  // Reserve roughly, since a token is usually longer than a few bytes,
+  // and reallocation dominates lexing time of a large module map.
+  tokens->reserve(tokens->size() + content.size() / 8);
   for (Token token = lexer.Next(); token.type() != Token::Type::END;
        token = lexer.Next()) {
     if (token.type() == Token::Type::INVALID) {
@@ -52,7 +55,9 @@ Token Lexer::Next() {
       if (pos_ == content_->buf_end()) {
         return Token::Invalid();
       }
-      return Token::String(std::string(begin, pos_++));
+      const absl::string_view value(begin, pos_ - begin);
+      ++pos_;  // skip '"'
+      return Token::String(value);
     }
 
     if (absl::ascii_isdigit(*pos_)) {
@@ -60,7 +65,7 @@ Token Lexer::Next() {
       const char* const end =
           std::find_if_not(begin, content_->buf_end(), absl::ascii_isdigit);
       pos_ = end;
-      return Token::Integer(std::string(begin, end));
+      return Token::Integer(absl::string_view(begin, end - begin));
     }
 
     if (absl::ascii_isalpha(*pos_) || *pos_ == '_') {
@@ -69,7 +74,7 @@ Token Lexer::Next() {
              (absl::ascii_isalnum(*pos_) || *pos_ == '_')) {
         ++pos_;
       }
-      return Token::Ident(std::string(begin, pos_));
+      return Token::Ident(absl::string_view(begin, pos_ - begin));
     }
 
     if (absl::StartsWith(rest_view(), "//")) {
@@ -3,10 +3,17 @@
 // found in the LICENSE file.
 //
 // A simple program to runs modulemap lexer and shows the result.
+//
+// Usage: modulemap_lexer <modulemap file> [<repeat>]
+// If <repeat> is given, runs lexer <repeat> times and shows the throughput
+// instead of tokens.
 
 #include <iostream>
 #include <string>
 
+#include "absl/strings/numbers.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
 #include "client/content.h"
 #include "lexer.h"
 #include "token.h"
@@ -28,6 +35,27 @@ int main(int argc, char* argv[]) {
     return 1;
   }
 
+  int repeat = 0;
+  if (argc >= 3 && !absl::SimpleAtoi(argv[2], &repeat)) {
+    LOG(ERROR) << "invalid repeat " << argv[2];
+    return 1;
+  }
+  if (repeat > 0) {
+    const absl::Time start = absl::Now();
+    for (int i = 0; i < repeat; ++i) {
+      std::vector<Token> tokens;
+      if (!Lexer::Run(*content, &tokens)) {
+        return 1;
+      }
+    }
+    const absl::Duration duration = (absl::Now() - start) / repeat;
+    std::cout << path << ": " << content->size() << " bytes "
+              << absl::FormatDuration(duration) << "/run "
+              << content->size() / absl::ToDoubleSeconds(duration) / 1e6
+              << " MB/s" << std::endl;
+    return 0;
+  }
+
   std::vector<Token> tokens;
   if (!Lexer::Run(*content, &tokens)) {
     return 1;
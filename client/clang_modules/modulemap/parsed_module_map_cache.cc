@@ -0,0 +1,99 @@
+// Copyright 2021 The Goma Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "parsed_module_map_cache.h"
+
+#include <utility>
+
+#include "compiler_proxy_info.h"
+#include "compiler_specific.h"
+#include "counterz.h"
+#include "glog/logging.h"
+#include "proto_util.h"
+
+MSVC_PUSH_DISABLE_WARNING_FOR_PROTO()
+#include "client/modulemap_cache_data.pb.h"
+MSVC_POP_WARNING()
+
+namespace devtools_goma {
+namespace modulemap {
+
+ParsedModuleMapCache::ParsedModuleMapCache(size_t max_entries,
+                                           std::string cache_filename)
+    : cache_file_(std::move(cache_filename)),
+      entries_("parsed module map", max_entries) {}
+
+bool ParsedModuleMapCache::Lookup(const std::string& abs_path,
+                                  const FileStat& file_stat,
+                                  std::vector<std::string>* extern_filenames) {
+  GOMA_COUNTERZ("ParsedModuleMapCache::Lookup");
+  return entries_.Lookup(abs_path, file_stat, extern_filenames);
+}
+
+bool ParsedModuleMapCache::Insert(const std::string& abs_path,
+                                  const FileStat& file_stat,
+                                  std::vector<std::string> extern_filenames) {
+  return entries_.Insert(abs_path, file_stat, std::move(extern_filenames));
+}
+
+bool ParsedModuleMapCache::Load() {
+  LOG(INFO) << "loading from " << cache_file_.filename();
+
+  ModuleMapCacheData data;
+  if (!cache_file_.Load(&data)) {
+    LOG(ERROR) << "failed to load cache file " << cache_file_.filename();
+    return false;
+  }
+  if (data.built_revision() != kBuiltRevisionString) {
+    LOG(WARNING) << "loaded from " << cache_file_.filename()
+                 << " mismatch built_revision: got=" << data.built_revision()
+                 << " want=" << kBuiltRevisionString;
+    return false;
+  }
+
+  for (auto& data_entry : *data.mutable_entries()) {
+    FileStat file_stat;
+    file_stat.mtime = ProtoToTime(data_entry.mtime());
+    file_stat.size = data_entry.size();
+    std::vector<std::string> extern_filenames(
+        std::make_move_iterator(data_entry.mutable_extern_filenames()->begin()),
+        std::make_move_iterator(data_entry.mutable_extern_filenames()->end()));
+    entries_.InsertUnchecked(data_entry.abs_path(), file_stat,
+                             std::move(extern_filenames));
+  }
+  LOG(INFO) << "loaded from " << cache_file_.filename()
+            << " entries=" << entries_.size();
+  return true;
+}
+
+bool ParsedModuleMapCache::Save() const {
+  LOG(INFO) << "saving to " << cache_file_.filename();
+
+  ModuleMapCacheData data;
+  data.set_built_revision(kBuiltRevisionString);
+  // Entries are saved from the least recently used, so that Load keeps
+  // the order.
+  entries_.ForEach([&data](const std::string& abs_path,
+                           const FileStat& file_stat,
+                           const std::vector<std::string>& extern_filenames) {
+    ModuleMapCacheData::Entry* data_entry = data.add_entries();
+    data_entry->set_abs_path(abs_path);
+    *data_entry->mutable_mtime() = TimeToProto(*file_stat.mtime);
+    data_entry->set_size(file_stat.size);
+    for (const auto& extern_filename : extern_filenames) {
+      data_entry->add_extern_filenames(extern_filename);
+    }
+  });
+
+  if (!cache_file_.Save(data)) {
+    LOG(ERROR) << "failed to save cache file " << cache_file_.filename();
+    return false;
+  }
+  LOG(INFO) << "saved to " << cache_file_.filename()
+            << " entries=" << data.entries_size();
+  return true;
+}
+
+}  // namespace modulemap
+}  // namespace devtools_goma
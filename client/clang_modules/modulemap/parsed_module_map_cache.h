@@ -0,0 +1,64 @@
+// Copyright 2021 The Goma Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef DEVTOOLS_GOMA_CLIENT_CLANG_MODULES_MODULEMAP_PARSED_MODULE_MAP_CACHE_H_
+#define DEVTOOLS_GOMA_CLIENT_CLANG_MODULES_MODULEMAP_PARSED_MODULE_MAP_CACHE_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "client/cache_file.h"
+#include "client/file_stat.h"
+#include "client/file_stat_lru_cache.h"
+
+namespace devtools_goma {
+namespace modulemap {
+
+// ParsedModuleMapCache keeps the result of parsing module map files, i.e.
+// file names of `extern module` declarations, which is all Processor needs
+// from a module map file.
+// Unlike Cache, an entry is keyed by the absolute path only, since the
+// result doesn't depend on cwd. It is validated by FileStat of the file.
+// Thread-safe.
+class ParsedModuleMapCache {
+ public:
+  // If |cache_filename| is not empty, the cache can be loaded from and
+  // saved to it.
+  ParsedModuleMapCache(size_t max_entries, std::string cache_filename);
+
+  ParsedModuleMapCache(const ParsedModuleMapCache&) = delete;
+  void operator=(const ParsedModuleMapCache&) = delete;
+
+  // Returns true and sets |extern_filenames| if |abs_path| was parsed
+  // when its FileStat was |file_stat|.
+  bool Lookup(const std::string& abs_path,
+              const FileStat& file_stat,
+              std::vector<std::string>* extern_filenames);
+
+  // Stores |extern_filenames| parsed from |abs_path|.
+  // Returns false if |file_stat| is not cacheable, e.g. the file might be
+  // modified while parsing.
+  bool Insert(const std::string& abs_path,
+              const FileStat& file_stat,
+              std::vector<std::string> extern_filenames);
+
+  bool Load();
+  bool Save() const;
+
+  const CacheFile& cache_file() const { return cache_file_; }
+
+  size_t size() const { return entries_.size(); }
+  std::int64_t hit() const { return entries_.hit(); }
+  std::int64_t miss() const { return entries_.miss(); }
+
+ private:
+  const CacheFile cache_file_;
+  FileStatLruCache<std::vector<std::string>> entries_;
+};
+
+}  // namespace modulemap
+}  // namespace devtools_goma
+
+#endif  // DEVTOOLS_GOMA_CLIENT_CLANG_MODULES_MODULEMAP_PARSED_MODULE_MAP_CACHE_H_
@@ -0,0 +1,60 @@
+// Copyright 2021 The Goma Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "parsed_module_map_cache.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "client/unittest_util.h"
+#include "gtest/gtest.h"
+#include "path.h"
+
+namespace devtools_goma {
+namespace modulemap {
+
+class ParsedModuleMapCacheTest : public testing::Test {
+ public:
+  ParsedModuleMapCacheTest() {
+    tmpdir_util_ = absl::make_unique<TmpdirUtil>("parsed_module_map_cache");
+  }
+
+ protected:
+  std::unique_ptr<TmpdirUtil> tmpdir_util_;
+};
+
+TEST_F(ParsedModuleMapCacheTest, SaveAndLoad) {
+  const std::string cache_file =
+      file::JoinPath(tmpdir_util_->tmpdir(), "parsed_module_map_cache");
+  const std::string foo =
+      tmpdir_util_->CreateTmpFileWithOldMtime("foo.modulemap", "module foo {}");
+  const std::string bar =
+      tmpdir_util_->CreateTmpFileWithOldMtime("bar.modulemap", "module bar {}");
+
+  {
+    ParsedModuleMapCache cache(10, cache_file);
+    EXPECT_TRUE(cache.Insert(foo, FileStat(foo), {"a.modulemap"}));
+    EXPECT_TRUE(cache.Insert(bar, FileStat(bar), {}));
+    EXPECT_TRUE(cache.Save());
+  }
+
+  ParsedModuleMapCache cache(2, cache_file);
+  EXPECT_TRUE(cache.Load());
+  EXPECT_EQ(2U, cache.size());
+  std::vector<std::string> extern_filenames;
+  ASSERT_TRUE(cache.Lookup(foo, FileStat(foo), &extern_filenames));
+  EXPECT_EQ(std::vector<std::string>({"a.modulemap"}), extern_filenames);
+  ASSERT_TRUE(cache.Lookup(bar, FileStat(bar), &extern_filenames));
+  EXPECT_TRUE(extern_filenames.empty());
+
+  // Modified after saved.
+  tmpdir_util_->CreateTmpFileWithOldMtime("foo.modulemap",
+                                          "module foo { header \"a.h\" }");
+  EXPECT_FALSE(cache.Lookup(foo, FileStat(foo), &extern_filenames));
+}
+
+}  // namespace modulemap
+}  // namespace devtools_goma
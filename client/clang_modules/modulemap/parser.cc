@@ -53,7 +53,7 @@ bool Parser::Run(const std::vector<Token>& tokens, ModuleMap* module_map) {
 
 bool Parser::ParseIdent(std::string* ident) {
   if (current().type() == Token::Type::IDENT) {
-    *ident = current().value();
+    *ident = std::string(current().value());
     pos_ += 1;
     return true;
   }
@@ -63,7 +63,7 @@ bool Parser::ParseIdent(std::string* ident) {
 
 bool Parser::ParseString(std::string* s) {
   if (current().type() == Token::Type::STRING) {
-    *s = current().value();
+    *s = std::string(current().value());
     pos_ += 1;
     return true;
   }
@@ -73,7 +73,7 @@ bool Parser::ParseString(std::string* s) {
 
 bool Parser::ParseInteger(std::string* s) {
   if (current().type() == Token::Type::INTEGER) {
-    *s = current().value();
+    *s = std::string(current().value());
     pos_ += 1;
     return true;
   }
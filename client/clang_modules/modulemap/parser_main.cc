@@ -4,10 +4,17 @@
 //
 // A simple program to parse modulemap file.
 // This parses a modulemap file, and pretty-print it.
+//
+// Usage: modulemap_parser <modulemap file> [<repeat>]
+// If <repeat> is given, runs lexer and parser <repeat> times and shows
+// the throughput instead of the module map.
 
 #include <iostream>
 #include <string>
 
+#include "absl/strings/numbers.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
 #include "client/content.h"
 #include "lexer.h"
 #include "parser.h"
@@ -31,6 +38,29 @@ int main(int argc, char* argv[]) {
     LOG(ERROR) << "failed to open/read " << path;
     return 1;
   }
+  int repeat = 0;
+  if (argc >= 3 && !absl::SimpleAtoi(argv[2], &repeat)) {
+    LOG(ERROR) << "invalid repeat " << argv[2];
+    return 1;
+  }
+  if (repeat > 0) {
+    const absl::Time start = absl::Now();
+    for (int i = 0; i < repeat; ++i) {
+      std::vector<Token> tokens;
+      ModuleMap module_map;
+      if (!Lexer::Run(*content, &tokens) ||
+          !Parser::Run(tokens, &module_map)) {
+        return 1;
+      }
+    }
+    const absl::Duration duration = (absl::Now() - start) / repeat;
+    std::cout << path << ": " << content->size() << " bytes "
+              << absl::FormatDuration(duration) << "/run "
+              << content->size() / absl::ToDoubleSeconds(duration) / 1e6
+              << " MB/s" << std::endl;
+    return 0;
+  }
+
   std::vector<Token> tokens;
   if (!Lexer::Run(*content, &tokens)) {
     return 1;
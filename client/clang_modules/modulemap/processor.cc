@@ -33,7 +33,33 @@ bool Processor::AddModuleMapFile(const absl::string_view module_map_file) {
                                            abs_module_map_file, stat);
   visited_abs_paths_.emplace(abs_module_map_file);
 
-  // Parse modulemap.
+  std::vector<std::string> extern_filenames;
+  if (parsed_cache_ == nullptr ||
+      !parsed_cache_->Lookup(abs_module_map_file, stat, &extern_filenames)) {
+    if (!ParseExternModuleMapFiles(abs_module_map_file, &extern_filenames)) {
+      return false;
+    }
+    if (parsed_cache_ != nullptr) {
+      parsed_cache_->Insert(abs_module_map_file, stat, extern_filenames);
+    }
+  }
+
+  absl::string_view module_map_dir = file::Dirname(module_map_file);
+  for (const auto& extern_filename : extern_filenames) {
+    std::string rel_path =
+        file::JoinPathRespectAbsolute(module_map_dir, extern_filename);
+    if (!AddModuleMapFile(rel_path)) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+// static
+bool Processor::ParseExternModuleMapFiles(
+    const std::string& abs_module_map_file,
+    std::vector<std::string>* extern_filenames) {
   std::unique_ptr<Content> content =
       Content::CreateFromFile(abs_module_map_file);
   if (!content) {
@@ -55,35 +81,24 @@ bool Processor::AddModuleMapFile(const absl::string_view module_map_file) {
     return false;
   }
 
-  absl::string_view module_map_dir = file::Dirname(module_map_file);
   for (const auto& module_decl : module_map.modules()) {
-    if (!AddExternMapduleMapFilesRecursively(module_decl, module_map_dir)) {
-      return false;
-    }
+    CollectExternFilenamesRecursively(module_decl, extern_filenames);
   }
-
   return true;
 }
 
-bool Processor::AddExternMapduleMapFilesRecursively(
+// static
+void Processor::CollectExternFilenamesRecursively(
     const Module& module_decl,
-    const absl::string_view module_map_dir) {
+    std::vector<std::string>* extern_filenames) {
   // If the module is `extern module` form, extern_filename exists.
   if (!module_decl.extern_filename().empty()) {
-    std::string rel_path = file::JoinPathRespectAbsolute(
-        module_map_dir, module_decl.extern_filename());
-    if (!AddModuleMapFile(rel_path)) {
-      return false;
-    }
+    extern_filenames->push_back(module_decl.extern_filename());
   }
 
   for (const auto& submodule : module_decl.submodules()) {
-    if (!AddExternMapduleMapFilesRecursively(submodule, module_map_dir)) {
-      return false;
-    }
+    CollectExternFilenamesRecursively(submodule, extern_filenames);
   }
-
-  return true;
 }
 
 }  // namespace modulemap
@@ -14,6 +14,7 @@
 #include "absl/time/time.h"
 #include "file_stat.h"
 #include "file_stat_cache.h"
+#include "parsed_module_map_cache.h"
 #include "type.h"
 
 namespace devtools_goma {
@@ -38,7 +39,15 @@ struct CollectedModuleMapFile {
 class Processor {
  public:
   Processor(std::string cwd, FileStatCache* file_stat_cache)
-      : cwd_(std::move(cwd)), file_stat_cache_(file_stat_cache) {}
+      : Processor(std::move(cwd), file_stat_cache, nullptr) {}
+  // If |parsed_cache| is not nullptr, it is used instead of parsing
+  // module map files, and module map files parsed are stored into it.
+  Processor(std::string cwd,
+            FileStatCache* file_stat_cache,
+            ParsedModuleMapCache* parsed_cache)
+      : cwd_(std::move(cwd)),
+        file_stat_cache_(file_stat_cache),
+        parsed_cache_(parsed_cache) {}
 
   Processor(const Processor&) = delete;
   void operator=(const Processor&) = delete;
@@ -63,12 +72,20 @@ class Processor {
   }
 
  private:
-  // Finds `extern module ...` from |module_decl|, and add them.
-  bool AddExternMapduleMapFilesRecursively(const Module& module_decl,
-                                           absl::string_view module_map_dir);
+  // Reads and parses |abs_module_map_file|, and lists file names of
+  // `extern module ...` in it.
+  static bool ParseExternModuleMapFiles(
+      const std::string& abs_module_map_file,
+      std::vector<std::string>* extern_filenames);
+
+  // Finds `extern module ...` from |module_decl|, and add their file names.
+  static void CollectExternFilenamesRecursively(
+      const Module& module_decl,
+      std::vector<std::string>* extern_filenames);
 
   const std::string cwd_;
   FileStatCache* file_stat_cache_;
+  ParsedModuleMapCache* parsed_cache_;
 
   std::vector<CollectedModuleMapFile> collected_module_map_files_;
   absl::flat_hash_set<std::string> visited_abs_paths_;
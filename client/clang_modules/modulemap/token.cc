@@ -7,6 +7,26 @@
 namespace devtools_goma {
 namespace modulemap {
 
+namespace {
+
+struct PuncTable {
+  PuncTable() {
+    for (int i = 0; i < 256; ++i) {
+      chars[i] = static_cast<char>(i);
+    }
+  }
+
+  char chars[256];
+};
+
+}  // namespace
+
+// static
+absl::string_view Token::PuncValue(char c) {
+  static const PuncTable* const table = new PuncTable();
+  return absl::string_view(&table->chars[static_cast<unsigned char>(c)], 1);
+}
+
 std::ostream& operator<<(std::ostream& os, const Token& token) {
   switch (token.type()) {
     case Token::Type::STRING:
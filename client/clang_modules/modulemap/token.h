@@ -16,6 +16,9 @@
 namespace devtools_goma {
 namespace modulemap {
 
+// Token refers to the buffer it was lexed from (e.g. Content given to
+// Lexer::Run) instead of owning its value, so the buffer must outlive
+// the token.
 class Token {
  public:
   enum class Type {
@@ -28,23 +31,25 @@ class Token {
   };
 
   // utility constructors. We provide only these ctors to users.
-  static Token Ident(std::string value) {
-    return Token(Type::IDENT, std::move(value));
+  static Token Ident(absl::string_view value) {
+    return Token(Type::IDENT, value);
   }
-  static Token String(std::string value) {
-    return Token(Type::STRING, std::move(value));
+  static Token String(absl::string_view value) {
+    return Token(Type::STRING, value);
   }
-  static Token Integer(std::string value) {
-    return Token(Type::INTEGER, std::move(value));
+  static Token Integer(absl::string_view value) {
+    return Token(Type::INTEGER, value);
+  }
+  static Token Punc(char c) { return Token(Type::PUNC, PuncValue(c)); }
+  static Token End() { return Token(Type::END, absl::string_view()); }
+  static Token Invalid() {
+    return Token(Type::INVALID, absl::string_view());
   }
-  static Token Punc(char c) { return Token(Type::PUNC, std::string(1, c)); }
-  static Token End() { return Token(Type::END, std::string()); }
-  static Token Invalid() { return Token(Type::INVALID, std::string()); }
 
   friend std::ostream& operator<<(std::ostream& os, const Token& token);
 
   Type type() const { return type_; }
-  const std::string& value() const { return value_; }
+  absl::string_view value() const { return value_; }
 
   bool IsIdent(absl::string_view ident) const {
     return type_ == Type::IDENT && value_ == ident;
@@ -72,10 +77,13 @@ class Token {
   }
 
  private:
-  Token(Type type, std::string value) : type_(type), value_(std::move(value)) {}
+  Token(Type type, absl::string_view value) : type_(type), value_(value) {}
+
+  // Returns a string_view of |c| in a static buffer.
+  static absl::string_view PuncValue(char c);
 
   Type type_;
-  std::string value_;
+  absl::string_view value_;
 };
 
 }  // namespace modulemap
@@ -29,6 +29,7 @@
 #include "compile_stats.h"
 #include "compile_task.h"
 #include "compiler_flags.h"
+#include "compiler_flags_template_cache.h"
 #include "compiler_proxy_histogram.h"
 #include "compiler_proxy_info.h"
 #include "cxx/include_processor/cpp_include_processor.h"
@@ -147,6 +148,7 @@ CompileService::CompileService(WorkerThreadManager* wm, int compiler_info_pool)
       compiler_info_pool_(wm_->StartPool(compiler_info_pool, "compiler_info")),
       file_hash_cache_(new FileHashCache),
       include_processor_pool_(WorkerThreadManager::kFreePool),
+      file_io_pool_(WorkerThreadManager::kFreePool),
       histogram_(new CompilerProxyHistogram),
       new_file_threshold_duration_(absl::Minutes(1)),
       enable_gch_hack_(true),
@@ -220,6 +222,11 @@ void CompileService::SetMultiFileStore(
   multi_file_store_ = std::move(multi_file_store);
 }
 
+void CompileService::SetCompilerFlagsTemplateCache(
+    std::unique_ptr<CompilerFlagsTemplateCache> cache) {
+  compiler_flags_template_cache_ = std::move(cache);
+}
+
 void CompileService::SetFileServiceHttpClient(
     std::unique_ptr<FileServiceHttpClient> file_service) {
   blob_client_ = absl::make_unique<FileBlobClient>(std::move(file_service));
@@ -238,6 +245,15 @@ void CompileService::StartIncludeProcessorWorkers(int num_threads) {
             << " num_thread=" << num_threads;
 }
 
+void CompileService::StartFileIOWorkers(int num_threads) {
+  if (num_threads <= 0) {
+    return;
+  }
+  file_io_pool_ = wm_->StartPool(num_threads, "file_io");
+  LOG(INFO) << "file_io_pool=" << file_io_pool_
+            << " num_thread=" << num_threads;
+}
+
 void CompileService::SetLogServiceClient(
     std::unique_ptr<LogServiceClient> log_service_client) {
   log_service_client_ = std::move(log_service_client);
@@ -842,6 +858,10 @@ void CompileService::DumpStats(std::ostringstream* ss) {
           << std::endl
           << " gc_count=" << loc_stats.gc_count()
           << " gc_total_time_ms=" << loc_stats.gc_total_time_ms()
+          << std::endl
+          << " cloned_bytes=" << loc_stats.cloned_bytes()
+          << " copied_bytes=" << loc_stats.copied_bytes()
+          << " hardlinked_bytes=" << loc_stats.hardlinked_bytes()
           << std::endl;
     // TODO: Merge these to stats.
     if (LocalOutputCache::IsEnabled()) {
@@ -857,6 +877,18 @@ void CompileService::DumpStats(std::ostringstream* ss) {
             << std::endl;
     }
   }
+  if (gstats.has_compiler_flags_template_cache_stats()) {
+    const CompilerFlagsTemplateCacheStats& cftc_stats =
+        gstats.compiler_flags_template_cache_stats();
+    (*ss) << "compiler_flags_template_cache:"
+          << " entries=" << cftc_stats.entries()
+          << " hit=" << cftc_stats.hit()
+          << " miss=" << cftc_stats.miss()
+          << " uncacheable=" << cftc_stats.uncacheable()
+          << " verified=" << cftc_stats.verified()
+          << " verify_failure=" << cftc_stats.verify_failure()
+          << std::endl;
+  }
 
   (*ss) << "http_rpc:"
         << " query=" << gstats.http_rpc_stats().query()
@@ -1634,6 +1666,10 @@ void CompileService::DumpCommonStatsUnlocked(GomaStats* stats) {
       LocalOutputCache::instance()->DumpStatsToProto(
           stats->mutable_local_output_cache_stats());
     }
+    if (compiler_flags_template_cache_ != nullptr) {
+      compiler_flags_template_cache_->DumpStatsToProto(
+          stats->mutable_compiler_flags_template_cache_stats());
+    }
     http_rpc_->DumpStatsToProto(stats->mutable_http_rpc_stats());
     subprocess_option_setter_->DumpStatsToProto(
         stats->mutable_subprocess_stats());
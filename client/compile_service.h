@@ -39,6 +39,7 @@ namespace devtools_goma {
 class BlobClient;
 class CompileTask;
 class CompilerFlags;
+class CompilerFlagsTemplateCache;
 class CompilerProxyHistogram;
 class ExecReq;
 class ExecResp;
@@ -139,12 +140,29 @@ class CompileService {
       std::unique_ptr<FileServiceHttpClient> file_service);
   BlobClient* blob_client() const;
 
+  void SetCompilerFlagsTemplateCache(
+      std::unique_ptr<CompilerFlagsTemplateCache> cache);
+  // Returns nullptr if compiler flags template cache is disabled.
+  CompilerFlagsTemplateCache* compiler_flags_template_cache() const {
+    return compiler_flags_template_cache_.get();
+  }
+
   FileHashCache* file_hash_cache() const { return file_hash_cache_.get(); }
   CompilerProxyHistogram* histogram() const { return histogram_.get(); }
 
   void StartIncludeProcessorWorkers(int num_threads);
   int include_processor_pool() const { return include_processor_pool_; }
 
+  // Starts dedicated workers for blocking file I/O (input hashing, output
+  // download/commit and local output cache), so that worker threads
+  // servicing network descriptors are not stalled by slow disks.
+  // If not started, file I/O runs in kFreePool or on the task thread.
+  void StartFileIOWorkers(int num_threads);
+  int file_io_pool() const { return file_io_pool_; }
+  bool has_file_io_pool() const {
+    return file_io_pool_ != WorkerThreadManager::kFreePool;
+  }
+
   void SetLogServiceClient(
       std::unique_ptr<LogServiceClient> log_service_client);
   LogServiceClient* log_service() const { return log_service_client_.get(); }
@@ -467,6 +485,7 @@ class CompileService {
   std::unique_ptr<ExecServiceClient> exec_service_client_;
   std::unique_ptr<MultiFileStore> multi_file_store_;
   std::unique_ptr<BlobClient> blob_client_;
+  std::unique_ptr<CompilerFlagsTemplateCache> compiler_flags_template_cache_;
 
   std::unique_ptr<CompilerTypeSpecificCollection>
       compiler_type_specific_collection_;
@@ -482,6 +501,8 @@ class CompileService {
 
   int include_processor_pool_;
 
+  int file_io_pool_;
+
   std::unique_ptr<LogServiceClient> log_service_client_;
 
   std::unique_ptr<CompilerProxyHistogram> histogram_;
@@ -374,6 +374,13 @@ void CompileStats::DumpToJson(Json::Value* json,
     StoreDurationToJsonIfNotZero("output_file_rpc_resp_parse_time",
                                  this->output_file_rpc_resp_parse_time, json);
 
+    StoreDurationToJsonIfNotZero("file_io_wait_time", this->file_io_wait_time,
+                                 json);
+    StoreDurationToJsonIfNotZero("commit_output_time",
+                                 this->commit_output_time, json);
+    StoreDurationToJsonIfNotZero("local_output_cache_save_time",
+                                 this->local_output_cache_save_time, json);
+
     StoreDurationToJsonIfNotZero("rbe_execution_time",
                                  this->total_rbe_execution_time, json);
 
@@ -113,6 +113,12 @@ class CompileStats {
   absl::Duration file_response_time;
   absl::Duration output_file_time;
 
+  // in FINISHED.
+  // file_io_wait_time is time waiting for a thread in file I/O pool.
+  absl::Duration file_io_wait_time;
+  absl::Duration commit_output_time;
+  absl::Duration local_output_cache_save_time;
+
   // Total time elapsed for handling the request in compiler_proxy.
   absl::Duration handler_time;
 
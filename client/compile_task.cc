@@ -31,6 +31,7 @@
 #include "absl/strings/str_split.h"
 #include "absl/time/clock.h"
 #include "autolock_timer.h"
+#include "blob/local_output_cache_blob_downloader.h"
 #include "callback.h"
 #include "clang_tidy_flags.h"
 #include "compile_service.h"
@@ -38,6 +39,7 @@
 #include "compiler_flag_type_specific.h"
 #include "compiler_flags.h"
 #include "compiler_flags_parser.h"
+#include "compiler_flags_template_cache.h"
 #include "compiler_flags_util.h"
 #include "compiler_info.h"
 #include "compiler_proxy_info.h"
@@ -99,6 +101,16 @@ namespace {
 
 constexpr int kMaxExecRetry = 4;
 
+// Categories and tracks of trace events recorded by CompileTask.
+// A subprocess may run in parallel with remote execution, and input/output
+// files are processed in parallel, so they are not on the task track.
+constexpr char kTraceCategoryTask[] = "compile_task";
+constexpr char kTraceCategoryInclude[] = "include";
+constexpr char kTraceCategoryFile[] = "file";
+constexpr char kTraceCategorySubProcess[] = "subprocess";
+constexpr int kTraceTrackTask = 0;
+constexpr int kTraceTrackSubProcess = 1;
+
 std::string GetLastErrorMessage() {
   char error_message[1024];
 #ifndef _WIN32
@@ -183,7 +195,7 @@ std::string CreateCommandVersionString(const CommandSpec& spec) {
   return spec.name() + ' ' + spec.version() + " (" + spec.binary_hash() + ")";
 }
 
-std::string StateName(CompileTask::State state) {
+const char* StateName(CompileTask::State state) {
   static const char* names[] = {
     "INIT",
     "SETUP",
@@ -323,7 +335,9 @@ CompileTask::CompileTask(CompileService* service, int id)
   ss << "Task:" << id_;
   trace_id_ = ss.str();
 
-  stats_->exec_log.set_start_time(absl::ToTimeT(absl::Now()));
+  task_start_time_ = absl::Now();
+  state_start_time_ = task_start_time_;
+  stats_->exec_log.set_start_time(absl::ToTimeT(task_start_time_));
   stats_->exec_log.set_compiler_proxy_user_agent(kUserAgentString);
 }
 
@@ -584,7 +598,7 @@ void CompileTask::Start() {
     LOG(INFO) << trace_id_ << " GOMA_USE_LOCAL=false";
   }
   if (subproc_ != nullptr && ShouldStopGoma()) {
-    state_ = LOCAL_RUN;
+    SetState(LOCAL_RUN);
     stats_->exec_log.set_local_run_reason(
         "slow goma, local run started in INIT");
     return;
@@ -633,6 +647,13 @@ bool CompileTask::IsGomaccRunning() {
 }
 
 void CompileTask::GomaccClosed() {
+  DCHECK(BelongsToCurrentThread());
+  if (committing_output_in_pool_) {
+    // The file I/O pool owns this task. Handle it in ProcessReplyDone.
+    LOG(INFO) << trace_id_ << " gomacc closed while committing output";
+    gomacc_closed_while_committing_output_ = true;
+    return;
+  }
   LOG(INFO) << trace_id_ << " gomacc closed "
             << "at state=" << StateName(state_)
             << " subproc pid="
@@ -650,15 +671,38 @@ bool CompileTask::IsSubprocRunning() const {
       subproc_->started().pid() != SubProcessState::kInvalidPid;
 }
 
+void CompileTask::SetState(State state) {
+  if (TraceEventRecorder::IsEnabled()) {
+    const absl::Time now = absl::Now();
+    trace_events_.emplace_back(StateName(state_), kTraceCategoryTask,
+                               kTraceTrackTask, state_start_time_,
+                               now - state_start_time_);
+    state_start_time_ = now;
+  }
+  state_ = state;
+}
+
+void CompileTask::AddTraceEvent(const char* name,
+                                const char* category,
+                                int track,
+                                absl::Duration duration,
+                                std::string detail) {
+  if (!TraceEventRecorder::IsEnabled()) {
+    return;
+  }
+  trace_events_.emplace_back(name, category, track, absl::Now() - duration,
+                             duration, std::move(detail));
+}
+
 void CompileTask::ProcessSetup() {
   VLOG(1) << trace_id_ << " setup";
   CHECK(BelongsToCurrentThread());
   CHECK_EQ(INIT, state_);
   CHECK(!abort_);
   CHECK(!should_fallback_);
-  state_ = SETUP;
+  SetState(SETUP);
   if (ShouldStopGoma()) {
-    state_ = LOCAL_RUN;
+    SetState(LOCAL_RUN);
     stats_->exec_log.set_local_run_reason(
         "slow goma, local run started in SETUP");
     return;
@@ -705,10 +749,10 @@ void CompileTask::ProcessFileRequest() {
     ProcessFinished("canceled before file req");
     return;
   }
-  state_ = FILE_REQ;
+  SetState(FILE_REQ);
   if (ShouldStopGoma()) {
     ProcessPendingFileRequest();
-    state_ = LOCAL_RUN;
+    SetState(LOCAL_RUN);
     stats_->exec_log.set_local_run_reason(
         "slow goma, local run started in FILE_REQ");
     return;
@@ -848,8 +892,9 @@ void CompileTask::ProcessFileRequest() {
     return;
   }
   for (auto* closure : closures)
-    service_->wm()->RunClosure(
-        FROM_HERE, closure, WorkerThread::PRIORITY_LOW);
+    service_->wm()->RunClosureInPool(
+        FROM_HERE, service_->file_io_pool(), closure,
+        WorkerThread::PRIORITY_LOW);
 }
 
 namespace {
@@ -936,7 +981,7 @@ void CompileTask::ProcessFileRequestDone() {
     if (IsSubprocRunning()) {
       VLOG(1) << trace_id_ << " file request failed,"
               << " but subprocess running";
-      state_ = LOCAL_RUN;
+      SetState(LOCAL_RUN);
       stats_->exec_log.set_local_run_reason(
           "fail goma, local run started in FILE_REQ");
       return;
@@ -990,12 +1035,13 @@ void CompileTask::ProcessFileRequestDone() {
     local_output_cache_key_ = LocalOutputCache::MakeCacheKey(*req_);
     if (LocalOutputCache::instance()->Lookup(local_output_cache_key_,
                                              resp_.get(),
+                                             &local_output_cache_files_,
                                              trace_id_)) {
       LOG(INFO) << trace_id_ << " lookup succeeded";
       stats_->exec_log.set_cache_hit(true);
       stats_->exec_log.set_cache_source(ExecLog::LOCAL_OUTPUT_CACHE);
       ReleaseMemoryForExecReqInput(req_.get());
-      state_ = LOCAL_OUTPUT;
+      SetState(LOCAL_OUTPUT);
       ProcessFileResponse();
       return;
     }
@@ -1041,9 +1087,9 @@ void CompileTask::ProcessCallExec() {
   }
   CHECK(!requester_env_.verify_command().empty() ||
         req_->input_size() > 0) << trace_id_ << " call exec";
-  state_ = CALL_EXEC;
+  SetState(CALL_EXEC);
   if (ShouldStopGoma()) {
-    state_ = LOCAL_RUN;
+    SetState(LOCAL_RUN);
     stats_->exec_log.set_local_run_reason(
         "slow goma, local run started in CALL_EXEC");
     return;
@@ -1154,7 +1200,7 @@ void CompileTask::ProcessCallExecDone() {
       // If rpc was failed while receiving response, goma should retry Exec call
       // because the reponse will be replied from cache with high probability.
       LOG(WARNING) << trace_id_ << " goma failed, but subprocess running.";
-      state_ = LOCAL_RUN;
+      SetState(LOCAL_RUN);
       stats_->exec_log.set_local_run_reason(
           "fail goma, local run started in CALL_EXEC");
       return;
@@ -1210,7 +1256,7 @@ void CompileTask::ProcessCallExecDone() {
         LOG(INFO) << trace_id_ << " retry in CALL_EXEC";
         resp_->clear_error_message();
         resp_->clear_error();
-        state_ = FILE_REQ;
+        SetState(FILE_REQ);
         service_->wm()->RunClosureInThread(
             FROM_HERE,
             thread_id_,
@@ -1283,9 +1329,9 @@ void CompileTask::ProcessFileResponse() {
     ProcessFinished("canceled before file resp");
     return;
   }
-  state_ = FILE_RESP;
+  SetState(FILE_RESP);
   if (ShouldStopGoma()) {
-    state_ = LOCAL_RUN;
+    SetState(LOCAL_RUN);
     stats_->exec_log.set_local_run_reason(
         "slow goma, local run started in FILE_RESP");
     return;
@@ -1396,8 +1442,24 @@ void CompileTask::ProcessFileResponse() {
     auto* output_info = &output_file_infos_[i];
     output_info->filename = filename;
     bool try_acquire_output_buffer = want_in_memory_output;
+    const bool has_local_output_cache_file =
+        resp_->cache_hit() == ExecResp::LOCAL_OUTPUT_CACHE &&
+        static_cast<size_t>(i) < local_output_cache_files_.size() &&
+        !local_output_cache_files_[i].empty();
+    if (has_local_output_cache_file) {
+      // Clone cache file to output file rather than reading it in memory.
+      try_acquire_output_buffer = false;
+    }
     if (IsValidFileBlob(resp_->result().output(i).blob())) {
       output_info->size = resp_->result().output(i).blob().file_size();
+      if (resp_->result().output(i).blob().blob_type() ==
+          FileBlob::FILE_META) {
+        // Chunked output is streamed into the file chunk by chunk,
+        // so it doesn't need whole-file in-memory buffer.
+        VLOG(1) << trace_id_ << " output is chunked. stream to file:"
+                << filename << " size=" << output_info->size;
+        try_acquire_output_buffer = false;
+      }
     } else {
       LOG(ERROR) << trace_id_ << " output is invalid:"
                  << filename;
@@ -1432,9 +1494,16 @@ void CompileTask::ProcessFileResponse() {
               << " filename=" << filename
               << " mode=" << std::oct << output_info->mode;
     }
+    std::unique_ptr<BlobClient::Downloader> downloader;
+    if (has_local_output_cache_file) {
+      downloader = absl::make_unique<LocalOutputCacheBlobDownloader>(
+          local_output_cache_files_[i], trace_id_);
+    } else {
+      downloader =
+          service_->blob_client()->NewDownloader(requester_info_, trace_id_);
+    }
     std::unique_ptr<OutputFileTask> output_file_task(new OutputFileTask(
-        service_->wm(),
-        service_->blob_client()->NewDownloader(requester_info_, trace_id_),
+        service_->wm(), std::move(downloader),
         this, i, resp_->result().output(i), output_info));
 
     OutputFileTask* output_file_task_pointer = output_file_task.get();
@@ -1452,8 +1521,9 @@ void CompileTask::ProcessFileResponse() {
     MaybeRunOutputFileCallback(-1, false);
   } else {
     for (auto* closure : closures) {
-      service_->wm()->RunClosure(
-          FROM_HERE, closure, WorkerThread::PRIORITY_LOW);
+      service_->wm()->RunClosureInPool(
+          FROM_HERE, service_->file_io_pool(), closure,
+          WorkerThread::PRIORITY_LOW);
     }
   }
 }
@@ -1483,7 +1553,7 @@ void CompileTask::ProcessFileResponseDone() {
           IsSubprocRunning()) {
         VLOG(1) << trace_id_ << " failed to process file response,"
                 << " but subprocess running";
-        state_ = LOCAL_RUN;
+        SetState(LOCAL_RUN);
         stats_->exec_log.set_local_run_reason(
             "fail goma, local run started in FILE_RESP");
         return;
@@ -1598,12 +1668,12 @@ void CompileTask::ProcessFinished(const std::string& msg) {
     CHECK(subproc_ == nullptr);
     CHECK(delayed_setup_subproc_ == nullptr);
     CHECK(!abort_);
-    state_ = FINISHED;
+    SetState(FINISHED);
     ReplyResponse("failed in INIT");
     return;
   }
   if (!abort_)
-    state_ = FINISHED;
+    SetState(FINISHED);
   if (verify_output_) {
     VLOG(2) << trace_id_ << " verify response:" << resp_->DebugString();
     CHECK(subproc_ == nullptr);
@@ -1716,46 +1786,98 @@ void CompileTask::ProcessReply() {
   CHECK(subproc_ == nullptr);
   CHECK(delayed_setup_subproc_ == nullptr);
   CHECK(!abort_);
-  std::string msg;
-  if (IsGomaccRunning()) {
-    VLOG(2) << trace_id_ << " goma result:" << resp_->DebugString();
-    if (local_run_ && service_->dont_kill_subprocess()) {
-      // if we ran local process and dont_kill_subprocess is true, we just
-      // use local results, so we don't need to rename remote outputs.
-      CommitOutput(false);
-      msg = "goma success, but local used";
+  if (!IsGomaccRunning()) {
+    reply_message_ = "goma canceled";
+    ProcessReplyDone();
+    return;
+  }
+  VLOG(2) << trace_id_ << " goma result:" << resp_->DebugString();
+  if (!service_->has_file_io_pool()) {
+    ProcessReplyCommitOutput();
+    ProcessReplyDone();
+    return;
+  }
+  committing_output_in_pool_ = true;
+  file_io_wait_timer_.Start();
+  service_->wm()->RunClosureInPool(
+      FROM_HERE, service_->file_io_pool(),
+      NewCallback(this, &CompileTask::ProcessReplyCommitOutput),
+      WorkerThread::PRIORITY_LOW);
+}
+
+void CompileTask::ProcessReplyCommitOutput() {
+  VLOG(1) << trace_id_ << " process reply commit output";
+  CHECK_EQ(FINISHED, state_);
+  // committing_output_in_pool_ was set before this was posted to the pool,
+  // and is not updated until ProcessReplyDone.
+  const bool in_file_io_pool = committing_output_in_pool_;
+  DCHECK_EQ(in_file_io_pool, !BelongsToCurrentThread());
+  if (in_file_io_pool) {
+    stats_->file_io_wait_time += file_io_wait_timer_.GetDuration();
+  }
+
+  SimpleTimer timer;
+  // Hash keys of committed outputs, if they are remote outputs.
+  std::vector<std::string> output_hash_keys;
+  if (local_run_ && service_->dont_kill_subprocess()) {
+    // if we ran local process and dont_kill_subprocess is true, we just
+    // use local results, so we don't need to rename remote outputs.
+    CommitOutput(false);
+    reply_message_ = "goma success, but local used";
+  } else {
+    // CommitOutput clears output_file_infos_.
+    for (const auto& info : output_file_infos_) {
+      output_hash_keys.push_back(info.hash_key);
+    }
+    CommitOutput(true);
+    if (local_cache_hit()) {
+      reply_message_ = "goma success (local cache hit)";
+    } else if (cache_hit()) {
+      reply_message_ = "goma success (cache hit)";
     } else {
-      CommitOutput(true);
-      if (local_cache_hit()) {
-        msg = "goma success (local cache hit)";
-      } else if (cache_hit()) {
-        msg = "goma success (cache hit)";
-      } else {
-        msg = "goma success";
-      }
+      reply_message_ = "goma success";
     }
+  }
+  stats_->commit_output_time = timer.GetDuration();
 
-    if (LocalOutputCache::IsEnabled()) {
-      if (!local_cache_hit() && !local_output_cache_key_.empty() && success()) {
-        // Here, local or remote output has been performed,
-        // and output cache key exists.
-        // Note: we need to save output before ReplyResponse. Otherwise,
-        // output file might be removed by ninja.
-        if (!LocalOutputCache::instance()->SaveOutput(local_output_cache_key_,
-                                                      req_.get(),
-                                                      resp_.get(),
-                                                      trace_id_)) {
-          LOG(ERROR) << trace_id_ << " failed to save localoutputcache";
-        }
+  if (LocalOutputCache::IsEnabled()) {
+    if (!local_cache_hit() && !local_output_cache_key_.empty() && success()) {
+      // Here, local or remote output has been performed,
+      // and output cache key exists.
+      // Note: we need to save output before ReplyResponse. Otherwise,
+      // output file might be removed by ninja.
+      timer.Start();
+      if (!LocalOutputCache::instance()->SaveOutput(local_output_cache_key_,
+                                                    req_.get(),
+                                                    resp_.get(),
+                                                    output_hash_keys,
+                                                    trace_id_)) {
+        LOG(ERROR) << trace_id_ << " failed to save localoutputcache";
       }
+      stats_->local_output_cache_save_time = timer.GetDuration();
     }
-  } else {
-    msg = "goma canceled";
   }
 
+  if (in_file_io_pool) {
+    service_->wm()->RunClosureInThread(
+        FROM_HERE, thread_id_,
+        NewCallback(this, &CompileTask::ProcessReplyDone),
+        WorkerThread::PRIORITY_LOW);
+  }
+}
+
+void CompileTask::ProcessReplyDone() {
+  VLOG(1) << trace_id_ << " process reply done";
+  DCHECK(BelongsToCurrentThread());
+  CHECK_EQ(FINISHED, state_);
+  committing_output_in_pool_ = false;
+  if (gomacc_closed_while_committing_output_) {
+    gomacc_closed_while_committing_output_ = false;
+    GomaccClosed();
+  }
   if (!subproc_stdout_.empty()) remove(subproc_stdout_.c_str());
   if (!subproc_stderr_.empty()) remove(subproc_stderr_.c_str());
-  ReplyResponse(msg);
+  ReplyResponse(reply_message_);
 }
 
 struct CompileTask::RenameParam {
@@ -1976,7 +2098,8 @@ void CompileTask::RewriteCoffTimestamp(const std::string& filename) {
 
 void CompileTask::CommitOutput(bool use_remote) {
   VLOG(1) << trace_id_ << " commit output " << use_remote;
-  DCHECK(BelongsToCurrentThread());
+  // This may run in file I/O pool. See ProcessReply.
+  DCHECK(BelongsToCurrentThread() || committing_output_in_pool_);
   CHECK(state_ == FINISHED);
   CHECK(!abort_);
   CHECK(subproc_ == nullptr);
@@ -2292,13 +2415,15 @@ void CompileTask::ProcessLocalFileOutput() {
     return;
   }
   for (auto* closure : closures)
-    service_->wm()->RunClosure(
-        FROM_HERE, closure, WorkerThread::PRIORITY_LOW);
+    service_->wm()->RunClosureInPool(
+        FROM_HERE, service_->file_io_pool(), closure,
+        WorkerThread::PRIORITY_LOW);
 }
 
 void CompileTask::ProcessLocalFileOutputDone() {
   VLOG(1) << trace_id_ << " local output done";
   CHECK(BelongsToCurrentThread());
+  DCHECK(!committing_output_in_pool_);
   local_output_file_callback_ = nullptr;
   if (finished_) {
     CHECK(subproc_ == nullptr);
@@ -2339,10 +2464,34 @@ void CompileTask::Done() {
   }
 
   SaveInfoFromInputOutput();
+  RecordTraceEvents();
   service_->CompileTaskDone(this);
   VLOG(1) << trace_id_ << " finalized.";
 }
 
+void CompileTask::RecordTraceEvents() {
+  if (!TraceEventRecorder::IsEnabled()) {
+    return;
+  }
+  const absl::Time now = absl::Now();
+  trace_events_.emplace_back(StateName(state_), kTraceCategoryTask,
+                             kTraceTrackTask, state_start_time_,
+                             now - state_start_time_);
+  std::string detail = trace_id_;
+  if (flags_ != nullptr && !flags_->input_filenames().empty()) {
+    absl::StrAppend(&detail, " ", flags_->input_filenames()[0]);
+  }
+  trace_events_.emplace_back("task", kTraceCategoryTask, kTraceTrackTask,
+                             task_start_time_, now - task_start_time_,
+                             std::move(detail));
+
+  TraceEventRecorder::Task task;
+  task.id = id_;
+  task.events = std::move(trace_events_);
+  trace_events_.clear();
+  TraceEventRecorder::instance()->AddTask(std::move(task));
+}
+
 void CompileTask::DumpToJson(bool need_detail, Json::Value* root) const {
   SubProcessState::State subproc_state = SubProcessState::NUM_STATE;
   pid_t subproc_pid = static_cast<pid_t>(SubProcessState::kInvalidPid);
@@ -2459,7 +2608,11 @@ void CompileTask::InitCompilerFlags() {
   CHECK_EQ(INIT, state_);
   std::vector<std::string> args(req_->arg().begin(), req_->arg().end());
   VLOG(1) << trace_id_ << " " << args;
-  flags_ = CompilerFlagsParser::New(args, req_->cwd());
+  if (service_->compiler_flags_template_cache() != nullptr) {
+    flags_ = service_->compiler_flags_template_cache()->New(args, req_->cwd());
+  } else {
+    flags_ = CompilerFlagsParser::New(args, req_->cwd());
+  }
   if (flags_.get() == nullptr) {
     return;
   }
@@ -2704,6 +2857,8 @@ void CompileTask::FillCompilerInfoDone(
   stats_->exec_log.set_compiler_info_process_time(
       DurationToIntMs(compiler_info_time));
   stats_->compiler_info_process_time = compiler_info_time;
+  AddTraceEvent("compiler_info", kTraceCategoryTask, kTraceTrackTask,
+                compiler_info_time);
   std::ostringstream ss;
   ss << " cache_hit=" << param->cache_hit
      << " updated=" << param->updated
@@ -2849,6 +3004,22 @@ void CompileTask::UpdateRequiredFilesDone(bool ok) {
       DurationToIntMs(include_preprocess_time));
   stats_->include_preprocess_time = include_preprocess_time;
   stats_->exec_log.set_depscache_used(depscache_used_);
+  if (TraceEventRecorder::IsEnabled()) {
+    // The include processor runs in the pool after waiting for a free
+    // thread, so its wait and run are nested in include preprocess.
+    const absl::Time include_start_time =
+        absl::Now() - include_preprocess_time;
+    trace_events_.emplace_back("include_preprocess", kTraceCategoryInclude,
+                               kTraceTrackTask, include_start_time,
+                               include_preprocess_time);
+    trace_events_.emplace_back(
+        "include_processor_wait", kTraceCategoryInclude, kTraceTrackTask,
+        include_start_time, stats_->include_processor_wait_time);
+    trace_events_.emplace_back(
+        "include_processor_run", kTraceCategoryInclude, kTraceTrackTask,
+        include_start_time + stats_->include_processor_wait_time,
+        stats_->include_processor_run_time);
+  }
 
   LOG_IF(WARNING, stats_->include_processor_run_time > absl::Seconds(1))
       << trace_id_ << " SLOW run IncludeProcessor"
@@ -2878,7 +3049,7 @@ void CompileTask::SetupRequestDone(bool ok) {
       VLOG(1) << trace_id_ << " should fallback by setup failure";
       // should_fallback_ expects INIT state when subprocess finishes
       // in CompileTask::FinishSubProcess().
-      state_ = INIT;
+      SetState(INIT);
       if (subproc_ == nullptr)
         SetupSubProcess();
       RunSubProcess("fallback by setup failure");
@@ -3521,6 +3692,9 @@ void CompileTask::InputFileTaskFinished(InputFileTask* input_file_task) {
   DCHECK(!hash_key.empty()) << filename;
   stats_->exec_log.add_input_file_time(
       DurationToIntMs(input_file_task->timer().GetDuration()));
+  AddTraceEvent("input_file", kTraceCategoryFile,
+                TraceEventRecorder::kUntracked,
+                input_file_task->timer().GetDuration(), filename);
   stats_->exec_log.add_input_file_size(file_size);
   if (!input_file_task->UpdateInputInTask(this)) {
     LOG(ERROR) << trace_id_ << " bad input data "
@@ -3970,6 +4144,8 @@ void CompileTask::OutputFileTaskFinished(
     return;
   }
   absl::Duration output_file_time = output_file_task->timer().GetDuration();
+  AddTraceEvent("output_file", kTraceCategoryFile,
+                TraceEventRecorder::kUntracked, output_file_time, filename);
   LOG_IF(WARNING, output_file_time > absl::Minutes(1))
       << trace_id_ << " SLOW output file:"
       << " filename=" << filename
@@ -4120,6 +4296,9 @@ void CompileTask::LocalOutputFileTaskFinished(
       local_output_file_task->timer().GetDuration();
   stats_->exec_log.add_local_output_file_time(
       DurationToIntMs(local_output_file_task_duration));
+  AddTraceEvent("local_output_file", kTraceCategoryFile,
+                TraceEventRecorder::kUntracked,
+                local_output_file_task_duration, filename);
   stats_->total_local_output_file_time += local_output_file_task_duration;
 
   const FileStat& file_stat = local_output_file_task->file_stat();
@@ -4364,6 +4543,17 @@ void CompileTask::FinishSubProcess() {
 
     stats_->exec_log.set_local_run_time(subproc->terminated().run_ms());
     stats_->local_run_time = absl::Milliseconds(subproc->terminated().run_ms());
+    if (TraceEventRecorder::IsEnabled()) {
+      const absl::Time local_run_start_time =
+          absl::Now() - stats_->local_run_time;
+      trace_events_.emplace_back(
+          "local_pending", kTraceCategorySubProcess, kTraceTrackSubProcess,
+          local_run_start_time - stats_->local_pending_time,
+          stats_->local_pending_time);
+      trace_events_.emplace_back("local_run", kTraceCategorySubProcess,
+                                 kTraceTrackSubProcess, local_run_start_time,
+                                 stats_->local_run_time);
+    }
 
     stats_->exec_log.set_local_mem_kb(subproc->terminated().mem_kb());
     VLOG(1) << trace_id_ << " subproc finished"
@@ -4465,7 +4655,7 @@ void CompileTask::FinishSubProcess() {
   }
   if (should_fallback_) {
     CHECK_EQ(INIT, state_);
-    state_ = LOCAL_FINISHED;
+    SetState(LOCAL_FINISHED);
     finished_ = true;
     // reply fallback response.
     VLOG(2) << trace_id_ << " should fallback:" << resp_->DebugString();
@@ -4491,7 +4681,7 @@ void CompileTask::FinishSubProcess() {
   }
   if (state_ == LOCAL_RUN) {
     VLOG(2) << trace_id_ << " local run finished:" << resp_->DebugString();
-    state_ = LOCAL_FINISHED;
+    SetState(LOCAL_FINISHED);
     finished_ = true;
     if (!local_run_goma_failure) {
       resp_->clear_error_message();
@@ -32,6 +32,7 @@
 #include "simple_timer.h"
 #include "subprocess_task.h"
 #include "threadpool_http_server.h"
+#include "trace_event_recorder.h"
 #include "worker_thread.h"
 #include "worker_thread_manager.h"
 
@@ -152,6 +153,10 @@ class CompileTask {
   FRIEND_TEST(CompileTaskTest, SetCompilerResourcesSendCompilerBinary);
   FRIEND_TEST(CompileTaskTest, ModifyRequestCWDAndPWD);
   FRIEND_TEST(CompileTaskTest, IsRelocatableCompilerFlags);
+  FRIEND_TEST(CompileTaskTest, SaveLocalOutputCacheWithHashKeys);
+  FRIEND_TEST(CompileTaskTest, ProcessReplyWithoutFileIOPool);
+  FRIEND_TEST(CompileTaskTest, ProcessReplyInFileIOPool);
+  FRIEND_TEST(CompileTaskTest, GomaccClosedWhileCommittingOutputInPool);
 
   enum ErrDest {
     // To log: write in log file, and show on status page.
@@ -164,6 +169,7 @@ class CompileTask {
   friend class OutputFileTask;
   friend class LocalOutputFileTask;
   friend class CompilerProxyHistogram;
+  friend class CompileTaskTest;
   struct RenameParam;
   struct ContentOutputParam;
   struct IncludeProcessorRequestParam;
@@ -205,6 +211,16 @@ class CompileTask {
   // Checks if we should stop goma and use local run only.
   bool ShouldStopGoma() const;
 
+  // Changes state_ to |state|, and records the previous state in
+  // |trace_events_| if TraceEventRecorder is enabled.
+  void SetState(State state);
+  // Records an event finished now that took |duration|.
+  void AddTraceEvent(const char* name,
+                     const char* category,
+                     int track,
+                     absl::Duration duration,
+                     std::string detail = std::string());
+
   // Sets up goma request. (e.g include processor).
   // state_: INIT -> SETUP
   void ProcessSetup();
@@ -231,7 +247,16 @@ class CompileTask {
 
   // Replies with goma result.
   // state_: FINISHED && !abort_ && subprocess has been finished.
+  // Output files are committed in file I/O pool if it is available,
+  // and ProcessReplyDone will be called on the task thread.
+  // While output files are committed in the pool, the pool thread owns
+  // this task: the task thread must not touch it until ProcessReplyDone.
+  // GomaccClosed is deferred until then.
   void ProcessReply();
+  // Commits output files and saves them in local output cache.
+  // This may run in file I/O pool.
+  void ProcessReplyCommitOutput();
+  void ProcessReplyDone();
 
   // state_: !abort_, FINISHED.
   // If use_remote is true, it renames remote outputs to real outputs.
@@ -263,6 +288,8 @@ class CompileTask {
   // Saves stats, clears proto messages and calls CompileTaskDone to make
   // this CompileTask expired.
   void Done();
+  // Passes |trace_events_| to TraceEventRecorder.
+  void RecordTraceEvents();
 
   // Methods used in state_: SETUP
   void FillCompilerInfo();
@@ -398,6 +425,11 @@ class CompileTask {
   int gomacc_pid_ = SubProcessState::kInvalidPid;
   // true if a connection to gomacc is lost, and the task is canceled.
   bool canceled_ = false;
+  // true while output files are committed in file I/O pool.
+  // Only updated on the task thread.
+  bool committing_output_in_pool_ = false;
+  // true if gomacc closed while committing_output_in_pool_.
+  bool gomacc_closed_while_committing_output_ = false;
 
   std::string orig_flag_dump_;
   std::string flag_dump_;
@@ -475,9 +507,15 @@ class CompileTask {
   SimpleTimer rpc_call_timer_;
   SimpleTimer file_response_timer_;
   SimpleTimer file_request_timer_;
+  SimpleTimer file_io_wait_timer_;
 
   // trace info.
   std::string resp_cache_key_;
+  // Timeline of this task passed to TraceEventRecorder in Done().
+  // Empty if TraceEventRecorder is not enabled.
+  absl::Time task_start_time_;
+  absl::Time state_start_time_;
+  std::vector<TraceEventRecorder::Event> trace_events_;
 
   // Input file process.
   OneshotClosure* input_file_callback_ = nullptr;
@@ -490,6 +528,9 @@ class CompileTask {
   int num_output_file_task_ = 0;
   bool output_file_success_ = false;
 
+  // Message to reply after output files are committed.
+  std::string reply_message_;
+
   // Local output file process.
   OneshotClosure* local_output_file_callback_ = nullptr;
   int num_local_output_file_task_ = 0;
@@ -501,6 +542,9 @@ class CompileTask {
   // we can put cache later and at that time we don't need to recalculate
   // the key.
   std::string local_output_cache_key_;
+  // Content files of LocalOutputCache hit for each output, to be cloned to
+  // output files.  Empty if output content is in |resp_|.
+  std::vector<std::string> local_output_cache_files_;
 
   mutable Lock refcnt_mu_;
   int refcnt_ GUARDED_BY(refcnt_mu_) = 0;
@@ -16,12 +16,17 @@
 #include "compile_stats.h"
 #include "compiler_flags.h"
 #include "compiler_flags_parser.h"
+#include "file_helper.h"
 #include "glog/logging.h"
 #include "gtest/gtest.h"
 #include "json_util.h"
 #include "lib/goma_data.pb.h"
+#include "local_output_cache.h"
+#include "lockhelper.h"
 #include "rpc_controller.h"
 #include "threadpool_http_server.h"
+#include "unittest_util.h"
+#include "util.h"
 #include "worker_thread_manager.h"
 
 namespace devtools_goma {
@@ -137,6 +142,8 @@ class FakeExecServiceClient : public ExecServiceClient {
   int http_return_code_;
 };
 
+}  // anonymous namespace
+
 // Unit tests that require a real instance of CompileTask should inherit from
 // this class.
 class CompileTaskTest : public ::testing::Test,
@@ -192,8 +199,94 @@ class CompileTaskTest : public ::testing::Test,
   const std::unique_ptr<CompileService>& compile_service() const {
     return compile_service_;
   }
+  WorkerThreadManager* wm() const { return worker_thread_manager_.get(); }
+
+  // Sets up |compile_task()| as if it received a successful remote result
+  // whose output was written in <tmpdir>/build/foo.o.tmp.
+  void PrepareRemoteOutput(const TmpdirUtil& tmpdir) {
+    CompileTask* task = compile_task();
+    task->req_->set_cwd(tmpdir.FullPath("build"));
+    task->output_file_stat_cache_ = absl::make_unique<FileStatCache>();
+    task->resp_->mutable_result()->set_exit_status(0);
+    task->resp_->mutable_result()->add_output()->set_filename("foo.o");
+    ASSERT_TRUE(WriteStringToFile("(output)",
+                                  tmpdir.FullPath("build/foo.o.tmp")));
+    task->output_file_infos_.resize(1);
+    task->output_file_infos_[0].filename = tmpdir.FullPath("build/foo.o");
+    task->output_file_infos_[0].tmp_filename =
+        tmpdir.FullPath("build/foo.o.tmp");
+    task->output_file_infos_[0].hash_key = "output-hash-key";
+    task->output_file_infos_[0].mode = 0644;
+    task->state_ = CompileTask::FINISHED;
+  }
+
+  // Runs ProcessReply of |compile_task()| on a worker thread, which becomes
+  // the task thread.  If |gomacc_closed| is true, gomacc is closed right
+  // after ProcessReply.
+  // If |block_file_io_pool| is true, file I/O pool is blocked until
+  // UnblockFileIOPool is called.
+  void RunProcessReplyOnWorker(bool gomacc_closed, bool block_file_io_pool) {
+    if (block_file_io_pool) {
+      {
+        AutoLock lock(&mu_);
+        file_io_pool_blocked_ = true;
+      }
+      wm()->RunClosureInPool(
+          FROM_HERE, compile_service()->file_io_pool(),
+          NewCallback(this, &CompileTaskTest::BlockFileIOPool),
+          WorkerThread::PRIORITY_IMMEDIATE);
+    }
+    wm()->RunClosure(
+        FROM_HERE,
+        NewCallback(this, &CompileTaskTest::ProcessReplyOnTaskThread,
+                    gomacc_closed),
+        WorkerThread::PRIORITY_LOW);
+  }
+
+  void UnblockFileIOPool() {
+    AutoLock lock(&mu_);
+    file_io_pool_blocked_ = false;
+    cond_.Signal();
+  }
+
+  // Waits until |compile_task()| replies, and returns whether the task was
+  // canceled by gomacc close just after ProcessReply.
+  bool WaitReplied() {
+    AutoLock lock(&mu_);
+    while (!replied_) {
+      cond_.Wait(&mu_);
+    }
+    return canceled_after_process_reply_;
+  }
 
  private:
+  void BlockFileIOPool() {
+    AutoLock lock(&mu_);
+    while (file_io_pool_blocked_) {
+      cond_.Wait(&mu_);
+    }
+  }
+
+  void ProcessReplyOnTaskThread(bool gomacc_closed) {
+    CompileTask* task = compile_task();
+    task->thread_id_ = GetCurrentThreadId();
+    task->caller_thread_id_ = wm()->GetCurrentThreadId();
+    task->gomacc_pid_ = Getpid();
+    task->done_ = NewCallback(this, &CompileTaskTest::Replied);
+    task->ProcessReply();
+    if (gomacc_closed) {
+      task->GomaccClosed();
+    }
+    AutoLock lock(&mu_);
+    canceled_after_process_reply_ = task->canceled_;
+  }
+
+  void Replied() {
+    AutoLock lock(&mu_);
+    replied_ = true;
+    cond_.Signal();
+  }
+
   // These objects need to be initialized at the start of each test.
   std::unique_ptr<WorkerThreadManager> worker_thread_manager_;
   std::unique_ptr<ThreadpoolHttpServer> http_server_;
@@ -210,9 +303,13 @@ class CompileTaskTest : public ::testing::Test,
   ExecReq exec_request_;
   ExecResp exec_response_;
   DummyHttpHandler http_handler_;
-};
 
-}  // anonymous namespace
+  Lock mu_;
+  ConditionVariable cond_;
+  bool file_io_pool_blocked_ GUARDED_BY(mu_) = false;
+  bool replied_ GUARDED_BY(mu_) = false;
+  bool canceled_after_process_reply_ GUARDED_BY(mu_) = false;
+};
 
 TEST_F(CompileTaskTest, DumpToJsonWithoutRunning) {
   Json::Value json;
@@ -747,4 +844,93 @@ TEST_F(CompileTaskTest, IsRelocatableCompilerFlags) {
   EXPECT_FALSE(CompileTask::IsRelocatableCompilerFlags(*flags));
 }
 
+TEST_F(CompileTaskTest, SaveLocalOutputCacheWithHashKeys) {
+  TmpdirUtil tmpdir("compile_task_unittest_local_output_cache");
+  tmpdir.MkdirForPath("build", true);
+  tmpdir.MkdirForPath("cache", true);
+  LocalOutputCache::Init(tmpdir.FullPath("cache"), nullptr, 1000000, 10000000,
+                         1000, 1000);
+  PrepareRemoteOutput(tmpdir);
+  CompileTask* task = compile_task();
+  const std::string key = LocalOutputCache::MakeCacheKey(*task->req_);
+  task->local_output_cache_key_ = key;
+
+  task->ProcessReplyCommitOutput();
+
+  std::string content;
+  EXPECT_TRUE(ReadFileToString(tmpdir.FullPath("build/foo.o"), &content));
+  EXPECT_EQ("(output)", content);
+
+  ExecResp cached_resp;
+  std::vector<std::string> content_files;
+  ASSERT_TRUE(LocalOutputCache::instance()->Lookup(key, &cached_resp,
+                                                   &content_files, "test"));
+  ASSERT_EQ(1, cached_resp.result().output_size());
+  const FileBlob& blob = cached_resp.result().output(0).blob();
+  EXPECT_EQ(FileBlob::FILE_REF, blob.blob_type());
+  ASSERT_EQ(1, blob.hash_key_size());
+  EXPECT_EQ("output-hash-key", blob.hash_key(0));
+  ASSERT_EQ(1U, content_files.size());
+  EXPECT_FALSE(content_files[0].empty());
+
+  LocalOutputCache::Quit();
+}
+
+TEST_F(CompileTaskTest, ProcessReplyWithoutFileIOPool) {
+  TmpdirUtil tmpdir("compile_task_unittest_process_reply");
+  tmpdir.MkdirForPath("build", true);
+  PrepareRemoteOutput(tmpdir);
+  ASSERT_FALSE(compile_service()->has_file_io_pool());
+  wm()->Start(1);
+
+  RunProcessReplyOnWorker(false, false);
+  EXPECT_FALSE(WaitReplied());
+
+  std::string content;
+  EXPECT_TRUE(ReadFileToString(tmpdir.FullPath("build/foo.o"), &content));
+  EXPECT_EQ("(output)", content);
+  EXPECT_EQ("goma success", compile_task()->reply_message_);
+  EXPECT_FALSE(compile_task()->committing_output_in_pool_);
+}
+
+TEST_F(CompileTaskTest, ProcessReplyInFileIOPool) {
+  TmpdirUtil tmpdir("compile_task_unittest_process_reply");
+  tmpdir.MkdirForPath("build", true);
+  PrepareRemoteOutput(tmpdir);
+  wm()->Start(1);
+  compile_service()->StartFileIOWorkers(1);
+  ASSERT_TRUE(compile_service()->has_file_io_pool());
+
+  RunProcessReplyOnWorker(false, false);
+  EXPECT_FALSE(WaitReplied());
+
+  std::string content;
+  EXPECT_TRUE(ReadFileToString(tmpdir.FullPath("build/foo.o"), &content));
+  EXPECT_EQ("(output)", content);
+  EXPECT_EQ("goma success", compile_task()->reply_message_);
+  EXPECT_FALSE(compile_task()->committing_output_in_pool_);
+  EXPECT_FALSE(compile_task()->canceled_);
+}
+
+TEST_F(CompileTaskTest, GomaccClosedWhileCommittingOutputInPool) {
+  TmpdirUtil tmpdir("compile_task_unittest_process_reply");
+  tmpdir.MkdirForPath("build", true);
+  PrepareRemoteOutput(tmpdir);
+  wm()->Start(1);
+  compile_service()->StartFileIOWorkers(1);
+
+  // gomacc is closed while the output is waiting to be committed in the
+  // pool.  It must not be handled until the pool finishes.
+  RunProcessReplyOnWorker(true, true);
+  UnblockFileIOPool();
+  EXPECT_FALSE(WaitReplied());
+
+  std::string content;
+  EXPECT_TRUE(ReadFileToString(tmpdir.FullPath("build/foo.o"), &content));
+  EXPECT_EQ("(output)", content);
+  EXPECT_EQ("goma success", compile_task()->reply_message_);
+  EXPECT_FALSE(compile_task()->gomacc_closed_while_committing_output_);
+  EXPECT_TRUE(compile_task()->canceled_);
+}
+
 }  // namespace devtools_goma
@@ -0,0 +1,174 @@
+// Copyright 2021 The Goma Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "compiler_flags_template_cache.h"
+
+#include <utility>
+
+#include "compiler_flag_type_specific.h"
+#include "compiler_flags_parser.h"
+#include "glog/logging.h"
+#include "lib/goma_stats.pb.h"
+#include "path_util.h"
+
+namespace devtools_goma {
+
+CompilerFlagsTemplateCache::CompilerFlagsTemplateCache(size_t max_entries)
+    : max_entries_(max_entries) {}
+
+std::unique_ptr<CompilerFlags> CompilerFlagsTemplateCache::New(
+    const std::vector<std::string>& args,
+    const std::string& cwd) {
+  std::vector<size_t> per_file_arg_indices;
+  if (args.empty() ||
+      CompilerFlagTypeSpecific::FromArg(args[0]).type() !=
+          CompilerFlagType::Gcc ||
+      !GCCFlags::GetPerFileArgIndices(args, &per_file_arg_indices)) {
+    uncacheable_.Add(1);
+    return CompilerFlagsParser::New(args, cwd);
+  }
+
+  const std::string key = MakeKey(args, cwd, per_file_arg_indices);
+  std::shared_ptr<const GCCFlags> template_flags;
+  bool verified = false;
+  {
+    AUTOLOCK(lock, &mu_);
+    auto it = entries_.find(key);
+    if (it != entries_.end()) {
+      if (it->second.disabled) {
+        miss_.Add(1);
+        return CompilerFlagsParser::New(args, cwd);
+      }
+      template_flags = it->second.flags;
+      verified = it->second.verified;
+      entries_.MoveToBack(it);
+    }
+  }
+
+  if (template_flags && verified) {
+    std::unique_ptr<GCCFlags> flags =
+        template_flags->CloneWithPerFileArgs(args, per_file_arg_indices);
+    if (flags) {
+      hit_.Add(1);
+      return flags;
+    }
+  }
+
+  miss_.Add(1);
+  std::unique_ptr<CompilerFlags> flags = CompilerFlagsParser::New(args, cwd);
+  if (!flags || flags->type() != CompilerFlagType::Gcc ||
+      !flags->is_successful()) {
+    return flags;
+  }
+  const GCCFlags& gcc_flags = static_cast<const GCCFlags&>(*flags);
+
+  if (!template_flags) {
+    // New template. Check it can be a template for itself.
+    if (gcc_flags.CloneWithPerFileArgs(args, per_file_arg_indices) ==
+        nullptr) {
+      uncacheable_.Add(1);
+      return flags;
+    }
+    Entry entry;
+    entry.flags = std::make_shared<GCCFlags>(gcc_flags);
+    entry.per_file_arg_indices = std::move(per_file_arg_indices);
+    AUTOLOCK(lock, &mu_);
+    if (!entries_.contains(key)) {
+      entries_.emplace_back(key, std::move(entry));
+      while (entries_.size() > max_entries_) {
+        entries_.pop_front();
+      }
+    }
+    return flags;
+  }
+
+  if (verified) {
+    // template could not be used for |args|.
+    return flags;
+  }
+
+  // Verify the template with the parsed result of other command.
+  std::unique_ptr<GCCFlags> derived =
+      template_flags->CloneWithPerFileArgs(args, per_file_arg_indices);
+  const bool ok = derived != nullptr && IsSameParsedResult(*derived, gcc_flags);
+  if (ok) {
+    verified_.Add(1);
+  } else {
+    LOG(WARNING) << "compiler flags template doesn't match:"
+                 << " template=" << template_flags->DebugString()
+                 << " args=" << gcc_flags.DebugString();
+    verify_failure_.Add(1);
+  }
+  AUTOLOCK(lock, &mu_);
+  auto it = entries_.find(key);
+  if (it != entries_.end() && it->second.flags == template_flags) {
+    it->second.verified = ok;
+    it->second.disabled = !ok;
+    if (!ok) {
+      // no need to keep flags for disabled entry.
+      it->second.flags.reset();
+    }
+  }
+  return flags;
+}
+
+void CompilerFlagsTemplateCache::DumpStatsToProto(
+    CompilerFlagsTemplateCacheStats* stats) const {
+  {
+    AUTOLOCK(lock, &mu_);
+    stats->set_entries(entries_.size());
+  }
+  stats->set_hit(hit_.value());
+  stats->set_miss(miss_.value());
+  stats->set_uncacheable(uncacheable_.value());
+  stats->set_verified(verified_.value());
+  stats->set_verify_failure(verify_failure_.value());
+}
+
+// static
+std::string CompilerFlagsTemplateCache::MakeKey(
+    const std::vector<std::string>& args,
+    const std::string& cwd,
+    const std::vector<size_t>& per_file_arg_indices) {
+  std::string key = cwd;
+  size_t next = 0;
+  for (size_t i = 0; i < args.size(); ++i) {
+    key.push_back('\0');
+    if (next < per_file_arg_indices.size() && per_file_arg_indices[next] == i) {
+      ++next;
+      // Language and output file names may depend on extension.
+      key.push_back('\1');
+      absl::string_view ext = GetExtension(args[i]);
+      key.append(ext.data(), ext.size());
+      continue;
+    }
+    key.append(args[i]);
+  }
+  return key;
+}
+
+// static
+bool CompilerFlagsTemplateCache::IsSameParsedResult(const GCCFlags& a,
+                                                    const GCCFlags& b) {
+  return a.args() == b.args() && a.expanded_args() == b.expanded_args() &&
+         a.output_files() == b.output_files() &&
+         a.output_dirs() == b.output_dirs() &&
+         a.input_filenames() == b.input_filenames() &&
+         a.optional_input_filenames() == b.optional_input_filenames() &&
+         a.is_successful() == b.is_successful() &&
+         a.fail_message() == b.fail_message() && a.lang() == b.lang() &&
+         a.cwd() == b.cwd() &&
+         a.compiler_info_flags() == b.compiler_info_flags() &&
+         a.unknown_flags() == b.unknown_flags() && a.mode() == b.mode() &&
+         a.non_system_include_dirs() == b.non_system_include_dirs() &&
+         a.root_includes() == b.root_includes() &&
+         a.framework_dirs() == b.framework_dirs() &&
+         a.commandline_macros() == b.commandline_macros() &&
+         a.is_precompiling_header() == b.is_precompiling_header() &&
+         a.is_stdin_input() == b.is_stdin_input() &&
+         a.clang_module_map_file() == b.clang_module_map_file() &&
+         a.clang_module_file() == b.clang_module_file();
+}
+
+}  // namespace devtools_goma
@@ -0,0 +1,84 @@
+// Copyright 2021 The Goma Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef DEVTOOLS_GOMA_CLIENT_COMPILER_FLAGS_TEMPLATE_CACHE_H_
+#define DEVTOOLS_GOMA_CLIENT_COMPILER_FLAGS_TEMPLATE_CACHE_H_
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "atomic_stats_counter.h"
+#include "autolock_timer.h"
+#include "compiler_flags.h"
+#include "gcc_flags.h"
+#include "linked_unordered_map.h"
+#include "lockhelper.h"
+
+namespace devtools_goma {
+
+class CompilerFlagsTemplateCacheStats;
+
+// CompilerFlagsTemplateCache creates CompilerFlags like CompilerFlagsParser,
+// but reuses parsed result of a compile command for other commands that have
+// the same args except per-file args (input filename, -o and -MF values).
+// e.g. all files of a build target are usually compiled with the same flags.
+//
+// A template is verified with fully parsed result of the second command
+// with the same shape, and used only after it is verified.
+//
+// Only gcc/clang commands are supported for now.
+//
+// This class is thread-safe.
+class CompilerFlagsTemplateCache {
+ public:
+  explicit CompilerFlagsTemplateCache(size_t max_entries);
+
+  CompilerFlagsTemplateCache(const CompilerFlagsTemplateCache&) = delete;
+  CompilerFlagsTemplateCache& operator=(const CompilerFlagsTemplateCache&) =
+      delete;
+
+  // Returns new instance of subclass of CompilerFlags for |args|.
+  // The result is the same as CompilerFlagsParser::New(args, cwd).
+  std::unique_ptr<CompilerFlags> New(const std::vector<std::string>& args,
+                                     const std::string& cwd)
+      LOCKS_EXCLUDED(mu_);
+
+  void DumpStatsToProto(CompilerFlagsTemplateCacheStats* stats) const
+      LOCKS_EXCLUDED(mu_);
+
+  // Returns a key of |args| where per-file args are replaced.
+  // Exposed for testing.
+  static std::string MakeKey(const std::vector<std::string>& args,
+                             const std::string& cwd,
+                             const std::vector<size_t>& per_file_arg_indices);
+
+ private:
+  struct Entry {
+    std::shared_ptr<const GCCFlags> flags;
+    std::vector<size_t> per_file_arg_indices;
+    // true if |flags| is verified to generate the same result as parser.
+    bool verified = false;
+    // true if |flags| generated different result. never used.
+    bool disabled = false;
+  };
+
+  // Returns true if |a| and |b| have the same parsed result.
+  static bool IsSameParsedResult(const GCCFlags& a, const GCCFlags& b);
+
+  const size_t max_entries_;
+
+  mutable Lock mu_;
+  LinkedUnorderedMap<std::string, Entry> entries_ GUARDED_BY(mu_);
+
+  StatsCounter hit_;
+  StatsCounter miss_;
+  StatsCounter uncacheable_;
+  StatsCounter verified_;
+  StatsCounter verify_failure_;
+};
+
+}  // namespace devtools_goma
+
+#endif  // DEVTOOLS_GOMA_CLIENT_COMPILER_FLAGS_TEMPLATE_CACHE_H_
@@ -0,0 +1,172 @@
+// Copyright 2021 The Goma Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "compiler_flags_template_cache.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "compiler_flags_parser.h"
+#include "gcc_flags.h"
+#include "glog/logging.h"
+#include "gtest/gtest.h"
+#include "lib/goma_stats.pb.h"
+
+namespace devtools_goma {
+
+namespace {
+
+std::vector<std::string> CompileArgs(const std::string& input,
+                                     const std::string& output) {
+  return std::vector<std::string>{
+      "clang++",
+      "-MMD",
+      "-MF",
+      output + ".d",
+      "-DFOO=1",
+      "-I../..",
+      "-gsplit-dwarf",
+      "-ftime-trace",
+      "-std=c++14",
+      "-c",
+      input,
+      "-o",
+      output,
+  };
+}
+
+void ExpectSameFlags(const CompilerFlags& expected,
+                     const CompilerFlags& actual) {
+  ASSERT_EQ(CompilerFlagType::Gcc, actual.type());
+  const GCCFlags& e = static_cast<const GCCFlags&>(expected);
+  const GCCFlags& a = static_cast<const GCCFlags&>(actual);
+  EXPECT_EQ(e.args(), a.args());
+  EXPECT_EQ(e.input_filenames(), a.input_filenames());
+  EXPECT_EQ(e.output_files(), a.output_files());
+  EXPECT_EQ(e.optional_input_filenames(), a.optional_input_filenames());
+  EXPECT_EQ(e.compiler_info_flags(), a.compiler_info_flags());
+  EXPECT_EQ(e.commandline_macros(), a.commandline_macros());
+  EXPECT_EQ(e.non_system_include_dirs(), a.non_system_include_dirs());
+  EXPECT_EQ(e.lang(), a.lang());
+  EXPECT_EQ(e.mode(), a.mode());
+  EXPECT_EQ(e.is_successful(), a.is_successful());
+}
+
+}  // namespace
+
+TEST(CompilerFlagsTemplateCacheTest, MakeKey) {
+  std::vector<size_t> foo_indices, bar_indices, baz_indices;
+  const std::vector<std::string> foo = CompileArgs("../../foo.cc", "obj/foo.o");
+  const std::vector<std::string> bar =
+      CompileArgs("../../bar/bar.cc", "obj/bar/bar.o");
+  const std::vector<std::string> baz = CompileArgs("../../baz.c", "obj/baz.o");
+  ASSERT_TRUE(GCCFlags::GetPerFileArgIndices(foo, &foo_indices));
+  ASSERT_TRUE(GCCFlags::GetPerFileArgIndices(bar, &bar_indices));
+  ASSERT_TRUE(GCCFlags::GetPerFileArgIndices(baz, &baz_indices));
+
+  EXPECT_EQ(CompilerFlagsTemplateCache::MakeKey(foo, "/out", foo_indices),
+            CompilerFlagsTemplateCache::MakeKey(bar, "/out", bar_indices));
+  EXPECT_NE(CompilerFlagsTemplateCache::MakeKey(foo, "/out", foo_indices),
+            CompilerFlagsTemplateCache::MakeKey(foo, "/out2", foo_indices));
+  // language depends on the extension of input.
+  EXPECT_NE(CompilerFlagsTemplateCache::MakeKey(foo, "/out", foo_indices),
+            CompilerFlagsTemplateCache::MakeKey(baz, "/out", baz_indices));
+}
+
+TEST(CompilerFlagsTemplateCacheTest, New) {
+  CompilerFlagsTemplateCache cache(10);
+  const std::string cwd = "/src/out/Release";
+
+  const std::vector<std::vector<std::string>> commands = {
+      CompileArgs("../../foo.cc", "obj/foo.o"),
+      CompileArgs("../../bar/bar.cc", "obj/bar/bar.o"),
+      CompileArgs("../../baz.cc", "obj/baz.o"),
+      CompileArgs("/abs/qux.cc", "/abs/out/qux.o"),
+  };
+  for (const auto& args : commands) {
+    std::unique_ptr<CompilerFlags> expected =
+        CompilerFlagsParser::MustNew(args, cwd);
+    std::unique_ptr<CompilerFlags> actual = cache.New(args, cwd);
+    ASSERT_TRUE(actual);
+    ExpectSameFlags(*expected, *actual);
+  }
+
+  CompilerFlagsTemplateCacheStats stats;
+  cache.DumpStatsToProto(&stats);
+  EXPECT_EQ(1, stats.entries());
+  EXPECT_EQ(1, stats.verified());
+  EXPECT_EQ(0, stats.verify_failure());
+  // first command creates template, second command verifies it.
+  EXPECT_EQ(2, stats.miss());
+  EXPECT_EQ(2, stats.hit());
+}
+
+TEST(CompilerFlagsTemplateCacheTest, Uncacheable) {
+  CompilerFlagsTemplateCache cache(10);
+
+  std::unique_ptr<CompilerFlags> flags = cache.New(
+      std::vector<std::string>{"clang-cl", "/c", "foo.cc", "/Fofoo.obj"},
+      "C:\\src");
+  ASSERT_TRUE(flags);
+  EXPECT_EQ(CompilerFlagType::Clexe, flags->type());
+
+  flags = cache.New(std::vector<std::string>{"gcc", "-c", "foo.c"}, "/src");
+  ASSERT_TRUE(flags);
+  EXPECT_EQ(std::vector<std::string>{"foo.o"}, flags->output_files());
+
+  CompilerFlagsTemplateCacheStats stats;
+  cache.DumpStatsToProto(&stats);
+  EXPECT_EQ(0, stats.entries());
+  EXPECT_EQ(2, stats.uncacheable());
+}
+
+TEST(CompilerFlagsTemplateCacheTest, VerifyFailure) {
+  CompilerFlagsTemplateCache cache(10);
+  const std::string cwd = "/src/out/Release";
+
+  // -Wp,-MD value is not recognized as per-file arg, and same for both
+  // commands, but it equals to the .d file derived from output of the
+  // first command.
+  auto make_args = [](const std::string& input, const std::string& output) {
+    return std::vector<std::string>{
+        "clang", "-Wp,-MD,obj/foo.d", "-MD", "-c", input, "-o", output,
+    };
+  };
+  const std::vector<std::vector<std::string>> commands = {
+      make_args("foo.c", "obj/foo.o"),
+      make_args("bar.c", "obj/bar.o"),
+      make_args("baz.c", "obj/baz.o"),
+  };
+  for (const auto& args : commands) {
+    std::unique_ptr<CompilerFlags> expected =
+        CompilerFlagsParser::MustNew(args, cwd);
+    std::unique_ptr<CompilerFlags> actual = cache.New(args, cwd);
+    ASSERT_TRUE(actual);
+    ExpectSameFlags(*expected, *actual);
+  }
+
+  CompilerFlagsTemplateCacheStats stats;
+  cache.DumpStatsToProto(&stats);
+  EXPECT_EQ(0, stats.hit());
+  EXPECT_EQ(1, stats.verify_failure());
+}
+
+TEST(CompilerFlagsTemplateCacheTest, Eviction) {
+  CompilerFlagsTemplateCache cache(1);
+  const std::string cwd = "/src/out/Release";
+
+  for (const auto& define : {"-DA", "-DB", "-DC"}) {
+    std::vector<std::string> args = CompileArgs("foo.cc", "foo.o");
+    args.push_back(define);
+    ASSERT_TRUE(cache.New(args, cwd));
+  }
+
+  CompilerFlagsTemplateCacheStats stats;
+  cache.DumpStatsToProto(&stats);
+  EXPECT_EQ(1, stats.entries());
+  EXPECT_EQ(3, stats.miss());
+}
+
+}  // namespace devtools_goma
@@ -34,22 +34,29 @@
 #include "absl/strings/str_replace.h"
 #include "absl/strings/str_split.h"
 #include "absl/time/time.h"
+#include "binutils/dynamic_dep_index.h"
 #include "breakpad.h"
 #include "clang_modules/modulemap/cache.h"
 #include "compiler_info_cache.h"
 #include "compiler_proxy_http_handler.h"
 #include "counterz.h"
+#include "cxx/include_processor/cpp_preamble_cache.h"
 #include "cxx/include_processor/include_cache.h"
 #include "cxx/include_processor/include_file_finder.h"
+#include "dart_analyzer/dart_import_cache.h"
 #include "deps_cache.h"
+#include "descriptor_poller.h"
 #include "glog/logging.h"
 #include "goma_init.h"
 #include "ioutil.h"
+#include "java/jar_manifest_cache.h"
+#include "linker/linker_input_processor/linker_driver_dump_cache.h"
 #include "list_dir_cache.h"
 #include "local_output_cache.h"
 #include "mypath.h"
 #include "path.h"
 #include "platform_thread.h"
+#include "rust/rustc_deps_cache.h"
 #include "scoped_fd.h"
 #include "settings.h"
 #include "subprocess.h"
@@ -57,6 +64,7 @@
 #include "subprocess_controller_client.h"
 #include "subprocess_option_setter.h"
 #include "subprocess_task.h"
+#include "trace_event_recorder.h"
 #include "trustedipsmanager.h"
 #include "util.h"
 #include "watchdog.h"
@@ -197,6 +205,10 @@ int main(int argc, char* argv[], const char* envp[]) {
     devtools_goma::GlobalFileStatCache::Init();
   }
 
+  if (FLAGS_MAX_TRACE_EVENTS > 0) {
+    devtools_goma::TraceEventRecorder::Init(FLAGS_MAX_TRACE_EVENTS);
+  }
+
   const std::string tmpdir = FLAGS_TMP_DIR;
 #ifndef _WIN32
   const std::string compiler_proxy_addr =
@@ -306,6 +318,10 @@ int main(int argc, char* argv[], const char* envp[]) {
   LOG(INFO) << "max_num_sockets=" << max_num_sockets
             << " max_nfile=" << max_nfile;
 
+#ifdef __linux__
+  devtools_goma::DescriptorPoller::SetUseIoUring(
+      FLAGS_COMPILER_PROXY_USE_IO_URING);
+#endif
   devtools_goma::WorkerThreadManager wm;
   wm.Start(FLAGS_COMPILER_PROXY_THREADS);
 
@@ -318,8 +334,69 @@ int main(int argc, char* argv[], const char* envp[]) {
 
   devtools_goma::IncludeCache::Init(FLAGS_MAX_INCLUDE_CACHE_ENTRIES,
                                     !FLAGS_DEPS_CACHE_FILE.empty());
-  devtools_goma::modulemap::Cache::Init(FLAGS_MAX_MODULEMAP_CACHE_ENTRIES);
+  std::unique_ptr<devtools_goma::WorkerThreadRunner> cleanup_include_cache_dir;
+  if (!FLAGS_INCLUDE_CACHE_DIR.empty()) {
+    const std::string include_cache_dir =
+        file::JoinPathRespectAbsolute(devtools_goma::GetCacheDirectory(),
+                                      FLAGS_INCLUDE_CACHE_DIR);
+    if (devtools_goma::IncludeCache::instance()->SetCacheDir(
+            include_cache_dir)) {
+      cleanup_include_cache_dir =
+          absl::make_unique<devtools_goma::WorkerThreadRunner>(
+              &wm, FROM_HERE,
+              devtools_goma::NewCallback(
+                  devtools_goma::IncludeCache::CleanupCacheDir,
+                  include_cache_dir,
+                  static_cast<int64_t>(
+                      FLAGS_INCLUDE_CACHE_DIR_MAX_SIZE_IN_MB) *
+                      1024 * 1024,
+                  absl::Now()));
+    }
+  }
+  devtools_goma::IncludeCache::instance()->StartPrefetchPool(
+      &wm, FLAGS_INCLUDE_PREFETCH_THREADS);
+  {
+    std::string modulemap_cache_filename;
+    if (!FLAGS_MODULEMAP_CACHE_FILE.empty()) {
+      modulemap_cache_filename = file::JoinPathRespectAbsolute(
+          devtools_goma::GetCacheDirectory(), FLAGS_MODULEMAP_CACHE_FILE);
+    }
+    devtools_goma::modulemap::Cache::Init(FLAGS_MAX_MODULEMAP_CACHE_ENTRIES,
+                                          std::move(modulemap_cache_filename));
+    devtools_goma::modulemap::Cache::LoadIfEnabled();
+  }
+  if (FLAGS_MAX_CPP_PREAMBLE_CACHE_ENTRIES > 0) {
+    devtools_goma::CppPreambleCache::Init(
+        FLAGS_MAX_CPP_PREAMBLE_CACHE_ENTRIES);
+  }
   devtools_goma::ListDirCache::Init(FLAGS_MAX_LIST_DIR_CACHE_ENTRY_NUM);
+  if (FLAGS_MAX_DYNAMIC_DEP_INDEX_ENTRIES > 0) {
+    std::string index_filename;
+    if (!FLAGS_DYNAMIC_DEP_INDEX_FILE.empty()) {
+      index_filename = file::JoinPathRespectAbsolute(
+          devtools_goma::GetCacheDirectory(), FLAGS_DYNAMIC_DEP_INDEX_FILE);
+    }
+    devtools_goma::DynamicDepIndex::Init(FLAGS_MAX_DYNAMIC_DEP_INDEX_ENTRIES,
+                                         std::move(index_filename));
+    devtools_goma::DynamicDepIndex::LoadIfEnabled();
+  }
+  if (FLAGS_MAX_LINKER_DRIVER_DUMP_CACHE_ENTRIES > 0) {
+    devtools_goma::LinkerDriverDumpCache::Init(
+        FLAGS_MAX_LINKER_DRIVER_DUMP_CACHE_ENTRIES);
+  }
+  if (FLAGS_MAX_JAR_MANIFEST_CACHE_ENTRIES > 0) {
+    devtools_goma::JarManifestCache::Init(
+        FLAGS_MAX_JAR_MANIFEST_CACHE_ENTRIES);
+  }
+  if (FLAGS_MAX_RUSTC_DEPS_CACHE_ENTRIES > 0) {
+    devtools_goma::RustcDepsCache::Init(FLAGS_MAX_RUSTC_DEPS_CACHE_ENTRIES);
+  }
+  if (FLAGS_MAX_DART_IMPORT_CACHE_ENTRIES > 0) {
+    devtools_goma::DartImportCache::Init(
+        FLAGS_MAX_DART_IMPORT_CACHE_ENTRIES);
+    devtools_goma::DartImportCache::instance()->StartPool(
+        &wm, FLAGS_DART_IMPORT_THREADS);
+  }
 
   devtools_goma::DepsCacheInit();
   std::unique_ptr<devtools_goma::WorkerThreadRunner> load_deps_cache(
@@ -381,6 +458,10 @@ int main(int argc, char* argv[], const char* envp[]) {
       FLAGS_LOCAL_OUTPUT_CACHE_THRESHOLD_CACHE_AMOUNT_IN_MB,
       FLAGS_LOCAL_OUTPUT_CACHE_MAX_ITEMS,
       FLAGS_LOCAL_OUTPUT_CACHE_THRESHOLD_ITEMS);
+  if (devtools_goma::LocalOutputCache::IsEnabled()) {
+    devtools_goma::LocalOutputCache::instance()->SetUseHardLink(
+        FLAGS_LOCAL_OUTPUT_CACHE_USE_HARDLINK);
+  }
 
   // Show memory just before server loop to understand how much memory is
   // used for initialization.
@@ -407,6 +488,7 @@ int main(int argc, char* argv[], const char* envp[]) {
 
   load_deps_cache.reset();
   load_compiler_info_cache.reset();
+  cleanup_include_cache_dir.reset();
   // TODO: Remove this when b/118804052 is fixed.
   devtools_goma::CompilerInfoCache::instance()->Save();
 
@@ -415,8 +497,14 @@ int main(int argc, char* argv[], const char* envp[]) {
   devtools_goma::CompilerInfoCache::Quit();
   devtools_goma::DepsCache::Quit();
   devtools_goma::IncludeCache::Quit();
+  devtools_goma::CppPreambleCache::Quit();
   devtools_goma::modulemap::Cache::Quit();
   devtools_goma::ListDirCache::Quit();
+  devtools_goma::LinkerDriverDumpCache::Quit();
+  devtools_goma::DynamicDepIndex::Quit();
+  devtools_goma::JarManifestCache::Quit();
+  devtools_goma::RustcDepsCache::Quit();
+  devtools_goma::DartImportCache::Quit();
   devtools_goma::SubProcessControllerClient::Get()->Shutdown();
 
   handler.reset();
@@ -425,6 +513,7 @@ int main(int argc, char* argv[], const char* envp[]) {
   if (FLAGS_ENABLE_GLOBAL_FILE_STAT_CACHE) {
     devtools_goma::GlobalFileStatCache::Quit();
   }
+  devtools_goma::TraceEventRecorder::Quit();
 
 #if HAVE_COUNTERZ
   if (FLAGS_ENABLE_COUNTERZ) {
@@ -6,12 +6,12 @@
 #ifndef DEVTOOLS_GOMA_CLIENT_COMPILER_PROXY_HISTOGRAM_H_
 #define DEVTOOLS_GOMA_CLIENT_COMPILER_PROXY_HISTOGRAM_H_
 
+#include <memory>
 #include <sstream>
 #include <vector>
 
 #include "basictypes.h"
-#include "histogram.h"
-#include "lockhelper.h"
+#include "hdr_histogram.h"
 #include "threadpool_http_server.h"
 
 namespace devtools_goma {
@@ -19,6 +19,9 @@ namespace devtools_goma {
 class CompileStats;
 class GomaHistograms;
 
+// CompilerProxyHistogram keeps HdrHistogram for each item.
+// Items are updated without lock, so that tasks finishing at the same time
+// don't contend.
 class CompilerProxyHistogram {
  public:
   enum HistogramItems {
@@ -68,6 +71,11 @@ class CompilerProxyHistogram {
     OutputFileRespRawSize,
     OutputFileRespCompressionRatio,
 
+    // Stats for file I/O
+    FileIOWaitTime,
+    CommitOutputTime,
+    LocalOutputCacheSaveTime,
+
     // Stats for subprocess
     LocalDelayTime,
     LocalPendingTime,
@@ -101,8 +109,7 @@ class CompilerProxyHistogram {
   void Reset();
 
  private:
-  mutable Lock mu_;
-  std::vector<Histogram> histogram_;
+  std::vector<std::unique_ptr<HdrHistogram>> histogram_;
 
   DISALLOW_COPY_AND_ASSIGN(CompilerProxyHistogram);
 };
@@ -13,6 +13,7 @@
 #include "absl/time/clock.h"
 #include "absl/time/time.h"
 #include "chart.bundle.min.h"
+#include "compiler_flags_template_cache.h"
 #include "compiler_proxy_contentionz_script.h"
 #include "compiler_proxy_histogram.h"
 #include "compiler_proxy_info.h"
@@ -50,6 +51,7 @@
 #include "rand_util.h"
 #include "rpc_controller.h"
 #include "subprocess_controller_client.h"
+#include "trace_event_recorder.h"
 #include "util.h"
 
 #if HAVE_HEAP_PROFILER
@@ -250,15 +252,28 @@ CompilerProxyHttpHandler::CompilerProxyHttpHandler(std::string myname,
       absl::Milliseconds(FLAGS_MULTI_STORE_PENDING_MS);
   service_.SetMultiFileStore(absl::make_unique<MultiFileStore>(
       service_.http_rpc(), "/s", multi_store_options, wm));
-  service_.SetFileServiceHttpClient(absl::make_unique<FileServiceHttpClient>(
-      service_.http_rpc(), "/s", "/l", service_.multi_file_store()));
+  std::unique_ptr<FileServiceHttpClient> file_service_client =
+      absl::make_unique<FileServiceHttpClient>(
+          service_.http_rpc(), "/s", "/l", service_.multi_file_store());
+  file_service_client->SetChunkConcurrency(
+      FLAGS_FILE_CHUNK_CONCURRENCY_PER_FILE,
+      std::make_shared<ChunkConcurrencyLimiter>(
+          FLAGS_FILE_CHUNK_CONCURRENCY));
+  service_.SetFileServiceHttpClient(std::move(file_service_client));
+  if (FLAGS_COMPILER_FLAGS_TEMPLATE_CACHE_SIZE > 0) {
+    service_.SetCompilerFlagsTemplateCache(
+        absl::make_unique<CompilerFlagsTemplateCache>(
+            FLAGS_COMPILER_FLAGS_TEMPLATE_CACHE_SIZE));
+  }
   if (FLAGS_PROVIDE_INFO)
     service_.SetLogServiceClient(absl::make_unique<LogServiceClient>(
         service_.http_rpc(), "/sl", FLAGS_NUM_LOG_IN_SAVE_LOG,
         absl::Milliseconds(FLAGS_LOG_PENDING_MS), wm));
+  ArFile::SetUseMmap(FLAGS_ARFILE_USE_MMAP);
   ArFileReader::Register();
   JarFileReader::Register();
   service_.StartIncludeProcessorWorkers(FLAGS_INCLUDE_PROCESSOR_THREADS);
+  service_.StartFileIOWorkers(FLAGS_FILE_IO_THREADS);
   service_.SetNeedToSendContent(FLAGS_COMPILER_PROXY_STORE_FILE);
   service_.SetNewFileThresholdDuration(
       absl::Seconds(FLAGS_COMPILER_PROXY_NEW_FILE_THRESHOLD));
@@ -381,6 +396,8 @@ CompilerProxyHttpHandler::CompilerProxyHttpHandler(std::string myname,
       "/api/compilerz", &CompilerProxyHttpHandler::HandleCompilerJSONRequest));
   internal_http_handlers_.insert(std::make_pair(
       "/api/rbe_statsz", &CompilerProxyHttpHandler::HandleRbeStatsRequest));
+  internal_http_handlers_.insert(std::make_pair(
+      "/api/tracez", &CompilerProxyHttpHandler::HandleTraceRequest));
   http_handlers_.insert(
       std::make_pair("/statz", &CompilerProxyHttpHandler::HandleStatsRequest));
   http_handlers_.insert(std::make_pair(
@@ -584,6 +601,7 @@ void CompilerProxyHttpHandler::HandleHttpRequest(
       DumpContentionLogToInfoLog();
       DumpStatsProto();
       DumpCounterz();
+      DumpTraceEvents();
       DumpDirectiveOptimizer();
       LOG(INFO) << "Dump done.";
       FlushLogFiles();
@@ -1141,6 +1159,29 @@ int CompilerProxyHttpHandler::HandleRbeStatsRequest(
   return 200;
 }
 
+int CompilerProxyHttpHandler::HandleTraceRequest(
+    const HttpServerRequest& /* request */,
+    std::string* response) {
+  std::ostringstream ss;
+  if (!TraceEventRecorder::IsEnabled()) {
+    const std::string content = "trace event is not recorded.\r\n";
+    ss << "HTTP/1.1 404 Not Found\r\n";
+    ss << "Content-Type: text/plain\r\n";
+    ss << "Content-Length: " << content.size() << "\r\n";
+    ss << "\r\n";
+    ss << content;
+    *response = ss.str();
+    return 404;
+  }
+
+  Json::Value json;
+  TraceEventRecorder::instance()->DumpToJson(&json);
+  Json::FastWriter writer;
+  OutputOkHeaderAndBody("application/json", writer.write(json), &ss);
+  *response = ss.str();
+  return 200;
+}
+
 int CompilerProxyHttpHandler::HandleIncludeCacheRequest(
     const HttpServerRequest& /* request */,
     std::string* response) {
@@ -1461,6 +1502,13 @@ void CompilerProxyHttpHandler::DumpCounterz() {
 #endif  // HAVE_COUNTERZ
 }
 
+void CompilerProxyHttpHandler::DumpTraceEvents() {
+  if (FLAGS_DUMP_TRACE_EVENT_FILE.empty())
+    return;
+
+  TraceEventRecorder::Dump(FLAGS_DUMP_TRACE_EVENT_FILE);
+}
+
 void CompilerProxyHttpHandler::DumpDirectiveOptimizer() {
   std::ostringstream ss;
   CppDirectiveOptimizer::DumpStats(&ss);
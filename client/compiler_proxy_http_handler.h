@@ -140,6 +140,9 @@ class CompilerProxyHttpHandler : public ThreadpoolHttpServer::HttpHandler,
   int HandleRbeStatsRequest(const HttpServerRequest& /* request */,
                             std::string* response);
 
+  int HandleTraceRequest(const HttpServerRequest& /* request */,
+                         std::string* response);
+
   int HandleIncludeCacheRequest(const HttpServerRequest& /* request */,
                                 std::string* response);
 
@@ -192,6 +195,7 @@ class CompilerProxyHttpHandler : public ThreadpoolHttpServer::HttpHandler,
   void DumpStatsProto();
 
   void DumpCounterz();
+  void DumpTraceEvents();
 
   void DumpDirectiveOptimizer();
 
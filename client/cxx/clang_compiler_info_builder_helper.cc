@@ -4,6 +4,9 @@
 
 #include "clang_compiler_info_builder_helper.h"
 
+#include <functional>
+#include <vector>
+
 #include "absl/memory/memory.h"
 #include "absl/strings/ascii.h"
 #include "absl/strings/match.h"
@@ -870,50 +873,69 @@ bool ClangCompilerInfoBuilderHelper::SetBasicCompilerInfo(
   //
   // Note that the way to get system include paths are still under discussion
   // in b/13178705.
+  //
+  // The compiler invocations below are independent of each other, so they
+  // run concurrently. Each of them writes its own output, and the outputs
+  // are examined in the original order after all of them finished.
   std::string c_output, cxx_output;
+  int32_t c_status = 0;
+  int32_t cxx_status = 0;
+  std::vector<std::function<void()>> probes;
   if (is_cplusplus) {
-    int32_t status;
-    cxx_output =
-        GccDisplayPrograms(local_compiler_path, compiler_info_flags,
-                           compiler_info_envs, cxx_lang_flag, "", cwd, &status);
-    if (status != 0) {
-      CompilerInfoBuilder::AddErrorMessage(
-          "Failed to execute compiler to get c++ system "
-          "include paths for " +
-              local_compiler_path,
-          compiler_info);
-      LOG(ERROR) << compiler_info->error_message() << " status=" << status
-                 << " cxx_output=" << cxx_output;
-      return false;
-    }
-    c_output = GccDisplayPrograms(local_compiler_path, compiler_info_flags,
-                                  compiler_info_envs, cxx_lang_flag,
-                                  "-nostdinc++", cwd, &status);
-    if (status != 0) {
-      CompilerInfoBuilder::AddErrorMessage(
-          "Failed to execute compiler to get c system "
-          "include paths for " +
-              local_compiler_path,
-          compiler_info);
-      LOG(ERROR) << compiler_info->error_message() << " status=" << status
-                 << " c_output=" << c_output;
-      return false;
-    }
+    probes.emplace_back([&]() {
+      cxx_output = GccDisplayPrograms(local_compiler_path, compiler_info_flags,
+                                      compiler_info_envs, cxx_lang_flag, "",
+                                      cwd, &cxx_status);
+    });
+    probes.emplace_back([&]() {
+      c_output = GccDisplayPrograms(local_compiler_path, compiler_info_flags,
+                                    compiler_info_envs, cxx_lang_flag,
+                                    "-nostdinc++", cwd, &c_status);
+    });
   } else {
-    int32_t status;
-    c_output =
-        GccDisplayPrograms(local_compiler_path, compiler_info_flags,
-                           compiler_info_envs, c_lang_flag, "", cwd, &status);
-    if (status != 0) {
-      CompilerInfoBuilder::AddErrorMessage(
-          "Failed to execute compiler to get c system "
-          "include paths for " +
-              local_compiler_path,
-          compiler_info);
-      LOG(ERROR) << compiler_info->error_message() << " status=" << status
-                 << " c_output=" << c_output;
-      return false;
-    }
+    probes.emplace_back([&]() {
+      c_output = GccDisplayPrograms(local_compiler_path, compiler_info_flags,
+                                    compiler_info_envs, c_lang_flag, "", cwd,
+                                    &c_status);
+    });
+  }
+  // Predefined macros and features are set in their own CompilerInfoData,
+  // since |compiler_info| must not be modified concurrently.
+  CompilerInfoData macros_info;
+  bool has_macros = false;
+  probes.emplace_back([&]() {
+    has_macros =
+        GetPredefinedMacros(local_compiler_path, compiler_info_flags,
+                            compiler_info_envs, cwd, lang_flag, &macros_info);
+  });
+  CompilerInfoData features_info;
+  bool has_features = false;
+  probes.emplace_back([&]() {
+    has_features = GetPredefinedFeaturesAndExtensions(
+        local_compiler_path, lang_flag, compiler_info_flags,
+        compiler_info_envs, cwd, &features_info);
+  });
+  CxxCompilerInfoBuilder::RunProbesConcurrently(std::move(probes));
+
+  if (cxx_status != 0) {
+    CompilerInfoBuilder::AddErrorMessage(
+        "Failed to execute compiler to get c++ system "
+        "include paths for " +
+            local_compiler_path,
+        compiler_info);
+    LOG(ERROR) << compiler_info->error_message() << " status=" << cxx_status
+               << " cxx_output=" << cxx_output;
+    return false;
+  }
+  if (c_status != 0) {
+    CompilerInfoBuilder::AddErrorMessage(
+        "Failed to execute compiler to get c system "
+        "include paths for " +
+            local_compiler_path,
+        compiler_info);
+    LOG(ERROR) << compiler_info->error_message() << " status=" << c_status
+               << " c_output=" << c_output;
+    return false;
   }
 
   if (!GetSystemIncludePaths(local_compiler_path, compiler_info_flags,
@@ -925,14 +947,15 @@ bool ClangCompilerInfoBuilderHelper::SetBasicCompilerInfo(
     LOG(ERROR) << compiler_info->error_message();
     return false;
   }
-  if (!GetPredefinedMacros(local_compiler_path, compiler_info_flags,
-                           compiler_info_envs, cwd, lang_flag, compiler_info)) {
+  if (!has_macros) {
     CompilerInfoBuilder::AddErrorMessage(
         "Failed to get predefined macros for " + local_compiler_path,
         compiler_info);
     LOG(ERROR) << compiler_info->error_message();
     return false;
   }
+  compiler_info->mutable_cxx()->set_predefined_macros(
+      macros_info.cxx().predefined_macros());
 
   if (!c_output.empty()) {
     std::vector<ClangCompilerInfoBuilderHelper::ResourceList> resource;
@@ -980,9 +1003,11 @@ bool ClangCompilerInfoBuilderHelper::SetBasicCompilerInfo(
     }
   }
 
-  if (!GetPredefinedFeaturesAndExtensions(
-          local_compiler_path, lang_flag, compiler_info_flags,
-          compiler_info_envs, cwd, compiler_info)) {
+  if (features_info.has_error_message()) {
+    CompilerInfoBuilder::AddErrorMessage(features_info.error_message(),
+                                         compiler_info);
+  }
+  if (!has_features) {
     CompilerInfoBuilder::AddErrorMessage(
         "failed to get predefined features and extensions for " +
             local_compiler_path,
@@ -993,6 +1018,7 @@ bool ClangCompilerInfoBuilderHelper::SetBasicCompilerInfo(
     DCHECK(compiler_info->has_error_message());
     return false;
   }
+  compiler_info->mutable_cxx()->MergeFrom(features_info.cxx());
   return true;
 }
 
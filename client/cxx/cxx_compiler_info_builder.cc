@@ -4,6 +4,9 @@
 
 #include "cxx_compiler_info_builder.h"
 
+#include <memory>
+
+#include "absl/memory/memory.h"
 #include "absl/strings/str_split.h"
 #include "cmdline_parser.h"
 #include "compiler_info.h"
@@ -13,12 +16,68 @@
 #include "goma_hash.h"
 #include "ioutil.h"
 #include "path.h"
+#include "platform_thread.h"
 #include "scoped_tmp_file.h"
 #include "sha256_hash_cache.h"
 #include "util.h"
 
 namespace devtools_goma {
 
+namespace {
+
+class ProbeThread : public PlatformThread::Delegate {
+ public:
+  explicit ProbeThread(std::function<void()> probe)
+      : probe_(std::move(probe)) {}
+
+  ~ProbeThread() override {
+    if (handle_ != kNullThreadHandle) {
+      PlatformThread::Join(handle_);
+    }
+  }
+
+  // Returns false if a thread could not be created.
+  bool Start() {
+    if (!PlatformThread::Create(this, &handle_)) {
+      handle_ = kNullThreadHandle;
+      return false;
+    }
+    return true;
+  }
+
+  void ThreadMain() override { probe_(); }
+
+ private:
+  std::function<void()> probe_;
+  PlatformThreadHandle handle_ = kNullThreadHandle;
+};
+
+}  // anonymous namespace
+
+/* static */
+void CxxCompilerInfoBuilder::RunProbesConcurrently(
+    std::vector<std::function<void()>> probes) {
+  if (probes.empty()) {
+    return;
+  }
+  GOMA_COUNTERZ("RunProbesConcurrently");
+
+  // The first probe runs on the current thread.
+  std::vector<std::unique_ptr<ProbeThread>> threads;
+  for (size_t i = 1; i < probes.size(); ++i) {
+    auto thread = absl::make_unique<ProbeThread>(probes[i]);
+    if (!thread->Start()) {
+      LOG(WARNING) << "failed to create a thread for probe. run it serially.";
+      probes[i]();
+      continue;
+    }
+    threads.push_back(std::move(thread));
+  }
+  probes[0]();
+  // ProbeThread joins its thread in the destructor.
+  threads.clear();
+}
+
 /* static */
 void CxxCompilerInfoBuilder::ParseGetSubprogramsOutput(
     const std::string& gcc_output,
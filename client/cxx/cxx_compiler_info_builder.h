@@ -5,6 +5,7 @@
 #ifndef DEVTOOLS_GOMA_CLIENT_CXX_CXX_COMPILER_INFO_BUILDER_H_
 #define DEVTOOLS_GOMA_CLIENT_CXX_CXX_COMPILER_INFO_BUILDER_H_
 
+#include <functional>
 #include <string>
 #include <vector>
 
@@ -41,6 +42,13 @@ class CxxCompilerInfoBuilder : public CompilerInfoBuilder {
                                      const std::string& abs_path,
                                      CompilerInfoData::SubprogramInfo* s);
 
+  // Runs |probes| concurrently, and returns after all of them finished.
+  // A probe usually runs the compiler with ReadCommandOutput, which blocks
+  // until the compiler exits, so running independent probes at the same
+  // time reduces the latency to build CompilerInfo.
+  // Probes must not touch the same object without synchronization.
+  static void RunProbesConcurrently(std::vector<std::function<void()>> probes);
+
   void SetLanguageExtension(CompilerInfoData* data) const override;
 };
 
@@ -4,7 +4,13 @@
 
 #include "cxx_compiler_info_builder.h"
 
+#include <atomic>
+#include <functional>
+#include <vector>
+
 #include "absl/memory/memory.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
 #include "cxx_compiler_info.h"
 #include "gtest/gtest.h"
 #include "mypath.h"
@@ -275,4 +281,30 @@ TEST_F(CxxCompilerInfoBuilderTest, GetRealSubprogramPath) {
 }
 #endif
 
+TEST_F(CxxCompilerInfoBuilderTest, RunProbesConcurrently) {
+  static constexpr int kNumProbes = 4;
+  std::atomic<int> num_started(0);
+  bool saw_all_started[kNumProbes] = {};
+
+  std::vector<std::function<void()>> probes;
+  for (int i = 0; i < kNumProbes; ++i) {
+    probes.emplace_back([i, &num_started, &saw_all_started]() {
+      ++num_started;
+      // Each probe waits for the others, which would time out if probes ran
+      // one by one.
+      const absl::Time deadline = absl::Now() + absl::Seconds(10);
+      while (num_started.load() < kNumProbes && absl::Now() < deadline) {
+        absl::SleepFor(absl::Milliseconds(1));
+      }
+      saw_all_started[i] = num_started.load() == kNumProbes;
+    });
+  }
+  CxxCompilerInfoBuilder::RunProbesConcurrently(std::move(probes));
+
+  EXPECT_EQ(kNumProbes, num_started.load());
+  for (int i = 0; i < kNumProbes; ++i) {
+    EXPECT_TRUE(saw_all_started[i]) << i;
+  }
+}
+
 }  // namespace devtools_goma
@@ -4,6 +4,9 @@
 
 #include "gcc_compiler_info_builder.h"
 
+#include <functional>
+#include <vector>
+
 #include "absl/strings/match.h"
 #include "base/path.h"
 #include "client/autolock_timer.h"
@@ -212,16 +215,6 @@ void GCCCompilerInfoBuilder::SetTypeSpecificCompilerInfo(
     const std::string& abs_local_compiler_path,
     const std::vector<std::string>& compiler_info_envs,
     CompilerInfoData* data) const {
-  // Some compilers uses wrapper script to set build target, and in such a
-  // situation, build target could be different.
-  // To make goma backend use proper wrapper script, or set proper -target,
-  // we should need to use local_compiler_path instead of real path.
-  bool has_version = GetGccVersion(abs_local_compiler_path, compiler_info_envs,
-                                   flags.cwd(), data->mutable_version());
-  bool has_target = GetGccTarget(abs_local_compiler_path, compiler_info_envs,
-                                 flags.cwd(), data->mutable_target());
-
-
   const GCCFlags& gcc_flags = static_cast<const GCCFlags&>(flags);
 
   // If input is LLVM IR, we assume it ThinLTO backend phase.
@@ -240,12 +233,41 @@ void GCCCompilerInfoBuilder::SetTypeSpecificCompilerInfo(
   //               (-isystem and CPLUS_INCLUDE_PATH).
   //               Once b/5218687 is fixed, we should
   //               be able to eliminate cxx_system_include_paths.
-  if (!is_input_ir &&
-      !ClangCompilerInfoBuilderHelper::SetBasicCompilerInfo(
+  //
+  // Version and target are taken concurrently with the basic compiler info.
+  // Some compilers uses wrapper script to set build target, and in such a
+  // situation, build target could be different.
+  // To make goma backend use proper wrapper script, or set proper -target,
+  // we should need to use local_compiler_path instead of real path.
+  std::string version;
+  std::string target;
+  bool has_version = false;
+  bool has_target = false;
+  bool has_basic_info = true;
+  std::vector<std::function<void()>> probes;
+  if (!is_input_ir) {
+    // |data| is modified only by this probe.
+    probes.emplace_back([&]() {
+      has_basic_info = ClangCompilerInfoBuilderHelper::SetBasicCompilerInfo(
           local_compiler_path, gcc_flags.compiler_info_flags(),
           compiler_info_envs, gcc_flags.cwd(), "-x" + flags.lang(),
           gcc_flags.resource_dir(), gcc_flags.is_cplusplus(),
-          gcc_flags.has_nostdinc(), data)) {
+          gcc_flags.has_nostdinc(), data);
+    });
+  }
+  probes.emplace_back([&]() {
+    has_version = GetGccVersion(abs_local_compiler_path, compiler_info_envs,
+                                flags.cwd(), &version);
+  });
+  probes.emplace_back([&]() {
+    has_target = GetGccTarget(abs_local_compiler_path, compiler_info_envs,
+                              flags.cwd(), &target);
+  });
+  RunProbesConcurrently(std::move(probes));
+  data->set_version(version);
+  data->set_target(target);
+
+  if (!has_basic_info) {
     DCHECK(data->has_error_message());
     // If error occurred in SetBasicCompilerInfo, we do not need to
     // continue.
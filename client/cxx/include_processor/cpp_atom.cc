@@ -0,0 +1,190 @@
+// Copyright 2021 The Goma Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "cpp_atom.h"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/hash/hash.h"
+#include "autolock_timer.h"
+#include "basictypes.h"
+#include "glog/logging.h"
+#include "lockhelper.h"
+
+namespace devtools_goma {
+
+namespace {
+
+// Identifiers are looked up in one of kNumShards maps, to reduce lock
+// contention between threads tokenizing different files.
+constexpr size_t kNumShards = 16;
+
+// id to identifier table is a fixed array of chunks, so that it can be read
+// without lock while new identifiers are added.
+constexpr int kChunkBits = 12;
+constexpr uint32_t kChunkSize = 1 << kChunkBits;
+constexpr uint32_t kMaxChunks = 1 << 12;
+constexpr uint32_t kMaxId = kChunkSize * kMaxChunks - 1;
+
+class CppAtomTable {
+ public:
+  CppAtomTable() : next_id_(1), max_id_(kMaxId), num_failures_(0) {
+    for (auto& chunk : chunks_) {
+      chunk.store(nullptr, std::memory_order_relaxed);
+    }
+    // id 0 is for the empty atom.
+    EnsureChunk(0)[0] = new std::string();
+  }
+
+  uint32_t Intern(absl::string_view name) {
+    if (name.empty()) {
+      return 0;
+    }
+    Shard& shard = shards_[absl::Hash<absl::string_view>()(name) % kNumShards];
+    {
+      AUTO_SHARED_LOCK(lock, &shard.mu);
+      auto it = shard.ids.find(name);
+      if (it != shard.ids.end()) {
+        return it->second;
+      }
+    }
+
+    AUTO_EXCLUSIVE_LOCK(lock, &shard.mu);
+    auto it = shard.ids.find(name);
+    if (it != shard.ids.end()) {
+      return it->second;
+    }
+    const uint32_t id = NewId();
+    if (id == 0) {
+      if (num_failures_.fetch_add(1, std::memory_order_relaxed) == 0) {
+        LOG(ERROR) << "too many identifiers are interned:"
+                   << " max=" << max_id_.load(std::memory_order_relaxed)
+                   << " name=" << name;
+      }
+      return 0;
+    }
+    const std::string* str = new std::string(name);
+    // The identifier must be stored before |id| is published.
+    EnsureChunk(id / kChunkSize)[id % kChunkSize] = str;
+    shard.ids.emplace(*str, id);
+    return id;
+  }
+
+  uint32_t Find(absl::string_view name) {
+    if (name.empty()) {
+      return 0;
+    }
+    Shard& shard = shards_[absl::Hash<absl::string_view>()(name) % kNumShards];
+    AUTO_SHARED_LOCK(lock, &shard.mu);
+    auto it = shard.ids.find(name);
+    if (it == shard.ids.end()) {
+      return 0;
+    }
+    return it->second;
+  }
+
+  const std::string& Get(uint32_t id) const {
+    const std::string* const* chunk =
+        chunks_[id / kChunkSize].load(std::memory_order_acquire);
+    DCHECK(chunk != nullptr) << id;
+    return *chunk[id % kChunkSize];
+  }
+
+  size_t size() const {
+    return next_id_.load(std::memory_order_relaxed) - 1;
+  }
+
+  size_t num_failures() const {
+    return num_failures_.load(std::memory_order_relaxed);
+  }
+
+  void set_max_id(size_t max_id) {
+    max_id_.store(static_cast<uint32_t>(std::min<size_t>(max_id, kMaxId)),
+                  std::memory_order_relaxed);
+  }
+
+ private:
+  struct Shard {
+    ReadWriteLock mu;
+    absl::flat_hash_map<absl::string_view, uint32_t> ids GUARDED_BY(mu);
+  };
+
+  // Returns a new id, or 0 if the table is full.
+  uint32_t NewId() {
+    uint32_t id = next_id_.load(std::memory_order_relaxed);
+    do {
+      if (id > max_id_.load(std::memory_order_relaxed)) {
+        return 0;
+      }
+    } while (!next_id_.compare_exchange_weak(id, id + 1,
+                                             std::memory_order_relaxed));
+    return id;
+  }
+
+  const std::string** EnsureChunk(uint32_t index) {
+    const std::string** chunk = chunks_[index].load(std::memory_order_acquire);
+    if (chunk != nullptr) {
+      return chunk;
+    }
+    std::unique_ptr<const std::string* []> new_chunk(
+        new const std::string* [kChunkSize]());
+    if (chunks_[index].compare_exchange_strong(chunk, new_chunk.get(),
+                                               std::memory_order_acq_rel)) {
+      return new_chunk.release();
+    }
+    // Another thread has set the chunk.
+    return chunk;
+  }
+
+  Shard shards_[kNumShards];
+  std::atomic<uint32_t> next_id_;
+  std::atomic<uint32_t> max_id_;
+  std::atomic<size_t> num_failures_;
+  std::atomic<const std::string**> chunks_[kMaxChunks];
+
+  DISALLOW_COPY_AND_ASSIGN(CppAtomTable);
+};
+
+CppAtomTable* GetCppAtomTable() {
+  // Never deleted, since CppAtom can be used until the process exits.
+  static CppAtomTable* table = new CppAtomTable();
+  return table;
+}
+
+}  // anonymous namespace
+
+// static
+CppAtom CppAtom::Intern(absl::string_view name) {
+  return CppAtom(GetCppAtomTable()->Intern(name));
+}
+
+// static
+CppAtom CppAtom::Find(absl::string_view name) {
+  return CppAtom(GetCppAtomTable()->Find(name));
+}
+
+// static
+size_t CppAtom::NumAtoms() {
+  return GetCppAtomTable()->size();
+}
+
+// static
+size_t CppAtom::NumInternFailures() {
+  return GetCppAtomTable()->num_failures();
+}
+
+// static
+void CppAtom::SetMaxAtomsForTest(size_t max_atoms) {
+  // id 0 is the empty atom, so the max id is the same as |max_atoms|.
+  GetCppAtomTable()->set_max_id(max_atoms);
+}
+
+const std::string& CppAtom::str() const {
+  return GetCppAtomTable()->Get(id_);
+}
+
+}  // namespace devtools_goma
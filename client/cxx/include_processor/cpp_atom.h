@@ -0,0 +1,73 @@
+// Copyright 2021 The Goma Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef DEVTOOLS_GOMA_CLIENT_CXX_INCLUDE_PROCESSOR_CPP_ATOM_H_
+#define DEVTOOLS_GOMA_CLIENT_CXX_INCLUDE_PROCESSOR_CPP_ATOM_H_
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <utility>
+
+#include "absl/strings/string_view.h"
+
+namespace devtools_goma {
+
+// CppAtom is an interned identifier.
+//
+// The same identifier is always interned to the same 32-bit id in the
+// process, so identifiers can be copied, compared and hashed as integers.
+// Interned identifiers are never freed, so the table has a fixed capacity.
+// Once it is full, Intern returns an empty atom for new identifiers, and
+// callers must keep the identifier text by themselves.
+//
+// CppAtom is thread-safe.
+class CppAtom {
+ public:
+  // Constructs an empty atom. Its str() is "".
+  CppAtom() : id_(0) {}
+
+  // Returns the atom of |name|, interning |name| if it is new.
+  // Returns an empty atom if |name| is new and the table is full.
+  static CppAtom Intern(absl::string_view name);
+
+  // Returns the atom of |name| if it has been interned.
+  // Returns an empty atom otherwise.
+  static CppAtom Find(absl::string_view name);
+
+  // Returns the number of interned identifiers.
+  static size_t NumAtoms();
+
+  // Returns the number of Intern calls that failed since the table was full.
+  static size_t NumInternFailures();
+
+  // Limits the number of interned identifiers to |max_atoms|, or to the
+  // table capacity if it is smaller. For testing.
+  static void SetMaxAtomsForTest(size_t max_atoms);
+
+  bool empty() const { return id_ == 0; }
+  uint32_t id() const { return id_; }
+  const std::string& str() const;
+
+  bool operator==(CppAtom other) const { return id_ == other.id_; }
+  bool operator!=(CppAtom other) const { return id_ != other.id_; }
+
+  template <typename H>
+  friend H AbslHashValue(H h, CppAtom atom) {
+    return H::combine(std::move(h), atom.id_);
+  }
+
+  friend std::ostream& operator<<(std::ostream& os, CppAtom atom) {
+    return os << atom.str();
+  }
+
+ private:
+  explicit CppAtom(uint32_t id) : id_(id) {}
+
+  uint32_t id_;
+};
+
+}  // namespace devtools_goma
+
+#endif  // DEVTOOLS_GOMA_CLIENT_CXX_INCLUDE_PROCESSOR_CPP_ATOM_H_
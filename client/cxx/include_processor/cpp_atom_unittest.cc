@@ -0,0 +1,83 @@
+// Copyright 2021 The Goma Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "cpp_atom.h"
+
+#include <limits>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace devtools_goma {
+
+TEST(CppAtomTest, Intern) {
+  const CppAtom empty;
+  EXPECT_TRUE(empty.empty());
+  EXPECT_EQ("", empty.str());
+  EXPECT_EQ(empty, CppAtom::Intern(""));
+
+  const CppAtom foo = CppAtom::Intern("cpp_atom_test_foo");
+  EXPECT_FALSE(foo.empty());
+  EXPECT_EQ("cpp_atom_test_foo", foo.str());
+  EXPECT_EQ(foo, CppAtom::Intern(std::string("cpp_atom_test_foo")));
+  EXPECT_EQ(foo, CppAtom::Find("cpp_atom_test_foo"));
+
+  const CppAtom bar = CppAtom::Intern("cpp_atom_test_bar");
+  EXPECT_NE(foo, bar);
+  EXPECT_EQ("cpp_atom_test_bar", bar.str());
+}
+
+TEST(CppAtomTest, FindNotInterned) {
+  EXPECT_TRUE(CppAtom::Find("cpp_atom_test_never_interned").empty());
+  EXPECT_TRUE(CppAtom::Find("").empty());
+}
+
+TEST(CppAtomTest, InternWhenFull) {
+  const CppAtom known = CppAtom::Intern("cpp_atom_test_known");
+  const size_t num_failures = CppAtom::NumInternFailures();
+  CppAtom::SetMaxAtomsForTest(CppAtom::NumAtoms());
+
+  EXPECT_TRUE(CppAtom::Intern("cpp_atom_test_when_full").empty());
+  EXPECT_EQ(num_failures + 1, CppAtom::NumInternFailures());
+  EXPECT_TRUE(CppAtom::Find("cpp_atom_test_when_full").empty());
+  // Interned identifiers are still available.
+  EXPECT_EQ(known, CppAtom::Intern("cpp_atom_test_known"));
+  EXPECT_EQ(num_failures + 1, CppAtom::NumInternFailures());
+
+  CppAtom::SetMaxAtomsForTest(std::numeric_limits<size_t>::max());
+  const CppAtom atom = CppAtom::Intern("cpp_atom_test_when_full");
+  EXPECT_FALSE(atom.empty());
+  EXPECT_EQ("cpp_atom_test_when_full", atom.str());
+}
+
+TEST(CppAtomTest, InternOnThreads) {
+  static const int kNumIdents = 10000;
+  static const int kNumThreads = 4;
+
+  std::vector<std::vector<CppAtom>> atoms(kNumThreads);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kNumThreads; ++t) {
+    threads.emplace_back([&atoms, t]() {
+      for (int i = 0; i < kNumIdents; ++i) {
+        atoms[t].push_back(
+            CppAtom::Intern("cpp_atom_test_" + std::to_string(i)));
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  for (int i = 0; i < kNumIdents; ++i) {
+    const std::string name = "cpp_atom_test_" + std::to_string(i);
+    for (int t = 0; t < kNumThreads; ++t) {
+      EXPECT_EQ(atoms[0][i], atoms[t][i]) << name;
+    }
+    EXPECT_EQ(name, atoms[0][i].str());
+  }
+}
+
+}  // namespace devtools_goma
@@ -0,0 +1,60 @@
+// Copyright 2021 The Goma Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef DEVTOOLS_GOMA_CLIENT_CXX_INCLUDE_PROCESSOR_CPP_CONDITION_MEMO_H_
+#define DEVTOOLS_GOMA_CLIENT_CXX_INCLUDE_PROCESSOR_CPP_CONDITION_MEMO_H_
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "cpp_atom.h"
+
+namespace devtools_goma {
+
+// CppConditionMemo keeps the last evaluated value of an #if or #elif
+// condition, with the macros used to evaluate it.
+//
+// Since cached directives are shared by CppParsers, the memo lets a parser
+// reuse a value evaluated by another parser (or for another translation
+// unit) if the macros used have the same definitions.
+//
+// CppConditionMemo is thread-safe.
+class CppConditionMemo {
+ public:
+  // A macro looked up while evaluating a condition.
+  struct MacroRef {
+    CppAtom atom;
+    // True if only defined(atom) was checked.
+    bool defined_only;
+    // True if the macro was defined.
+    bool defined;
+    // Macro::fingerprint if the macro was defined and expanded.
+    size_t fingerprint;
+  };
+
+  struct Entry {
+    int64_t value = 0;
+    // CppParser flags that change evaluation, e.g. is_cplusplus.
+    int parser_flags = 0;
+    std::vector<MacroRef> macro_refs;
+  };
+
+  CppConditionMemo() = default;
+
+  CppConditionMemo(const CppConditionMemo&) = delete;
+  CppConditionMemo& operator=(const CppConditionMemo&) = delete;
+
+  std::shared_ptr<const Entry> Get() const { return std::atomic_load(&entry_); }
+  void Set(std::shared_ptr<const Entry> entry) {
+    std::atomic_store(&entry_, std::move(entry));
+  }
+
+ private:
+  std::shared_ptr<const Entry> entry_;
+};
+
+}  // namespace devtools_goma
+
+#endif  // DEVTOOLS_GOMA_CLIENT_CXX_INCLUDE_PROCESSOR_CPP_CONDITION_MEMO_H_
@@ -9,6 +9,10 @@
 #include <string>
 #include <vector>
 
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "cpp_atom.h"
+#include "cpp_condition_memo.h"
 #include "cpp_macro.h"
 #include "cpp_token.h"
 
@@ -67,9 +71,10 @@ class CppDirective {
   }
 
  private:
+  friend class CppDirectiveArena;
   friend class CppDirectiveParser;
 
-  // CppDirectiveParser can set position.
+  // CppDirectiveParser and CppDirectiveArena can set position.
   void set_position(int pos) { position_ = pos; }
 
   const CppDirectiveType directive_type_;
@@ -87,7 +92,7 @@ class CppDirectiveIncludeBase : public CppDirective {
     DCHECK(delimiter_ == '<' || delimiter_ == '"') << delimiter_;
     return filename_;
   }
-  const std::vector<CppToken>& tokens() const {
+  absl::Span<const CppToken> tokens() const {
     // valid only if delimiter is ' '.
     DCHECK(delimiter_ == ' ') << delimiter_;
     return tokens_;
@@ -105,7 +110,15 @@ class CppDirectiveIncludeBase : public CppDirective {
   CppDirectiveIncludeBase(CppDirectiveType type, std::vector<CppToken> tokens)
       : CppDirective(type),
         delimiter_(' '),
-        tokens_(std::move(tokens)) {
+        owned_tokens_(std::move(tokens)),
+        tokens_(owned_tokens_) {
+  }
+  // |tokens| is owned by CppDirectiveArena.
+  CppDirectiveIncludeBase(CppDirectiveType type,
+                          absl::Span<const CppToken> tokens)
+      : CppDirective(type),
+        delimiter_(' '),
+        tokens_(tokens) {
   }
 
   std::string DebugString() const override;
@@ -114,7 +127,8 @@ class CppDirectiveIncludeBase : public CppDirective {
   const char delimiter_; // one of '<', '"', or ' '.
   const std::string filename_;
 
-  const std::vector<CppToken> tokens_;
+  const std::vector<CppToken> owned_tokens_;
+  const absl::Span<const CppToken> tokens_;
 };
 
 // ----------------------------------------------------------------------
@@ -130,6 +144,14 @@ class CppDirectiveInclude : public CppDirectiveIncludeBase {
                                 std::move(tokens)) {
   }
   ~CppDirectiveInclude() override {}
+
+ private:
+  friend class CppDirectiveArena;
+
+  explicit CppDirectiveInclude(absl::Span<const CppToken> tokens)
+      : CppDirectiveIncludeBase(CppDirectiveType::DIRECTIVE_INCLUDE,
+                                tokens) {
+  }
 };
 
 // ----------------------------------------------------------------------
@@ -145,6 +167,14 @@ class CppDirectiveImport : public CppDirectiveIncludeBase {
                                 std::move(tokens)) {
   }
   ~CppDirectiveImport() override {}
+
+ private:
+  friend class CppDirectiveArena;
+
+  explicit CppDirectiveImport(absl::Span<const CppToken> tokens)
+      : CppDirectiveIncludeBase(CppDirectiveType::DIRECTIVE_IMPORT,
+                                tokens) {
+  }
 };
 
 // ----------------------------------------------------------------------
@@ -160,6 +190,14 @@ class CppDirectiveIncludeNext : public CppDirectiveIncludeBase {
                                 std::move(tokens)) {
   }
   ~CppDirectiveIncludeNext() override {}
+
+ private:
+  friend class CppDirectiveArena;
+
+  explicit CppDirectiveIncludeNext(absl::Span<const CppToken> tokens)
+      : CppDirectiveIncludeBase(CppDirectiveType::DIRECTIVE_INCLUDE_NEXT,
+                                tokens) {
+  }
 };
 
 // ----------------------------------------------------------------------
@@ -167,25 +205,28 @@ class CppDirectiveIncludeNext : public CppDirectiveIncludeBase {
 class CppDirectiveDefine : public CppDirective {
  public:
   // ObjectMacro
-  CppDirectiveDefine(std::string name, std::vector<CppToken> replacement)
+  CppDirectiveDefine(absl::string_view name,
+                     std::vector<CppToken> replacement)
       : CppDirective(CppDirectiveType::DIRECTIVE_DEFINE),
-        macro_(new Macro(std::move(name),
-                         Macro::OBJ,
-                         std::move(replacement),
-                         0,
-                         false)) {}
+        owned_macro_(new Macro(name,
+                               Macro::OBJ,
+                               std::move(replacement),
+                               0,
+                               false)),
+        macro_(owned_macro_.get()) {}
 
   // FunctionMacro
-  CppDirectiveDefine(std::string name,
+  CppDirectiveDefine(absl::string_view name,
                      int num_args,
                      bool has_vararg,
                      std::vector<CppToken> replacement)
       : CppDirective(CppDirectiveType::DIRECTIVE_DEFINE),
-        macro_(new Macro(std::move(name),
-                         Macro::FUNC,
-                         std::move(replacement),
-                         num_args,
-                         has_vararg)) {}
+        owned_macro_(new Macro(name,
+                               Macro::FUNC,
+                               std::move(replacement),
+                               num_args,
+                               has_vararg)),
+        macro_(owned_macro_.get()) {}
   ~CppDirectiveDefine() override {}
 
   std::string DebugString() const override;
@@ -207,61 +248,77 @@ class CppDirectiveDefine : public CppDirective {
     return macro_->replacement;
   }
 
-  const Macro* macro() const { return macro_.get(); }
+  const Macro* macro() const { return macro_; }
 
  private:
-  const std::unique_ptr<Macro> macro_;
+  friend class CppDirectiveArena;
+
+  // |macro| is owned by CppDirectiveArena.
+  explicit CppDirectiveDefine(const Macro* macro)
+      : CppDirective(CppDirectiveType::DIRECTIVE_DEFINE), macro_(macro) {}
+
+  const std::unique_ptr<Macro> owned_macro_;
+  const Macro* const macro_;
 };
 
 // ----------------------------------------------------------------------
 
 class CppDirectiveUndef : public CppDirective {
  public:
-  explicit CppDirectiveUndef(std::string name)
+  explicit CppDirectiveUndef(absl::string_view name)
+      : CppDirectiveUndef(CppAtom::Intern(name)) {}
+  explicit CppDirectiveUndef(CppAtom name)
       : CppDirective(CppDirectiveType::DIRECTIVE_UNDEF),
-        name_(std::move(name)) {}
+        name_(name) {}
   ~CppDirectiveUndef() override {}
 
-  const std::string& name() const { return name_; }
+  const std::string& name() const { return name_.str(); }
+  CppAtom name_atom() const { return name_; }
 
-  std::string DebugString() const override { return "#undef " + name_; }
+  std::string DebugString() const override { return "#undef " + name(); }
 
  private:
-  const std::string name_;
+  const CppAtom name_;
 };
 
 // ----------------------------------------------------------------------
 
 class CppDirectiveIfdef : public CppDirective {
  public:
-  explicit CppDirectiveIfdef(std::string name)
+  explicit CppDirectiveIfdef(absl::string_view name)
+      : CppDirectiveIfdef(CppAtom::Intern(name)) {}
+  explicit CppDirectiveIfdef(CppAtom name)
       : CppDirective(CppDirectiveType::DIRECTIVE_IFDEF),
-        name_(std::move(name)) {}
+        name_(name) {}
   ~CppDirectiveIfdef() override {}
 
-  const std::string& name() const { return name_; }
+  const std::string& name() const { return name_.str(); }
+  CppAtom name_atom() const { return name_; }
 
-  std::string DebugString() const override { return "#ifdef " + name_; }
+  std::string DebugString() const override { return "#ifdef " + name(); }
 
  private:
-  const std::string name_;
+  const CppAtom name_;
 };
 
 // ----------------------------------------------------------------------
 
 class CppDirectiveIfndef : public CppDirective {
  public:
-  explicit CppDirectiveIfndef(std::string name)
+  explicit CppDirectiveIfndef(absl::string_view name)
+      : CppDirectiveIfndef(CppAtom::Intern(name)) {}
+  explicit CppDirectiveIfndef(CppAtom name)
       : CppDirective(CppDirectiveType::DIRECTIVE_IFNDEF),
-        name_(std::move(name)) {}
+        name_(name) {}
   ~CppDirectiveIfndef() override {}
 
-  const std::string& name() const { return name_; }
+  const std::string& name() const { return name_.str(); }
+  CppAtom name_atom() const { return name_; }
 
-  std::string DebugString() const override { return "#ifndef " + name_; }
+  std::string DebugString() const override { return "#ifndef " + name(); }
 
  private:
-  const std::string name_;
+  const CppAtom name_;
 };
 
 // ----------------------------------------------------------------------
@@ -270,15 +327,27 @@ class CppDirectiveIf : public CppDirective {
  public:
   explicit CppDirectiveIf(std::vector<CppToken> tokens)
       : CppDirective(CppDirectiveType::DIRECTIVE_IF),
-        tokens_(std::move(tokens)) {}
+        owned_tokens_(std::move(tokens)),
+        tokens_(owned_tokens_) {}
   ~CppDirectiveIf() override {}
 
-  const std::vector<CppToken>& tokens() const { return tokens_; }
+  absl::Span<const CppToken> tokens() const { return tokens_; }
+  // Memo of the evaluated condition. It can be updated by any CppParser
+  // using this directive.
+  CppConditionMemo* condition_memo() const { return &condition_memo_; }
 
   std::string DebugString() const override;
 
  private:
-  const std::vector<CppToken> tokens_;
+  friend class CppDirectiveArena;
+
+  // |tokens| is owned by CppDirectiveArena.
+  explicit CppDirectiveIf(absl::Span<const CppToken> tokens)
+      : CppDirective(CppDirectiveType::DIRECTIVE_IF), tokens_(tokens) {}
+
+  const std::vector<CppToken> owned_tokens_;
+  const absl::Span<const CppToken> tokens_;
+  mutable CppConditionMemo condition_memo_;
 };
 
 // ----------------------------------------------------------------------
@@ -307,14 +376,25 @@ class CppDirectiveElif : public CppDirective {
  public:
   explicit CppDirectiveElif(std::vector<CppToken> tokens)
       : CppDirective(CppDirectiveType::DIRECTIVE_ELIF),
-        tokens_(std::move(tokens)) {}
+        owned_tokens_(std::move(tokens)),
+        tokens_(owned_tokens_) {}
   ~CppDirectiveElif() override {}
 
-  const std::vector<CppToken>& tokens() const { return tokens_; }
+  absl::Span<const CppToken> tokens() const { return tokens_; }
+  // Memo of the evaluated condition. See CppDirectiveIf::condition_memo.
+  CppConditionMemo* condition_memo() const { return &condition_memo_; }
   std::string DebugString() const override;
 
  private:
-  const std::vector<CppToken> tokens_;
+  friend class CppDirectiveArena;
+
+  // |tokens| is owned by CppDirectiveArena.
+  explicit CppDirectiveElif(absl::Span<const CppToken> tokens)
+      : CppDirective(CppDirectiveType::DIRECTIVE_ELIF), tokens_(tokens) {}
+
+  const std::vector<CppToken> owned_tokens_;
+  const absl::Span<const CppToken> tokens_;
+  mutable CppConditionMemo condition_memo_;
 };
 
 // ----------------------------------------------------------------------
@@ -0,0 +1,231 @@
+// Copyright 2021 The Goma Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "cpp_directive_arena.h"
+
+#include <new>
+
+#include "glog/logging.h"
+
+namespace devtools_goma {
+
+namespace {
+
+// All objects in an arena are aligned to kAlignment.
+constexpr size_t kAlignment = alignof(void*);
+
+static_assert(alignof(CppToken) <= kAlignment, "CppToken is over aligned");
+static_assert(alignof(Macro) <= kAlignment, "Macro is over aligned");
+static_assert(alignof(CppDirectiveDefine) <= kAlignment,
+              "CppDirective is over aligned");
+
+constexpr size_t Aligned(size_t size) {
+  return (size + kAlignment - 1) & ~(kAlignment - 1);
+}
+
+size_t TokensSize(absl::Span<const CppToken> tokens) {
+  return Aligned(sizeof(CppToken) * tokens.size());
+}
+
+template <typename T>
+size_t IncludeSize(const CppDirectiveIncludeBase& directive) {
+  if (directive.delimiter() == ' ') {
+    return Aligned(sizeof(T)) + TokensSize(directive.tokens());
+  }
+  return Aligned(sizeof(T));
+}
+
+void DestroyTokens(absl::Span<const CppToken> tokens) {
+  for (const CppToken& token : tokens) {
+    token.~CppToken();
+  }
+}
+
+}  // anonymous namespace
+
+CppDirectiveArena::CppDirectiveArena(size_t size)
+    : block_(new char[size]), size_(size), used_(0) {}
+
+CppDirectiveArena::~CppDirectiveArena() {
+  // Tokens and macros in |block_| are owned by the arena, not by directives.
+  for (auto& directive : directives_) {
+    const CppDirective* d = directive.release();
+    switch (d->type()) {
+      case CppDirectiveType::DIRECTIVE_INCLUDE:
+      case CppDirectiveType::DIRECTIVE_IMPORT:
+      case CppDirectiveType::DIRECTIVE_INCLUDE_NEXT:
+        if (AsCppDirectiveIncludeBase(*d).delimiter() == ' ') {
+          DestroyTokens(AsCppDirectiveIncludeBase(*d).tokens());
+        }
+        break;
+      case CppDirectiveType::DIRECTIVE_DEFINE:
+        AsCppDirectiveDefine(*d).macro()->~Macro();
+        break;
+      case CppDirectiveType::DIRECTIVE_IF:
+        DestroyTokens(AsCppDirectiveIf(*d).tokens());
+        break;
+      case CppDirectiveType::DIRECTIVE_ELIF:
+        DestroyTokens(AsCppDirectiveElif(*d).tokens());
+        break;
+      default:
+        break;
+    }
+    d->~CppDirective();
+  }
+}
+
+// static
+SharedCppDirectives CppDirectiveArena::Compact(
+    const CppDirectiveList& directives,
+    size_t* allocated_bytes) {
+  size_t size = 0;
+  for (const auto& d : directives) {
+    size += ArenaSize(*d);
+  }
+
+  std::shared_ptr<CppDirectiveArena> arena(new CppDirectiveArena(size));
+  arena->directives_.reserve(directives.size());
+  for (const auto& d : directives) {
+    CppDirective* copied = arena->NewDirective(*d);
+    copied->set_position(d->position());
+    arena->directives_.emplace_back(copied);
+  }
+  DCHECK_EQ(arena->size_, arena->used_);
+
+  if (allocated_bytes != nullptr) {
+    *allocated_bytes = size;
+  }
+  const CppDirectiveList* list = &arena->directives_;
+  return SharedCppDirectives(std::move(arena), list);
+}
+
+// static
+size_t CppDirectiveArena::ArenaSize(const CppDirective& directive) {
+  switch (directive.type()) {
+    case CppDirectiveType::DIRECTIVE_INCLUDE:
+      return IncludeSize<CppDirectiveInclude>(
+          AsCppDirectiveIncludeBase(directive));
+    case CppDirectiveType::DIRECTIVE_IMPORT:
+      return IncludeSize<CppDirectiveImport>(
+          AsCppDirectiveIncludeBase(directive));
+    case CppDirectiveType::DIRECTIVE_INCLUDE_NEXT:
+      return IncludeSize<CppDirectiveIncludeNext>(
+          AsCppDirectiveIncludeBase(directive));
+    case CppDirectiveType::DIRECTIVE_DEFINE:
+      return Aligned(sizeof(CppDirectiveDefine)) + Aligned(sizeof(Macro));
+    case CppDirectiveType::DIRECTIVE_UNDEF:
+      return Aligned(sizeof(CppDirectiveUndef));
+    case CppDirectiveType::DIRECTIVE_IFDEF:
+      return Aligned(sizeof(CppDirectiveIfdef));
+    case CppDirectiveType::DIRECTIVE_IFNDEF:
+      return Aligned(sizeof(CppDirectiveIfndef));
+    case CppDirectiveType::DIRECTIVE_IF:
+      return Aligned(sizeof(CppDirectiveIf)) +
+             TokensSize(AsCppDirectiveIf(directive).tokens());
+    case CppDirectiveType::DIRECTIVE_ELSE:
+      return Aligned(sizeof(CppDirectiveElse));
+    case CppDirectiveType::DIRECTIVE_ENDIF:
+      return Aligned(sizeof(CppDirectiveEndif));
+    case CppDirectiveType::DIRECTIVE_ELIF:
+      return Aligned(sizeof(CppDirectiveElif)) +
+             TokensSize(AsCppDirectiveElif(directive).tokens());
+    case CppDirectiveType::DIRECTIVE_PRAGMA:
+      return Aligned(sizeof(CppDirectivePragma));
+    case CppDirectiveType::DIRECTIVE_ERROR:
+      return Aligned(sizeof(CppDirectiveError));
+  }
+
+  LOG(FATAL) << "unexpected directive type: "
+             << static_cast<int>(directive.type());
+  return 0;
+}
+
+void* CppDirectiveArena::Allocate(size_t size) {
+  size = Aligned(size);
+  CHECK_LE(used_ + size, size_);
+  void* p = block_.get() + used_;
+  used_ += size;
+  return p;
+}
+
+absl::Span<const CppToken> CppDirectiveArena::NewTokens(
+    absl::Span<const CppToken> tokens) {
+  if (tokens.empty()) {
+    return absl::Span<const CppToken>();
+  }
+  CppToken* copied =
+      static_cast<CppToken*>(Allocate(sizeof(CppToken) * tokens.size()));
+  for (size_t i = 0; i < tokens.size(); ++i) {
+    new (copied + i) CppToken(tokens[i]);
+  }
+  return absl::Span<const CppToken>(copied, tokens.size());
+}
+
+const Macro* CppDirectiveArena::NewMacro(const Macro& macro) {
+  return New<Macro>(macro);
+}
+
+template <typename T>
+CppDirective* CppDirectiveArena::NewInclude(
+    const CppDirectiveIncludeBase& directive) {
+  if (directive.delimiter() == ' ') {
+    // Allocate the directive first to keep it before its tokens.
+    void* p = Allocate(sizeof(T));
+    return new (p) T(NewTokens(directive.tokens()));
+  }
+  return New<T>(directive.delimiter(), directive.filename());
+}
+
+CppDirective* CppDirectiveArena::NewDirective(
+    const CppDirective& directive) {
+  switch (directive.type()) {
+    case CppDirectiveType::DIRECTIVE_INCLUDE:
+      return NewInclude<CppDirectiveInclude>(
+          AsCppDirectiveIncludeBase(directive));
+    case CppDirectiveType::DIRECTIVE_IMPORT:
+      return NewInclude<CppDirectiveImport>(
+          AsCppDirectiveIncludeBase(directive));
+    case CppDirectiveType::DIRECTIVE_INCLUDE_NEXT:
+      return NewInclude<CppDirectiveIncludeNext>(
+          AsCppDirectiveIncludeBase(directive));
+    case CppDirectiveType::DIRECTIVE_DEFINE: {
+      void* p = Allocate(sizeof(CppDirectiveDefine));
+      const Macro* macro = NewMacro(*AsCppDirectiveDefine(directive).macro());
+      return new (p) CppDirectiveDefine(macro);
+    }
+    case CppDirectiveType::DIRECTIVE_UNDEF:
+      return New<CppDirectiveUndef>(AsCppDirectiveUndef(directive).name_atom());
+    case CppDirectiveType::DIRECTIVE_IFDEF:
+      return New<CppDirectiveIfdef>(AsCppDirectiveIfdef(directive).name_atom());
+    case CppDirectiveType::DIRECTIVE_IFNDEF:
+      return New<CppDirectiveIfndef>(AsCppDirectiveIfndef(directive).name_atom());
+    case CppDirectiveType::DIRECTIVE_IF: {
+      void* p = Allocate(sizeof(CppDirectiveIf));
+      return new (p) CppDirectiveIf(
+          NewTokens(AsCppDirectiveIf(directive).tokens()));
+    }
+    case CppDirectiveType::DIRECTIVE_ELSE:
+      return New<CppDirectiveElse>();
+    case CppDirectiveType::DIRECTIVE_ENDIF:
+      return New<CppDirectiveEndif>();
+    case CppDirectiveType::DIRECTIVE_ELIF: {
+      void* p = Allocate(sizeof(CppDirectiveElif));
+      return new (p) CppDirectiveElif(
+          NewTokens(AsCppDirectiveElif(directive).tokens()));
+    }
+    case CppDirectiveType::DIRECTIVE_PRAGMA:
+      return New<CppDirectivePragma>(
+          AsCppDirectivePragma(directive).is_pragma_once());
+    case CppDirectiveType::DIRECTIVE_ERROR: {
+      const CppDirectiveError& error = AsCppDirectiveError(directive);
+      return New<CppDirectiveError>(error.error_reason(), error.arg());
+    }
+  }
+
+  LOG(FATAL) << "unexpected directive type: "
+             << static_cast<int>(directive.type());
+  return nullptr;
+}
+
+}  // namespace devtools_goma
@@ -0,0 +1,72 @@
+// Copyright 2021 The Goma Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef DEVTOOLS_GOMA_CLIENT_CXX_INCLUDE_PROCESSOR_CPP_DIRECTIVE_ARENA_H_
+#define DEVTOOLS_GOMA_CLIENT_CXX_INCLUDE_PROCESSOR_CPP_DIRECTIVE_ARENA_H_
+
+#include <memory>
+#include <utility>
+
+#include "absl/types/span.h"
+#include "basictypes.h"
+#include "cpp_directive.h"
+#include "cpp_macro.h"
+#include "cpp_token.h"
+
+namespace devtools_goma {
+
+// CppDirectiveArena stores the directives of one file in one memory block.
+//
+// CppDirectiveParser allocates each directive, its token vector and its
+// macro separately. CppDirectiveArena lays them out in the directive order
+// in a block, so a file kept in IncludeCache needs a few allocations
+// instead of several per directive, and CppParser reads the directives
+// sequentially from memory.
+class CppDirectiveArena {
+ public:
+  ~CppDirectiveArena();
+
+  // Copies |directives| into a new arena, and returns the copied
+  // directives. The returned SharedCppDirectives keeps the arena alive.
+  // If |allocated_bytes| is not nullptr, the size of the arena block is
+  // stored to it.
+  static SharedCppDirectives Compact(const CppDirectiveList& directives,
+                                     size_t* allocated_bytes);
+
+  size_t allocated_bytes() const { return size_; }
+
+ private:
+  explicit CppDirectiveArena(size_t size);
+
+  // Returns the size to store a copy of |directive| in an arena.
+  static size_t ArenaSize(const CppDirective& directive);
+
+  void* Allocate(size_t size);
+
+  template <typename T, typename... Args>
+  T* New(Args&&... args) {
+    return new (Allocate(sizeof(T))) T(std::forward<Args>(args)...);
+  }
+
+  absl::Span<const CppToken> NewTokens(absl::Span<const CppToken> tokens);
+  const Macro* NewMacro(const Macro& macro);
+
+  template <typename T>
+  CppDirective* NewInclude(const CppDirectiveIncludeBase& directive);
+  CppDirective* NewDirective(const CppDirective& directive);
+
+  const std::unique_ptr<char[]> block_;
+  const size_t size_;
+  size_t used_;
+
+  // Directives in |block_|. They are destructed in place, with their
+  // tokens and macros, instead of deleted.
+  CppDirectiveList directives_;
+
+  DISALLOW_COPY_AND_ASSIGN(CppDirectiveArena);
+};
+
+}  // namespace devtools_goma
+
+#endif  // DEVTOOLS_GOMA_CLIENT_CXX_INCLUDE_PROCESSOR_CPP_DIRECTIVE_ARENA_H_
@@ -0,0 +1,108 @@
+// Copyright 2021 The Goma Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "cpp_directive_arena.h"
+
+#include <memory>
+#include <string>
+
+#include "content.h"
+#include "cpp_directive_parser.h"
+#include "gtest/gtest.h"
+
+namespace devtools_goma {
+
+namespace {
+
+CppDirectiveList Parse(const std::string& source) {
+  CppDirectiveList directives;
+  EXPECT_TRUE(CppDirectiveParser().Parse(*Content::CreateFromString(source),
+                                         "<string>", &directives));
+  return directives;
+}
+
+}  // anonymous namespace
+
+TEST(CppDirectiveArenaTest, Compact) {
+  CppDirectiveList directives = Parse(
+      "#include <a.h>\n"
+      "#include \"b.h\"\n"
+      "#include_next MACRO_INCLUDE\n"
+      "#import <c.h>\n"
+      "#define A 1\n"
+      "#define F(x, ...) x + __VA_ARGS__\n"
+      "#undef B\n"
+      "#ifdef C\n"
+      "#elif defined(D) && E > 2\n"
+      "#else\n"
+      "#endif\n"
+      "#ifndef INCLUDE_GUARD\n"
+      "#if __has_include(<e.h>)\n"
+      "#endif\n"
+      "#pragma once\n"
+      "#pragma foo\n"
+      "#endif\n"
+      "#include\n");
+
+  size_t allocated_bytes = 0;
+  SharedCppDirectives compacted =
+      CppDirectiveArena::Compact(directives, &allocated_bytes);
+  ASSERT_NE(nullptr, compacted);
+  EXPECT_GT(allocated_bytes, 0U);
+
+  ASSERT_EQ(directives.size(), compacted->size());
+  for (size_t i = 0; i < directives.size(); ++i) {
+    const CppDirective& expected = *directives[i];
+    const CppDirective& actual = *(*compacted)[i];
+    EXPECT_NE(&expected, &actual);
+    EXPECT_EQ(expected.type(), actual.type()) << i;
+    EXPECT_EQ(expected.position(), actual.position()) << i;
+    EXPECT_EQ(expected.DebugString(), actual.DebugString()) << i;
+  }
+
+  const CppDirectiveDefine& f = AsCppDirectiveDefine(*(*compacted)[5]);
+  EXPECT_EQ("F", f.name());
+  EXPECT_TRUE(f.is_function_macro());
+  EXPECT_EQ(1, f.num_args());
+  EXPECT_TRUE(f.has_vararg());
+  EXPECT_NE(AsCppDirectiveDefine(*directives[5]).macro(), f.macro());
+
+  const CppDirectiveElif& elif = AsCppDirectiveElif(*(*compacted)[8]);
+  ASSERT_EQ(AsCppDirectiveElif(*directives[8]).tokens().size(),
+            elif.tokens().size());
+  EXPECT_EQ(CppToken::IDENTIFIER, elif.tokens()[0].type);
+  EXPECT_EQ("defined", elif.tokens()[0].atom.str());
+}
+
+TEST(CppDirectiveArenaTest, OutlivesOriginal) {
+  SharedCppDirectives compacted;
+  {
+    CppDirectiveList directives = Parse(
+        "#define LONG_MACRO_NAME_NOT_IN_SMALL_STRING \"long/path/to/file.h\"\n"
+        "#include LONG_MACRO_NAME_NOT_IN_SMALL_STRING\n");
+    compacted = CppDirectiveArena::Compact(directives, nullptr);
+  }
+
+  ASSERT_EQ(2U, compacted->size());
+  const CppDirectiveDefine& d = AsCppDirectiveDefine(*(*compacted)[0]);
+  EXPECT_EQ("LONG_MACRO_NAME_NOT_IN_SMALL_STRING", d.macro()->name);
+  ASSERT_EQ(1U, d.replacement().size());
+  EXPECT_EQ("long/path/to/file.h", d.replacement()[0].string_value);
+
+  const CppDirectiveInclude& i = AsCppDirectiveInclude(*(*compacted)[1]);
+  ASSERT_EQ(' ', i.delimiter());
+  ASSERT_EQ(1U, i.tokens().size());
+  EXPECT_EQ("LONG_MACRO_NAME_NOT_IN_SMALL_STRING", i.tokens()[0].atom.str());
+}
+
+TEST(CppDirectiveArenaTest, Empty) {
+  size_t allocated_bytes = 1;
+  SharedCppDirectives compacted =
+      CppDirectiveArena::Compact(CppDirectiveList(), &allocated_bytes);
+  ASSERT_NE(nullptr, compacted);
+  EXPECT_TRUE(compacted->empty());
+  EXPECT_EQ(0U, allocated_bytes);
+}
+
+}  // namespace devtools_goma
@@ -8,7 +8,7 @@ namespace devtools_goma {
 
 namespace {
 
-bool ContainsHasInclude(const std::vector<CppToken>& tokens) {
+bool ContainsHasInclude(absl::Span<const CppToken> tokens) {
   for (const auto& t : tokens) {
     if (t.IsIdentifier("__has_include") ||
         t.IsIdentifier("__has_include_next")) {
@@ -128,7 +128,7 @@ void CppDirectiveOptimizer::Optimize(CppDirectiveList* directives) {
           ifd.tokens()[2].type == CppToken::IDENTIFIER &&
           ifd.tokens()[3].IsPuncChar(')')) {
         result.emplace_back(
-            new CppDirectiveIfdef(ifd.tokens()[2].string_value));
+            new CppDirectiveIfdef(ifd.tokens()[2].atom));
         ++converted;
         continue;
       }
@@ -136,7 +136,7 @@ void CppDirectiveOptimizer::Optimize(CppDirectiveList* directives) {
       if (ifd.tokens().size() == 2 && ifd.tokens()[0].IsIdentifier("defined") &&
           ifd.tokens()[1].type == CppToken::IDENTIFIER) {
         result.emplace_back(
-            new CppDirectiveIfdef(ifd.tokens()[1].string_value));
+            new CppDirectiveIfdef(ifd.tokens()[1].atom));
         ++converted;
         continue;
       }
@@ -149,7 +149,7 @@ void CppDirectiveOptimizer::Optimize(CppDirectiveList* directives) {
           ifd.tokens()[3].type == CppToken::IDENTIFIER &&
           ifd.tokens()[4].IsPuncChar(')')) {
         result.emplace_back(
-            new CppDirectiveIfndef(ifd.tokens()[3].string_value));
+            new CppDirectiveIfndef(ifd.tokens()[3].atom));
         ++converted;
         continue;
       }
@@ -158,7 +158,7 @@ void CppDirectiveOptimizer::Optimize(CppDirectiveList* directives) {
           ifd.tokens()[1].IsIdentifier("defined") &&
           ifd.tokens()[2].type == CppToken::IDENTIFIER) {
         result.emplace_back(
-            new CppDirectiveIfndef(ifd.tokens()[2].string_value));
+            new CppDirectiveIfndef(ifd.tokens()[2].atom));
         ++converted;
         continue;
       }
@@ -12,6 +12,7 @@
 #include "absl/container/inlined_vector.h"
 #include "absl/strings/ascii.h"
 #include "compiler_specific.h"
+#include "cpp_atom.h"
 #include "cpp_token.h"
 #include "cpp_tokenizer.h"
 #include "directive_filter.h"
@@ -22,7 +23,7 @@ namespace devtools_goma {
 namespace {
 
 bool ReadIdent(CppInputStream* stream,
-               std::string* ident,
+               CppAtom* ident,
                std::string* error_reason) {
   CppToken token;
   if (!CppTokenizer::NextTokenFrom(stream, SpaceHandling::kSkip, &token,
@@ -36,7 +37,7 @@ bool ReadIdent(CppInputStream* stream,
     return false;
   }
 
-  *ident = token.string_value;
+  *ident = token.atom;
   return true;
 }
 
@@ -115,7 +116,7 @@ std::unique_ptr<CppDirective> ReadObjectMacro(const std::string& name,
 
 std::unique_ptr<CppDirective> ReadFunctionMacro(const std::string& name,
                                                 CppInputStream* stream) {
-  absl::flat_hash_map<std::string, size_t> params;
+  absl::flat_hash_map<CppAtom, size_t> params;
   size_t param_index = 0;
   bool is_vararg = false;
   for (;;) {
@@ -124,10 +125,9 @@ std::unique_ptr<CppDirective> ReadFunctionMacro(const std::string& name,
       return CppDirective::Error("missing ')' in the macro parameter list");
     }
     if (token.type == CppToken::IDENTIFIER) {
-      if (!params.insert(std::make_pair(token.string_value,
-                                        param_index)).second) {
+      if (!params.insert(std::make_pair(token.atom, param_index)).second) {
         return CppDirective::Error("duplicate macro parameter ",
-                                   token.string_value);
+                                   token.identifier());
       }
       param_index++;
       token = NextToken(stream, SpaceHandling::kSkip);
@@ -157,13 +157,13 @@ std::unique_ptr<CppDirective> ReadFunctionMacro(const std::string& name,
   CppToken token = NextToken(stream, SpaceHandling::kSkip);
   while (token.type != CppToken::NEWLINE && token.type != CppToken::END) {
     if (token.type == CppToken::IDENTIFIER) {
-      auto iter = params.find(token.string_value);
+      auto iter = params.find(token.atom);
       if (iter != params.end()) {
         token.MakeMacroParam(iter->second);
-      } else if (token.string_value == "__VA_ARGS__" && is_vararg) {
+      } else if (token.IsIdentifier("__VA_ARGS__") && is_vararg) {
         // __VA_ARGS__ is valid only for variadic template.
         token.MakeMacroParamVaArgs(params.size());
-      } else if (token.string_value == "__VA_OPT__" &&
+      } else if (token.IsIdentifier("__VA_OPT__") &&
                  (is_vararg || params.size() > 0)) {
         // __VA_OPT__ is valid only for variadic template.
         // If __VA_OPT__ is used in non variadic template: (as of 2018-07-13)
@@ -242,13 +242,13 @@ std::unique_ptr<CppDirective> ParseDefine(CppInputStream* stream) {
 
   CppToken token = NextToken(stream, SpaceHandling::kKeep);
   if (token.IsPuncChar('(')) {
-    return ReadFunctionMacro(name.string_value, stream);
+    return ReadFunctionMacro(name.identifier(), stream);
   }
 
   if (token.type == CppToken::NEWLINE || token.type == CppToken::END) {
     // Token::END. name only macro.
     return std::unique_ptr<CppDirective>(
-        new CppDirectiveDefine(name.string_value, std::vector<CppToken>()));
+        new CppDirectiveDefine(name.identifier(), std::vector<CppToken>()));
   }
 
   // here, object macro.
@@ -257,40 +257,39 @@ std::unique_ptr<CppDirective> ParseDefine(CppInputStream* stream) {
                                token.DebugString());
   }
 
-  return ReadObjectMacro(name.string_value, stream);
+  return ReadObjectMacro(name.identifier(), stream);
 }
 
 // Parse undef, and return token.
 std::unique_ptr<CppDirective> ParseUndef(CppInputStream* stream) {
-  std::string ident;
+  CppAtom ident;
   std::string error_reason;
   if (!ReadIdent(stream, &ident, &error_reason)) {
     return CppDirective::Error("failed to parse #undef: " + error_reason);
   }
 
-  return std::unique_ptr<CppDirective>(new CppDirectiveUndef(std::move(ident)));
+  return std::unique_ptr<CppDirective>(new CppDirectiveUndef(ident));
 }
 
 std::unique_ptr<CppDirective> ParseIfdef(CppInputStream* stream) {
-  std::string ident;
+  CppAtom ident;
   std::string error_reason;
   if (!ReadIdent(stream, &ident, &error_reason)) {
     return CppDirective::Error("failed to parse #ifdef: " + error_reason);
   }
 
-  return std::unique_ptr<CppDirective>(new CppDirectiveIfdef(std::move(ident)));
+  return std::unique_ptr<CppDirective>(new CppDirectiveIfdef(ident));
 }
 
 // Parse undef, and return token.
 std::unique_ptr<CppDirective> ParseIfndef(CppInputStream* stream) {
-  std::string ident;
+  CppAtom ident;
   std::string error_reason;
   if (!ReadIdent(stream, &ident, &error_reason)) {
     return CppDirective::Error("failed to parse #ifndef: " + error_reason);
   }
 
-  return std::unique_ptr<CppDirective>(
-      new CppDirectiveIfndef(std::move(ident)));
+  return std::unique_ptr<CppDirective>(new CppDirectiveIfndef(ident));
 }
 
 std::unique_ptr<CppDirective> ParseIf(CppInputStream* stream) {
@@ -325,7 +324,7 @@ std::unique_ptr<CppDirective> ParseElif(CppInputStream* stream) {
 
 std::unique_ptr<CppDirective> ParsePragma(CppInputStream* stream) {
   CppToken token(NextToken(stream, SpaceHandling::kSkip));
-  if (token.type == CppToken::IDENTIFIER && token.string_value == "once") {
+  if (token.IsIdentifier("once")) {
     return std::unique_ptr<CppDirective>(new CppDirectivePragma(true));
   }
 
@@ -363,6 +362,9 @@ bool CppDirectiveParser::Parse(const Content& content,
                                CppDirectiveList* result) {
   std::string error_reason;
   CppInputStream stream(&content, filename);
+  // Macro names and parameters must be interned, so parsing fails if some
+  // identifier could not be interned.
+  const size_t num_intern_failures = CppAtom::NumInternFailures();
 
   CppDirectiveList directives;
   while (CppTokenizer::SkipUntilDirective(&stream, &error_reason)) {
@@ -393,6 +395,11 @@ bool CppDirectiveParser::Parse(const Content& content,
     LOG(ERROR) << "failed to parse directives: " << error_reason;
     return false;
   }
+  if (CppAtom::NumInternFailures() != num_intern_failures) {
+    LOG(ERROR) << "failed to parse directives: too many identifiers:"
+               << " filename=" << filename;
+    return false;
+  }
 
   *result = std::move(directives);
   return true;
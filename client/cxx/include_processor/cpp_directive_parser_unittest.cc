@@ -4,9 +4,12 @@
 
 #include "cpp_directive_parser.h"
 
+#include <limits>
+
 #include "absl/base/macros.h"
 #include "absl/strings/string_view.h"
 #include "basictypes.h"
+#include "cpp_atom.h"
 #include "cpp_parser.h"
 #include "gtest/gtest.h"
 
@@ -163,7 +166,7 @@ TEST_F(CppDirectiveParserTest, Include) {
     EXPECT_EQ(' ', d.delimiter());
     ASSERT_EQ(1U, d.tokens().size());
     EXPECT_EQ(CppToken::IDENTIFIER, d.tokens()[0].type);
-    EXPECT_EQ("A", d.tokens()[0].string_value);
+    EXPECT_EQ("A", d.tokens()[0].atom.str());
   }
 
   // invalid case
@@ -204,7 +207,7 @@ TEST_F(CppDirectiveParserTest, Import) {
     EXPECT_EQ(' ', d.delimiter());
     ASSERT_EQ(1U, d.tokens().size());
     EXPECT_EQ(CppToken::IDENTIFIER, d.tokens()[0].type);
-    EXPECT_EQ("A", d.tokens()[0].string_value);
+    EXPECT_EQ("A", d.tokens()[0].atom.str());
   }
 
   // invalid case
@@ -245,7 +248,7 @@ TEST_F(CppDirectiveParserTest, IncludeNext) {
     EXPECT_EQ(' ', d.delimiter());
     ASSERT_EQ(1U, d.tokens().size());
     EXPECT_EQ(CppToken::IDENTIFIER, d.tokens()[0].type);
-    EXPECT_EQ("A", d.tokens()[0].string_value);
+    EXPECT_EQ("A", d.tokens()[0].atom.str());
   }
 
   // invalid case
@@ -278,7 +281,7 @@ TEST_F(CppDirectiveParserTest, IncludeDefine) {
     EXPECT_FALSE(d.is_function_macro());
     ASSERT_EQ(1U, d.replacement().size());
     EXPECT_EQ(CppToken::IDENTIFIER, d.replacement()[0].type);
-    EXPECT_EQ("B", d.replacement()[0].string_value);
+    EXPECT_EQ("B", d.replacement()[0].atom.str());
   }
 
   {
@@ -588,4 +591,19 @@ TEST_F(CppDirectiveParserTest, ParseUnknownDirective) {
   EXPECT_TRUE(parser.has_unknown_directives());
 }
 
+TEST_F(CppDirectiveParserTest, ParseTooManyIdentifiers) {
+  // Intern the identifiers before the table gets full.
+  ASSERT_NE(nullptr, ParseSingle("#define PARSER_TEST_KNOWN(x) x\n"));
+  CppAtom::SetMaxAtomsForTest(CppAtom::NumAtoms());
+
+  EXPECT_NE(nullptr, ParseSingle("#define PARSER_TEST_KNOWN(x) x\n"));
+  // A new macro name or parameter can't be interned.
+  EXPECT_EQ(nullptr, ParseSingle("#define PARSER_TEST_UNKNOWN 1\n"));
+  EXPECT_EQ(nullptr, ParseSingle("#define PARSER_TEST_KNOWN(parser_test_y) "
+                                 "parser_test_y\n"));
+
+  CppAtom::SetMaxAtomsForTest(std::numeric_limits<size_t>::max());
+  EXPECT_NE(nullptr, ParseSingle("#define PARSER_TEST_UNKNOWN 1\n"));
+}
+
 }  // namespace devtools_goma
@@ -22,15 +22,19 @@
 #include <fstream>
 #include <iostream>
 #include <iterator>
+#include <memory>
 #include <set>
 #include <string>
 #include <utility>
 #include <vector>
 
+#include "absl/memory/memory.h"
 #include "absl/strings/match.h"
+#include "absl/strings/str_cat.h"
 #include "absl/strings/str_split.h"
 #include "absl/strings/string_view.h"
 #include "autolock_timer.h"
+#include "callback.h"
 #include "clang_modules/modulemap/cache.h"
 #include "clang_tidy_flags.h"
 #include "compiler_flags.h"
@@ -41,9 +45,11 @@
 #include "cpp_directive_parser.h"
 #include "cpp_include_processor.h"
 #include "cpp_parser.h"
+#include "cpp_preamble_cache.h"
 #include "directive_filter.h"
 #include "env_flags.h"
 #include "file_dir.h"
+#include "file_stat_cache.h"
 #include "filesystem.h"
 #include "flag_parser.h"
 #include "gcc_flags.h"
@@ -100,6 +106,175 @@ IncludeItem TryInclude(const std::string& cwd,
   return IncludeCache::instance()->GetIncludeItem(abs_filepath, file_stat);
 }
 
+// Returns a key of CppPreambleCache.
+// It should contain everything that affects the parser state after
+// processing the preamble, except the content of files.
+std::string MakePreambleKey(
+    const std::string& current_directory,
+    const CompilerFlags& compiler_flags,
+    const CxxCompilerInfo& compiler_info,
+    const std::vector<std::string>& include_dirs,
+    int bracket_include_dir_index,
+    const std::vector<std::string>& framework_dirs,
+    bool ignore_case,
+    const std::vector<std::pair<std::string, bool>>& commandline_macros,
+    const std::vector<std::pair<std::string, int>>& root_includes_with_index,
+    bool gcc_like_hosted) {
+  std::string key;
+  absl::StrAppend(&key, current_directory, "\n",
+                  static_cast<int>(compiler_flags.type()), "\n",
+                  compiler_info.local_compiler_path(), "\n",
+                  compiler_info.real_compiler_hash(), "\n",
+                  compiler_info.lang(), "\n", ignore_case ? "i" : "",
+                  gcc_like_hosted ? "h" : "", "\n");
+  for (const auto& flag : compiler_flags.compiler_info_flags()) {
+    absl::StrAppend(&key, "f", flag, "\n");
+  }
+  // Quote include dirs and -I dirs can make the same include_dirs, but
+  // #include <...> starts searching from a different index.
+  absl::StrAppend(&key, "b", bracket_include_dir_index, "\n");
+  for (const auto& dir : include_dirs) {
+    absl::StrAppend(&key, "I", dir, "\n");
+  }
+  for (const auto& dir : framework_dirs) {
+    absl::StrAppend(&key, "F", dir, "\n");
+  }
+  for (const auto& macro : commandline_macros) {
+    absl::StrAppend(&key, macro.second ? "D" : "U", macro.first, "\n");
+  }
+  for (const auto& root_include : root_includes_with_index) {
+    absl::StrAppend(&key, "i", root_include.second, ":", root_include.first,
+                    "\n");
+  }
+  return key;
+}
+
+// IncludePrefetcher finds include files on the prefetch pool of
+// IncludeCache, and lets IncludeCache read and parse them there, so that
+// the include walk doesn't spend its time on files it might not use.
+// It is shared with the pool, so it may outlive GetIncludeFiles.
+class IncludePrefetcher {
+ public:
+  struct Include {
+    char delimiter;  // '"' or '<'
+    std::string path;
+    std::string current_directory;
+  };
+
+  IncludePrefetcher(std::string cwd,
+                    bool ignore_case,
+                    std::vector<std::string> include_dirs,
+                    std::vector<std::string> framework_dirs,
+                    int bracket_include_dir_index)
+      : cwd_(std::move(cwd)),
+        ignore_case_(ignore_case),
+        include_dirs_(std::move(include_dirs)),
+        framework_dirs_(std::move(framework_dirs)),
+        bracket_include_dir_index_(bracket_include_dir_index) {
+    // |file_stat_cache_| is used only on the pool.
+    file_stat_cache_.ReleaseOwner();
+  }
+
+  // Adds |includes| to be found on the pool.
+  static void Add(const std::shared_ptr<IncludePrefetcher>& prefetcher,
+                  std::vector<Include> includes) {
+    {
+      AUTOLOCK(lock, &prefetcher->mu_);
+      prefetcher->pending_.insert(prefetcher->pending_.end(),
+                                  std::make_move_iterator(includes.begin()),
+                                  std::make_move_iterator(includes.end()));
+      if (prefetcher->running_) {
+        return;
+      }
+      prefetcher->running_ = true;
+    }
+    IncludeCache::instance()->RunInPrefetchPool(
+        NewCallback(&IncludePrefetcher::Run, prefetcher));
+  }
+
+ private:
+  // Finds pending includes until none is left. Runs on the pool.
+  // At most one Run is running for |prefetcher| at a time.
+  static void Run(std::shared_ptr<IncludePrefetcher> prefetcher) {
+    prefetcher->RunPending();
+  }
+
+  void RunPending() LOCKS_EXCLUDED(mu_) {
+    GOMA_COUNTERZ("IncludePrefetcher::Run");
+    file_stat_cache_.AcquireOwner();
+    if (include_file_finder_ == nullptr) {
+      include_file_finder_ = absl::make_unique<IncludeFileFinder>(
+          cwd_, ignore_case_, &include_dirs_, &framework_dirs_,
+          &file_stat_cache_);
+    }
+    for (;;) {
+      std::vector<Include> includes;
+      {
+        AUTOLOCK(lock, &mu_);
+        if (pending_.empty()) {
+          // Released before another Run can start.
+          file_stat_cache_.ReleaseOwner();
+          running_ = false;
+          return;
+        }
+        includes.swap(pending_);
+      }
+      for (const auto& include : includes) {
+        Prefetch(include);
+      }
+    }
+  }
+
+  // Resolves |include| in the same way as IncludePathsObserver, except
+  // #include_next, and lets IncludeCache prefetch the found file.
+  void Prefetch(const Include& include) {
+    std::string filepath;
+    int dir_index = bracket_include_dir_index_;
+    if (include.delimiter == '"') {
+      std::string candidate = PathResolver::PlatformConvert(
+          file::JoinPathRespectAbsolute(include.current_directory,
+                                        include.path));
+      const FileStat file_stat = file_stat_cache_.Get(
+          file::JoinPathRespectAbsolute(cwd_, candidate));
+      if (file_stat.IsValid() && !file_stat.is_directory) {
+        filepath = std::move(candidate);
+      }
+      dir_index = CppParser::kIncludeDirIndexStarting;
+    }
+    if (filepath.empty() &&
+        !include_file_finder_->Lookup(include.path, &filepath, &dir_index)) {
+      return;
+    }
+    if (absl::EndsWith(filepath, GOMA_GCH_SUFFIX)) {
+      return;
+    }
+
+    const std::string abs_filepath =
+        file::JoinPathRespectAbsolute(cwd_, filepath);
+    const FileStat file_stat(file_stat_cache_.Get(abs_filepath));
+    if (!file_stat.IsValid() || file_stat.is_directory) {
+      return;
+    }
+    IncludeCache::instance()->Prefetch(abs_filepath, file_stat);
+  }
+
+  const std::string cwd_;
+  const bool ignore_case_;
+  const std::vector<std::string> include_dirs_;
+  const std::vector<std::string> framework_dirs_;
+  const int bracket_include_dir_index_;
+
+  // Used only in RunPending.
+  FileStatCache file_stat_cache_;
+  std::unique_ptr<IncludeFileFinder> include_file_finder_;
+
+  Lock mu_;
+  std::vector<Include> pending_ GUARDED_BY(mu_);
+  bool running_ GUARDED_BY(mu_) = false;
+
+  DISALLOW_COPY_AND_ASSIGN(IncludePrefetcher);
+};
+
 }  // anonymous namespace
 
 class IncludePathsObserver : public CppParser::IncludeObserver {
@@ -108,12 +283,14 @@ class IncludePathsObserver : public CppParser::IncludeObserver {
                        CppParser* parser,
                        std::set<std::string>* shared_include_files,
                        FileStatCache* file_stat_cache,
-                       IncludeFileFinder* include_file_finder)
+                       IncludeFileFinder* include_file_finder,
+                       std::shared_ptr<IncludePrefetcher> include_prefetcher)
       : cwd_(std::move(cwd)),
         parser_(parser),
         shared_include_files_(shared_include_files),
         file_stat_cache_(file_stat_cache),
-        include_file_finder_(include_file_finder) {
+        include_file_finder_(include_file_finder),
+        include_prefetcher_(std::move(include_prefetcher)) {
     CHECK(parser_);
     CHECK(shared_include_files_);
     CHECK(file_stat_cache_);
@@ -200,6 +377,7 @@ class IncludePathsObserver : public CppParser::IncludeObserver {
 
       VLOG(2) << "Looking into " << filepath << " index=" << dir_index;
       shared_include_files_->insert(filepath);
+      PrefetchIncludes(include_item, next_current_directory);
       parser_->AddFileInput(std::move(include_item), filepath,
                             next_current_directory, dir_index);
       return true;
@@ -242,6 +420,48 @@ class IncludePathsObserver : public CppParser::IncludeObserver {
     return false;
   }
 
+  // Lets |include_prefetcher_| find #include and #import of |include_item|
+  // in |current_directory| regardless of conditions, so that IncludeCache
+  // reads and parses them on the prefetch pool while |parser_| processes
+  // |include_item|. Since only IncludeCache is warmed, the result is the
+  // same as without prefetching.
+  void PrefetchIncludes(const IncludeItem& include_item,
+                        const std::string& current_directory) {
+    if (include_prefetcher_ == nullptr) {
+      return;
+    }
+    GOMA_COUNTERZ("PrefetchIncludes");
+
+    std::vector<IncludePrefetcher::Include> includes;
+    for (const auto& directive : *include_item.directives()) {
+      if (directive->type() != CppDirectiveType::DIRECTIVE_INCLUDE &&
+          directive->type() != CppDirectiveType::DIRECTIVE_IMPORT) {
+        // #include_next depends on the include dir of the current file,
+        // which is not worth resolving here.
+        continue;
+      }
+      const CppDirectiveIncludeBase& include =
+          AsCppDirectiveIncludeBase(*directive);
+      if (include.delimiter() != '"' && include.delimiter() != '<') {
+        // Macro expansion is needed to get the path.
+        continue;
+      }
+      const std::string& path = include.filename();
+      if (path.empty()) {
+        continue;
+      }
+      if (!prefetched_.insert(std::make_pair(include.delimiter(), path))
+               .second) {
+        continue;
+      }
+      includes.push_back(IncludePrefetcher::Include{include.delimiter(), path,
+                                                    current_directory});
+    }
+    if (!includes.empty()) {
+      IncludePrefetcher::Add(include_prefetcher_, std::move(includes));
+    }
+  }
+
  private:
   bool CanPruneWithTopPathComponent(const std::string& dir,
                                     const std::string& path) {
@@ -292,6 +512,7 @@ class IncludePathsObserver : public CppParser::IncludeObserver {
         TryInclude(cwd_, filepath, next_current_directory, file_stat_cache_);
     if (include_item.IsValid()) {
       shared_include_files_->insert(filepath);
+      PrefetchIncludes(include_item, *next_current_directory);
       parser_->AddFileInput(std::move(include_item), filepath,
                             *next_current_directory, include_dir_index);
       return true;
@@ -338,6 +559,14 @@ class IncludePathsObserver : public CppParser::IncludeObserver {
 
   IncludeFileFinder* include_file_finder_;
 
+  // nullptr if prefetching is disabled.
+  const std::shared_ptr<IncludePrefetcher> include_prefetcher_;
+  // A set of (delimiter, path) already given to |include_prefetcher_|.
+  // Note that "..." relative to different directories might be resolved to
+  // different files, but it is just a hint, so it is fine to prefetch only
+  // the first one.
+  std::set<std::pair<char, std::string>> prefetched_;
+
   DISALLOW_COPY_AND_ASSIGN(IncludePathsObserver);
 };
 
@@ -569,21 +798,27 @@ bool CppIncludeProcessor::GetIncludeFiles(const std::string& filename,
                                         &include_dirs, &framework_dirs,
                                         file_stat_cache);
 
-  std::vector<std::pair<std::string, int>> root_includes_with_index =
+  // Files included before this are not a part of preamble.
+  const std::set<std::string> non_preamble_files = *include_files;
+  const std::vector<std::pair<std::string, int>> root_includes_with_index =
       CalculateRootIncludesWithIncludeDirIndex(
           root_includes, current_directory, compiler_flags,
           &include_file_finder, include_files);
-  root_includes_with_index.emplace_back(PathResolver::PlatformConvert(filename),
-                                        CppParser::kCurrentDirIncludeDirIndex);
 
-  IncludePathsObserver include_observer(current_directory,
-                                        &cpp_parser_, include_files,
-                                        file_stat_cache, &include_file_finder);
+  std::shared_ptr<IncludePrefetcher> include_prefetcher;
+  if (IncludeCache::instance()->prefetch_enabled()) {
+    include_prefetcher = std::make_shared<IncludePrefetcher>(
+        current_directory, ignore_case, include_dirs, framework_dirs,
+        cpp_parser_.bracket_include_dir_index());
+  }
+  IncludePathsObserver include_observer(
+      current_directory, &cpp_parser_, include_files, file_stat_cache,
+      &include_file_finder, std::move(include_prefetcher));
   IncludeErrorObserver error_observer;
   cpp_parser_.set_include_observer(&include_observer);
+  include_observer_ = &include_observer;
   if (VLOG_IS_ON(1))
     cpp_parser_.set_error_observer(&error_observer);
-  cpp_parser_.SetCompilerInfo(&compiler_info);
   if (compiler_flags.type() == CompilerFlagType::Clexe) {
     cpp_parser_.set_is_vc();
   }
@@ -595,6 +830,78 @@ bool CppIncludeProcessor::GetIncludeFiles(const std::string& filename,
     gcc_like_hosted = !(flags.has_ffreestanding() || flags.has_fno_hosted());
   }
 
+  std::string preamble_key;
+  std::shared_ptr<const CppPreambleCache::Preamble> preamble;
+  if (CppPreambleCache::IsEnabled()) {
+    preamble_key = MakePreambleKey(
+        current_directory, compiler_flags, compiler_info, include_dirs,
+        cpp_parser_.bracket_include_dir_index(), framework_dirs, ignore_case,
+        commandline_macros, root_includes_with_index, gcc_like_hosted);
+    preamble = CppPreambleCache::instance()->Lookup(
+        preamble_key, current_directory, file_stat_cache);
+  }
+  if (preamble) {
+    VLOG(2) << "resume from preamble snapshot";
+    cpp_parser_.RestoreSnapshot(*preamble->parser_snapshot, &compiler_info);
+    for (const auto& file : preamble->files) {
+      include_files->insert(file.first);
+    }
+  } else {
+    if (!ProcessPreamble(current_directory, compiler_info, commandline_macros,
+                         root_includes_with_index, gcc_like_hosted)) {
+      include_observer_ = nullptr;
+      return false;
+    }
+    if (!preamble_key.empty()) {
+      std::shared_ptr<const CppParser::Snapshot> snapshot =
+          cpp_parser_.CreateSnapshot();
+      if (snapshot) {
+        auto new_preamble = std::make_shared<CppPreambleCache::Preamble>();
+        new_preamble->parser_snapshot = std::move(snapshot);
+        for (const auto& file : *include_files) {
+          if (non_preamble_files.count(file)) {
+            continue;
+          }
+          new_preamble->files.emplace_back(
+              file, file_stat_cache->Get(
+                        file::JoinPathRespectAbsolute(current_directory, file)));
+        }
+        CppPreambleCache::instance()->Insert(preamble_key,
+                                             std::move(new_preamble));
+      }
+    }
+  }
+
+  const bool root_processed = ProcessRootInclude(
+      current_directory, PathResolver::PlatformConvert(filename),
+      CppParser::kCurrentDirIncludeDirIndex);
+  // |include_observer| is destroyed when this returns.
+  include_observer_ = nullptr;
+  if (!root_processed) {
+    return false;
+  }
+
+  if (compiler_flags.type() == CompilerFlagType::Gcc) {
+    const GCCFlags& flags = static_cast<const GCCFlags&>(compiler_flags);
+    if (flags.has_fmodules()) {
+      if (!AddClangModulesFiles(flags, current_directory, include_files,
+                                file_stat_cache)) {
+        return false;
+      }
+    }
+  }
+
+  return true;
+}
+
+bool CppIncludeProcessor::ProcessPreamble(
+    const std::string& current_directory,
+    const CxxCompilerInfo& compiler_info,
+    const std::vector<std::pair<std::string, bool>>& commandline_macros,
+    const std::vector<std::pair<std::string, int>>& root_includes_with_index,
+    bool gcc_like_hosted) {
+  cpp_parser_.SetCompilerInfo(&compiler_info);
+
   if (gcc_like_hosted) {
     // CompilerInfo was generated with -ffreestanding, and set
     // __STDC_HOSTED__=0 - we must override this.
@@ -659,47 +966,47 @@ bool CppIncludeProcessor::GetIncludeFiles(const std::string& filename,
   }
 
   for (const auto& input_index : root_includes_with_index) {
-    const std::string& input = input_index.first;
-    const int dir_index = input_index.second;
-
-    const std::string& abs_input =
-        file::JoinPathRespectAbsolute(current_directory, input);
-    std::unique_ptr<Content> content(Content::CreateFromFile(abs_input));
-    if (!content) {
-      LOG(ERROR) << "root include:" << abs_input << " not found";
-      return false;
-    }
-
-    // TODO: To mitigate b/78094849, let me run directive filter for
-    // sources, too.
-    SharedCppDirectives directives(CppDirectiveParser::ParseFromContent(
-        *DirectiveFilter::MakeFilteredContent(*content), abs_input));
-    if (!directives) {
-      LOG(ERROR) << "failed to parse directives: " << abs_input;
+    if (!ProcessRootInclude(current_directory, input_index.first,
+                            input_index.second)) {
       return false;
     }
-    VLOG(2) << "Looking into " << abs_input;
-
-    std::string input_basedir = std::string(file::Dirname(input));
+  }
+  return true;
+}
 
-    cpp_parser_.AddFileInput(IncludeItem(std::move(directives), ""), input,
-                             input_basedir, dir_index);
-    if (!cpp_parser_.ProcessDirectives()) {
-      LOG(ERROR) << "cpp parser fatal error in " << abs_input;
-      return false;
-    }
+bool CppIncludeProcessor::ProcessRootInclude(const std::string& current_directory,
+                                             const std::string& input,
+                                             int dir_index) {
+  const std::string& abs_input =
+      file::JoinPathRespectAbsolute(current_directory, input);
+  std::unique_ptr<Content> content(Content::CreateFromFile(abs_input));
+  if (!content) {
+    LOG(ERROR) << "root include:" << abs_input << " not found";
+    return false;
   }
 
-  if (compiler_flags.type() == CompilerFlagType::Gcc) {
-    const GCCFlags& flags = static_cast<const GCCFlags&>(compiler_flags);
-    if (flags.has_fmodules()) {
-      if (!AddClangModulesFiles(flags, current_directory, include_files,
-                                file_stat_cache)) {
-        return false;
-      }
-    }
+  // TODO: To mitigate b/78094849, let me run directive filter for
+  // sources, too.
+  SharedCppDirectives directives(CppDirectiveParser::ParseFromContent(
+      *DirectiveFilter::MakeFilteredContent(*content), abs_input));
+  if (!directives) {
+    LOG(ERROR) << "failed to parse directives: " << abs_input;
+    return false;
   }
+  VLOG(2) << "Looking into " << abs_input;
+
+  std::string input_basedir = std::string(file::Dirname(input));
 
+  IncludeItem include_item(std::move(directives), "");
+  if (include_observer_) {
+    include_observer_->PrefetchIncludes(include_item, input_basedir);
+  }
+  cpp_parser_.AddFileInput(std::move(include_item), input, input_basedir,
+                           dir_index);
+  if (!cpp_parser_.ProcessDirectives()) {
+    LOG(ERROR) << "cpp parser fatal error in " << abs_input;
+    return false;
+  }
   return true;
 }
 
@@ -9,6 +9,8 @@
 #include <map>
 #include <set>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include "basictypes.h"
 #include "compiler_flags.h"
@@ -21,6 +23,7 @@ namespace devtools_goma {
 
 class Content;
 class GCCFlags;
+class IncludePathsObserver;
 
 class CppIncludeProcessor {
  public:
@@ -42,6 +45,20 @@ class CppIncludeProcessor {
   int skipped_files() const;
 
  private:
+  // Processes predefined macros, command line macros and forced includes
+  // before the source file.
+  bool ProcessPreamble(
+      const std::string& current_directory,
+      const CxxCompilerInfo& compiler_info,
+      const std::vector<std::pair<std::string, bool>>& commandline_macros,
+      const std::vector<std::pair<std::string, int>>& root_includes_with_index,
+      bool gcc_like_hosted);
+
+  // Processes |input| given as the source file or a forced include file.
+  bool ProcessRootInclude(const std::string& current_directory,
+                          const std::string& input,
+                          int dir_index);
+
   // Returns a vector of tuple<filepath, dir_index>.
   std::vector<std::pair<std::string, int>>
   CalculateRootIncludesWithIncludeDirIndex(
@@ -57,6 +74,9 @@ class CppIncludeProcessor {
                             FileStatCache* file_stat_cache) const;
 
   CppParser cpp_parser_;
+  // Points to the observer on the stack of GetIncludeFiles while it is
+  // processing the preamble and the input. nullptr otherwise.
+  IncludePathsObserver* include_observer_ = nullptr;
 
   friend class CppIncludeProcessorTest;
 
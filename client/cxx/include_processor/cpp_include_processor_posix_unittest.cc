@@ -50,7 +50,7 @@ class CppIncludeProcessorPosixTest : public testing::Test {
     InstallReadCommandOutputFunc(ReadCommandOutputByPopen);
     IncludeFileFinder::Init(true);
     ListDirCache::Init(4096);
-    modulemap::Cache::Init(10);
+    modulemap::Cache::Init(10, "");
   }
 
   void TearDown() override {
@@ -5,10 +5,13 @@
 
 #include "gtest/gtest.h"
 
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
 #include "compiler_flags.h"
 #include "compiler_flags_parser.h"
 #include "compiler_info.h"
 #include "cpp_include_processor.h"
+#include "cpp_preamble_cache.h"
 #include "cxx/cxx_compiler_info.h"
 #include "file_stat_cache.h"
 #include "filesystem.h"
@@ -18,6 +21,7 @@
 #include "options.h"
 #include "path.h"
 #include "unittest_util.h"
+#include "worker_thread_manager.h"
 
 namespace devtools_goma {
 
@@ -35,12 +39,16 @@ class CppIncludeProcessorTest : public testing::Test {
 
   std::set<std::string> RunCppIncludeProcessor(
       const std::string& source_file,
-      const std::vector<std::string>& args) {
+      const std::vector<std::string>& args,
+      const std::vector<std::string>& quote_include_paths = {}) {
     std::unique_ptr<CompilerFlags> flags(
         CompilerFlagsParser::MustNew(args, tmpdir_util_->tmpdir()));
     std::unique_ptr<CompilerInfoData> data(new CompilerInfoData);
     data->set_found(true);
     data->mutable_cxx();
+    for (const auto& path : quote_include_paths) {
+      data->mutable_cxx()->add_quote_include_paths(path);
+    }
     CxxCompilerInfo compiler_info(std::move(data));
 
     CppIncludeProcessor processor;
@@ -232,6 +240,115 @@ TEST_F(CppIncludeProcessorTest, opt_include_in_cwd) {
   EXPECT_EQ("foo.h", *files.begin());
 }
 
+TEST_F(CppIncludeProcessorTest, preamble_cache) {
+  CppPreambleCache::Init(10);
+  const absl::Time past = absl::Now() - absl::Seconds(10);
+
+  const std::string& forced_h = CreateTmpFile(
+      "#define USE_BAR\n"
+      "#include \"baz.h\"\n",
+      "forced.h");
+  const std::string& baz_h = CreateTmpFile("", "baz.h");
+  const std::string& bar_h = CreateTmpFile("", "bar.h");
+  const std::string& source_file = CreateTmpFile(
+      "#ifdef USE_BAR\n"
+      "#include \"bar.h\"\n"
+      "#endif\n",
+      "foo.c");
+  ASSERT_TRUE(UpdateMtime(forced_h, past));
+  ASSERT_TRUE(UpdateMtime(baz_h, past));
+
+  const std::vector<std::string> args{"gcc", "-include", forced_h, "-c",
+                                      source_file};
+
+  // The first run creates the preamble, and the second run uses it.
+  const std::set<std::string> expected{forced_h, baz_h, bar_h};
+  EXPECT_EQ(expected, RunCppIncludeProcessor(source_file, args));
+  EXPECT_EQ(1U, CppPreambleCache::instance()->size());
+  EXPECT_EQ(0, CppPreambleCache::instance()->hit());
+  EXPECT_EQ(expected, RunCppIncludeProcessor(source_file, args));
+  EXPECT_EQ(1, CppPreambleCache::instance()->hit());
+
+  // Modified forced include invalidates the preamble.
+  CreateTmpFile("#include \"baz.h\"\n", "forced.h");
+  ASSERT_TRUE(UpdateMtime(forced_h, past + absl::Seconds(1)));
+  const std::set<std::string> expected_modified{forced_h, baz_h};
+  EXPECT_EQ(expected_modified, RunCppIncludeProcessor(source_file, args));
+  EXPECT_EQ(1, CppPreambleCache::instance()->invalidated());
+  EXPECT_EQ(expected_modified, RunCppIncludeProcessor(source_file, args));
+  EXPECT_EQ(2, CppPreambleCache::instance()->hit());
+
+  CppPreambleCache::Quit();
+}
+
+TEST_F(CppIncludeProcessorTest, preamble_cache_bracket_include_dir) {
+  CppPreambleCache::Init(10);
+  const absl::Time past = absl::Now() - absl::Seconds(10);
+
+  const std::string& forced_h = CreateTmpFile("#include <x.h>\n", "forced.h");
+  const std::string& a_x_h = CreateTmpFile("", "a/x.h");
+  const std::string& b_x_h = CreateTmpFile("", "b/x.h");
+  const std::string& source_file = CreateTmpFile("", "foo.c");
+  ASSERT_TRUE(UpdateMtime(forced_h, past));
+  ASSERT_TRUE(UpdateMtime(a_x_h, past));
+  ASSERT_TRUE(UpdateMtime(b_x_h, past));
+  const std::string a_dir = tmpdir_util_->FullPath("a");
+  const std::string b_dir = tmpdir_util_->FullPath("b");
+
+  // a is a -I dir in the first run, and a quote include dir in the second.
+  // Both have the same include dirs, but #include <...> is not searched
+  // in quote include dirs, so they must not share the preamble.
+  const std::vector<std::string> args_i{
+      "gcc", "-I", a_dir, "-I", b_dir, "-include", forced_h, "-c", source_file};
+  const std::vector<std::string> args_quote{
+      "gcc", "-I", b_dir, "-include", forced_h, "-c", source_file};
+
+  const std::set<std::string> expected_i{forced_h, a_x_h};
+  EXPECT_EQ(expected_i, RunCppIncludeProcessor(source_file, args_i));
+  const std::set<std::string> expected_quote{forced_h, b_x_h};
+  EXPECT_EQ(expected_quote,
+            RunCppIncludeProcessor(source_file, args_quote, {a_dir}));
+  EXPECT_EQ(2U, CppPreambleCache::instance()->size());
+  EXPECT_EQ(0, CppPreambleCache::instance()->hit());
+
+  CppPreambleCache::Quit();
+}
+
+TEST_F(CppIncludeProcessorTest, prefetch) {
+  WorkerThreadManager wm;
+  wm.Start(1);
+  IncludeCache::Quit();
+  IncludeCache::Init(5, true);
+  IncludeCache::instance()->StartPrefetchPool(&wm, 2);
+
+  CreateTmpFile("#include \"x.h\"\n", "a.h");
+  const std::string& b_h = CreateTmpFile("#include \"c.h\"\n", "b.h");
+  const std::string& c_h = CreateTmpFile("#define C 1\n", "c.h");
+  const std::string& source_file = CreateTmpFile(
+      "#if 0\n"
+      "#include \"a.h\"\n"
+      "#endif\n"
+      "#include \"b.h\"\n",
+      "foo.cc");
+
+  // Prefetching a.h, which is not included, must not change the result.
+  const std::vector<std::string> args{"/usr/bin/g++", "-c", source_file};
+  const std::set<std::string> expected{b_h, c_h};
+  EXPECT_EQ(expected, RunCppIncludeProcessor(source_file, args));
+
+  // a.h is read only by the prefetch pool.
+  IncludeCache::instance()->WaitAllPrefetchDone();
+  std::ostringstream ss;
+  IncludeCache::instance()->Dump(&ss);
+  EXPECT_NE(std::string::npos, ss.str().find("current cache entries = 3"))
+      << ss.str();
+
+  // IncludeCache must quit before the prefetch pool.
+  IncludeCache::Quit();
+  IncludeCache::Init(5, true);
+  wm.Finish();
+}
+
 TEST_F(CppIncludeProcessorTest, vc_opt_fi) {
   const std::string& header = CreateTmpFile("", "foo.h");
   std::vector<std::string> args;
@@ -63,7 +63,7 @@ CppToken::int_value CppIntegerConstantEvaluator::Primary() {
         // If it comes to here without expanded to number, it means
         // identifier is not defined.  Such case should be 0 unless
         // it is the C++ reserved keyword "true".
-        if (parser_->is_cplusplus() && token.string_value == "true") {
+        if (parser_->is_cplusplus() && token.IsIdentifier("true")) {
           // Int value of C++ reserved keyword "true" is 1.
           // See: ISO/IEC 14882:2011 (C++11) 4.5 Integral promotions.
           result.value = 1;
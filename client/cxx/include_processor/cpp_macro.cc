@@ -4,10 +4,22 @@
 
 #include "cpp_macro.h"
 
+#include <tuple>
+
+#include "absl/hash/hash.h"
 #include "autolock_timer.h"
 
 namespace devtools_goma {
 
+// static
+size_t Macro::Fingerprint(Type type,
+                          const ArrayTokenList& replacement,
+                          size_t num_args,
+                          bool is_vararg) {
+  return absl::Hash<std::tuple<Type, const ArrayTokenList&, size_t, bool>>()(
+      std::tie(type, replacement, num_args, is_vararg));
+}
+
 // static
 bool Macro::IsParenBalanced(const ArrayTokenList& tokens) {
   int level = 0;
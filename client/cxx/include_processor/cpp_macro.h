@@ -9,6 +9,8 @@
 #include <string>
 #include <unordered_map>
 
+#include "absl/strings/string_view.h"
+#include "cpp_atom.h"
 #include "cpp_token.h"
 #include "glog/logging.h"
 
@@ -41,12 +43,13 @@ struct Macro {
   };
 
   // OBJ or FUNC
-  Macro(std::string name,
+  Macro(absl::string_view name,
         Type type,
         ArrayTokenList replacement,
         size_t num_args,
         bool is_vararg)
-      : name(std::move(name)),
+      : atom(CppAtom::Intern(name)),
+        name(atom.str()),
         type(type),
         replacement(std::move(replacement)),
         callback(nullptr),
@@ -54,42 +57,53 @@ struct Macro {
         num_args(num_args),
         is_vararg(is_vararg),
         is_hidden(false),
-        is_paren_balanced(IsParenBalanced(this->replacement)) {
+        is_paren_balanced(IsParenBalanced(this->replacement)),
+        fingerprint(Fingerprint(type, this->replacement, num_args, is_vararg)) {
     DCHECK(type == OBJ || type == FUNC) << type;
   }
 
   // CBK
-  Macro(std::string name, Type type, CallbackObj obj)
-      : name(std::move(name)),
+  Macro(absl::string_view name, Type type, CallbackObj obj)
+      : atom(CppAtom::Intern(name)),
+        name(atom.str()),
         type(type),
         callback(obj),
         callback_func(nullptr),
         num_args(0),
         is_vararg(false),
         is_hidden(false),
-        is_paren_balanced(true) {
+        is_paren_balanced(true),
+        fingerprint(0) {
     DCHECK_EQ(type, CBK);
   }
 
   // CBK_FUNC
-  Macro(std::string name, Type type, CallbackFunc func, bool is_hidden)
-      : name(std::move(name)),
+  Macro(absl::string_view name, Type type, CallbackFunc func, bool is_hidden)
+      : atom(CppAtom::Intern(name)),
+        name(atom.str()),
         type(type),
         callback(nullptr),
         callback_func(func),
         num_args(1),  // CallbackFunc takes always 1 argument.
         is_vararg(false),
         is_hidden(is_hidden),
-        is_paren_balanced(true) {
+        is_paren_balanced(true),
+        fingerprint(0) {
     DCHECK_EQ(type, CBK_FUNC);
   }
 
   static bool IsParenBalanced(const ArrayTokenList& tokens);
+  static size_t Fingerprint(Type type,
+                            const ArrayTokenList& replacement,
+                            size_t num_args,
+                            bool is_vararg);
 
   std::string DebugString(CppParser* parser) const;
   bool IsPredefinedMacro() const { return type == CBK || type == CBK_FUNC; }
 
-  const std::string name;
+  // |name| is the interned string of |atom|.
+  const CppAtom atom;
+  const std::string& name;
   const Type type;
   const ArrayTokenList replacement;
   const CallbackObj callback;
@@ -101,6 +115,9 @@ struct Macro {
   // but __has_include__ can be used.
   const bool is_hidden;
   const bool is_paren_balanced;
+  // Hash of the definition of OBJ or FUNC macro. Macros with the same
+  // fingerprint expand to the same tokens. 0 for CBK and CBK_FUNC.
+  const size_t fingerprint;
 };
 
 }  // namespace devtools_goma
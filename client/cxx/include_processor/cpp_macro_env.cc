@@ -0,0 +1,297 @@
+// Copyright 2021 The Goma Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "cpp_macro_env.h"
+
+#include <bitset>
+#include <utility>
+
+#include "absl/hash/hash.h"
+#include "glog/logging.h"
+
+namespace devtools_goma {
+
+namespace {
+
+constexpr int kBitsPerLevel = 5;
+constexpr size_t kLevelMask = (1 << kBitsPerLevel) - 1;
+constexpr int kHashBits = sizeof(size_t) * 8;
+
+size_t HashAtom(CppAtom atom) {
+  return absl::Hash<CppAtom>()(atom);
+}
+
+uint32_t ChunkBit(size_t hash, int shift) {
+  return 1u << ((hash >> shift) & kLevelMask);
+}
+
+// Returns the slot position of |bit| in a node having |bitmap|.
+size_t SlotPos(uint32_t bitmap, uint32_t bit) {
+  return std::bitset<32>(bitmap & (bit - 1)).count();
+}
+
+}  // namespace
+
+CppMacroEnv::~CppMacroEnv() {
+  if (root_ != nullptr) {
+    Unref(root_);
+  }
+}
+
+CppMacroEnv::CppMacroEnv(const CppMacroEnv& other)
+    : root_(other.root_), size_(other.size_) {
+  if (root_ != nullptr) {
+    Ref(root_);
+  }
+}
+
+CppMacroEnv& CppMacroEnv::operator=(const CppMacroEnv& other) {
+  if (other.root_ != nullptr) {
+    Ref(other.root_);
+  }
+  if (root_ != nullptr) {
+    Unref(root_);
+  }
+  root_ = other.root_;
+  size_ = other.size_;
+  return *this;
+}
+
+CppMacroEnv::CppMacroEnv(CppMacroEnv&& other) noexcept
+    : root_(other.root_), size_(other.size_) {
+  other.root_ = nullptr;
+  other.size_ = 0;
+}
+
+CppMacroEnv& CppMacroEnv::operator=(CppMacroEnv&& other) noexcept {
+  std::swap(root_, other.root_);
+  std::swap(size_, other.size_);
+  return *this;
+}
+
+const Macro* CppMacroEnv::Add(const Macro* macro) {
+  const Macro* existing = AddToNode(&root_, HashAtom(macro->atom), 0, macro);
+  if (existing == nullptr) {
+    ++size_;
+  }
+  return existing;
+}
+
+const Macro* CppMacroEnv::Get(CppAtom atom) const {
+  const size_t hash = HashAtom(atom);
+  int shift = 0;
+  const Node* node = root_;
+  while (node != nullptr) {
+    if (node->is_collision) {
+      for (const auto& slot : node->slots) {
+        if (slot.macro->atom == atom) {
+          return slot.macro;
+        }
+      }
+      return nullptr;
+    }
+    const uint32_t bit = ChunkBit(hash, shift);
+    if ((node->bitmap & bit) == 0) {
+      return nullptr;
+    }
+    const Slot& slot = node->slots[SlotPos(node->bitmap, bit)];
+    if (slot.child == nullptr) {
+      return slot.macro->atom == atom ? slot.macro : nullptr;
+    }
+    node = slot.child;
+    shift += kBitsPerLevel;
+  }
+  return nullptr;
+}
+
+const Macro* CppMacroEnv::Get(absl::string_view name) const {
+  const CppAtom atom = CppAtom::Find(name);
+  if (atom.empty()) {
+    return nullptr;
+  }
+  return Get(atom);
+}
+
+const Macro* CppMacroEnv::Delete(CppAtom atom) {
+  // Check existence first not to copy shared nodes needlessly.
+  const Macro* existing = Get(atom);
+  if (existing == nullptr) {
+    return nullptr;
+  }
+  DeleteFromNode(&root_, HashAtom(atom), 0, atom);
+  --size_;
+  if (root_->slots.empty()) {
+    Unref(root_);
+    root_ = nullptr;
+  }
+  return existing;
+}
+
+const Macro* CppMacroEnv::Delete(absl::string_view name) {
+  const CppAtom atom = CppAtom::Find(name);
+  if (atom.empty()) {
+    return nullptr;
+  }
+  return Delete(atom);
+}
+
+// static
+void CppMacroEnv::Ref(Node* node) {
+  node->refcount.fetch_add(1, std::memory_order_relaxed);
+}
+
+// static
+void CppMacroEnv::Unref(Node* node) {
+  if (node->refcount.fetch_sub(1, std::memory_order_acq_rel) != 1) {
+    return;
+  }
+  for (const auto& slot : node->slots) {
+    if (slot.child != nullptr) {
+      Unref(slot.child);
+    }
+  }
+  delete node;
+}
+
+// static
+void CppMacroEnv::MakeUnique(Node** node) {
+  Node* shared = *node;
+  // acquire to see all accesses by other owners that have released |shared|.
+  if (shared->refcount.load(std::memory_order_acquire) == 1) {
+    return;
+  }
+  Node* copy = new Node(shared->is_collision);
+  copy->bitmap = shared->bitmap;
+  copy->slots = shared->slots;
+  for (const auto& slot : copy->slots) {
+    if (slot.child != nullptr) {
+      Ref(slot.child);
+    }
+  }
+  Unref(shared);
+  *node = copy;
+}
+
+// static
+const Macro* CppMacroEnv::AddToNode(Node** node,
+                                    size_t hash,
+                                    int shift,
+                                    const Macro* macro) {
+  if (*node == nullptr) {
+    *node = new Node(shift >= kHashBits);
+  }
+  MakeUnique(node);
+  Node* n = *node;
+
+  if (n->is_collision) {
+    for (auto& slot : n->slots) {
+      if (slot.macro->atom == macro->atom) {
+        const Macro* existing = slot.macro;
+        slot.macro = macro;
+        return existing;
+      }
+    }
+    n->slots.push_back(Slot{hash, macro, nullptr});
+    return nullptr;
+  }
+
+  const uint32_t bit = ChunkBit(hash, shift);
+  const size_t pos = SlotPos(n->bitmap, bit);
+  if ((n->bitmap & bit) == 0) {
+    n->bitmap |= bit;
+    n->slots.insert(n->slots.begin() + pos, Slot{hash, macro, nullptr});
+    return nullptr;
+  }
+
+  Slot& slot = n->slots[pos];
+  if (slot.child != nullptr) {
+    return AddToNode(&slot.child, hash, shift + kBitsPerLevel, macro);
+  }
+  if (slot.macro->atom == macro->atom) {
+    const Macro* existing = slot.macro;
+    slot.macro = macro;
+    return existing;
+  }
+  const Slot existing_slot = slot;
+  slot.child = NewNodeWithTwo(existing_slot, Slot{hash, macro, nullptr},
+                              shift + kBitsPerLevel);
+  slot.macro = nullptr;
+  slot.hash = 0;
+  return nullptr;
+}
+
+// static
+const Macro* CppMacroEnv::DeleteFromNode(Node** node,
+                                         size_t hash,
+                                         int shift,
+                                         CppAtom atom) {
+  MakeUnique(node);
+  Node* n = *node;
+
+  if (n->is_collision) {
+    for (auto it = n->slots.begin(); it != n->slots.end(); ++it) {
+      if (it->macro->atom == atom) {
+        const Macro* existing = it->macro;
+        n->slots.erase(it);
+        return existing;
+      }
+    }
+    return nullptr;
+  }
+
+  const uint32_t bit = ChunkBit(hash, shift);
+  DCHECK(n->bitmap & bit);
+  const size_t pos = SlotPos(n->bitmap, bit);
+  Slot& slot = n->slots[pos];
+  if (slot.child == nullptr) {
+    DCHECK(slot.macro->atom == atom) << slot.macro->name;
+    const Macro* existing = slot.macro;
+    n->bitmap &= ~bit;
+    n->slots.erase(n->slots.begin() + pos);
+    return existing;
+  }
+
+  const Macro* existing =
+      DeleteFromNode(&slot.child, hash, shift + kBitsPerLevel, atom);
+  Node* child = slot.child;
+  if (child->slots.empty()) {
+    Unref(child);
+    n->bitmap &= ~bit;
+    n->slots.erase(n->slots.begin() + pos);
+  } else if (child->slots.size() == 1 && child->slots[0].child == nullptr) {
+    // Pull up the last macro in |child|.
+    slot = child->slots[0];
+    Unref(child);
+  }
+  return existing;
+}
+
+// static
+CppMacroEnv::Node* CppMacroEnv::NewNodeWithTwo(const Slot& a,
+                                               const Slot& b,
+                                               int shift) {
+  if (shift >= kHashBits) {
+    Node* node = new Node(true);
+    node->slots = {a, b};
+    return node;
+  }
+  Node* node = new Node(false);
+  const uint32_t bit_a = ChunkBit(a.hash, shift);
+  const uint32_t bit_b = ChunkBit(b.hash, shift);
+  if (bit_a == bit_b) {
+    node->bitmap = bit_a;
+    node->slots.push_back(
+        Slot{0, nullptr, NewNodeWithTwo(a, b, shift + kBitsPerLevel)});
+    return node;
+  }
+  node->bitmap = bit_a | bit_b;
+  if (bit_a < bit_b) {
+    node->slots = {a, b};
+  } else {
+    node->slots = {b, a};
+  }
+  return node;
+}
+
+}  // namespace devtools_goma
@@ -5,68 +5,114 @@
 #ifndef DEVTOOLS_GOMA_CLIENT_CXX_INCLUDE_PROCESSOR_CPP_MACRO_ENV_H_
 #define DEVTOOLS_GOMA_CLIENT_CXX_INCLUDE_PROCESSOR_CPP_MACRO_ENV_H_
 
+#include <atomic>
+#include <cstdint>
 #include <string>
+#include <vector>
 
-#include "absl/container/flat_hash_map.h"
+#include "absl/strings/string_view.h"
+#include "cpp_atom.h"
 #include "cpp_macro.h"
 
 namespace devtools_goma {
 
+// CppMacroEnv is a map from macro name to Macro, keyed by the interned
+// name (CppAtom).
+//
+// It is a persistent hash array mapped trie (HAMT), so copying CppMacroEnv
+// is O(1) and copies share their nodes. A node is copied when it is
+// modified while shared by other CppMacroEnv (copy-on-write), and is
+// modified in place otherwise.
+//
+// CppMacroEnv itself is thread-unsafe, but it is safe to use copies of
+// the same CppMacroEnv on different threads.
 class CppMacroEnv {
  public:
-  using UnderlyingMapType =
-      absl::flat_hash_map<absl::string_view, const Macro*>;
+  CppMacroEnv() = default;
+  ~CppMacroEnv();
+
+  CppMacroEnv(const CppMacroEnv& other);
+  CppMacroEnv& operator=(const CppMacroEnv& other);
+  CppMacroEnv(CppMacroEnv&& other) noexcept;
+  CppMacroEnv& operator=(CppMacroEnv&& other) noexcept;
 
   // Add |macro| to map.
   // If the same name macro exists, |macro| overrides the existing one,
   // and the old macro is returned. nullptr if not.
-  const Macro* Add(const Macro* macro) {
-    absl::string_view name = macro->name;
-    auto p = env_.emplace(name, macro);
-    if (p.second) {
-      // no existing macro.
-      return nullptr;
-    }
+  const Macro* Add(const Macro* macro);
 
-    const Macro* existing_macro = p.first->second;
+  // Get a macro by |atom| or |name|.
+  const Macro* Get(CppAtom atom) const;
+  const Macro* Get(absl::string_view name) const;
 
-    // Be careful. key must be always the view of macro name.
-    // Otherwise, string_view won't be alive.
-    // So, we need to erase & insert to update key.
-    env_.erase(p.first);
-    env_.emplace(name, macro);
+  // Delete a macro by |atom| or |name|.
+  // The deleted macro is returned.
+  const Macro* Delete(CppAtom atom);
+  const Macro* Delete(absl::string_view name);
 
-    return existing_macro;
-  }
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
 
-  // Get a macro by |name|.
-  const Macro* Get(const std::string& name) const {
-    auto it = env_.find(name);
-    if (it == env_.end()) {
-      return nullptr;
+  // Calls |fn| with each macro. for dump, debug, etc.
+  template <typename Fn>
+  void ForEach(Fn&& fn) const {
+    if (root_ != nullptr) {
+      ForEachInNode(*root_, fn);
     }
-
-    return it->second;
   }
 
-  // Delete a macro by name.
-  // The deleted macro is returned.
-  const Macro* Delete(const std::string& name) {
-    auto it = env_.find(name);
-    if (it == env_.end()) {
-      return nullptr;
+ private:
+  struct Node;
+
+  // A slot in Node. It has either |macro| or |child|.
+  struct Slot {
+    size_t hash;
+    const Macro* macro;
+    Node* child;
+  };
+
+  struct Node {
+    explicit Node(bool is_collision) : is_collision(is_collision) {}
+
+    std::atomic<int> refcount{1};
+    // Bit i is set if a slot for hash chunk i exists.
+    // Not used for collision node.
+    uint32_t bitmap = 0;
+    // Collision node has macros having the same hash, and it is used only
+    // after all hash bits are consumed.
+    const bool is_collision;
+    std::vector<Slot> slots;
+  };
+
+  template <typename Fn>
+  static void ForEachInNode(const Node& node, Fn& fn) {
+    for (const auto& slot : node.slots) {
+      if (slot.child != nullptr) {
+        ForEachInNode(*slot.child, fn);
+      } else {
+        fn(slot.macro);
+      }
     }
-
-    const Macro* existing = it->second;
-    env_.erase(it);
-    return existing;
   }
 
-  // Returns the underlying map. for dump, debug, etc.
-  const UnderlyingMapType& UnderlyingMap() const { return env_; }
-
- private:
-  UnderlyingMapType env_;
+  static void Ref(Node* node);
+  static void Unref(Node* node);
+  // Makes |*node| owned only by the caller, copying it if shared.
+  static void MakeUnique(Node** node);
+
+  static const Macro* AddToNode(Node** node,
+                                size_t hash,
+                                int shift,
+                                const Macro* macro);
+  static const Macro* DeleteFromNode(Node** node,
+                                     size_t hash,
+                                     int shift,
+                                     CppAtom atom);
+  // Creates a node having |a| and |b|, which have different names.
+  static Node* NewNodeWithTwo(const Slot& a, const Slot& b, int shift);
+
+  Node* root_ = nullptr;
+  size_t size_ = 0;
 };
 
 }  // namespace devtools_goma
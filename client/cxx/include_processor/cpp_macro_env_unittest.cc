@@ -0,0 +1,167 @@
+// Copyright 2021 The Goma Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "cpp_macro_env.h"
+
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "cpp_macro.h"
+#include "gtest/gtest.h"
+
+namespace devtools_goma {
+
+namespace {
+
+std::unique_ptr<Macro> NewMacro(const std::string& name) {
+  return absl::make_unique<Macro>(name, Macro::OBJ, ArrayTokenList(), 0,
+                                  false);
+}
+
+std::map<std::string, const Macro*> ToMap(const CppMacroEnv& env) {
+  std::map<std::string, const Macro*> m;
+  env.ForEach([&m](const Macro* macro) {
+    EXPECT_TRUE(m.emplace(macro->name, macro).second) << macro->name;
+  });
+  return m;
+}
+
+}  // namespace
+
+TEST(CppMacroEnvTest, AddGetDelete) {
+  auto a = NewMacro("a");
+  auto a2 = NewMacro("a");
+  auto b = NewMacro("b");
+
+  CppMacroEnv env;
+  EXPECT_TRUE(env.empty());
+  EXPECT_EQ(nullptr, env.Get("a"));
+
+  EXPECT_EQ(nullptr, env.Add(a.get()));
+  EXPECT_EQ(nullptr, env.Add(b.get()));
+  EXPECT_EQ(2U, env.size());
+  EXPECT_EQ(a.get(), env.Get("a"));
+  EXPECT_EQ(b.get(), env.Get("b"));
+
+  EXPECT_EQ(a.get(), env.Add(a2.get()));
+  EXPECT_EQ(2U, env.size());
+  EXPECT_EQ(a2.get(), env.Get("a"));
+
+  EXPECT_EQ(nullptr, env.Delete("c"));
+  EXPECT_EQ(a2.get(), env.Delete("a"));
+  EXPECT_EQ(nullptr, env.Get("a"));
+  EXPECT_EQ(1U, env.size());
+  EXPECT_EQ(b.get(), env.Delete("b"));
+  EXPECT_TRUE(env.empty());
+  EXPECT_TRUE(ToMap(env).empty());
+}
+
+TEST(CppMacroEnvTest, ManyMacros) {
+  static const int kNumMacros = 20000;
+  std::vector<std::unique_ptr<Macro>> macros;
+  for (int i = 0; i < kNumMacros; ++i) {
+    macros.push_back(NewMacro("MACRO_" + std::to_string(i)));
+  }
+
+  CppMacroEnv env;
+  std::map<std::string, const Macro*> expected;
+  for (const auto& macro : macros) {
+    EXPECT_EQ(nullptr, env.Add(macro.get()));
+    expected.emplace(macro->name, macro.get());
+  }
+  EXPECT_EQ(expected.size(), env.size());
+  EXPECT_EQ(expected, ToMap(env));
+
+  for (int i = 0; i < kNumMacros; i += 3) {
+    const std::string name = "MACRO_" + std::to_string(i);
+    EXPECT_EQ(expected[name], env.Delete(name));
+    expected.erase(name);
+  }
+  EXPECT_EQ(expected.size(), env.size());
+  EXPECT_EQ(expected, ToMap(env));
+  for (const auto& macro : macros) {
+    if (expected.count(macro->name)) {
+      EXPECT_EQ(macro.get(), env.Get(macro->name));
+    } else {
+      EXPECT_EQ(nullptr, env.Get(macro->name));
+    }
+  }
+}
+
+TEST(CppMacroEnvTest, Fork) {
+  std::vector<std::unique_ptr<Macro>> macros;
+  for (int i = 0; i < 1000; ++i) {
+    macros.push_back(NewMacro("MACRO_" + std::to_string(i)));
+  }
+  auto override_macro = NewMacro("MACRO_0");
+  auto new_macro = NewMacro("NEW");
+
+  CppMacroEnv base;
+  for (const auto& macro : macros) {
+    base.Add(macro.get());
+  }
+  const std::map<std::string, const Macro*> base_map = ToMap(base);
+
+  CppMacroEnv fork1 = base;
+  CppMacroEnv fork2;
+  fork2 = base;
+  EXPECT_EQ(macros[0].get(), fork1.Add(override_macro.get()));
+  EXPECT_EQ(macros[1].get(), fork1.Delete("MACRO_1"));
+  EXPECT_EQ(nullptr, fork2.Add(new_macro.get()));
+
+  EXPECT_EQ(base_map, ToMap(base));
+  EXPECT_EQ(macros[0].get(), base.Get("MACRO_0"));
+  EXPECT_EQ(macros[1].get(), base.Get("MACRO_1"));
+  EXPECT_EQ(nullptr, base.Get("NEW"));
+
+  EXPECT_EQ(override_macro.get(), fork1.Get("MACRO_0"));
+  EXPECT_EQ(nullptr, fork1.Get("MACRO_1"));
+  EXPECT_EQ(nullptr, fork1.Get("NEW"));
+  EXPECT_EQ(999U, fork1.size());
+
+  EXPECT_EQ(macros[0].get(), fork2.Get("MACRO_0"));
+  EXPECT_EQ(new_macro.get(), fork2.Get("NEW"));
+  EXPECT_EQ(1001U, fork2.size());
+
+  CppMacroEnv moved = std::move(fork2);
+  EXPECT_EQ(new_macro.get(), moved.Get("NEW"));
+  EXPECT_EQ(1001U, moved.size());
+}
+
+TEST(CppMacroEnvTest, ForkOnThreads) {
+  std::vector<std::unique_ptr<Macro>> macros;
+  for (int i = 0; i < 1000; ++i) {
+    macros.push_back(NewMacro("MACRO_" + std::to_string(i)));
+  }
+  CppMacroEnv base;
+  for (const auto& macro : macros) {
+    base.Add(macro.get());
+  }
+
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back([&base, &macros, t]() {
+      for (int n = 0; n < 10; ++n) {
+        CppMacroEnv env = base;
+        for (int i = t; i < 1000; i += 4) {
+          EXPECT_EQ(macros[i].get(), env.Delete(macros[i]->name));
+        }
+        EXPECT_EQ(750U, env.size());
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(1000U, base.size());
+  for (const auto& macro : macros) {
+    EXPECT_EQ(macro.get(), base.Get(macro->name));
+  }
+}
+
+}  // namespace devtools_goma
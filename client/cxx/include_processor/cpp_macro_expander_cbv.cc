@@ -58,11 +58,11 @@ bool CppMacroExpanderCBV::Expand(ArrayTokenList::const_iterator input_begin,
     // #define e.g. "#define FOO (defined(BAR))".
     // "defined" in #if should be expanded before in CppParser::EvalCondition.
     // We don't support "defined" here. Naive expander will handle it.
-    if (token.string_value == "defined") {
+    if (token.IsIdentifier("defined")) {
       return false;
     }
 
-    const Macro* macro = parser_->GetMacro(token.string_value);
+    const Macro* macro = parser_->GetMacro(token.atom);
     if (!macro || hideset.Has(macro)) {
       output->push_back(token);
       continue;
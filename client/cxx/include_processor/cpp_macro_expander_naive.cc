@@ -129,14 +129,14 @@ bool CppMacroExpanderNaive::Expand(TokenHSList* input,
     //
     // On VC, defined(XXX) is not handled well but defined XXX
     // is handled. See b/6533195.
-    if (input_range.begin->token.string_value == "defined") {
+    if (input_range.begin->token.IsIdentifier("defined")) {
       auto next_it =
           NextNonSpaceTokenHSFrom(input_range.begin, input_range.end);
 
       if (next_it != input_range.end &&
           next_it->token.type == CppToken::IDENTIFIER) {
         // defined XXX.
-        int defined = parser_->IsMacroDefined(next_it->token.string_value);
+        int defined = parser_->IsMacroDefined(next_it->token.atom);
         output->emplace_back(CppToken(defined), MacroSet());
 
         input_range.begin = next_it;
@@ -152,7 +152,7 @@ bool CppMacroExpanderNaive::Expand(TokenHSList* input,
             next2_it->token.type == CppToken::IDENTIFIER &&
             next3_it->token.IsPuncChar(')')) {
           // defined(XXX)
-          int defined = parser_->IsMacroDefined(next2_it->token.string_value);
+          int defined = parser_->IsMacroDefined(next2_it->token.atom);
           output->emplace_back(CppToken(defined), MacroSet());
           input_range.begin = next3_it;
           ++input_range.begin;
@@ -165,7 +165,7 @@ bool CppMacroExpanderNaive::Expand(TokenHSList* input,
 
     // Case 1. input[0] is not a macro or in input[0]'s hide_set.
     const Macro* macro =
-        parser_->GetMacro(input_range.begin->token.string_value);
+        parser_->GetMacro(input_range.begin->token.atom);
     if (!macro || input_range.begin->hideset.Has(macro)) {
       output->push_back(*input_range.begin);
       ++input_range.begin;
@@ -563,8 +563,11 @@ bool CppMacroExpanderNaive::Glue(TokenHSList* output, const TokenHS& ths) {
 
   std::string s = s1 + s2;
 
+  // Pasted identifiers are not interned, since they can be made without
+  // bound, e.g. by pasting __LINE__ or __COUNTER__.
   ArrayTokenList tokens;
-  if (!CppTokenizer::TokenizeAll(s, SpaceHandling::kSkip, &tokens)) {
+  if (!CppTokenizer::TokenizeAllWithoutInterning(s, SpaceHandling::kSkip,
+                                                 &tokens)) {
     std::string error_message =
         "does not give a valid preprocessing token: failed to tokenize: " + s;
     parser_->Error(error_message);
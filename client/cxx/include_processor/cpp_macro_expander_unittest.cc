@@ -592,6 +592,37 @@ TEST(CppMacroExpanderTest, GlueInclude) {
       "<boost/atomic/detail/caps_gcc_atomic.hpp>");
 }
 
+TEST(CppMacroExpanderTest, GlueNotInterned) {
+  CppParser cpp_parser;
+  cpp_parser.AddStringInput(
+      "#define GLUE(X, Y) X ## Y\n"
+      "#define STR(X) #X\n"
+      "#define XSTR(X) STR(X)\n"
+      "#define glue_test_defined 1\n",
+      "(string)");
+  EXPECT_TRUE(cpp_parser.ProcessDirectives());
+
+  ArrayTokenList tokens;
+  ASSERT_TRUE(CppTokenizer::TokenizeAll(
+      "GLUE(glue_test_, defined) GLUE(glue_test_, 12345) "
+      "XSTR(GLUE(glue_test_, 12345))",
+      SpaceHandling::kKeep, &tokens));
+
+  ArrayTokenList expanded;
+  CppMacroExpanderNaive(&cpp_parser)
+      .ExpandMacro(tokens, SpaceHandling::kSkip, &expanded);
+  ASSERT_EQ(3U, expanded.size()) << DebugString(expanded);
+  // A pasted identifier is still expanded if it is a macro.
+  EXPECT_EQ(CppToken(1), expanded[0]);
+  // Otherwise, it is not interned, but keeps its text.
+  EXPECT_EQ(CppToken::IDENTIFIER, expanded[1].type);
+  EXPECT_TRUE(expanded[1].atom.empty());
+  EXPECT_EQ("glue_test_12345", expanded[1].identifier());
+  EXPECT_TRUE(expanded[1].IsIdentifier("glue_test_12345"));
+  EXPECT_EQ(CppToken(CppToken::STRING, "glue_test_12345"), expanded[2]);
+  EXPECT_TRUE(CppAtom::Find("glue_test_12345").empty());
+}
+
 TEST(CppMacroExpanderTest, Complex) {
   CheckExpand(CheckFlag::kPassAll,
               "#define f(x) f\n"
@@ -14,6 +14,7 @@
 #include <memory>
 #include <set>
 #include <unordered_map>
+#include <utility>
 
 #include "absl/memory/memory.h"
 #include "absl/strings/ascii.h"
@@ -77,8 +78,13 @@ CppParser::CppParser()
       compiler_info_(nullptr),
       is_vc_(false),
       disabled_(false),
+      macro_refs_(nullptr),
+      macro_refs_uncacheable_(false),
       skipped_files_(0),
       total_files_(0),
+      num_errors_(0),
+      condition_memo_hits_(0),
+      condition_memo_misses_(0),
       owner_thread_id_(GetCurrentThreadId()) {
   const absl::Time now = absl::Now();
   current_time_ = absl::FormatTime("%H:%M:%S", now, absl::LocalTimeZone());
@@ -114,6 +120,40 @@ void CppParser::SetCompilerInfo(const CxxCompilerInfo* compiler_info) {
   ProcessDirectives();
 }
 
+std::shared_ptr<const CppParser::Snapshot> CppParser::CreateSnapshot() const {
+  if (disabled_ || HasMoreInput() || !conditions_.empty()) {
+    return nullptr;
+  }
+  auto snapshot = std::make_shared<Snapshot>();
+  snapshot->input_protects_ = input_protects_;
+  snapshot->macro_env_ = macro_env_;
+  snapshot->pragma_once_fileset_ = pragma_once_fileset_;
+  snapshot->include_guard_ident_ = include_guard_ident_;
+  snapshot->base_file_ = base_file_;
+  snapshot->counter_ = counter_;
+  snapshot->is_cplusplus_ = is_cplusplus_;
+  snapshot->is_vc_ = is_vc_;
+  return snapshot;
+}
+
+void CppParser::RestoreSnapshot(const Snapshot& snapshot,
+                                const CxxCompilerInfo* compiler_info) {
+  DCHECK(!HasMoreInput());
+  DCHECK(conditions_.empty());
+  compiler_info_ = compiler_info;
+  // Keep own input_protects_, since |last_input_| may refer it.
+  input_protects_.insert(input_protects_.end(),
+                         snapshot.input_protects_.begin(),
+                         snapshot.input_protects_.end());
+  macro_env_ = snapshot.macro_env_;
+  pragma_once_fileset_ = snapshot.pragma_once_fileset_;
+  include_guard_ident_ = snapshot.include_guard_ident_;
+  base_file_ = snapshot.base_file_;
+  counter_ = snapshot.counter_;
+  is_cplusplus_ = snapshot.is_cplusplus_;
+  is_vc_ = snapshot.is_vc_;
+}
+
 bool CppParser::ProcessDirectives() {
   GOMA_COUNTERZ("ProcessDirectives");
   if (disabled_)
@@ -237,20 +277,50 @@ void CppParser::AddMacro(const Macro* macro) {
   }
 }
 
-const Macro* CppParser::GetMacro(const std::string& name) {
-  return macro_env_.Get(name);
+const Macro* CppParser::GetMacro(CppAtom atom) {
+  const Macro* macro = macro_env_.Get(atom);
+  if (macro_refs_) {
+    RecordMacroRef(atom, macro, false);
+  }
+  return macro;
 }
 
-void CppParser::DeleteMacro(const std::string& name) {
-  const Macro* existing_macro = macro_env_.Delete(name);
+const Macro* CppParser::GetMacro(absl::string_view name) {
+  const CppAtom atom = CppAtom::Find(name);
+  if (atom.empty()) {
+    return nullptr;
+  }
+  return GetMacro(atom);
+}
+
+void CppParser::DeleteMacro(CppAtom atom) {
+  const Macro* existing_macro = macro_env_.Delete(atom);
 
   if (existing_macro && existing_macro->IsPredefinedMacro()) {
-    Error("predefined macro is deleted:", name);
+    Error("predefined macro is deleted:", atom.str());
+  }
+}
+
+void CppParser::DeleteMacro(absl::string_view name) {
+  const CppAtom atom = CppAtom::Find(name);
+  if (!atom.empty()) {
+    DeleteMacro(atom);
   }
 }
 
-bool CppParser::IsMacroDefined(const std::string& name) {
-  const Macro* m = GetMacro(name);
+bool CppParser::IsMacroDefined(absl::string_view name) {
+  const CppAtom atom = CppAtom::Find(name);
+  if (atom.empty()) {
+    return false;
+  }
+  return IsMacroDefined(atom);
+}
+
+bool CppParser::IsMacroDefined(CppAtom atom) {
+  const Macro* m = macro_env_.Get(atom);
+  if (macro_refs_) {
+    RecordMacroRef(atom, m, true);
+  }
   if (!m) {
     return false;
   }
@@ -351,9 +421,9 @@ void CppParser::AddPreparsedDirectivesInput(SharedCppDirectives directives) {
 
 std::string CppParser::DumpMacros() {
   std::stringstream ss;
-  for (const auto& entry : macro_env_.UnderlyingMap()) {
-    ss << entry.second->DebugString(this) << std::endl;
-  }
+  macro_env_.ForEach([this, &ss](const Macro* macro) {
+    ss << macro->DebugString(this) << std::endl;
+  });
   return ss.str();
 }
 
@@ -370,12 +440,11 @@ std::string CppParser::DebugStringPrefix() {
 }
 
 void CppParser::Error(absl::string_view error) {
-  if (!error_observer_)
-    return;
   Error(error, "");
 }
 
 void CppParser::Error(absl::string_view error, absl::string_view arg) {
+  ++num_errors_;
   if (!error_observer_)
     return;
   std::string str;
@@ -427,7 +496,7 @@ void CppParser::ProcessDefine(const CppDirectiveDefine& d) {
 
 void CppParser::ProcessUndef(const CppDirectiveUndef& d) {
   GOMA_COUNTERZ("undef");
-  DeleteMacro(d.name());
+  DeleteMacro(d.name_atom());
 }
 
 void CppParser::ProcessConditionInFalse(const CppDirective& directive) {
@@ -436,21 +505,21 @@ void CppParser::ProcessConditionInFalse(const CppDirective& directive) {
 
 void CppParser::ProcessIfdef(const CppDirectiveIfdef& d) {
   GOMA_COUNTERZ("ifdef");
-  bool v = IsMacroDefined(d.name());
+  bool v = IsMacroDefined(d.name_atom());
   VLOG(2) << DebugStringPrefix() << " #IFDEF " << v;
   conditions_.push_back(Condition(v));
 }
 
 void CppParser::ProcessIfndef(const CppDirectiveIfndef& d) {
   GOMA_COUNTERZ("ifndef");
-  bool v = !IsMacroDefined(d.name());
+  bool v = !IsMacroDefined(d.name_atom());
   VLOG(2) << DebugStringPrefix() << " #IFNDEF " << v;
   conditions_.push_back(Condition(v));
 }
 
 void CppParser::ProcessIf(const CppDirectiveIf& d) {
   GOMA_COUNTERZ("if");
-  int64_t v = EvalCondition(d.tokens());
+  int64_t v = EvalCondition(d.tokens(), d.condition_memo());
   VLOG(2) << DebugStringPrefix() << " #IF " << v;
   conditions_.push_back(Condition(v != 0));
 }
@@ -495,7 +564,7 @@ void CppParser::ProcessElif(const CppDirectiveElif& d) {
     return;
   }
 
-  int64_t v = EvalCondition(d.tokens());
+  int64_t v = EvalCondition(d.tokens(), d.condition_memo());
   VLOG(2) << DebugStringPrefix() << " #ELIF " << v;
   conditions_.back().cond = (v != 0);
   conditions_.back().taken |= (v != 0);
@@ -579,8 +648,9 @@ void CppParser::ProcessIncludeInternal(const CppDirectiveIncludeBase& d) {
 
   DCHECK_EQ(' ', d.delimiter());
 
-  ArrayTokenList expanded =
-      CppMacroExpander(this).Expand(d.tokens(), SpaceHandling::kKeep);
+  ArrayTokenList expanded = CppMacroExpander(this).Expand(
+      ArrayTokenList(d.tokens().begin(), d.tokens().end()),
+      SpaceHandling::kKeep);
 
   if (expanded.empty()) {
     Error("#include expects \"filename\" or <filename>");
@@ -654,7 +724,110 @@ void CppParser::ProcessIncludeInternal(const CppDirectiveIncludeBase& d) {
   Error("#include expects \"filename\" or <filename>");
 }
 
-int64_t CppParser::EvalCondition(const ArrayTokenList& orig_tokens) {
+int64_t CppParser::EvalCondition(absl::Span<const CppToken> orig_tokens,
+                                 CppConditionMemo* memo) {
+  if (memo == nullptr) {
+    return EvalConditionInternal(orig_tokens);
+  }
+
+  std::shared_ptr<const CppConditionMemo::Entry> entry = memo->Get();
+  if (entry && IsConditionMemoValid(*entry)) {
+    GOMA_COUNTERZ("condition memo hit");
+    ++condition_memo_hits_;
+    return entry->value;
+  }
+  ++condition_memo_misses_;
+
+  DCHECK(macro_refs_ == nullptr);
+  std::vector<CppConditionMemo::MacroRef> macro_refs;
+  macro_refs_ = &macro_refs;
+  macro_refs_uncacheable_ = false;
+  const int num_errors = num_errors_;
+
+  int64_t v = EvalConditionInternal(orig_tokens);
+
+  macro_refs_ = nullptr;
+  if (macro_refs_uncacheable_ || num_errors_ != num_errors) {
+    // Evaluate it every time, to report errors.
+    return v;
+  }
+
+  // The same macro can be looked up several times during expansion.
+  std::sort(macro_refs.begin(), macro_refs.end(),
+            [](const CppConditionMemo::MacroRef& a,
+               const CppConditionMemo::MacroRef& b) {
+              return std::make_pair(a.atom.id(), a.defined_only) <
+                     std::make_pair(b.atom.id(), b.defined_only);
+            });
+  macro_refs.erase(
+      std::unique(macro_refs.begin(), macro_refs.end(),
+                  [](const CppConditionMemo::MacroRef& a,
+                     const CppConditionMemo::MacroRef& b) {
+                    return a.atom == b.atom && a.defined_only == b.defined_only;
+                  }),
+      macro_refs.end());
+
+  auto new_entry = std::make_shared<CppConditionMemo::Entry>();
+  new_entry->value = v;
+  new_entry->parser_flags = ConditionMemoParserFlags();
+  new_entry->macro_refs = std::move(macro_refs);
+  memo->Set(std::move(new_entry));
+  return v;
+}
+
+int CppParser::ConditionMemoParserFlags() const {
+  // CppIntegerConstantEvaluator and CppMacroExpander depend on them.
+  return (is_cplusplus_ ? 1 : 0) | (is_vc_ ? 2 : 0);
+}
+
+bool CppParser::IsConditionMemoValid(const CppConditionMemo::Entry& entry) {
+  if (entry.parser_flags != ConditionMemoParserFlags()) {
+    return false;
+  }
+  for (const auto& ref : entry.macro_refs) {
+    const Macro* macro = macro_env_.Get(ref.atom);
+    if (ref.defined_only) {
+      if ((macro != nullptr && !macro->is_hidden) != ref.defined) {
+        return false;
+      }
+      continue;
+    }
+    if ((macro != nullptr) != ref.defined) {
+      return false;
+    }
+    if (macro != nullptr && macro->fingerprint != ref.fingerprint) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void CppParser::RecordMacroRef(CppAtom atom,
+                               const Macro* macro,
+                               bool defined_only) {
+  DCHECK(macro_refs_);
+  if (atom.empty()) {
+    // An identifier that is not interned, e.g. made by "##". It is not
+    // defined now, but can't be checked later once it is defined.
+    macro_refs_uncacheable_ = true;
+    return;
+  }
+  if (!defined_only && macro != nullptr && macro->IsPredefinedMacro()) {
+    // Its value depends on the input, the include dirs or CompilerInfo.
+    macro_refs_uncacheable_ = true;
+    return;
+  }
+  CppConditionMemo::MacroRef ref;
+  ref.atom = atom;
+  ref.defined_only = defined_only;
+  ref.defined = macro != nullptr && !(defined_only && macro->is_hidden);
+  ref.fingerprint =
+      (macro != nullptr && !defined_only) ? macro->fingerprint : 0;
+  macro_refs_->push_back(ref);
+}
+
+int64_t CppParser::EvalConditionInternal(
+    absl::Span<const CppToken> orig_tokens) {
   // TODO: Add DCHECK here orig_tokens does not contain spaces.
   ArrayTokenList tokens;
   tokens.reserve(orig_tokens.size());
@@ -662,11 +835,10 @@ int64_t CppParser::EvalCondition(const ArrayTokenList& orig_tokens) {
   // convert "[defined][(][xxx][)] or [defined][xxx]
   // We need to convert defined() in #if here due to b/6533195.
   for (size_t i = 0; i < orig_tokens.size(); ++i) {
-    if (orig_tokens[i].type == Token::IDENTIFIER &&
-        orig_tokens[i].string_value == "defined") {
+    if (orig_tokens[i].IsIdentifier("defined")) {
       if (i + 1 < orig_tokens.size() &&
           orig_tokens[i + 1].type == CppToken::IDENTIFIER) {
-        int defined = IsMacroDefined(orig_tokens[i + 1].string_value);
+        int defined = IsMacroDefined(orig_tokens[i + 1].atom);
         tokens.push_back(Token(defined));
         i += 1;
         continue;
@@ -675,7 +847,7 @@ int64_t CppParser::EvalCondition(const ArrayTokenList& orig_tokens) {
       if (i + 3 < orig_tokens.size() && orig_tokens[i + 1].IsPuncChar('(') &&
           orig_tokens[i + 2].type == CppToken::IDENTIFIER &&
           orig_tokens[i + 3].IsPuncChar(')')) {
-        int defined = IsMacroDefined(orig_tokens[i + 2].string_value);
+        int defined = IsMacroDefined(orig_tokens[i + 2].atom);
         tokens.push_back(Token(defined));
         i += 3;
         continue;
@@ -861,7 +1033,7 @@ CppParser::Token CppParser::ProcessHasCheckMacro(
     // Concat the expanded tokens. Allow only ident or ':'.
     for (const auto& t : expanded) {
       if (t.type == Token::IDENTIFIER) {
-        ident += t.string_value;
+        ident += t.identifier();
       } else if (t.IsPuncChar(':')) {
         ident += ':';
       } else {
@@ -879,7 +1051,7 @@ CppParser::Token CppParser::ProcessHasCheckMacro(
               << token;
       return Token(0);
     }
-    ident = token.string_value;
+    ident = token.identifier();
   }
 
   // Normalize the extension identifier.
@@ -18,8 +18,11 @@
 #include "absl/container/flat_hash_map.h"
 #include "absl/container/flat_hash_set.h"
 #include "absl/strings/string_view.h"
+#include "absl/types/span.h"
 #include "autolock_timer.h"
 #include "basictypes.h"
+#include "cpp_atom.h"
+#include "cpp_condition_memo.h"
 #include "cpp_directive.h"
 #include "cpp_input.h"
 #include "cpp_macro.h"
@@ -77,12 +80,18 @@ class CppParser {
   using Token = CppToken;
   using Input = CppInput;
 
+  // Snapshot holds the state of CppParser which lasts over inputs, i.e.
+  // macros, files having #pragma once and include guards.
+  // It is immutable, so it can be shared among CppParsers on other threads.
+  class Snapshot;
+
   CppParser();
   ~CppParser();
 
   void set_bracket_include_dir_index(int index) {
     bracket_include_dir_index_ = index;
   }
+  int bracket_include_dir_index() const { return bracket_include_dir_index_; }
   void set_include_observer(IncludeObserver* obs) { include_observer_ = obs; }
   void set_error_observer(ErrorObserver* obs) { error_observer_ = obs; }
   void SetCompilerInfo(const CxxCompilerInfo* compiler_info);
@@ -102,9 +111,12 @@ class CppParser {
   // Macro dictionary helpers.
   void AddMacroByString(const std::string& name, const std::string& body);
   void AddMacro(const Macro* macro);
-  void DeleteMacro(const std::string& name);
-  const Macro* GetMacro(const std::string& name);
-  bool IsMacroDefined(const std::string& name);
+  void DeleteMacro(CppAtom atom);
+  void DeleteMacro(absl::string_view name);
+  const Macro* GetMacro(CppAtom atom);
+  const Macro* GetMacro(absl::string_view name);
+  bool IsMacroDefined(CppAtom atom);
+  bool IsMacroDefined(absl::string_view name);
   // For testing purpose
   bool EnablePredefinedMacro(const std::string& name, bool is_hidden);
 
@@ -134,8 +146,20 @@ class CppParser {
   bool disabled() const { return disabled_; }
   void ClearDisabled() { disabled_ = false; }
 
+  // Creates a snapshot of the current state.
+  // Returns nullptr if the parser is disabled, or is processing some input.
+  std::shared_ptr<const Snapshot> CreateSnapshot() const;
+
+  // Restores the state from |snapshot|, and sets |compiler_info| without
+  // processing its predefined macros, since they should be in |snapshot|.
+  // This must be called on a parser that has not processed any input yet.
+  void RestoreSnapshot(const Snapshot& snapshot,
+                       const CxxCompilerInfo* compiler_info);
+
   int total_files() const { return total_files_; }
   int skipped_files() const { return skipped_files_; }
+  int condition_memo_hits() const { return condition_memo_hits_; }
+  int condition_memo_misses() const { return condition_memo_misses_; }
 
   // For debug.
   std::string DumpMacros();
@@ -201,7 +225,14 @@ class CppParser {
   void ProcessConditionInFalse(const CppDirective&);
 
   void EvalFunctionMacro(const std::string& name);
-  int64_t EvalCondition(const ArrayTokenList& orig_tokens);
+  // Evaluates #if or #elif condition. If |memo| is not nullptr, it is used
+  // to skip evaluation when the same macros are used.
+  int64_t EvalCondition(absl::Span<const CppToken> orig_tokens,
+                        CppConditionMemo* memo);
+  int64_t EvalConditionInternal(absl::Span<const CppToken> orig_tokens);
+  int ConditionMemoParserFlags() const;
+  bool IsConditionMemoValid(const CppConditionMemo::Entry& entry);
+  void RecordMacroRef(CppAtom atom, const Macro* macro, bool defined_only);
   // Detects include guard from #if condition.
   std::string DetectIncludeGuard(const ArrayTokenList& orig_tokens);
 
@@ -351,9 +382,19 @@ class CppParser {
   // b/9286087
   bool disabled_;
 
+  // Macros looked up while evaluating a condition for CppConditionMemo.
+  // nullptr if not recording.
+  std::vector<CppConditionMemo::MacroRef>* macro_refs_;
+  // True if the condition being recorded can not be memoized, e.g. it
+  // uses __LINE__ or __has_include.
+  bool macro_refs_uncacheable_;
+
   // For statistics.
   int skipped_files_;
   int total_files_;
+  int num_errors_;
+  int condition_memo_hits_;
+  int condition_memo_misses_;
 
   PlatformThreadId owner_thread_id_;
 
@@ -371,6 +412,27 @@ class CppParser {
   DISALLOW_COPY_AND_ASSIGN(CppParser);
 };
 
+class CppParser::Snapshot {
+ public:
+  Snapshot() = default;
+
+  Snapshot(const Snapshot&) = delete;
+  Snapshot& operator=(const Snapshot&) = delete;
+
+ private:
+  friend class CppParser;
+
+  // Keeps macros in |macro_env_| alive.
+  std::vector<SharedCppDirectives> input_protects_;
+  CppMacroEnv macro_env_;
+  PragmaOnceFileSet pragma_once_fileset_;
+  absl::flat_hash_map<std::string, std::string> include_guard_ident_;
+  std::string base_file_;
+  int counter_ = 0;
+  bool is_cplusplus_ = false;
+  bool is_vc_ = false;
+};
+
 }  // namespace devtools_goma
 
 #endif  // DEVTOOLS_GOMA_CLIENT_CXX_INCLUDE_PROCESSOR_CPP_PARSER_H_
@@ -608,6 +608,166 @@ TEST(CppParserTest, ImportOnlyOnce) {
   EXPECT_EQ(1, cpp_parser.skipped_files());
 }
 
+TEST(CppParserTest, Snapshot) {
+  std::shared_ptr<const CppParser::Snapshot> snapshot;
+  {
+    CppParser cpp_parser;
+    CppIncludeObserver include_observer(&cpp_parser);
+    include_observer.SetInclude("guarded.h",
+                                "#ifndef GUARDED_H_\n"
+                                "#define GUARDED_H_\n"
+                                "#endif\n");
+    include_observer.SetInclude("once.h", "#pragma once\n");
+    cpp_parser.set_include_observer(&include_observer);
+    cpp_parser.set_is_cplusplus(true);
+    cpp_parser.AddStringInput("#define FOO 1\n"
+                              "#define BAR(x) x\n"
+                              "#include <guarded.h>\n"
+                              "#include <once.h>\n",
+                              "preamble.h");
+    EXPECT_TRUE(cpp_parser.ProcessDirectives());
+    snapshot = cpp_parser.CreateSnapshot();
+    ASSERT_TRUE(snapshot);
+    // snapshot is not affected by later changes.
+    cpp_parser.DeleteMacro("FOO");
+  }
+
+  for (int i = 0; i < 2; ++i) {
+    CppParser cpp_parser;
+    CppIncludeObserver include_observer(&cpp_parser);
+    include_observer.SetInclude("guarded.h", "#error should be skipped\n");
+    include_observer.SetInclude("once.h", "#error should be skipped\n");
+    cpp_parser.set_include_observer(&include_observer);
+    cpp_parser.RestoreSnapshot(*snapshot, nullptr);
+    EXPECT_TRUE(cpp_parser.is_cplusplus());
+    cpp_parser.AddStringInput("#if BAR(FOO) && true\n"
+                              "#define OK\n"
+                              "#endif\n"
+                              "#include <guarded.h>\n"
+                              "#include <once.h>\n"
+                              "#undef FOO\n",
+                              "foo.cc");
+    EXPECT_TRUE(cpp_parser.ProcessDirectives());
+    EXPECT_TRUE(cpp_parser.IsMacroDefined("OK"));
+    EXPECT_FALSE(cpp_parser.IsMacroDefined("FOO"));
+    EXPECT_EQ(0, include_observer.IncludedCount("guarded.h"));
+    EXPECT_EQ(0, include_observer.IncludedCount("once.h"));
+    EXPECT_EQ(2, cpp_parser.skipped_files());
+  }
+}
+
+TEST(CppParserTest, SnapshotInProgress) {
+  CppParser cpp_parser;
+  cpp_parser.AddStringInput("#define FOO\n", "foo.h");
+  EXPECT_FALSE(cpp_parser.CreateSnapshot());
+  EXPECT_TRUE(cpp_parser.ProcessDirectives());
+  EXPECT_TRUE(cpp_parser.CreateSnapshot());
+}
+
+TEST(CppParserTest, ConditionMemo) {
+  // Cached directives are shared by parsers.
+  SharedCppDirectives header(CppDirectiveParser::ParseFromString(
+      "#if defined(FOO) && BAR(VERSION) >= 2\n"
+      "#define OK1\n"
+      "#elif defined BAZ\n"
+      "#define OK2\n"
+      "#endif\n",
+      "header.h"));
+
+  struct Result {
+    bool ok1;
+    bool ok2;
+    int hits;
+    int misses;
+  };
+  auto process = [&header](const std::string& macros, bool is_cplusplus) {
+    CppParser cpp_parser;
+    cpp_parser.set_is_cplusplus(is_cplusplus);
+    cpp_parser.AddStringInput(macros, "macros.h");
+    EXPECT_TRUE(cpp_parser.ProcessDirectives());
+    cpp_parser.AddPreparsedDirectivesInput(header);
+    EXPECT_TRUE(cpp_parser.ProcessDirectives());
+    return Result{cpp_parser.IsMacroDefined("OK1"),
+                  cpp_parser.IsMacroDefined("OK2"),
+                  cpp_parser.condition_memo_hits(),
+                  cpp_parser.condition_memo_misses()};
+  };
+
+  const std::string macros =
+      "#define FOO\n"
+      "#define BAR(x) x\n"
+      "#define VERSION 2\n";
+  Result r = process(macros, true);
+  EXPECT_TRUE(r.ok1);
+  EXPECT_FALSE(r.ok2);
+  EXPECT_EQ(0, r.hits);
+  EXPECT_EQ(1, r.misses);
+
+  // The same definitions in another parser.
+  r = process(macros, true);
+  EXPECT_TRUE(r.ok1);
+  EXPECT_EQ(1, r.hits);
+  EXPECT_EQ(0, r.misses);
+
+  // Different parser flags.
+  r = process(macros, false);
+  EXPECT_TRUE(r.ok1);
+  EXPECT_EQ(0, r.hits);
+  EXPECT_EQ(1, r.misses);
+
+  // Different definition of a macro used in expansion.
+  r = process(
+      "#define FOO\n"
+      "#define BAR(x) x\n"
+      "#define VERSION 1\n"
+      "#define BAZ 0\n",
+      false);
+  EXPECT_FALSE(r.ok1);
+  EXPECT_TRUE(r.ok2);
+  EXPECT_EQ(0, r.hits);
+  EXPECT_EQ(2, r.misses);
+
+  // Different definition of BAZ does not matter for defined(BAZ).
+  r = process(
+      "#define FOO\n"
+      "#define BAR(x) x\n"
+      "#define VERSION 1\n"
+      "#define BAZ 1\n",
+      false);
+  EXPECT_FALSE(r.ok1);
+  EXPECT_TRUE(r.ok2);
+  EXPECT_EQ(2, r.hits);
+  EXPECT_EQ(0, r.misses);
+
+  // FOO is not defined.
+  r = process(
+      "#define BAR(x) x\n"
+      "#define VERSION 2\n",
+      false);
+  EXPECT_FALSE(r.ok1);
+  EXPECT_FALSE(r.ok2);
+  EXPECT_EQ(0, r.hits);
+  EXPECT_EQ(2, r.misses);
+}
+
+TEST(CppParserTest, ConditionMemoNotUsedForCallbackMacro) {
+  SharedCppDirectives header(CppDirectiveParser::ParseFromString(
+      "#if __COUNTER__ == 0\n"
+      "#define OK\n"
+      "#endif\n",
+      "header.h"));
+
+  for (int i = 0; i < 2; ++i) {
+    CppParser cpp_parser;
+    ASSERT_TRUE(cpp_parser.EnablePredefinedMacro("__COUNTER__", false));
+    cpp_parser.AddPreparsedDirectivesInput(header);
+    EXPECT_TRUE(cpp_parser.ProcessDirectives());
+    EXPECT_TRUE(cpp_parser.IsMacroDefined("OK"));
+    EXPECT_EQ(0, cpp_parser.condition_memo_hits());
+    EXPECT_EQ(1, cpp_parser.condition_memo_misses());
+  }
+}
+
 TEST(CppParserTest, BoolShouldBeTreatedAsBoolOnCplusplus) {
   CppParser cpp_parser;
   cpp_parser.set_is_cplusplus(true);
@@ -0,0 +1,68 @@
+// Copyright 2021 The Goma Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "cpp_preamble_cache.h"
+
+#include <utility>
+
+#include "counterz.h"
+#include "glog/logging.h"
+#include "path.h"
+
+namespace devtools_goma {
+
+CppPreambleCache* CppPreambleCache::instance_;
+
+// static
+void CppPreambleCache::Init(size_t max_entries) {
+  instance_ = new CppPreambleCache(max_entries);
+}
+
+// static
+void CppPreambleCache::Quit() {
+  delete instance_;
+  instance_ = nullptr;
+}
+
+CppPreambleCache::CppPreambleCache(size_t max_entries)
+    : entries_("preamble", max_entries) {}
+
+std::shared_ptr<const CppPreambleCache::Preamble> CppPreambleCache::Lookup(
+    const std::string& key,
+    const std::string& cwd,
+    FileStatCache* file_stat_cache) {
+  GOMA_COUNTERZ("CppPreambleCache::Lookup");
+
+  auto is_valid = [&cwd, file_stat_cache](
+                      const std::shared_ptr<const Preamble>& preamble) {
+    for (const auto& file : preamble->files) {
+      const std::string abs_path =
+          file::JoinPathRespectAbsolute(cwd, file.first);
+      if (file_stat_cache->Get(abs_path) != file.second) {
+        VLOG(1) << "preamble is invalidated by " << abs_path;
+        return false;
+      }
+    }
+    return true;
+  };
+  std::shared_ptr<const Preamble> preamble;
+  if (!entries_.Lookup(key, is_valid, &preamble)) {
+    return nullptr;
+  }
+  return preamble;
+}
+
+bool CppPreambleCache::Insert(const std::string& key,
+                              std::shared_ptr<const Preamble> preamble) {
+  DCHECK(preamble->parser_snapshot);
+  for (const auto& file : preamble->files) {
+    if (!IsCacheableFileStat("preamble", file.first, file.second)) {
+      return false;
+    }
+  }
+  entries_.Insert(key, std::move(preamble));
+  return true;
+}
+
+}  // namespace devtools_goma
@@ -0,0 +1,78 @@
+// Copyright 2021 The Goma Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef DEVTOOLS_GOMA_CLIENT_CXX_INCLUDE_PROCESSOR_CPP_PREAMBLE_CACHE_H_
+#define DEVTOOLS_GOMA_CLIENT_CXX_INCLUDE_PROCESSOR_CPP_PREAMBLE_CACHE_H_
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "basictypes.h"
+#include "cpp_parser.h"
+#include "file_stat.h"
+#include "file_stat_cache.h"
+#include "file_stat_lru_cache.h"
+
+namespace devtools_goma {
+
+// CppPreambleCache stores the state of CppParser after processing
+// the preamble of a compile, i.e. predefined macros, command line macros,
+// stdc-predef.h and forced include files (-include, /FI).
+// Compiles having the same preamble can resume from the stored state
+// instead of parsing the same files again.
+//
+// A preamble is identified by a key made from compiler info and flags
+// (see CppIncludeProcessor), and is invalidated when any file used in
+// the preamble is modified. Like DepsCache, it doesn't detect a newly
+// created file that would shadow an include file in the preamble.
+class CppPreambleCache {
+ public:
+  struct Preamble {
+    std::shared_ptr<const CppParser::Snapshot> parser_snapshot;
+    // Files added to include files while processing the preamble, with
+    // their FileStat. paths are relative to cwd.
+    std::vector<std::pair<std::string, FileStat>> files;
+  };
+
+  static CppPreambleCache* instance() { return instance_; }
+  static bool IsEnabled() { return instance_ != nullptr; }
+
+  // Initializes CppPreambleCache.
+  // If the number of entries exceeds |max_entries|, the least recently used
+  // entry will be evicted.
+  static void Init(size_t max_entries);
+  static void Quit();
+
+  // Returns the preamble for |key| if no file in it is modified.
+  // Returns nullptr otherwise.
+  std::shared_ptr<const Preamble> Lookup(const std::string& key,
+                                         const std::string& cwd,
+                                         FileStatCache* file_stat_cache);
+
+  // Stores |preamble| for |key|.
+  // Returns false if |preamble| is not cacheable, e.g. some file might be
+  // modified while processing.
+  bool Insert(const std::string& key, std::shared_ptr<const Preamble> preamble);
+
+  size_t size() const { return entries_.size(); }
+  int64_t hit() const { return entries_.hit(); }
+  int64_t miss() const { return entries_.miss(); }
+  int64_t invalidated() const { return entries_.invalidated(); }
+
+ private:
+  explicit CppPreambleCache(size_t max_entries);
+  ~CppPreambleCache() = default;
+
+  static CppPreambleCache* instance_;
+
+  FileStatLruCache<std::shared_ptr<const Preamble>> entries_;
+
+  DISALLOW_COPY_AND_ASSIGN(CppPreambleCache);
+};
+
+}  // namespace devtools_goma
+
+#endif  // DEVTOOLS_GOMA_CLIENT_CXX_INCLUDE_PROCESSOR_CPP_PREAMBLE_CACHE_H_
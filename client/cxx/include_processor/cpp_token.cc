@@ -204,7 +204,7 @@ std::string CppToken::DebugString() const {
   switch (type) {
     case IDENTIFIER:
       str.append("[IDENT(");
-      str.append(string_value);
+      str.append(identifier());
       str.append(")]");
       break;
     case STRING:
@@ -267,6 +267,8 @@ std::string CppToken::DebugString() const {
 }
 
 std::string CppToken::GetCanonicalString() const {
+  if (type == IDENTIFIER)
+    return identifier();
   if (!string_value.empty())
     return string_value;
   if (v.char_value.c)
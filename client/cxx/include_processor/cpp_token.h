@@ -12,6 +12,7 @@
 #include <vector>
 
 #include "absl/strings/string_view.h"
+#include "cpp_atom.h"
 #include "glog/logging.h"
 
 namespace devtools_goma {
@@ -71,12 +72,49 @@ struct CppToken {
   CppToken(Type type, int i) : type(type) {
     v.int_value = i;
   }
-  CppToken(Type type, absl::string_view s) : type(type), string_value(s) {}
+  // For IDENTIFIER, |s| is interned to |atom|, and |string_value| is empty.
+  // If |s| could not be interned, |atom| is empty and |s| is kept in
+  // |string_value|.
+  CppToken(Type type, absl::string_view s) : type(type) {
+    if (type == IDENTIFIER) {
+      atom = CppAtom::Intern(s);
+      if (!atom.empty()) {
+        return;
+      }
+    }
+    string_value = std::string(s);
+  }
+  explicit CppToken(CppAtom atom) : type(IDENTIFIER), atom(atom) {}
 
   friend std::ostream& operator<<(std::ostream& os, const CppToken& token) {
     return os << token.DebugString();
   }
 
+  // Tokens that are operator== have the same hash.
+  template <typename H>
+  friend H AbslHashValue(H h, const CppToken& token) {
+    h = H::combine(std::move(h), token.type);
+    switch (token.type) {
+      case IDENTIFIER:
+        return H::combine(std::move(h), token.atom, token.string_value);
+      case STRING:
+        return H::combine(std::move(h), token.string_value);
+      case NUMBER:
+      case UNSIGNED_NUMBER:
+      case CHAR_LITERAL:
+        return H::combine(std::move(h), token.v.int_value);
+      case MACRO_PARAM:
+        return H::combine(std::move(h), token.v.param_index);
+      case SPACE:
+      case ESCAPED:
+      case PUNCTUATOR:
+        return H::combine(std::move(h), token.GetCanonicalString());
+      default:
+        // The type determines the token.
+        return h;
+    }
+  }
+
   bool operator==(const CppToken& other) const {
     if (type != other.type) {
       return false;
@@ -84,6 +122,9 @@ struct CppToken {
     if (type == NUMBER || type == UNSIGNED_NUMBER) {
       return v.int_value == other.v.int_value;
     }
+    if (type == IDENTIFIER) {
+      return atom == other.atom && string_value == other.string_value;
+    }
 
     return DebugString() == other.DebugString();
   }
@@ -92,8 +133,19 @@ struct CppToken {
   void Append(const std::string& str);
   bool IsPuncChar(int c) const;
   bool IsIdentifier(absl::string_view s) const {
-    return type == IDENTIFIER && string_value == s;
+    return type == IDENTIFIER && identifier() == s;
+  }
+  // Returns the text of IDENTIFIER token.
+  const std::string& identifier() const {
+    DCHECK_EQ(IDENTIFIER, type);
+    return atom.empty() ? string_value : atom.str();
   }
+  // Interns identifier text built in |string_value| by Append.
+  // |string_value| is kept if it could not be interned.
+  void InternIdentifier();
+  // Same as InternIdentifier, but does not intern a new identifier.
+  // Such identifier is never a macro name, since macro names are interned.
+  void FindIdentifier();
   bool IsMacroParamType() const {
     return type == MACRO_PARAM || type == MACRO_PARAM_VA_ARGS;
   }
@@ -123,6 +175,10 @@ struct CppToken {
   static const int kPrecedenceTable[];
 
   Type type;
+  // Interned identifier. Valid only for IDENTIFIER.
+  CppAtom atom;
+  // Text of tokens other than IDENTIFIER, or of IDENTIFIER that is not
+  // interned. Use identifier() to get the text of IDENTIFIER.
   std::string string_value;
 
   // A struct to hold char value(s) for operators and punctuators.
@@ -166,6 +222,22 @@ inline bool CppToken::IsPuncChar(int c) const {
 }
 #endif  // !MEMORY_SANITIZER
 
+inline void CppToken::InternIdentifier() {
+  DCHECK_EQ(IDENTIFIER, type);
+  atom = CppAtom::Intern(string_value);
+  if (!atom.empty()) {
+    string_value.clear();
+  }
+}
+
+inline void CppToken::FindIdentifier() {
+  DCHECK_EQ(IDENTIFIER, type);
+  atom = CppAtom::Find(string_value);
+  if (!atom.empty()) {
+    string_value.clear();
+  }
+}
+
 inline bool CppToken::IsOperator() const {
   return (type >= OP_BEGIN);
 }
@@ -174,22 +246,23 @@ inline void CppToken::MakeMacroParam(size_t param_index) {
   DCHECK_EQ(IDENTIFIER, type);
   type = MACRO_PARAM;
   v.param_index = param_index;
+  atom = CppAtom();
   string_value.clear();
 }
 
 inline void CppToken::MakeMacroParamVaArgs(size_t param_index) {
   DCHECK_EQ(IDENTIFIER, type);
-  DCHECK_EQ("__VA_ARGS__", string_value);
+  DCHECK_EQ("__VA_ARGS__", identifier());
   type = MACRO_PARAM_VA_ARGS;
   v.param_index = param_index;
-  string_value.clear();
+  atom = CppAtom();
 }
 
 inline void CppToken::MakeMacroParamVaOpt() {
   DCHECK_EQ(IDENTIFIER, type);
-  DCHECK_EQ("__VA_OPT__", string_value);
+  DCHECK_EQ("__VA_OPT__", identifier());
   type = VA_OPT;
-  string_value.clear();
+  atom = CppAtom();
 }
 
 static_assert(std::is_nothrow_move_constructible<CppToken>::value,
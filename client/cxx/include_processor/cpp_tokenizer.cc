@@ -74,6 +74,21 @@ namespace devtools_goma {
 bool CppTokenizer::TokenizeAll(const std::string& str,
                                SpaceHandling space_handling,
                                ArrayTokenList* result) {
+  return TokenizeAllInternal(str, space_handling, true, result);
+}
+
+// static
+bool CppTokenizer::TokenizeAllWithoutInterning(const std::string& str,
+                                               SpaceHandling space_handling,
+                                               ArrayTokenList* result) {
+  return TokenizeAllInternal(str, space_handling, false, result);
+}
+
+// static
+bool CppTokenizer::TokenizeAllInternal(const std::string& str,
+                                       SpaceHandling space_handling,
+                                       bool intern_identifier,
+                                       ArrayTokenList* result) {
   std::unique_ptr<Content> content = Content::CreateFromString(str);
   CppInputStream stream(content.get(), "<content>");
 
@@ -81,7 +96,8 @@ bool CppTokenizer::TokenizeAll(const std::string& str,
   ArrayTokenList tokens;
   while (true) {
     CppToken token;
-    if (!NextTokenFrom(&stream, space_handling, &token, &error_reason)) {
+    if (!NextTokenFrom(&stream, space_handling, intern_identifier, &token,
+                       &error_reason)) {
       break;
     }
     if (token.type == CppToken::END) {
@@ -106,6 +122,15 @@ bool CppTokenizer::NextTokenFrom(CppInputStream* stream,
                                  SpaceHandling space_handling,
                                  CppToken* token,
                                  std::string* error_reason) {
+  return NextTokenFrom(stream, space_handling, true, token, error_reason);
+}
+
+// static
+bool CppTokenizer::NextTokenFrom(CppInputStream* stream,
+                                 SpaceHandling space_handling,
+                                 bool intern_identifier,
+                                 CppToken* token,
+                                 std::string* error_reason) {
   for (;;) {
     const char* cur = stream->cur();
     int c = stream->GetChar();
@@ -195,7 +220,7 @@ bool CppTokenizer::NextTokenFrom(CppInputStream* stream,
         ABSL_FALLTHROUGH_INTENDED;
       default:
         if (c == '_'  || c == '$' || absl::ascii_isalpha(c)) {
-          *token = ReadIdentifier(stream, cur);
+          *token = ReadIdentifier(stream, cur, intern_identifier);
           return true;
         }
         if (c >= '0' && c <= '9') {
@@ -254,7 +279,8 @@ bool CppTokenizer::ReadStringUntilDelimiter(CppInputStream* stream,
 
 // static
 CppToken CppTokenizer::ReadIdentifier(CppInputStream* stream,
-                                      const char* begin) {
+                                      const char* begin,
+                                      bool intern_identifier) {
   CppToken token(CppToken::IDENTIFIER);
   for (;;) {
     int c = stream->GetChar();
@@ -262,8 +288,19 @@ CppToken CppTokenizer::ReadIdentifier(CppInputStream* stream,
         (c == '\\' && HandleLineFoldingWithToken(stream, &token, &begin))) {
       continue;
     }
-    token.Append(begin, stream->GetLengthToCurrentFrom(begin, c));
+    absl::string_view rest(begin, stream->GetLengthToCurrentFrom(begin, c));
     stream->UngetChar(c);
+    if (!intern_identifier) {
+      token.Append(rest.data(), rest.size());
+      token.FindIdentifier();
+      return token;
+    }
+    if (token.string_value.empty()) {
+      // No line folding. Intern it without copying.
+      return CppToken(CppToken::IDENTIFIER, rest);
+    }
+    token.Append(rest.data(), rest.size());
+    token.InternIdentifier();
     return token;
   }
 }
@@ -31,6 +31,13 @@ class CppTokenizer {
                           SpaceHandling space_handling,
                           ArrayTokenList* result);
 
+  // Same as TokenizeAll, but does not intern new identifiers.
+  // This is for tokens made while expanding macros (e.g. by "##"), which
+  // should not grow CppAtom table without bound.
+  static bool TokenizeAllWithoutInterning(const std::string& str,
+                                          SpaceHandling space_handling,
+                                          ArrayTokenList* result);
+
   // Reads string CppToken.
   static bool ReadString(CppInputStream* stream,
                          CppToken* result_token,
@@ -47,7 +54,11 @@ class CppTokenizer {
                                        char delimiter,
                                        std::string* error_reason);
 
-  static CppToken ReadIdentifier(CppInputStream* stream, const char* begin);
+  // Reads IDENTIFIER CppToken. If |intern_identifier| is false, a new
+  // identifier is not interned, and kept in string_value.
+  static CppToken ReadIdentifier(CppInputStream* stream,
+                                 const char* begin,
+                                 bool intern_identifier);
   static CppToken ReadNumber(CppInputStream* stream, int c0, const char* begin);
 
   // Handles line-folding with '\\', updates the token's string_value and
@@ -64,6 +75,16 @@ class CppTokenizer {
   static bool IsAfterEndOfLine(const char* cur, const char* begin);
 
  private:
+  static bool TokenizeAllInternal(const std::string& str,
+                                  SpaceHandling space_handling,
+                                  bool intern_identifier,
+                                  ArrayTokenList* result);
+  static bool NextTokenFrom(CppInputStream* stream,
+                            SpaceHandling space_handling,
+                            bool intern_identifier,
+                            CppToken* token,
+                            std::string* error_reason);
+
   static bool IsValidIntegerSuffix(const std::string& s);
   static bool IsUnsignedIntegerSuffix(const std::string& s);
   static CppToken::Type TypeFrom(int c1, int c2);
@@ -135,12 +135,12 @@ TEST(CppTokenizerTest, TokenizeDefineString) {
   EXPECT_TRUE(
       CppTokenizer::NextTokenFrom(&stream, SpaceHandling::kSkip, &t, &error));
   EXPECT_EQ(t.type, CppToken::IDENTIFIER);
-  EXPECT_EQ(t.string_value, "define");
+  EXPECT_EQ(t.atom.str(), "define");
 
   EXPECT_TRUE(
       CppTokenizer::NextTokenFrom(&stream, SpaceHandling::kSkip, &t, &error));
   EXPECT_EQ(t.type, CppToken::IDENTIFIER);
-  EXPECT_EQ(t.string_value, "KOTORI");
+  EXPECT_EQ(t.atom.str(), "KOTORI");
 
   EXPECT_TRUE(
       CppTokenizer::NextTokenFrom(&stream, SpaceHandling::kSkip, &t, &error));
@@ -5,51 +5,88 @@
 
 #include "include_cache.h"
 
+#include <stdio.h>  // For rename
+
+#include <algorithm>
+#include <atomic>
+#include <vector>
+
+#ifdef _WIN32
+#include "config_win.h"
+#endif
+
 #include "absl/memory/memory.h"
+#include "callback.h"
+#include "absl/strings/match.h"
+#include "absl/strings/str_cat.h"
+#include "compiler_proxy_info.h"
 #include "compiler_specific.h"
 #include "content.h"
 #include "counterz.h"
+#include "cxx/include_processor/cpp_directive_arena.h"
 #include "cxx/include_processor/cpp_directive_optimizer.h"
 #include "cxx/include_processor/cpp_directive_parser.h"
 #include "cxx/include_processor/directive_filter.h"
 #include "cxx/include_processor/include_guard_detector.h"
+#include "file_dir.h"
+#include "file_helper.h"
 #include "file_stat.h"
+#include "filesystem.h"
 #include "goma_hash.h"
 #include "histogram.h"
+#include "options.h"
+#include "path.h"
+#include "proto_util.h"
+#include "worker_thread.h"
+#include "worker_thread_manager.h"
 
 MSVC_PUSH_DISABLE_WARNING_FOR_PROTO()
+#include "client/include_cache_data.pb.h"
 #include "lib/goma_stats.pb.h"
 MSVC_POP_WARNING()
 
 namespace devtools_goma {
 
+namespace {
+
+// Renames |from| to |to|.  |to| is replaced if it exists.
+bool RenameReplacing(const std::string& from, const std::string& to) {
+#ifndef _WIN32
+  return rename(from.c_str(), to.c_str()) == 0;
+#else
+  // rename fails on Windows if |to| exists.
+  return MoveFileExA(from.c_str(), to.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+#endif
+}
+
+}  // anonymous namespace
+
 // IncludeCache::Item owns |content|.
 class IncludeCache::Item {
  public:
   Item(IncludeItem include_item,
+       size_t directives_bytes,
        absl::optional<SHA256HashValue> directive_hash,
        const FileStat& content_file_stat)
       : include_item_(std::move(include_item)),
+        directives_bytes_(directives_bytes),
         directive_hash_(std::move(directive_hash)),
         content_file_stat_(content_file_stat),
         updated_count_(0) {}
 
   ~Item() {}
 
-  static std::unique_ptr<Item> CreateFromFile(const std::string& filepath,
-                                              const FileStat& file_stat,
-                                              bool needs_directive_hash) {
-    std::unique_ptr<Content> content(Content::CreateFromFile(filepath));
-    if (!content) {
-      return nullptr;
-    }
-
-    std::unique_ptr<Content> filtered_content(
-        DirectiveFilter::MakeFilteredContent(*content));
-
+  // Creates Item from |filtered_content|, which is the output of
+  // DirectiveFilter for |filepath|.
+  // |directive_hash| is the hash of |filtered_content| if it is needed.
+  static std::unique_ptr<Item> CreateFromFilteredContent(
+      const std::string& filepath,
+      const Content& filtered_content,
+      const FileStat& file_stat,
+      absl::optional<SHA256HashValue> directive_hash) {
     CppDirectiveParser parser;
     CppDirectiveList directives;
-    if (!parser.Parse(*filtered_content, filepath, &directives)) {
+    if (!parser.Parse(filtered_content, filepath, &directives)) {
       return nullptr;
     }
 
@@ -57,21 +94,18 @@ class IncludeCache::Item {
 
     std::string include_guard_ident = IncludeGuardDetector::Detect(directives);
 
-    absl::optional<SHA256HashValue> directive_hash;
-    if (needs_directive_hash) {
-      SHA256HashValue h;
-      ComputeDataHashKeyForSHA256HashValue(filtered_content->ToStringView(),
-                                           &h);
-      directive_hash = std::move(h);
-    }
+    // Cached directives live long, so store them compactly.
+    size_t directives_bytes = 0;
+    SharedCppDirectives compacted =
+        CppDirectiveArena::Compact(directives, &directives_bytes);
 
     return absl::make_unique<Item>(
-        IncludeItem(std::make_shared<CppDirectiveList>(std::move(directives)),
-                    std::move(include_guard_ident)),
-        directive_hash, file_stat);
+        IncludeItem(std::move(compacted), std::move(include_guard_ident)),
+        directives_bytes, directive_hash, file_stat);
   }
 
   const IncludeItem& include_item() const { return include_item_; }
+  size_t directives_bytes() const { return directives_bytes_; }
   const absl::optional<SHA256HashValue>& directive_hash() const {
     return directive_hash_;
   }
@@ -82,6 +116,7 @@ class IncludeCache::Item {
 
  private:
   const IncludeItem include_item_;
+  const size_t directives_bytes_;
   const absl::optional<SHA256HashValue> directive_hash_;
 
   const FileStat content_file_stat_;
@@ -111,12 +146,134 @@ IncludeCache::IncludeCache(size_t max_cache_entries,
       count_item_evicted_(0) {}
 
 IncludeCache::~IncludeCache() {
+  WaitAllPrefetchDone();
+}
+
+void IncludeCache::StartPrefetchPool(WorkerThreadManager* wm,
+                                     int num_threads) {
+  DCHECK(prefetch_wm_ == nullptr);
+  if (num_threads <= 0) {
+    return;
+  }
+  prefetch_pool_ = wm->StartPool(num_threads, "include_prefetch");
+  prefetch_wm_ = wm;
+  LOG(INFO) << "include_prefetch_pool=" << prefetch_pool_
+            << " num_thread=" << num_threads;
+}
+
+void IncludeCache::Prefetch(const std::string& filepath,
+                            const FileStat& file_stat) {
+  DCHECK(prefetch_enabled());
+  {
+    AUTO_SHARED_LOCK(lock, &rwlock_);
+    if (GetItemIfNotModifiedUnlocked(filepath, file_stat)) {
+      return;
+    }
+  }
+  {
+    AUTOLOCK(lock, &prefetch_mu_);
+    if (!prefetching_.emplace(filepath, false).second) {
+      return;
+    }
+  }
+  prefetch_requested_count_.Add(1);
+  prefetch_wm_->RunClosureInPool(
+      FROM_HERE, prefetch_pool_,
+      NewCallback(this, &IncludeCache::RunPrefetch, filepath, file_stat),
+      WorkerThread::PRIORITY_LOW);
+}
+
+void IncludeCache::RunInPrefetchPool(OneshotClosure* closure) {
+  DCHECK(prefetch_enabled());
+  {
+    AUTOLOCK(lock, &prefetch_mu_);
+    ++num_prefetch_closures_;
+  }
+  prefetch_wm_->RunClosureInPool(
+      FROM_HERE, prefetch_pool_,
+      NewCallback(this, &IncludeCache::RunPrefetchClosure, closure),
+      WorkerThread::PRIORITY_LOW);
+}
+
+void IncludeCache::RunPrefetchClosure(OneshotClosure* closure) {
+  // |closure| deletes itself after Run.
+  closure->Run();
+
+  AUTOLOCK(lock, &prefetch_mu_);
+  --num_prefetch_closures_;
+  prefetch_cond_.Broadcast();
+}
+
+void IncludeCache::RunPrefetch(std::string filepath, FileStat file_stat) {
+  GOMA_COUNTERZ("RunPrefetch");
+  {
+    AUTOLOCK(lock, &prefetch_mu_);
+    prefetching_[filepath] = true;
+  }
+
+  bool cached = false;
+  {
+    AUTO_SHARED_LOCK(lock, &rwlock_);
+    cached = GetItemIfNotModifiedUnlocked(filepath, file_stat) != nullptr;
+  }
+  // The file might be parsed by GetIncludeItem while it was queued.
+  if (!cached) {
+    std::unique_ptr<Item> item(CreateItem(filepath, file_stat));
+    if (item) {
+      prefetch_parsed_count_.Add(1);
+      AUTO_EXCLUSIVE_LOCK(lock, &rwlock_);
+      InsertUnlocked(filepath, std::move(item), file_stat);
+    }
+  }
+
+  AUTOLOCK(lock, &prefetch_mu_);
+  prefetching_.erase(filepath);
+  prefetch_cond_.Broadcast();
+}
+
+void IncludeCache::WaitPrefetchRunning(const std::string& filepath) {
+  AUTOLOCK(lock, &prefetch_mu_);
+  bool waited = false;
+  for (;;) {
+    auto it = prefetching_.find(filepath);
+    // If it is still queued, it is faster to parse it by ourselves than
+    // to wait for the pool.
+    if (it == prefetching_.end() || !it->second) {
+      break;
+    }
+    waited = true;
+    prefetch_cond_.Wait(&prefetch_mu_);
+  }
+  if (waited) {
+    prefetch_waited_count_.Add(1);
+  }
+}
+
+void IncludeCache::WaitAllPrefetchDone() {
+  AUTOLOCK(lock, &prefetch_mu_);
+  while (!prefetching_.empty() || num_prefetch_closures_ > 0) {
+    prefetch_cond_.Wait(&prefetch_mu_);
+  }
+}
+
+bool IncludeCache::SetCacheDir(const std::string& cache_dir) {
+  if (!EnsureDirectory(cache_dir, 0700)) {
+    LOG(ERROR) << "failed to create include cache dir: " << cache_dir;
+    return false;
+  }
+  LOG(INFO) << "include cache dir: " << cache_dir;
+  cache_dir_ = cache_dir;
+  return true;
 }
 
 IncludeItem IncludeCache::GetIncludeItem(const std::string& filepath,
                                          const FileStat& file_stat) {
   GOMA_COUNTERZ("GetDirectiveList");
 
+  if (prefetch_enabled()) {
+    WaitPrefetchRunning(filepath);
+  }
+
   {
     AUTO_SHARED_LOCK(lock, &rwlock_);
     if (const Item* item = GetItemIfNotModifiedUnlocked(filepath, file_stat)) {
@@ -127,8 +284,7 @@ IncludeItem IncludeCache::GetIncludeItem(const std::string& filepath,
 
   missed_count_.Add(1);
 
-  std::unique_ptr<Item> item(
-      Item::CreateFromFile(filepath, file_stat, calculates_directive_hash()));
+  std::unique_ptr<Item> item(CreateItem(filepath, file_stat));
   if (!item) {
     return IncludeItem();
   }
@@ -155,8 +311,7 @@ absl::optional<SHA256HashValue> IncludeCache::GetDirectiveHash(
     }
   }
 
-  std::unique_ptr<Item> item(
-      Item::CreateFromFile(filepath, file_stat, calculates_directive_hash()));
+  std::unique_ptr<Item> item(CreateItem(filepath, file_stat));
   if (!item) {
     return absl::nullopt;
   }
@@ -169,6 +324,230 @@ absl::optional<SHA256HashValue> IncludeCache::GetDirectiveHash(
   return directive_hash;
 }
 
+std::unique_ptr<IncludeCache::Item> IncludeCache::CreateItem(
+    const std::string& filepath,
+    const FileStat& file_stat) {
+  // A file whose mtime is unknown or too new might be modified without
+  // changing FileStat, so it is not stored in the persistent cache.
+  const bool use_cache_dir =
+      !cache_dir_.empty() && file_stat.mtime.has_value() &&
+      !file_stat.CanBeStale();
+  if (use_cache_dir) {
+    std::unique_ptr<Item> item = LoadItem(filepath, file_stat);
+    if (item) {
+      disk_hit_count_.Add(1);
+      return item;
+    }
+    disk_missed_count_.Add(1);
+  }
+
+  std::unique_ptr<Content> content(Content::CreateFromFile(filepath));
+  if (!content) {
+    return nullptr;
+  }
+
+  std::unique_ptr<Content> filtered_content(
+      DirectiveFilter::MakeFilteredContent(*content));
+
+  absl::optional<SHA256HashValue> directive_hash;
+  if (calculates_directive_hash_ || use_cache_dir) {
+    SHA256HashValue h;
+    ComputeDataHashKeyForSHA256HashValue(filtered_content->ToStringView(), &h);
+    directive_hash = std::move(h);
+  }
+
+  std::unique_ptr<Item> item = Item::CreateFromFilteredContent(
+      filepath, *filtered_content, file_stat,
+      calculates_directive_hash_ ? directive_hash : absl::nullopt);
+  if (item && use_cache_dir) {
+    SaveItem(filepath, file_stat, filtered_content->ToStringView(),
+             *directive_hash);
+  }
+  return item;
+}
+
+std::unique_ptr<IncludeCache::Item> IncludeCache::LoadItem(
+    const std::string& filepath,
+    const FileStat& file_stat) {
+  GOMA_COUNTERZ("LoadItem");
+
+  const std::string cache_file_path = CacheFilePath(filepath);
+  std::string serialized;
+  if (!ReadFileToString(cache_file_path, &serialized)) {
+    return nullptr;
+  }
+
+  IncludeCacheEntry entry;
+  if (!entry.ParseFromString(serialized)) {
+    LOG(WARNING) << "broken include cache entry: path=" << cache_file_path;
+    return nullptr;
+  }
+  if (entry.built_revision() != kBuiltRevisionString) {
+    VLOG(1) << "include cache entry of old revision:"
+            << " path=" << cache_file_path
+            << " revision=" << entry.built_revision();
+    return nullptr;
+  }
+  if (entry.filepath() != filepath) {
+    // SHA256 collision should not happen, but just in case.
+    LOG(WARNING) << "include cache entry for different file:"
+                 << " path=" << cache_file_path
+                 << " want=" << filepath << " got=" << entry.filepath();
+    return nullptr;
+  }
+
+  FileStat cached_file_stat;
+  cached_file_stat.mtime = ProtoToTime(entry.mtime());
+  cached_file_stat.size = entry.size();
+  if (cached_file_stat != file_stat) {
+    VLOG(1) << "include cache entry is modified:"
+            << " filepath=" << filepath
+            << " cached=" << cached_file_stat
+            << " file_stat=" << file_stat;
+    return nullptr;
+  }
+
+  SHA256HashValue h;
+  ComputeDataHashKeyForSHA256HashValue(entry.filtered_content(), &h);
+  if (h.ToHexString() != entry.filtered_content_hash()) {
+    LOG(WARNING) << "include cache entry hash mismatch:"
+                 << " path=" << cache_file_path;
+    return nullptr;
+  }
+
+  std::unique_ptr<Content> filtered_content(
+      Content::CreateFromString(entry.filtered_content()));
+  return Item::CreateFromFilteredContent(
+      filepath, *filtered_content, file_stat,
+      calculates_directive_hash_ ? absl::make_optional(h) : absl::nullopt);
+}
+
+void IncludeCache::SaveItem(const std::string& filepath,
+                            const FileStat& file_stat,
+                            absl::string_view filtered_content,
+                            const SHA256HashValue& filtered_content_hash) {
+  GOMA_COUNTERZ("SaveItem");
+
+  IncludeCacheEntry entry;
+  entry.set_built_revision(kBuiltRevisionString);
+  entry.set_filepath(filepath);
+  *entry.mutable_mtime() = TimeToProto(*file_stat.mtime);
+  entry.set_size(file_stat.size);
+  entry.set_filtered_content(std::string(filtered_content));
+  entry.set_filtered_content_hash(filtered_content_hash.ToHexString());
+
+  std::string serialized;
+  if (!entry.SerializeToString(&serialized)) {
+    LOG(ERROR) << "failed to serialize include cache entry:"
+               << " filepath=" << filepath;
+    return;
+  }
+
+  const std::string cache_file_path = CacheFilePath(filepath);
+  if (!EnsureDirectory(std::string(file::Dirname(cache_file_path)), 0700)) {
+    LOG(ERROR) << "failed to create include cache dir for "
+               << cache_file_path;
+    return;
+  }
+
+  // Write to a tmp file and rename it, so that a reader never sees a
+  // partially written entry. The tmp file name is unique, since the same
+  // file can be saved by several threads at the same time.
+  static std::atomic<uint64_t> tmp_file_id;
+  const std::string tmp_path =
+      absl::StrCat(cache_file_path, ".tmp.", tmp_file_id.fetch_add(1));
+  if (!WriteStringToFile(serialized, tmp_path)) {
+    LOG(ERROR) << "failed to write include cache entry: path=" << tmp_path;
+    return;
+  }
+  if (!RenameReplacing(tmp_path, cache_file_path)) {
+    LOG(ERROR) << "failed to rename include cache entry:"
+               << " path=" << cache_file_path;
+    (void)file::Delete(tmp_path, file::Defaults());
+    return;
+  }
+  disk_saved_count_.Add(1);
+}
+
+// static
+void IncludeCache::CleanupCacheDir(std::string cache_dir,
+                                   int64_t max_cache_dir_size,
+                                   absl::Time tmp_file_threshold) {
+  struct CacheFile {
+    std::string path;
+    absl::Time mtime;
+    int64_t size;
+  };
+  std::vector<CacheFile> cache_files;
+  int64_t total_size = 0;
+  int num_removed = 0;
+
+  std::vector<DirEntry> dirs;
+  if (!ListDirectory(cache_dir, &dirs)) {
+    LOG(WARNING) << "failed to list include cache dir: " << cache_dir;
+    return;
+  }
+  for (const auto& dir : dirs) {
+    if (!dir.is_dir || dir.name == "." || dir.name == "..") {
+      continue;
+    }
+    const std::string dirpath = file::JoinPath(cache_dir, dir.name);
+    std::vector<DirEntry> entries;
+    if (!ListDirectory(dirpath, &entries)) {
+      continue;
+    }
+    for (const auto& entry : entries) {
+      if (entry.is_dir) {
+        continue;
+      }
+      CacheFile cache_file;
+      cache_file.path = file::JoinPath(dirpath, entry.name);
+      FileStat file_stat(cache_file.path);
+      if (!file_stat.IsValid()) {
+        continue;
+      }
+      if (absl::StrContains(entry.name, ".tmp.")) {
+        if (*file_stat.mtime < tmp_file_threshold &&
+            file::Delete(cache_file.path, file::Defaults()).ok()) {
+          ++num_removed;
+        }
+        continue;
+      }
+      cache_file.mtime = *file_stat.mtime;
+      cache_file.size = file_stat.size;
+      total_size += cache_file.size;
+      cache_files.push_back(std::move(cache_file));
+    }
+  }
+
+  if (total_size > max_cache_dir_size) {
+    std::sort(cache_files.begin(), cache_files.end(),
+              [](const CacheFile& a, const CacheFile& b) {
+                return a.mtime < b.mtime;
+              });
+    for (const auto& cache_file : cache_files) {
+      if (total_size <= max_cache_dir_size) {
+        break;
+      }
+      if (!file::Delete(cache_file.path, file::Defaults()).ok()) {
+        continue;
+      }
+      total_size -= cache_file.size;
+      ++num_removed;
+    }
+  }
+  LOG(INFO) << "include cache dir cleaned up:"
+            << " cache_dir=" << cache_dir
+            << " removed=" << num_removed
+            << " total_size=" << total_size;
+}
+
+std::string IncludeCache::CacheFilePath(const std::string& filepath) const {
+  std::string key;
+  ComputeDataHashKey(filepath, &key);
+  return file::JoinPath(cache_dir_, key.substr(0, 2), key);
+}
+
 const IncludeCache::Item* IncludeCache::GetItemIfNotModifiedUnlocked(
     const std::string& key,
     const FileStat& file_stat) const {
@@ -214,21 +593,42 @@ void IncludeCache::Dump(std::ostringstream* ss) {
   Histogram item_update_count_histogram;
   item_update_count_histogram.SetName("Item Update Count Histogram");
 
+  size_t directives_bytes = 0;
   for (const auto& it : cache_items_) {
     const Item* item = it.second.get();
     item_update_count_histogram.Add(item->updated_count());
+    directives_bytes += item->directives_bytes();
   }
 
   (*ss) << "IncludeCache summary" << std::endl;
 
   (*ss) << std::endl;
   (*ss) << "current cache entries = " << num_cache_item << std::endl
-        << "entry capacity = " << max_cache_entries_ << std::endl;
+        << "entry capacity = " << max_cache_entries_ << std::endl
+        << "directive arena bytes = " << directives_bytes << std::endl;
 
   (*ss) << std::endl;
   (*ss) << " Hit    = " << hit_count_.value() << std::endl;
   (*ss) << " Missed = " << missed_count_.value() << std::endl;
 
+  if (!cache_dir_.empty()) {
+    (*ss) << std::endl;
+    (*ss) << "cache dir = " << cache_dir_ << std::endl;
+    (*ss) << " Disk hit    = " << disk_hit_count_.value() << std::endl;
+    (*ss) << " Disk missed = " << disk_missed_count_.value() << std::endl;
+    (*ss) << " Disk saved  = " << disk_saved_count_.value() << std::endl;
+  }
+
+  if (prefetch_enabled()) {
+    (*ss) << std::endl;
+    (*ss) << " Prefetch requested = " << prefetch_requested_count_.value()
+          << std::endl;
+    (*ss) << " Prefetch parsed    = " << prefetch_parsed_count_.value()
+          << std::endl;
+    (*ss) << " Prefetch waited    = " << prefetch_waited_count_.value()
+          << std::endl;
+  }
+
   (*ss) << std::endl;
   (*ss) << "Item updated count = " << count_item_updated_ << std::endl;
   (*ss) << "Item evicted count = " << count_item_evicted_ << std::endl;
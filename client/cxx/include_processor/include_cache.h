@@ -11,6 +11,9 @@
 #include <string>
 
 #include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/strings/string_view.h"
+#include "absl/time/time.h"
 #include "absl/types/optional.h"
 #include "atomic_stats_counter.h"
 #include "autolock_timer.h"
@@ -18,11 +21,14 @@
 #include "cxx/include_processor/include_item.h"
 #include "goma_hash.h"
 #include "linked_unordered_map.h"
+#include "lockhelper.h"
 
 namespace devtools_goma {
 
 struct FileStat;
 class IncludeCacheStats;
+class OneshotClosure;
+class WorkerThreadManager;
 
 // IncludeCache stores the parsed result of include headers.
 class IncludeCache {
@@ -38,8 +44,45 @@ class IncludeCache {
   static void Init(int max_cache_entries, bool calculates_directive_hash);
   static void Quit();
 
+  // Enables the persistent cache in |cache_dir|.
+  // Parsed header files are saved in |cache_dir|, and loaded when they are
+  // not in memory, e.g. after compiler_proxy restarts.
+  // Returns false if |cache_dir| cannot be used.
+  // This must be called before GetIncludeItem or GetDirectiveHash is used.
+  bool SetCacheDir(const std::string& cache_dir);
+
+  // Removes entries in |cache_dir| from the least recently saved one until
+  // the total size gets |max_cache_dir_size| bytes or less.  Also removes
+  // tmp files older than |tmp_file_threshold|, which were left by killed
+  // compiler_proxy.
+  // This stats every file in |cache_dir|, so it should run on a worker
+  // thread at startup.  It does not use the IncludeCache instance.
+  static void CleanupCacheDir(std::string cache_dir,
+                              int64_t max_cache_dir_size,
+                              absl::Time tmp_file_threshold);
+
+  // Starts a pool of |num_threads| in |wm| to prefetch include files.
+  // |wm| must outlive Quit().
+  // This must be called before Prefetch is used.
+  void StartPrefetchPool(WorkerThreadManager* wm, int num_threads);
+  bool prefetch_enabled() const { return prefetch_wm_ != nullptr; }
+
+  // Schedules reading and parsing |filepath| on the prefetch pool,
+  // so that later GetIncludeItem for |filepath| will hit the cache.
+  // Does nothing if |filepath| is already cached or being prefetched.
+  void Prefetch(const std::string& filepath, const FileStat& file_stat);
+
+  // Runs |closure| on the prefetch pool, e.g. to find files to Prefetch.
+  // Quit waits for |closure| to finish.
+  void RunInPrefetchPool(OneshotClosure* closure);
+
+  // Waits until all closures and files scheduled on the prefetch pool are
+  // done.
+  void WaitAllPrefetchDone() LOCKS_EXCLUDED(prefetch_mu_);
+
   // Get IncludeItem from cache or file.
   // If it does not exist in the cache, reat it from file and parse it.
+  // If |filepath| is being parsed by the prefetch pool, waits for it.
   IncludeItem GetIncludeItem(const std::string& filepath,
                              const FileStat& file_stat);
 
@@ -73,10 +116,33 @@ class IncludeCache {
       EXCLUSIVE_LOCKS_REQUIRED(rwlock_);
   void EvictCacheUnlocked() EXCLUSIVE_LOCKS_REQUIRED(rwlock_);
 
+  // Creates Item of |filepath| from the persistent cache or the file.
+  std::unique_ptr<Item> CreateItem(const std::string& filepath,
+                                   const FileStat& file_stat);
+  // Loads Item from the persistent cache. Returns nullptr if it is not
+  // cached, or cached for different |file_stat|.
+  std::unique_ptr<Item> LoadItem(const std::string& filepath,
+                                 const FileStat& file_stat);
+  void SaveItem(const std::string& filepath,
+                const FileStat& file_stat,
+                absl::string_view filtered_content,
+                const SHA256HashValue& filtered_content_hash);
+  std::string CacheFilePath(const std::string& filepath) const;
+
+  // Runs on the prefetch pool.
+  void RunPrefetch(std::string filepath, FileStat file_stat);
+  void RunPrefetchClosure(OneshotClosure* closure)
+      LOCKS_EXCLUDED(prefetch_mu_);
+  // Waits while |filepath| is being parsed by the prefetch pool.
+  void WaitPrefetchRunning(const std::string& filepath)
+      LOCKS_EXCLUDED(prefetch_mu_);
+
   static IncludeCache* instance_;
 
   const size_t max_cache_entries_;
   const bool calculates_directive_hash_;
+  // Directory for the persistent cache. Empty if disabled.
+  std::string cache_dir_;
 
   ReadWriteLock rwlock_;
   // A map from filepath to unique_ptr<Item>.
@@ -90,6 +156,25 @@ class IncludeCache {
 
   StatsCounter hit_count_;
   StatsCounter missed_count_;
+  StatsCounter disk_hit_count_;
+  StatsCounter disk_missed_count_;
+  StatsCounter disk_saved_count_;
+
+  WorkerThreadManager* prefetch_wm_ = nullptr;
+  int prefetch_pool_ = -1;
+
+  mutable Lock prefetch_mu_;
+  ConditionVariable prefetch_cond_;
+  // A map from filepath being prefetched to true if it is running,
+  // or false if it is still queued in the pool.
+  absl::flat_hash_map<std::string, bool> prefetching_
+      GUARDED_BY(prefetch_mu_);
+  // The number of closures given to RunInPrefetchPool and not finished.
+  int num_prefetch_closures_ GUARDED_BY(prefetch_mu_) = 0;
+
+  StatsCounter prefetch_requested_count_;
+  StatsCounter prefetch_parsed_count_;
+  StatsCounter prefetch_waited_count_;
 
   DISALLOW_COPY_AND_ASSIGN(IncludeCache);
 };
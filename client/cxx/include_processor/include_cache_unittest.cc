@@ -17,6 +17,7 @@
 #include "file_stat_cache.h"
 #include "goma_hash.h"
 #include "unittest_util.h"
+#include "worker_thread_manager.h"
 
 namespace devtools_goma {
 
@@ -40,6 +41,24 @@ class IncludeCacheTest : public testing::Test {
   size_t MissedCount(IncludeCache* include_cache) const {
     return include_cache->missed_count_.value();
   }
+  size_t DiskHitCount(IncludeCache* include_cache) const {
+    return include_cache->disk_hit_count_.value();
+  }
+  size_t DiskMissedCount(IncludeCache* include_cache) const {
+    return include_cache->disk_missed_count_.value();
+  }
+  size_t DiskSavedCount(IncludeCache* include_cache) const {
+    return include_cache->disk_saved_count_.value();
+  }
+  size_t PrefetchRequestedCount(IncludeCache* include_cache) const {
+    return include_cache->prefetch_requested_count_.value();
+  }
+  size_t PrefetchParsedCount(IncludeCache* include_cache) const {
+    return include_cache->prefetch_parsed_count_.value();
+  }
+  void WaitAllPrefetchDone(IncludeCache* include_cache) const {
+    include_cache->WaitAllPrefetchDone();
+  }
 };
 
 TEST_F(IncludeCacheTest, GetDirectiveList) {
@@ -224,6 +243,188 @@ TEST_F(IncludeCacheTest, GetDirectiveHash)
   }
 }
 
+TEST_F(IncludeCacheTest, CacheDir) {
+  TmpdirUtil tmpdir("includecache");
+  const std::string ah = tmpdir.FullPath("a.h");
+  const std::string content =
+      "#ifndef A_H\n"
+      "#define A_H\n"
+      "#include <stdio.h>\n"
+      "int a;\n"
+      "#endif\n";
+  tmpdir.CreateTmpFile("a.h", content);
+  // Recently modified file is not saved in the cache dir.
+  ASSERT_TRUE(UpdateMtime(ah, absl::Now() - absl::Hours(1)));
+  const FileStat file_stat(ah);
+  ASSERT_TRUE(file_stat.IsValid());
+  ASSERT_FALSE(file_stat.CanBeStale());
+
+  const std::string cache_dir = tmpdir.FullPath("cache");
+  {
+    IncludeCache* ic = IncludeCache::instance();
+    ASSERT_TRUE(ic->SetCacheDir(cache_dir));
+
+    IncludeItem item = ic->GetIncludeItem(ah, file_stat);
+    ASSERT_TRUE(item.IsValid());
+    EXPECT_EQ("A_H", item.include_guard_ident());
+    EXPECT_EQ(0U, DiskHitCount(ic));
+    EXPECT_EQ(1U, DiskMissedCount(ic));
+    EXPECT_EQ(1U, DiskSavedCount(ic));
+  }
+
+  // Emulate restart. a.h is loaded from the cache dir, so it can be
+  // removed.
+  IncludeCache::Quit();
+  IncludeCache::Init(2, true);
+  tmpdir.RemoveTmpFile("a.h");
+  {
+    IncludeCache* ic = IncludeCache::instance();
+    ASSERT_TRUE(ic->SetCacheDir(cache_dir));
+
+    IncludeItem item = ic->GetIncludeItem(ah, file_stat);
+    ASSERT_TRUE(item.IsValid());
+    EXPECT_EQ("A_H", item.include_guard_ident());
+    ASSERT_EQ(4U, item.directives()->size());
+    EXPECT_EQ(1U, DiskHitCount(ic));
+    EXPECT_EQ(0U, DiskMissedCount(ic));
+    EXPECT_EQ(0U, DiskSavedCount(ic));
+  }
+
+  IncludeCache::Quit();
+  IncludeCache::Init(2, true);
+  {
+    IncludeCache* ic = IncludeCache::instance();
+    ASSERT_TRUE(ic->SetCacheDir(cache_dir));
+
+    SHA256HashValue hash_expected;
+    ComputeDataHashKeyForSHA256HashValue(
+        "#ifndef A_H\n#define A_H\n#include <stdio.h>\n#endif\n",
+        &hash_expected);
+    absl::optional<SHA256HashValue> hash_actual =
+        ic->GetDirectiveHash(ah, file_stat);
+    ASSERT_TRUE(hash_actual.has_value());
+    EXPECT_EQ(hash_expected, *hash_actual);
+    EXPECT_EQ(1U, DiskHitCount(ic));
+
+    // Cached entry is not used for modified file.
+    FileStat modified_file_stat = file_stat;
+    modified_file_stat.mtime = *file_stat.mtime + absl::Seconds(1);
+    EXPECT_FALSE(ic->GetIncludeItem(ah, modified_file_stat).IsValid());
+    EXPECT_EQ(1U, DiskHitCount(ic));
+    EXPECT_EQ(1U, DiskMissedCount(ic));
+  }
+}
+
+TEST_F(IncludeCacheTest, CacheDirReplacesEntry) {
+  TmpdirUtil tmpdir("includecache");
+  const std::string ah = tmpdir.FullPath("a.h");
+  tmpdir.CreateTmpFile("a.h", "#define A 1\n");
+  ASSERT_TRUE(UpdateMtime(ah, absl::Now() - absl::Hours(2)));
+  const FileStat old_file_stat(ah);
+  ASSERT_FALSE(old_file_stat.CanBeStale());
+
+  const std::string cache_dir = tmpdir.FullPath("cache");
+  IncludeCache* ic = IncludeCache::instance();
+  ASSERT_TRUE(ic->SetCacheDir(cache_dir));
+  ASSERT_TRUE(ic->GetIncludeItem(ah, old_file_stat).IsValid());
+  EXPECT_EQ(1U, DiskSavedCount(ic));
+
+  // The entry of the modified file is saved over the old entry.
+  tmpdir.CreateTmpFile("a.h", "#define A 2\n#define B 3\n");
+  ASSERT_TRUE(UpdateMtime(ah, absl::Now() - absl::Hours(1)));
+  const FileStat new_file_stat(ah);
+  ASSERT_FALSE(new_file_stat.CanBeStale());
+  IncludeCache::Quit();
+  IncludeCache::Init(2, true);
+  ic = IncludeCache::instance();
+  ASSERT_TRUE(ic->SetCacheDir(cache_dir));
+  ASSERT_TRUE(ic->GetIncludeItem(ah, new_file_stat).IsValid());
+  EXPECT_EQ(1U, DiskMissedCount(ic));
+  EXPECT_EQ(1U, DiskSavedCount(ic));
+
+  IncludeCache::Quit();
+  IncludeCache::Init(2, true);
+  ic = IncludeCache::instance();
+  ASSERT_TRUE(ic->SetCacheDir(cache_dir));
+  IncludeItem item = ic->GetIncludeItem(ah, new_file_stat);
+  ASSERT_TRUE(item.IsValid());
+  EXPECT_EQ(2U, item.directives()->size());
+  EXPECT_EQ(1U, DiskHitCount(ic));
+}
+
+TEST_F(IncludeCacheTest, CleanupCacheDir) {
+  TmpdirUtil tmpdir("includecache");
+  const absl::Time now = absl::Now();
+  // Entries are saved in 2-char subdirectories.
+  tmpdir.CreateTmpFile("cache/aa/old", std::string(100, 'o'));
+  tmpdir.CreateTmpFile("cache/bb/middle", std::string(100, 'm'));
+  tmpdir.CreateTmpFile("cache/aa/new", std::string(100, 'n'));
+  tmpdir.CreateTmpFile("cache/bb/new.tmp.1", "left by killed process");
+  tmpdir.CreateTmpFile("cache/bb/new.tmp.2", "being written");
+  ASSERT_TRUE(UpdateMtime(tmpdir.FullPath("cache/aa/old"),
+                          now - absl::Hours(3)));
+  ASSERT_TRUE(UpdateMtime(tmpdir.FullPath("cache/bb/middle"),
+                          now - absl::Hours(2)));
+  ASSERT_TRUE(UpdateMtime(tmpdir.FullPath("cache/aa/new"),
+                          now - absl::Hours(1)));
+  ASSERT_TRUE(UpdateMtime(tmpdir.FullPath("cache/bb/new.tmp.1"),
+                          now - absl::Hours(1)));
+
+  IncludeCache::CleanupCacheDir(tmpdir.FullPath("cache"), 250,
+                                now - absl::Minutes(1));
+
+  EXPECT_FALSE(FileStat(tmpdir.FullPath("cache/aa/old")).IsValid());
+  EXPECT_TRUE(FileStat(tmpdir.FullPath("cache/bb/middle")).IsValid());
+  EXPECT_TRUE(FileStat(tmpdir.FullPath("cache/aa/new")).IsValid());
+  EXPECT_FALSE(FileStat(tmpdir.FullPath("cache/bb/new.tmp.1")).IsValid());
+  EXPECT_TRUE(FileStat(tmpdir.FullPath("cache/bb/new.tmp.2")).IsValid());
+}
+
+TEST_F(IncludeCacheTest, Prefetch) {
+  TmpdirUtil tmpdir("includecache");
+  const std::string ah = tmpdir.FullPath("a.h");
+  const std::string bh = tmpdir.FullPath("b.h");
+  tmpdir.CreateTmpFile("a.h", "#include \"b.h\"\n");
+  tmpdir.CreateTmpFile("b.h", "#define B 1\n");
+  const FileStat ah_file_stat(ah);
+  const FileStat bh_file_stat(bh);
+  ASSERT_TRUE(ah_file_stat.IsValid());
+  ASSERT_TRUE(bh_file_stat.IsValid());
+
+  WorkerThreadManager wm;
+  wm.Start(1);
+  {
+    IncludeCache* ic = IncludeCache::instance();
+    ic->StartPrefetchPool(&wm, 2);
+    ASSERT_TRUE(ic->prefetch_enabled());
+
+    ic->Prefetch(ah, ah_file_stat);
+    ic->Prefetch(bh, bh_file_stat);
+    WaitAllPrefetchDone(ic);
+    EXPECT_EQ(2U, PrefetchRequestedCount(ic));
+    EXPECT_EQ(2U, PrefetchParsedCount(ic));
+    EXPECT_EQ(0U, HitCount(ic));
+    EXPECT_EQ(0U, MissedCount(ic));
+
+    // Already cached.
+    ic->Prefetch(ah, ah_file_stat);
+    EXPECT_EQ(2U, PrefetchRequestedCount(ic));
+
+    IncludeItem item = ic->GetIncludeItem(ah, ah_file_stat);
+    ASSERT_TRUE(item.IsValid());
+    ASSERT_EQ(1U, item.directives()->size());
+    item = ic->GetIncludeItem(bh, bh_file_stat);
+    ASSERT_TRUE(item.IsValid());
+    ASSERT_EQ(1U, item.directives()->size());
+    EXPECT_EQ(2U, HitCount(ic));
+    EXPECT_EQ(0U, MissedCount(ic));
+  }
+  // IncludeCache must quit before the prefetch pool.
+  IncludeCache::Quit();
+  IncludeCache::Init(2, true);
+  wm.Finish();
+}
+
 TEST_F(IncludeCacheTest, DumpEmpty) {
   IncludeCache* ic = IncludeCache::instance();
 
@@ -11,21 +11,19 @@ namespace {
 // We detect include guard if the following form.
 //    [!][defined][(][XXX][)]
 // or [!][defined][XXX]
-std::string DetectIncludeGuard(const ArrayTokenList& tokens) {
+std::string DetectIncludeGuard(absl::Span<const CppToken> tokens) {
   // Assuming |tokens| does not contains spaces.
 
   if (tokens.size() == 5 && tokens[0].IsPuncChar('!') &&
-      tokens[1].type == CppToken::IDENTIFIER &&
-      tokens[1].string_value == "defined" && tokens[2].IsPuncChar('(') &&
+      tokens[1].IsIdentifier("defined") && tokens[2].IsPuncChar('(') &&
       tokens[3].type == CppToken::IDENTIFIER && tokens[4].IsPuncChar(')')) {
-    return tokens[3].string_value;
+    return tokens[3].identifier();
   }
 
   if (tokens.size() == 3 && tokens[0].IsPuncChar('!') &&
-      tokens[1].type == CppToken::IDENTIFIER &&
-      tokens[1].string_value == "defined" &&
+      tokens[1].IsIdentifier("defined") &&
       tokens[2].type == CppToken::IDENTIFIER) {
-    return tokens[2].string_value;
+    return tokens[2].identifier();
   }
 
   return std::string();
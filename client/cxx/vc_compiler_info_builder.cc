@@ -150,19 +150,29 @@ void VCCompilerInfoBuilder::SetClangClSpecificCompilerInfo(
     const std::vector<std::string>& compiler_info_envs,
     CompilerInfoData* data) const {
   const std::string& lang_flag = vc_flags.is_cplusplus() ? "/TP" : "/TC";
-  if (!ClangCompilerInfoBuilderHelper::SetBasicCompilerInfo(
-          local_compiler_path, vc_flags.compiler_info_flags(),
-          compiler_info_envs, vc_flags.cwd(), lang_flag,
-          vc_flags.resource_dir(), vc_flags.is_cplusplus(), false, data)) {
+  // -### output is taken concurrently with the basic compiler info.
+  bool has_basic_info = false;
+  std::string sharp_output;
+  RunProbesConcurrently({
+      [&]() {
+        has_basic_info = ClangCompilerInfoBuilderHelper::SetBasicCompilerInfo(
+            local_compiler_path, vc_flags.compiler_info_flags(),
+            compiler_info_envs, vc_flags.cwd(), lang_flag,
+            vc_flags.resource_dir(), vc_flags.is_cplusplus(), false, data);
+      },
+      [&]() {
+        sharp_output = GetClangClSharpOutput(
+            local_compiler_path, vc_flags.compiler_info_flags(),
+            compiler_info_envs, vc_flags.cwd());
+      },
+  });
+  if (!has_basic_info) {
     DCHECK(data->has_error_message());
     // If error occurred in SetBasicCompilerInfo, we do not need to
     // continue.
     return;
   }
 
-  const std::string& sharp_output =
-      GetClangClSharpOutput(local_compiler_path, vc_flags.compiler_info_flags(),
-                            compiler_info_envs, vc_flags.cwd());
   if (sharp_output.empty() ||
       !ClangCompilerInfoBuilderHelper::ParseClangVersionTarget(
           sharp_output, data->mutable_version(), data->mutable_target())) {
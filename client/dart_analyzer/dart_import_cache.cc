@@ -0,0 +1,191 @@
+// Copyright 2021 The Goma Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "dart_analyzer/dart_import_cache.h"
+
+#include <algorithm>
+#include <atomic>
+
+#include "autolock_timer.h"
+#include "callback.h"
+#include "content.h"
+#include "counterz.h"
+#include "dart_analyzer/dart_include_processor.h"
+#include "glog/logging.h"
+#include "worker_thread.h"
+#include "worker_thread_manager.h"
+
+namespace devtools_goma {
+
+// Dart sources to be read in parallel.
+// This is shared by the caller of GetImportsList and tasks in the pool.
+// A task may start after all sources are read. It just finds nothing to do.
+struct DartImportCache::Batch {
+  std::vector<std::string> paths;
+  std::vector<std::shared_ptr<const Imports>> imports;
+  // Index in |paths| to be read next.
+  std::atomic<size_t> next{0};
+
+  Lock mu;
+  ConditionVariable cond;
+  size_t num_done GUARDED_BY(mu) = 0;
+};
+
+DartImportCache* DartImportCache::instance_;
+
+// static
+void DartImportCache::Init(size_t max_entries) {
+  instance_ = new DartImportCache(max_entries);
+}
+
+// static
+void DartImportCache::Quit() {
+  delete instance_;
+  instance_ = nullptr;
+}
+
+DartImportCache::DartImportCache(size_t max_entries)
+    : imports_("dart imports", max_entries),
+      package_configs_("dart package config", max_entries) {}
+
+void DartImportCache::StartPool(WorkerThreadManager* wm, int num_threads) {
+  DCHECK(wm_ == nullptr);
+  if (num_threads <= 0) {
+    return;
+  }
+  pool_ = wm->StartPool(num_threads, "dart_import");
+  num_threads_ = num_threads;
+  wm_ = wm;
+  LOG(INFO) << "dart_import_pool=" << pool_ << " num_thread=" << num_threads;
+}
+
+// static
+std::shared_ptr<const DartImportCache::Imports> DartImportCache::ReadImports(
+    const std::string& path) {
+  GOMA_COUNTERZ("DartImportCache::ReadImports");
+
+  auto imports = std::make_shared<Imports>();
+  std::unique_ptr<Content> content = Content::CreateFromFile(path);
+  if (content == nullptr) {
+    return imports;
+  }
+  imports->readable = true;
+  imports->parsed = DartIncludeProcessor::ParseDartImports(
+      content->ToStringView(), path, &imports->imports,
+      &imports->error_reason);
+  return imports;
+}
+
+// static
+void DartImportCache::RunBatch(std::shared_ptr<Batch> batch) {
+  for (;;) {
+    const size_t i = batch->next.fetch_add(1);
+    if (i >= batch->paths.size()) {
+      return;
+    }
+    batch->imports[i] = ReadImports(batch->paths[i]);
+    AUTOLOCK(lock, &batch->mu);
+    if (++batch->num_done == batch->paths.size()) {
+      batch->cond.Broadcast();
+    }
+  }
+}
+
+std::vector<std::shared_ptr<const DartImportCache::Imports>>
+DartImportCache::GetImportsList(const std::vector<std::string>& paths) {
+  GOMA_COUNTERZ("DartImportCache::GetImportsList");
+
+  std::vector<std::shared_ptr<const Imports>> result(paths.size());
+  std::vector<FileStat> file_stats;
+  file_stats.reserve(paths.size());
+  // Indices in |paths| not found in the cache.
+  std::vector<size_t> missed;
+  for (size_t i = 0; i < paths.size(); ++i) {
+    file_stats.emplace_back(paths[i]);
+    // A file not found never matches an entry, so ReadImports fills
+    // the result.
+    if (!imports_.Lookup(paths[i], file_stats.back(), &result[i])) {
+      missed.push_back(i);
+    }
+  }
+  if (missed.empty()) {
+    return result;
+  }
+
+  auto batch = std::make_shared<Batch>();
+  batch->paths.reserve(missed.size());
+  for (size_t i : missed) {
+    batch->paths.push_back(paths[i]);
+  }
+  batch->imports.resize(missed.size());
+  if (pool_enabled() && missed.size() > 1) {
+    // The calling thread also reads sources, so one task less is enough.
+    const size_t num_tasks =
+        std::min<size_t>(num_threads_, missed.size() - 1);
+    for (size_t i = 0; i < num_tasks; ++i) {
+      wm_->RunClosureInPool(FROM_HERE, pool_,
+                            NewCallback(&DartImportCache::RunBatch, batch),
+                            WorkerThread::PRIORITY_LOW);
+    }
+    parallel_read_.Add(1);
+  }
+  RunBatch(batch);
+  {
+    AUTOLOCK(lock, &batch->mu);
+    while (batch->num_done < batch->paths.size()) {
+      batch->cond.Wait(&batch->mu);
+    }
+  }
+
+  for (size_t j = 0; j < missed.size(); ++j) {
+    const size_t i = missed[j];
+    result[i] = std::move(batch->imports[j]);
+    if (!result[i]->readable) {
+      continue;
+    }
+    imports_.Insert(paths[i], file_stats[i], result[i]);
+  }
+  return result;
+}
+
+std::shared_ptr<const DartImportCache::PackageConfig>
+DartImportCache::LookupPackageConfig(const std::string& packages_file) {
+  GOMA_COUNTERZ("DartImportCache::LookupPackageConfig");
+
+  // Non-existing _embedder.yaml is also checked, since it might be
+  // created later.
+  auto is_valid = [&packages_file](
+                      const std::shared_ptr<const PackageConfig>& config) {
+    for (const auto& file : config->files) {
+      if (FileStat(file.first) != file.second) {
+        VLOG(1) << "dart package config " << packages_file
+                << " is invalidated by " << file.first;
+        return false;
+      }
+    }
+    return true;
+  };
+  std::shared_ptr<const PackageConfig> config;
+  if (!package_configs_.Lookup(packages_file, is_valid, &config)) {
+    return nullptr;
+  }
+  return config;
+}
+
+bool DartImportCache::InsertPackageConfig(
+    const std::string& packages_file,
+    std::shared_ptr<const PackageConfig> config) {
+  for (const auto& file : config->files) {
+    // Non-existing _embedder.yaml is fine.
+    if (file.second.IsValid() &&
+        !IsCacheableFileStat("dart package config", file.first,
+                             file.second)) {
+      return false;
+    }
+  }
+  package_configs_.Insert(packages_file, std::move(config));
+  return true;
+}
+
+}  // namespace devtools_goma
@@ -0,0 +1,125 @@
+// Copyright 2021 The Goma Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef DEVTOOLS_GOMA_CLIENT_DART_ANALYZER_DART_IMPORT_CACHE_H_
+#define DEVTOOLS_GOMA_CLIENT_DART_ANALYZER_DART_IMPORT_CACHE_H_
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
+#include "atomic_stats_counter.h"
+#include "basictypes.h"
+#include "file_stat.h"
+#include "file_stat_lru_cache.h"
+
+namespace devtools_goma {
+
+class WorkerThreadManager;
+
+// DartImportCache keeps imports parsed from dart sources and package
+// configs parsed from .packages and _embedder.yaml files, so that
+// DartIncludeProcessor doesn't need to walk the same package graph again
+// for every dart_analyzer task.
+// An entry is used only while FileStat of the files it was made from is
+// not changed.
+//
+// If a pool is started by StartPool, dart sources given to GetImportsList
+// are read and parsed in parallel.
+class DartImportCache {
+ public:
+  struct Imports {
+    // False if the dart source could not be read.
+    bool readable = false;
+    // False if the dart source could not be parsed. |error_reason| has
+    // the reason.
+    bool parsed = false;
+    std::string error_reason;
+    // Pairs of (package name, path) as DartIncludeProcessor::ParseDartImports
+    // returns.
+    absl::flat_hash_set<std::pair<std::string, std::string>> imports;
+  };
+
+  struct PackageConfig {
+    absl::flat_hash_map<std::string, std::string> package_path_map;
+    absl::flat_hash_map<std::string, std::string> library_path_map;
+    // _embedder.yaml files found in packages.
+    std::vector<std::string> yaml_files;
+    // Files the config was made from, i.e. the packages file and
+    // _embedder.yaml of every package, including non-existing ones.
+    std::vector<std::pair<std::string, FileStat>> files;
+  };
+
+  static DartImportCache* instance() { return instance_; }
+  static bool IsEnabled() { return instance_ != nullptr; }
+
+  // Initializes DartImportCache.
+  // If the number of imports entries or package config entries exceeds
+  // |max_entries|, the least recently used entry will be evicted.
+  static void Init(size_t max_entries);
+  static void Quit();
+
+  // Starts a pool of |num_threads| in |wm| to read dart sources.
+  // Does nothing if |num_threads| <= 0.
+  void StartPool(WorkerThreadManager* wm, int num_threads);
+  bool pool_enabled() const { return wm_ != nullptr; }
+
+  // Returns imports of each of |paths| in the same order.
+  std::vector<std::shared_ptr<const Imports>> GetImportsList(
+      const std::vector<std::string>& paths);
+
+  // Reads |path| and parses its imports without using the cache.
+  static std::shared_ptr<const Imports> ReadImports(const std::string& path);
+
+  // Returns the package config of |packages_file| if no file it was made
+  // from is modified. Returns nullptr otherwise.
+  std::shared_ptr<const PackageConfig> LookupPackageConfig(
+      const std::string& packages_file);
+
+  // Stores |config| for |packages_file|.
+  // Returns false if it is not cacheable, e.g. some file might be modified
+  // while reading.
+  bool InsertPackageConfig(const std::string& packages_file,
+                           std::shared_ptr<const PackageConfig> config);
+
+  size_t imports_size() const { return imports_.size(); }
+  size_t package_config_size() const { return package_configs_.size(); }
+  int64_t hit() const { return imports_.hit() + package_configs_.hit(); }
+  // An invalidated package config is also counted as a miss.
+  int64_t miss() const {
+    return imports_.miss() + package_configs_.miss() +
+           package_configs_.invalidated();
+  }
+  int64_t parallel_read() const { return parallel_read_.value(); }
+
+ private:
+  struct Batch;
+
+  explicit DartImportCache(size_t max_entries);
+  ~DartImportCache() = default;
+
+  // Reads dart sources in |batch| until no source is left.
+  // Runs on the pool and on the thread calling GetImportsList.
+  static void RunBatch(std::shared_ptr<Batch> batch);
+
+  static DartImportCache* instance_;
+
+  WorkerThreadManager* wm_ = nullptr;
+  int pool_ = -1;
+  int num_threads_ = 0;
+
+  FileStatLruCache<std::shared_ptr<const Imports>> imports_;
+  FileStatLruCache<std::shared_ptr<const PackageConfig>> package_configs_;
+
+  StatsCounter parallel_read_;
+
+  DISALLOW_COPY_AND_ASSIGN(DartImportCache);
+};
+
+}  // namespace devtools_goma
+
+#endif  // DEVTOOLS_GOMA_CLIENT_DART_ANALYZER_DART_IMPORT_CACHE_H_
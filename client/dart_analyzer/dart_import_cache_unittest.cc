@@ -0,0 +1,117 @@
+// Copyright 2021 The Goma Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "dart_analyzer/dart_import_cache.h"
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "client/unittest_util.h"
+#include "gtest/gtest.h"
+#include "worker_thread_manager.h"
+
+namespace devtools_goma {
+
+class DartImportCacheTest : public testing::Test {
+ public:
+  DartImportCacheTest() {
+    DartImportCache::Init(2);
+    tmpdir_util_ = absl::make_unique<TmpdirUtil>("dart_import_cache");
+  }
+
+  ~DartImportCacheTest() override { DartImportCache::Quit(); }
+
+ protected:
+  std::unique_ptr<TmpdirUtil> tmpdir_util_;
+};
+
+TEST_F(DartImportCacheTest, GetImportsList) {
+  DartImportCache* cache = DartImportCache::instance();
+  const std::string a = tmpdir_util_->CreateTmpFileWithOldMtime(
+      "a.dart", "import 'package:foo/foo.dart';\n");
+  const std::string nonexist = tmpdir_util_->FullPath("nonexist.dart");
+
+  std::vector<std::shared_ptr<const DartImportCache::Imports>> imports_list =
+      cache->GetImportsList({a, nonexist});
+  ASSERT_EQ(2U, imports_list.size());
+  EXPECT_TRUE(imports_list[0]->readable);
+  EXPECT_TRUE(imports_list[0]->parsed);
+  EXPECT_EQ(1U, imports_list[0]->imports.size());
+  EXPECT_EQ(1U, imports_list[0]->imports.count(
+                    std::make_pair(std::string("foo"),
+                                   std::string("foo.dart"))));
+  EXPECT_FALSE(imports_list[1]->readable);
+  EXPECT_EQ(0, cache->hit());
+  EXPECT_EQ(2, cache->miss());
+  // Non existing file is not cached.
+  EXPECT_EQ(1U, cache->imports_size());
+
+  imports_list = cache->GetImportsList({a});
+  ASSERT_EQ(1U, imports_list.size());
+  EXPECT_EQ(1U, imports_list[0]->imports.size());
+  EXPECT_EQ(1, cache->hit());
+  EXPECT_EQ(2, cache->miss());
+}
+
+TEST_F(DartImportCacheTest, ParallelRead) {
+  std::vector<std::string> paths;
+  for (int i = 0; i < 100; ++i) {
+    const std::string name = absl::StrCat("src", i, ".dart");
+    paths.push_back(tmpdir_util_->CreateTmpFileWithOldMtime(
+        name, absl::StrCat("import 'package:p", i, "/p.dart';\n")));
+  }
+  DartImportCache::Quit();
+  DartImportCache::Init(paths.size());
+
+  WorkerThreadManager wm;
+  wm.Start(1);
+  {
+    DartImportCache* cache = DartImportCache::instance();
+    cache->StartPool(&wm, 4);
+    ASSERT_TRUE(cache->pool_enabled());
+
+    std::vector<std::shared_ptr<const DartImportCache::Imports>>
+        imports_list = cache->GetImportsList(paths);
+    EXPECT_EQ(1, cache->parallel_read());
+    ASSERT_EQ(paths.size(), imports_list.size());
+    for (size_t i = 0; i < paths.size(); ++i) {
+      ASSERT_EQ(1U, imports_list[i]->imports.size()) << paths[i];
+      EXPECT_EQ(absl::StrCat("p", i), imports_list[i]->imports.begin()->first);
+    }
+    EXPECT_EQ(paths.size(), cache->imports_size());
+  }
+  wm.Finish();
+}
+
+TEST_F(DartImportCacheTest, PackageConfig) {
+  DartImportCache* cache = DartImportCache::instance();
+  const std::string packages =
+      tmpdir_util_->CreateTmpFileWithOldMtime(".packages", "foo:foo/lib\n");
+  const std::string yaml = tmpdir_util_->FullPath("foo/lib/_embedder.yaml");
+
+  EXPECT_EQ(nullptr, cache->LookupPackageConfig(packages));
+
+  auto config = std::make_shared<DartImportCache::PackageConfig>();
+  config->package_path_map.emplace("foo", tmpdir_util_->FullPath("foo/lib"));
+  config->files.emplace_back(packages, FileStat(packages));
+  config->files.emplace_back(yaml, FileStat(yaml));
+  EXPECT_TRUE(cache->InsertPackageConfig(packages, config));
+  EXPECT_EQ(1U, cache->package_config_size());
+
+  std::shared_ptr<const DartImportCache::PackageConfig> cached =
+      cache->LookupPackageConfig(packages);
+  ASSERT_NE(nullptr, cached);
+  EXPECT_EQ(config->package_path_map, cached->package_path_map);
+
+  // Newly created _embedder.yaml invalidates the config.
+  tmpdir_util_->CreateTmpFileWithOldMtime("foo/lib/_embedder.yaml",
+                                          "embedded_libs:\n");
+  EXPECT_EQ(nullptr, cache->LookupPackageConfig(packages));
+}
+
+}  // namespace devtools_goma
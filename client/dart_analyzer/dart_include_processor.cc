@@ -4,11 +4,14 @@
 
 #include "dart_analyzer/dart_include_processor.h"
 
-#include <queue>
+#include <memory>
+#include <vector>
 
 #include "absl/strings/match.h"
 #include "absl/strings/str_split.h"
 #include "content.h"
+#include "dart_analyzer/dart_import_cache.h"
+#include "file_stat.h"
 #include "lib/path_resolver.h"
 #include "path.h"
 #include "yaml.h"
@@ -105,28 +108,78 @@ bool ReadEmbededLibs(
   return true;
 }
 
-bool ReadPackageEmbededYAML(
-    const absl::flat_hash_map<std::string, std::string>& package_path_map,
-    absl::flat_hash_map<std::string, std::string>* library_path_map,
-    std::set<std::string>* required_files,
-    std::string* error_reason) {
-  for (const auto& package : package_path_map) {
+// Reads |packages_file| and _embedder.yaml of each package in it.
+bool ReadPackageConfig(const std::string& packages_file,
+                       DartImportCache::PackageConfig* config,
+                       std::string* error_reason) {
+  config->files.emplace_back(packages_file, FileStat(packages_file));
+  std::unique_ptr<Content> package_file_content =
+      Content::CreateFromFile(packages_file);
+  if (package_file_content == nullptr) {
+    *error_reason = "failed to read packages file " + packages_file;
+    return false;
+  }
+  if (!DartIncludeProcessor::ParsePackagesFile(
+          package_file_content->ToStringView(), packages_file,
+          &config->package_path_map, error_reason)) {
+    *error_reason = "failed to parse packages file " + packages_file +
+                    "due to error: " + *error_reason;
+    return false;
+  }
+  for (const auto& package : config->package_path_map) {
     std::string yaml_path = PathResolver::ResolvePath(
         file::JoinPathRespectAbsolute(package.second, "_embedder.yaml"));
+    config->files.emplace_back(yaml_path, FileStat(yaml_path));
     std::unique_ptr<Content> yaml_content = Content::CreateFromFile(yaml_path);
     if (!yaml_content) {
       // _embedder.yaml is optional. Continue if it is not readable.
       continue;
     }
     if (!DartIncludeProcessor::ParseDartYAML(yaml_content->ToStringView(),
-                                             yaml_path, library_path_map,
+                                             yaml_path,
+                                             &config->library_path_map,
                                              error_reason)) {
+      *error_reason =
+          "failed to parse embedded YAML due to error: " + *error_reason;
       return false;
     }
-    required_files->insert(std::move(yaml_path));
+    config->yaml_files.push_back(std::move(yaml_path));
   }
   return true;
 }
+
+std::shared_ptr<const DartImportCache::PackageConfig> GetPackageConfig(
+    const std::string& packages_file,
+    std::string* error_reason) {
+  if (DartImportCache::IsEnabled()) {
+    std::shared_ptr<const DartImportCache::PackageConfig> config =
+        DartImportCache::instance()->LookupPackageConfig(packages_file);
+    if (config) {
+      return config;
+    }
+  }
+  auto config = std::make_shared<DartImportCache::PackageConfig>();
+  if (!ReadPackageConfig(packages_file, config.get(), error_reason)) {
+    return nullptr;
+  }
+  if (DartImportCache::IsEnabled()) {
+    DartImportCache::instance()->InsertPackageConfig(packages_file, config);
+  }
+  return config;
+}
+
+std::vector<std::shared_ptr<const DartImportCache::Imports>> GetImportsList(
+    const std::vector<std::string>& dart_sources) {
+  if (DartImportCache::IsEnabled()) {
+    return DartImportCache::instance()->GetImportsList(dart_sources);
+  }
+  std::vector<std::shared_ptr<const DartImportCache::Imports>> imports_list;
+  imports_list.reserve(dart_sources.size());
+  for (const auto& dart_source : dart_sources) {
+    imports_list.push_back(DartImportCache::ReadImports(dart_source));
+  }
+  return imports_list;
+}
 }  // namespace
 
 bool DartIncludeProcessor::Run(
@@ -134,79 +187,75 @@ bool DartIncludeProcessor::Run(
     const DartAnalyzerCompilerInfo& dart_analyzer_compiler_info,
     std::set<std::string>* required_files,
     std::string* error_reason) {
-  absl::flat_hash_map<std::string, std::string> package_path_map;
-  absl::flat_hash_map<std::string, std::string> library_path_map;
+  std::shared_ptr<const DartImportCache::PackageConfig> package_config;
 
   // Read packages file if it exists to build package->path map.
   if (!dart_analyzer_flags.packages_file().empty()) {
-    std::unique_ptr<Content> package_file_content =
-        Content::CreateFromFile(dart_analyzer_flags.packages_file());
-    // TODO, parse _embedder.yaml file after parsing .packages
-    // file, as it contains additional package->path relationship
-    // information.
-    if (!DartIncludeProcessor::ParsePackagesFile(
-            package_file_content->ToStringView(),
-            dart_analyzer_flags.packages_file(), &package_path_map,
-            error_reason)) {
-      *error_reason = "failed to parse packages file " +
-                      dart_analyzer_flags.packages_file() +
-                      "due to error: " + *error_reason;
-      return false;
-    }
-    if (!ReadPackageEmbededYAML(package_path_map, &library_path_map,
-                                required_files, error_reason)) {
-      *error_reason =
-          "failed to parse embedded YAML due to error: " + *error_reason;
+    package_config =
+        GetPackageConfig(dart_analyzer_flags.packages_file(), error_reason);
+    if (package_config == nullptr) {
       return false;
     }
+    required_files->insert(package_config->yaml_files.begin(),
+                           package_config->yaml_files.end());
+  } else {
+    package_config = std::make_shared<DartImportCache::PackageConfig>();
   }
+
   // Read dart imports in BFS manner.
-  std::queue<std::string> work_list;
-  for (const auto& dart_source : dart_analyzer_flags.input_filenames()) {
-    work_list.emplace(dart_source);
-  }
+  // Dart sources in the same depth are read at once, so that they can be
+  // read in parallel by DartImportCache.
+  std::vector<std::string> work_list = dart_analyzer_flags.input_filenames();
   while (!work_list.empty()) {
-    std::string next = work_list.front();
-    work_list.pop();
-    if (required_files->find(next) != required_files->end()) {
-      continue;
-    }
-    required_files->emplace(next);
-    LOG(INFO) << "Read " << next << " from dart include processor work list";
-    std::unique_ptr<Content> dart_source_content =
-        Content::CreateFromFile(next);
-    if (dart_source_content == nullptr) {
-      // Dart standard library may not located in desired path. They
-      // are part of sdk so it's OK it is not accessible by goma.
-      LOG(WARNING) << "dart source " << next << " cannot be read.";
-      continue;
-    }
-    absl::flat_hash_set<std::pair<std::string, std::string>> imports;
-    if (!DartIncludeProcessor::ParseDartImports(
-            dart_source_content->ToStringView(), next, &imports,
-            error_reason)) {
-      *error_reason = "failed to parse dart source " + next +
-                      " due to error: " + *error_reason;
-      return false;
+    std::vector<std::string> dart_sources;
+    for (auto& next : work_list) {
+      if (!required_files->insert(next).second) {
+        continue;
+      }
+      LOG(INFO) << "Read " << next << " from dart include processor work list";
+      dart_sources.push_back(std::move(next));
     }
-
-    for (const auto& import_entry : imports) {
-      std::string file;
-      if (!DartIncludeProcessor::ResolveImports(package_path_map,
-                                                library_path_map, import_entry,
-                                                &file, error_reason)) {
-        *error_reason = "failed to resolve import " + import_entry.first + ":" +
-                        import_entry.second + " due to error: " + *error_reason;
+    work_list.clear();
+
+    std::vector<std::shared_ptr<const DartImportCache::Imports>> imports_list =
+        GetImportsList(dart_sources);
+    for (size_t i = 0; i < dart_sources.size(); ++i) {
+      const std::string& dart_source = dart_sources[i];
+      const DartImportCache::Imports& imports = *imports_list[i];
+      if (!imports.readable) {
+        // Dart standard library may not located in desired path. They
+        // are part of sdk so it's OK it is not accessible by goma.
+        LOG(WARNING) << "dart source " << dart_source << " cannot be read.";
+        continue;
+      }
+      if (!imports.parsed) {
+        *error_reason = "failed to parse dart source " + dart_source +
+                        " due to error: " + imports.error_reason;
         return false;
       }
-      if (file.empty()) {
-        // Some library imports do not contain resolvable file name. E.g.
-        // 'dart:io' is a builtin library which is part of dart sdk. In this
-        // case, ResolveImports returns an empty file and it should be skipped.
-        continue;
+
+      for (const auto& import_entry : imports.imports) {
+        std::string file;
+        if (!DartIncludeProcessor::ResolveImports(
+                package_config->package_path_map,
+                package_config->library_path_map, import_entry, &file,
+                error_reason)) {
+          *error_reason = "failed to resolve import " + import_entry.first +
+                          ":" + import_entry.second +
+                          " due to error: " + *error_reason;
+          return false;
+        }
+        if (file.empty()) {
+          // Some library imports do not contain resolvable file name. E.g.
+          // 'dart:io' is a builtin library which is part of dart sdk. In this
+          // case, ResolveImports returns an empty file and it should be
+          // skipped.
+          continue;
+        }
+        LOG(INFO) << "Add " << file
+                  << " into dart include processor work list";
+        work_list.push_back(std::move(file));
       }
-      LOG(INFO) << "Add " << file << " into dart include processor work list";
-      work_list.push(std::move(file));
     }
   }
   return true;
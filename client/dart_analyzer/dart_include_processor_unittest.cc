@@ -4,10 +4,16 @@
 
 #include "dart_analyzer/dart_include_processor.h"
 
+#include "absl/memory/memory.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "client/unittest_util.h"
+#include "dart_analyzer/dart_import_cache.h"
 #include "glog/logging.h"
 #include "gtest/gtest.h"
 #include "lib/path_resolver.h"
 #include "path.h"
+#include "worker_thread_manager.h"
 
 namespace devtools_goma {
 TEST(DartIncludeProcessorTest, ParsePackageFile) {
@@ -294,4 +300,70 @@ analyzer:
   EXPECT_TRUE(error_reason.empty());
 }
 
+TEST(DartIncludeProcessorTest, RunWithDartImportCache) {
+  TmpdirUtil tmpdir("dart_include_processor");
+  tmpdir.CreateTmpFile(".packages", "foo:foo/lib\n");
+  tmpdir.CreateTmpFile("foo/lib/_embedder.yaml",
+                       "embedded_libs:\n"
+                       "  \"dart:ui\": \"ui/ui.dart\"\n");
+  tmpdir.CreateTmpFile("foo/lib/foo.dart",
+                       "import 'dart:io';\n"
+                       "import 'dart:ui';\n");
+  tmpdir.CreateTmpFile("foo/lib/ui/ui.dart", "");
+  tmpdir.CreateTmpFile("main.dart",
+                       "import 'package:foo/foo.dart';\n"
+                       "import 'b.dart';\n");
+  tmpdir.CreateTmpFile("b.dart", "import 'package:foo/foo.dart';\n");
+  for (const auto& name : {".packages", "foo/lib/_embedder.yaml",
+                           "foo/lib/foo.dart", "foo/lib/ui/ui.dart",
+                           "main.dart", "b.dart"}) {
+    ASSERT_TRUE(UpdateMtime(tmpdir.FullPath(name),
+                            absl::Now() - absl::Seconds(10)));
+  }
+
+  // DartAnalyzerFlags also takes the packages file as an input.
+  const std::set<std::string> expected_files{
+      tmpdir.FullPath(".packages"),
+      tmpdir.FullPath("foo/lib/_embedder.yaml"),
+      tmpdir.FullPath("foo/lib/foo.dart"),
+      tmpdir.FullPath("foo/lib/ui/ui.dart"),
+      tmpdir.FullPath("main.dart"),
+      tmpdir.FullPath("b.dart"),
+  };
+  const DartAnalyzerFlags flags(
+      {"dartanalyzer", "--packages=" + tmpdir.FullPath(".packages"),
+       tmpdir.FullPath("main.dart")},
+      tmpdir.realcwd());
+  const DartAnalyzerCompilerInfo compiler_info(
+      absl::make_unique<CompilerInfoData>());
+
+  // Without cache.
+  {
+    std::set<std::string> required_files;
+    std::string error_reason;
+    EXPECT_TRUE(DartIncludeProcessor().Run(flags, compiler_info,
+                                           &required_files, &error_reason))
+        << error_reason;
+    EXPECT_EQ(expected_files, required_files);
+  }
+
+  DartImportCache::Init(100);
+  WorkerThreadManager wm;
+  wm.Start(1);
+  DartImportCache::instance()->StartPool(&wm, 2);
+  for (int i = 0; i < 2; ++i) {
+    std::set<std::string> required_files;
+    std::string error_reason;
+    EXPECT_TRUE(DartIncludeProcessor().Run(flags, compiler_info,
+                                           &required_files, &error_reason))
+        << error_reason;
+    EXPECT_EQ(expected_files, required_files);
+  }
+  // The second run uses the package config and imports of all inputs
+  // cached by the first run.
+  EXPECT_EQ(6, DartImportCache::instance()->hit());
+  DartImportCache::Quit();
+  wm.Finish();
+}
+
 }  // namespace devtools_goma
@@ -5,6 +5,8 @@
 
 #include "descriptor_poller.h"
 
+#include <atomic>
+
 #include "autolock_timer.h"
 #include "socket_descriptor.h"
 #include "glog/logging.h"
@@ -12,6 +14,22 @@
 
 namespace devtools_goma {
 
+namespace {
+
+std::atomic<bool> g_use_io_uring{false};
+
+}  // anonymous namespace
+
+// static
+void DescriptorPoller::SetUseIoUring(bool use_io_uring) {
+  g_use_io_uring.store(use_io_uring, std::memory_order_relaxed);
+}
+
+// static
+bool DescriptorPoller::use_io_uring() {
+  return g_use_io_uring.load(std::memory_order_relaxed);
+}
+
 DescriptorPollerBase::DescriptorPollerBase(
     std::unique_ptr<SocketDescriptor> poll_breaker,
     ScopedSocket&& poll_signaler)
@@ -22,6 +40,8 @@ DescriptorPollerBase::DescriptorPollerBase(
   CHECK(poll_signaler_.valid());
 }
 
+DescriptorPollerBase::~DescriptorPollerBase() {}
+
 bool DescriptorPollerBase::PollEvents(
     const DescriptorMap& descriptors,
     absl::Duration timeout,
@@ -36,6 +36,13 @@ class DescriptorPoller {
   static std::unique_ptr<DescriptorPoller> NewDescriptorPoller(
       std::unique_ptr<SocketDescriptor> poll_breaker,
       ScopedSocket&& poll_signaler);
+
+  // Selects io_uring based poller for DescriptorPoller created after this
+  // call.  It is only effective on Linux, and NewDescriptorPoller falls back
+  // to the default implementation if the kernel does not support io_uring.
+  static void SetUseIoUring(bool use_io_uring);
+  static bool use_io_uring();
+
   DescriptorPoller() {}
   virtual ~DescriptorPoller() {}
 
@@ -70,7 +77,7 @@ class DescriptorPollerBase : public DescriptorPoller {
  public:
   DescriptorPollerBase(std::unique_ptr<SocketDescriptor> poll_breaker,
                        ScopedSocket&& poll_signaler);
-  ~DescriptorPollerBase() override {}
+  ~DescriptorPollerBase() override;
 
   class EventEnumerator {
    public:
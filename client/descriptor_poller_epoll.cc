@@ -19,6 +19,7 @@
 #include "absl/memory/memory.h"
 #include "absl/time/time.h"
 #include "compiler_specific.h"
+#include "descriptor_poller_uring.h"
 #include "glog/logging.h"
 #include "scoped_fd.h"
 #include "socket_descriptor.h"
@@ -195,6 +196,10 @@ absl::once_flag EpollDescriptorPoller::s_init_once_;
 std::unique_ptr<DescriptorPoller> DescriptorPoller::NewDescriptorPoller(
     std::unique_ptr<SocketDescriptor> breaker,
     ScopedSocket&& signaler) {
+  if (use_io_uring() && IsIoUringDescriptorPollerSupported()) {
+    return NewIoUringDescriptorPoller(std::move(breaker),
+                                      std::move(signaler));
+  }
   return absl::make_unique<EpollDescriptorPoller>(std::move(breaker),
                                                   std::move(signaler));
 }
@@ -0,0 +1,619 @@
+// Copyright 2021 The Goma Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// io_uring based DescriptorPoller.
+//
+// Unlike epoll, io_uring polls are one-shot and need to be (re-)armed by
+// submitting IORING_OP_POLL_ADD.  All arming and disarming requests collected
+// during one loop of the worker thread are submitted together with waiting
+// for completions in a single io_uring_enter(2), so the number of syscalls
+// per loop does not depend on the number of descriptors that changed their
+// interests.
+// Only polls go through the ring; reads and writes are still done by
+// the descriptor's owner with read(2)/write(2).
+//
+// Interests are kept per descriptor as registered by RegisterPollEvent and
+// UnregisterPollEvent, same as epoll keeps them in the kernel, and a poll is
+// re-armed after each completion while the descriptor is registered.
+// SocketDescriptor::wait_readable()/wait_writable() can not be used here,
+// since they are false while the descriptor's callback is queued, and no
+// event would tell the poller to re-arm after the callback ran.
+
+#include "descriptor_poller_uring.h"
+
+#include <errno.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#if defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#endif
+#endif
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "absl/base/call_once.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
+#include "absl/memory/memory.h"
+#include "absl/time/time.h"
+#include "compiler_specific.h"
+#include "glog/logging.h"
+#include "socket_descriptor.h"
+
+// IORING_ENTER_EXT_ARG (linux 5.11) is required to wait completions with
+// timeout without submitting IORING_OP_TIMEOUT.
+#if defined(IORING_ENTER_EXT_ARG) && defined(__NR_io_uring_setup) && \
+    defined(__NR_io_uring_enter)
+#define GOMA_HAVE_IO_URING 1
+#endif
+
+namespace devtools_goma {
+
+#ifdef GOMA_HAVE_IO_URING
+
+namespace {
+
+// The number of submission queue entries.
+// The completion queue has twice as many entries by default.
+constexpr unsigned kRingEntries = 1024;
+
+// user_data for requests whose completions are not interesting
+// (e.g. IORING_OP_POLL_REMOVE).
+constexpr uint64_t kIgnoredUserData = 0;
+// user_data for the poll on the poll breaker.
+constexpr uint64_t kPollBreakerUserData = 1;
+// user_data for polls on SocketDescriptors are assigned from this value.
+constexpr uint64_t kFirstPollUserData = 2;
+
+int IoUringSetup(unsigned entries, struct io_uring_params* params) {
+  return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+}
+
+int IoUringEnter(int ring_fd,
+                 unsigned to_submit,
+                 unsigned min_complete,
+                 unsigned flags,
+                 const void* arg,
+                 size_t argsz) {
+  return static_cast<int>(syscall(__NR_io_uring_enter, ring_fd, to_submit,
+                                  min_complete, flags, arg, argsz));
+}
+
+unsigned LoadAcquire(const unsigned* p) {
+  return __atomic_load_n(p, __ATOMIC_ACQUIRE);
+}
+
+void StoreRelease(unsigned* p, unsigned v) {
+  __atomic_store_n(p, v, __ATOMIC_RELEASE);
+}
+
+// Minimal wrapper of io_uring rings.
+// This is not thread-safe, and must be used on a single thread.
+class IoUring {
+ public:
+  struct Completion {
+    uint64_t user_data;
+    int32_t res;
+  };
+
+  IoUring() = default;
+  ~IoUring() {
+    if (sqes_ != nullptr) {
+      munmap(sqes_, sqes_size_);
+    }
+    if (cq_ring_ptr_ != nullptr && cq_ring_ptr_ != sq_ring_ptr_) {
+      munmap(cq_ring_ptr_, cq_ring_size_);
+    }
+    if (sq_ring_ptr_ != nullptr) {
+      munmap(sq_ring_ptr_, sq_ring_size_);
+    }
+  }
+
+  IoUring(const IoUring&) = delete;
+  IoUring& operator=(const IoUring&) = delete;
+
+  // Sets up io_uring with |entries| submission queue entries.
+  // Returns false and sets |err| on failure.
+  bool Init(unsigned entries, std::string* err) {
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    ring_fd_.reset(IoUringSetup(entries, &params));
+    if (!ring_fd_.valid()) {
+      *err = std::string("io_uring_setup: ") + strerror(errno);
+      return false;
+    }
+    const unsigned kRequiredFeatures = IORING_FEAT_EXT_ARG | IORING_FEAT_NODROP;
+    if ((params.features & kRequiredFeatures) != kRequiredFeatures) {
+      *err = "io_uring lacks required features: features=" +
+             std::to_string(params.features);
+      return false;
+    }
+
+    sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cq_ring_size_ =
+        params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    const bool single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (single_mmap) {
+      sq_ring_size_ = cq_ring_size_ = std::max(sq_ring_size_, cq_ring_size_);
+    }
+    sq_ring_ptr_ = Map(sq_ring_size_, IORING_OFF_SQ_RING);
+    if (sq_ring_ptr_ == nullptr) {
+      *err = std::string("mmap sq ring: ") + strerror(errno);
+      return false;
+    }
+    if (single_mmap) {
+      cq_ring_ptr_ = sq_ring_ptr_;
+    } else {
+      cq_ring_ptr_ = Map(cq_ring_size_, IORING_OFF_CQ_RING);
+      if (cq_ring_ptr_ == nullptr) {
+        *err = std::string("mmap cq ring: ") + strerror(errno);
+        return false;
+      }
+    }
+    sqes_size_ = params.sq_entries * sizeof(struct io_uring_sqe);
+    sqes_ = static_cast<struct io_uring_sqe*>(
+        Map(sqes_size_, IORING_OFF_SQES));
+    if (sqes_ == nullptr) {
+      *err = std::string("mmap sqes: ") + strerror(errno);
+      return false;
+    }
+
+    char* sq = static_cast<char*>(sq_ring_ptr_);
+    sq_head_ = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+    sq_tail_ = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+    sq_ring_mask_ = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+    sq_array_ = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+    sq_entries_ = params.sq_entries;
+    sqe_tail_ = *sq_tail_;
+
+    char* cq = static_cast<char*>(cq_ring_ptr_);
+    cq_head_ = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+    cq_tail_ = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+    cq_ring_mask_ = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+    cqes_ = reinterpret_cast<struct io_uring_cqe*>(cq + params.cq_off.cqes);
+    return true;
+  }
+
+  // Returns a cleared submission queue entry, or nullptr if the submission
+  // queue is full.
+  struct io_uring_sqe* GetSqe() {
+    if (sqe_tail_ - LoadAcquire(sq_head_) >= sq_entries_) {
+      return nullptr;
+    }
+    unsigned index = sqe_tail_ & sq_ring_mask_;
+    struct io_uring_sqe* sqe = &sqes_[index];
+    memset(sqe, 0, sizeof(*sqe));
+    sq_array_[index] = index;
+    ++sqe_tail_;
+    return sqe;
+  }
+
+  // Submits queued entries without waiting.
+  // Returns the number of submitted entries, or -1 on error.
+  int Submit() {
+    unsigned to_submit = Publish();
+    if (to_submit == 0) {
+      return 0;
+    }
+    return IoUringEnter(ring_fd_.fd(), to_submit, 0, 0, nullptr, 0);
+  }
+
+  // Submits queued entries and waits for at least one completion at most
+  // |timeout|.
+  // Returns 0 on success or timeout, or -1 on error.
+  int SubmitAndWait(absl::Duration timeout) {
+    unsigned to_submit = Publish();
+    struct __kernel_timespec ts;
+    ts.tv_sec = absl::ToInt64Seconds(timeout);
+    ts.tv_nsec = absl::ToInt64Nanoseconds(
+        timeout - absl::Seconds(ts.tv_sec));
+    struct io_uring_getevents_arg arg;
+    memset(&arg, 0, sizeof(arg));
+    arg.ts = reinterpret_cast<uint64_t>(&ts);
+    int r = IoUringEnter(ring_fd_.fd(), to_submit, 1,
+                         IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG,
+                         &arg, sizeof(arg));
+    if (r < 0 && (errno == ETIME || errno == EBUSY)) {
+      // ETIME: timed out.
+      // EBUSY: completion queue is overflowing; reap completions first.
+      return 0;
+    }
+    return r < 0 ? -1 : 0;
+  }
+
+  // Moves all available completions to |completions|.
+  void ReapCompletions(std::vector<Completion>* completions) {
+    unsigned head = *cq_head_;
+    const unsigned tail = LoadAcquire(cq_tail_);
+    for (; head != tail; ++head) {
+      const struct io_uring_cqe& cqe = cqes_[head & cq_ring_mask_];
+      completions->push_back(Completion{cqe.user_data, cqe.res});
+    }
+    StoreRelease(cq_head_, head);
+  }
+
+ private:
+  void* Map(size_t size, off_t offset) {
+    void* p = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                   MAP_SHARED | MAP_POPULATE, ring_fd_.fd(), offset);
+    return p == MAP_FAILED ? nullptr : p;
+  }
+
+  // Makes queued entries visible to the kernel.
+  // Returns the number of entries not consumed by the kernel yet.
+  unsigned Publish() {
+    StoreRelease(sq_tail_, sqe_tail_);
+    return sqe_tail_ - LoadAcquire(sq_head_);
+  }
+
+  ScopedFd ring_fd_;
+
+  void* sq_ring_ptr_ = nullptr;
+  size_t sq_ring_size_ = 0;
+  void* cq_ring_ptr_ = nullptr;
+  size_t cq_ring_size_ = 0;
+  struct io_uring_sqe* sqes_ = nullptr;
+  size_t sqes_size_ = 0;
+
+  unsigned* sq_head_ = nullptr;
+  unsigned* sq_tail_ = nullptr;
+  unsigned sq_ring_mask_ = 0;
+  unsigned* sq_array_ = nullptr;
+  unsigned sq_entries_ = 0;
+  // Local tail of submission queue; published to |sq_tail_| on submit.
+  unsigned sqe_tail_ = 0;
+
+  unsigned* cq_head_ = nullptr;
+  unsigned* cq_tail_ = nullptr;
+  unsigned cq_ring_mask_ = 0;
+  struct io_uring_cqe* cqes_ = nullptr;
+};
+
+class IoUringDescriptorPoller : public DescriptorPollerBase {
+ public:
+  IoUringDescriptorPoller(std::unique_ptr<SocketDescriptor> breaker,
+                          ScopedSocket&& poll_signaler)
+      : DescriptorPollerBase(std::move(breaker), std::move(poll_signaler)),
+        next_user_data_(kFirstPollUserData),
+        poll_breaker_armed_(false) {
+    absl::call_once(s_init_once_, LogDescriptorPollerType);
+    std::string err;
+    CHECK(ring_.Init(kRingEntries, &err)) << err;
+    CHECK(poll_breaker());
+  }
+
+  static void LogDescriptorPollerType() {
+    LOG(INFO) << "descriptor_poller will use \"io_uring\"";
+  }
+
+  // Register/Unregister may be called on other threads than the polling
+  // thread, so they only record interests and descriptors whose interests
+  // changed.
+  // Polls are (re-)armed on the polling thread in PreparePollEvents.
+  void RegisterPollEvent(SocketDescriptor* d, EventType type) override {
+    interests_[d] |= ToPollEvents(type);
+    dirty_.insert(d);
+  }
+
+  void UnregisterPollEvent(SocketDescriptor* d, EventType type) override {
+    auto found = interests_.find(d);
+    if (found != interests_.end()) {
+      found->second &= ~ToPollEvents(type);
+      if (found->second == 0) {
+        interests_.erase(found);
+      }
+    }
+    dirty_.insert(d);
+  }
+
+  void RegisterTimeoutEvent(SocketDescriptor* d) override {
+    timeout_waiters_.insert(d);
+  }
+
+  void UnregisterTimeoutEvent(SocketDescriptor* d) override {
+    timeout_waiters_.erase(d);
+  }
+
+  void UnregisterDescriptor(SocketDescriptor* d) override {
+    CHECK(d);
+    timeout_waiters_.erase(d);
+    interests_.erase(d);
+    dirty_.erase(d);
+    Disarm(d);
+  }
+
+ protected:
+  void PreparePollEvents(
+      const DescriptorMap& descriptors ALLOW_UNUSED) override {
+    if (!poll_breaker_armed_) {
+      poll_breaker_armed_ =
+          QueuePollAdd(poll_breaker()->fd(), POLLIN, kPollBreakerUserData);
+    }
+    for (auto iter = dirty_.begin(); iter != dirty_.end();) {
+      if (UpdatePoll(*iter)) {
+        dirty_.erase(iter++);
+      } else {
+        // submission queue is full even after submit. retry in next loop.
+        ++iter;
+      }
+    }
+    while (!canceled_.empty()) {
+      if (!QueuePollRemove(canceled_.back())) {
+        break;
+      }
+      canceled_.pop_back();
+    }
+  }
+
+  int PollEventsInternal(absl::Duration timeout) override {
+    completions_.clear();
+    int r = ring_.SubmitAndWait(timeout);
+    int saved_errno = errno;
+    ring_.ReapCompletions(&completions_);
+    int nevents = 0;
+    for (const auto& c : completions_) {
+      if (c.user_data != kIgnoredUserData) {
+        ++nevents;
+      }
+    }
+    if (nevents == 0 && r < 0) {
+      errno = saved_errno;
+      return -1;
+    }
+    return nevents;
+  }
+
+  class IoUringEventEnumerator : public DescriptorPollerBase::EventEnumerator {
+   public:
+    explicit IoUringEventEnumerator(IoUringDescriptorPoller* poller)
+        : poller_(poller), idx_(0), current_events_(0) {
+      CHECK(poller_);
+      timedout_iter_ = poller_->timeout_waiters_.begin();
+    }
+
+    SocketDescriptor* Next() override {
+      // Iterates over fired events.
+      if (idx_ < poller_->events_.size()) {
+        const Event& ev = poller_->events_[idx_++];
+        current_events_ = ev.events;
+        event_received_.insert(ev.d);
+        return ev.d;
+      }
+      current_events_ = 0;
+      // Then iterates over timed out ones.
+      for (; timedout_iter_ != poller_->timeout_waiters_.end();
+           ++timedout_iter_) {
+        if (!event_received_.contains(*timedout_iter_))
+          return *timedout_iter_++;
+      }
+      return nullptr;
+    }
+
+    bool IsReadable() const override {
+      return current_events_ & (POLLIN | POLLHUP | POLLERR);
+    }
+    bool IsWritable() const override {
+      return current_events_ & (POLLOUT | POLLHUP | POLLERR);
+    }
+
+   private:
+    IoUringDescriptorPoller* poller_;
+    size_t idx_;
+    uint32_t current_events_;
+    absl::flat_hash_set<SocketDescriptor*>::const_iterator timedout_iter_;
+    absl::flat_hash_set<SocketDescriptor*> event_received_;
+
+    DISALLOW_COPY_AND_ASSIGN(IoUringEventEnumerator);
+  };
+
+  std::unique_ptr<EventEnumerator> GetEventEnumerator(
+      const DescriptorMap& descriptors ALLOW_UNUSED) override {
+    // Resolves completions to descriptors with lock held, since descriptors
+    // may be unregistered while polling.
+    events_.clear();
+    for (const auto& c : completions_) {
+      if (c.user_data == kIgnoredUserData) {
+        continue;
+      }
+      if (c.user_data == kPollBreakerUserData) {
+        poll_breaker_armed_ = false;
+        if (c.res >= 0) {
+          events_.push_back(Event{poll_breaker(), static_cast<uint32_t>(
+                                                      c.res)});
+        }
+        continue;
+      }
+      auto found = user_data_to_descriptor_.find(c.user_data);
+      if (found == user_data_to_descriptor_.end()) {
+        // already disarmed or unregistered.
+        continue;
+      }
+      SocketDescriptor* d = found->second;
+      user_data_to_descriptor_.erase(found);
+      armed_.erase(d);
+      // Polls are one-shot. Re-arm in next PreparePollEvents if it is
+      // still registered.
+      dirty_.insert(d);
+      if (c.res == -ECANCELED) {
+        continue;
+      }
+      // Report an error as readable and writable, so that the descriptor's
+      // owner would notice the error by read or write.
+      uint32_t events = c.res < 0 ? (POLLIN | POLLOUT | POLLERR)
+                                  : static_cast<uint32_t>(c.res);
+      events_.push_back(Event{d, events});
+    }
+    completions_.clear();
+    return absl::make_unique<IoUringEventEnumerator>(this);
+  }
+
+ private:
+  friend class IoUringEventEnumerator;
+
+  struct Event {
+    SocketDescriptor* d;
+    uint32_t events;
+  };
+
+  struct ArmedPoll {
+    uint64_t user_data;
+    uint32_t events;
+  };
+
+  // Queues IORING_OP_POLL_ADD.
+  // Returns false if the submission queue is full.
+  bool QueuePollAdd(int fd, uint32_t events, uint64_t user_data) {
+    struct io_uring_sqe* sqe = GetSqe();
+    if (sqe == nullptr) {
+      return false;
+    }
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = fd;
+    sqe->poll32_events = events;
+    sqe->user_data = user_data;
+    return true;
+  }
+
+  // Queues IORING_OP_POLL_REMOVE for the poll identified by |user_data|.
+  // Returns false if the submission queue is full.
+  bool QueuePollRemove(uint64_t user_data) {
+    struct io_uring_sqe* sqe = GetSqe();
+    if (sqe == nullptr) {
+      return false;
+    }
+    sqe->opcode = IORING_OP_POLL_REMOVE;
+    sqe->fd = -1;
+    sqe->addr = user_data;
+    sqe->user_data = kIgnoredUserData;
+    return true;
+  }
+
+  struct io_uring_sqe* GetSqe() {
+    struct io_uring_sqe* sqe = ring_.GetSqe();
+    if (sqe == nullptr) {
+      // Flush queued entries to make room.
+      PLOG_IF(WARNING, ring_.Submit() < 0) << "io_uring submit failed";
+      sqe = ring_.GetSqe();
+    }
+    return sqe;
+  }
+
+  static uint32_t ToPollEvents(EventType type) {
+    return type == EventType::kReadEvent ? POLLIN : POLLOUT;
+  }
+
+  // Makes the armed poll on |d| match with its registered interests.
+  // Returns false if the submission queue is full.
+  bool UpdatePoll(SocketDescriptor* d) {
+    uint32_t events = 0;
+    if (d->fd() >= 0) {
+      auto interest = interests_.find(d);
+      if (interest != interests_.end()) {
+        events = interest->second;
+      }
+    }
+    auto found = armed_.find(d);
+    if (found != armed_.end()) {
+      if (found->second.events == events) {
+        return true;
+      }
+      Disarm(d);
+    }
+    if (events == 0) {
+      return true;
+    }
+    uint64_t user_data = next_user_data_++;
+    if (!QueuePollAdd(d->fd(), events, user_data)) {
+      return false;
+    }
+    armed_[d] = ArmedPoll{user_data, events};
+    user_data_to_descriptor_[user_data] = d;
+    return true;
+  }
+
+  // Forgets the armed poll on |d| and queues its cancellation.
+  void Disarm(SocketDescriptor* d) {
+    auto found = armed_.find(d);
+    if (found == armed_.end()) {
+      return;
+    }
+    user_data_to_descriptor_.erase(found->second.user_data);
+    canceled_.push_back(found->second.user_data);
+    armed_.erase(found);
+  }
+
+  static absl::once_flag s_init_once_;
+
+  // Accessed only on the polling thread.
+  IoUring ring_;
+  std::vector<IoUring::Completion> completions_;
+  std::vector<Event> events_;
+
+  // Accessed with lock held.
+  // Poll events registered by RegisterPollEvent.
+  absl::flat_hash_map<SocketDescriptor*, uint32_t> interests_;
+  absl::flat_hash_set<SocketDescriptor*> dirty_;
+  absl::flat_hash_map<SocketDescriptor*, ArmedPoll> armed_;
+  absl::flat_hash_map<uint64_t, SocketDescriptor*> user_data_to_descriptor_;
+  std::vector<uint64_t> canceled_;
+  absl::flat_hash_set<SocketDescriptor*> timeout_waiters_;
+  uint64_t next_user_data_;
+  bool poll_breaker_armed_;
+
+  DISALLOW_COPY_AND_ASSIGN(IoUringDescriptorPoller);
+};
+
+absl::once_flag IoUringDescriptorPoller::s_init_once_;
+
+bool CheckIoUringSupported() {
+  IoUring ring;
+  std::string err;
+  if (!ring.Init(2, &err)) {
+    LOG(WARNING) << "io_uring is not available: " << err;
+    return false;
+  }
+  return true;
+}
+
+}  // anonymous namespace
+
+bool IsIoUringDescriptorPollerSupported() {
+  static const bool supported = CheckIoUringSupported();
+  return supported;
+}
+
+std::unique_ptr<DescriptorPoller> NewIoUringDescriptorPoller(
+    std::unique_ptr<SocketDescriptor> poll_breaker,
+    ScopedSocket&& poll_signaler) {
+  return absl::make_unique<IoUringDescriptorPoller>(std::move(poll_breaker),
+                                                    std::move(poll_signaler));
+}
+
+#else  // !GOMA_HAVE_IO_URING
+
+bool IsIoUringDescriptorPollerSupported() {
+  static absl::once_flag log_once;
+  absl::call_once(log_once, []() {
+    LOG(WARNING) << "io_uring is not supported in this build";
+  });
+  return false;
+}
+
+std::unique_ptr<DescriptorPoller> NewIoUringDescriptorPoller(
+    std::unique_ptr<SocketDescriptor> poll_breaker ALLOW_UNUSED,
+    ScopedSocket&& poll_signaler ALLOW_UNUSED) {
+  LOG(FATAL) << "io_uring is not supported in this build";
+  return nullptr;
+}
+
+#endif  // GOMA_HAVE_IO_URING
+
+}  // namespace devtools_goma
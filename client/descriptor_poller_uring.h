@@ -0,0 +1,30 @@
+// Copyright 2021 The Goma Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef DEVTOOLS_GOMA_CLIENT_DESCRIPTOR_POLLER_URING_H_
+#define DEVTOOLS_GOMA_CLIENT_DESCRIPTOR_POLLER_URING_H_
+
+#include <memory>
+
+#include "descriptor_poller.h"
+#include "scoped_fd.h"
+
+namespace devtools_goma {
+
+class SocketDescriptor;
+
+// Returns true if the running kernel provides io_uring features required by
+// the io_uring based DescriptorPoller.
+// The result is computed once and cached.
+bool IsIoUringDescriptorPollerSupported();
+
+// Creates io_uring based DescriptorPoller.
+// IsIoUringDescriptorPollerSupported() must return true.
+std::unique_ptr<DescriptorPoller> NewIoUringDescriptorPoller(
+    std::unique_ptr<SocketDescriptor> poll_breaker,
+    ScopedSocket&& poll_signaler);
+
+}  // namespace devtools_goma
+
+#endif  // DEVTOOLS_GOMA_CLIENT_DESCRIPTOR_POLLER_URING_H_
@@ -0,0 +1,25 @@
+// Copyright 2021 The Goma Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "file_stat_lru_cache.h"
+
+#include "glog/logging.h"
+
+namespace devtools_goma {
+
+bool IsCacheableFileStat(absl::string_view what,
+                         absl::string_view path,
+                         const FileStat& file_stat) {
+  if (!file_stat.IsValid()) {
+    VLOG(1) << what << " is not cacheable since " << path << " is not found";
+    return false;
+  }
+  if (file_stat.CanBeStale()) {
+    VLOG(1) << what << " is not cacheable since " << path << " can be stale";
+    return false;
+  }
+  return true;
+}
+
+}  // namespace devtools_goma
@@ -0,0 +1,152 @@
+// Copyright 2021 The Goma Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef DEVTOOLS_GOMA_CLIENT_FILE_STAT_LRU_CACHE_H_
+#define DEVTOOLS_GOMA_CLIENT_FILE_STAT_LRU_CACHE_H_
+
+#include <string>
+#include <utility>
+
+#include "absl/strings/string_view.h"
+#include "atomic_stats_counter.h"
+#include "autolock_timer.h"
+#include "file_stat.h"
+#include "linked_unordered_map.h"
+#include "lockhelper.h"
+
+namespace devtools_goma {
+
+// Returns true if |file_stat| of |path| can be used to validate a cache
+// entry made from the file, i.e. the file exists and can't be modified
+// without changing its FileStat.
+// Otherwise, logs that |what| is not cacheable, and returns false.
+bool IsCacheableFileStat(absl::string_view what,
+                         absl::string_view path,
+                         const FileStat& file_stat);
+
+// FileStatLruCache is a thread-safe LRU cache keyed by string, whose entries
+// are validated by FileStat of files they were made from.
+//
+// An entry made from one file is inserted with the FileStat of the file,
+// and is looked up with the current FileStat of the file.
+// An entry made from several files is inserted without FileStat, and is
+// looked up with a validator that checks the files in the entry.
+template <typename Value>
+class FileStatLruCache {
+ public:
+  // |name| is what the entries are, and is used for logging.
+  // If the number of entries exceeds |max_entries|, the least recently used
+  // entry will be evicted.
+  FileStatLruCache(std::string name, size_t max_entries)
+      : name_(std::move(name)), max_entries_(max_entries) {}
+
+  FileStatLruCache(const FileStatLruCache&) = delete;
+  void operator=(const FileStatLruCache&) = delete;
+
+  // Returns true and sets |value| if |key| was inserted with |file_stat|.
+  bool Lookup(const std::string& key, const FileStat& file_stat, Value* value)
+      LOCKS_EXCLUDED(mu_) {
+    AUTOLOCK(lock, &mu_);
+    auto it = entries_.find(key);
+    if (it == entries_.end() || it->second.file_stat != file_stat) {
+      miss_.Add(1);
+      return false;
+    }
+    entries_.MoveToBack(it);
+    *value = it->second.value;
+    hit_.Add(1);
+    return true;
+  }
+
+  // Returns true and sets |value| if |key| is in the cache and
+  // |is_valid(*value)| returns true.
+  // |is_valid| is called without lock, so it can check files on disk.
+  template <typename IsValid>
+  bool Lookup(const std::string& key, const IsValid& is_valid, Value* value)
+      LOCKS_EXCLUDED(mu_) {
+    {
+      AUTOLOCK(lock, &mu_);
+      auto it = entries_.find(key);
+      if (it == entries_.end()) {
+        miss_.Add(1);
+        return false;
+      }
+      entries_.MoveToBack(it);
+      *value = it->second.value;
+    }
+    if (!is_valid(*value)) {
+      invalidated_.Add(1);
+      return false;
+    }
+    hit_.Add(1);
+    return true;
+  }
+
+  // Stores |value| for |key|. |file_stat| is FileStat of the file |value|
+  // was made from, and |key| is used as its path in logging.
+  // Returns false if |file_stat| can't be used to validate the entry.
+  bool Insert(const std::string& key, const FileStat& file_stat, Value value)
+      LOCKS_EXCLUDED(mu_) {
+    if (!IsCacheableFileStat(name_, key, file_stat)) {
+      return false;
+    }
+    InsertUnchecked(key, file_stat, std::move(value));
+    return true;
+  }
+
+  // Stores |value| for |key|, to be validated by Lookup with a validator.
+  // The caller must check the files |value| was made from are cacheable.
+  void Insert(const std::string& key, Value value) LOCKS_EXCLUDED(mu_) {
+    InsertUnchecked(key, FileStat(), std::move(value));
+  }
+
+  // Stores |value| for |key| with |file_stat| without checking it, e.g. for
+  // an entry loaded from a cache file.
+  void InsertUnchecked(const std::string& key, const FileStat& file_stat,
+                       Value value) LOCKS_EXCLUDED(mu_) {
+    AUTOLOCK(lock, &mu_);
+    entries_.emplace_back(key, Entry{file_stat, std::move(value)});
+    while (entries_.size() > max_entries_) {
+      entries_.pop_front();
+    }
+  }
+
+  // Calls |f(key, file_stat, value)| for each entry, from the least
+  // recently used, e.g. to save entries in a cache file.
+  template <typename F>
+  void ForEach(const F& f) const LOCKS_EXCLUDED(mu_) {
+    AUTOLOCK(lock, &mu_);
+    for (const auto& it : entries_) {
+      f(it.first, it.second.file_stat, it.second.value);
+    }
+  }
+
+  size_t size() const LOCKS_EXCLUDED(mu_) {
+    AUTOLOCK(lock, &mu_);
+    return entries_.size();
+  }
+  int64_t hit() const { return hit_.value(); }
+  int64_t miss() const { return miss_.value(); }
+  int64_t invalidated() const { return invalidated_.value(); }
+
+ private:
+  struct Entry {
+    FileStat file_stat;
+    Value value;
+  };
+
+  const std::string name_;
+  const size_t max_entries_;
+
+  mutable Lock mu_;
+  LinkedUnorderedMap<std::string, Entry> entries_ GUARDED_BY(mu_);
+
+  StatsCounter hit_;
+  StatsCounter miss_;
+  StatsCounter invalidated_;
+};
+
+}  // namespace devtools_goma
+
+#endif  // DEVTOOLS_GOMA_CLIENT_FILE_STAT_LRU_CACHE_H_
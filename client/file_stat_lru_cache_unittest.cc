@@ -0,0 +1,139 @@
+// Copyright 2021 The Goma Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "file_stat_lru_cache.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "client/unittest_util.h"
+#include "gtest/gtest.h"
+
+namespace devtools_goma {
+
+class FileStatLruCacheTest : public testing::Test {
+ public:
+  FileStatLruCacheTest()
+      : tmpdir_util_(absl::make_unique<TmpdirUtil>("file_stat_lru_cache")) {}
+
+ protected:
+  std::unique_ptr<TmpdirUtil> tmpdir_util_;
+};
+
+TEST_F(FileStatLruCacheTest, LookupAndInsert) {
+  FileStatLruCache<std::string> cache("test value", 10);
+  const std::string foo = tmpdir_util_->CreateTmpFileWithOldMtime("foo", "a");
+
+  std::string value;
+  EXPECT_FALSE(cache.Lookup(foo, FileStat(foo), &value));
+  EXPECT_EQ(1, cache.miss());
+
+  EXPECT_TRUE(cache.Insert(foo, FileStat(foo), "foo value"));
+  EXPECT_EQ(1U, cache.size());
+  ASSERT_TRUE(cache.Lookup(foo, FileStat(foo), &value));
+  EXPECT_EQ("foo value", value);
+  EXPECT_EQ(1, cache.hit());
+
+  // Modified.
+  tmpdir_util_->CreateTmpFileWithOldMtime("foo", "modified a");
+  EXPECT_FALSE(cache.Lookup(foo, FileStat(foo), &value));
+  EXPECT_EQ(2, cache.miss());
+
+  // Inserting the same key replaces the entry.
+  EXPECT_TRUE(cache.Insert(foo, FileStat(foo), "modified foo value"));
+  EXPECT_EQ(1U, cache.size());
+  ASSERT_TRUE(cache.Lookup(foo, FileStat(foo), &value));
+  EXPECT_EQ("modified foo value", value);
+}
+
+TEST_F(FileStatLruCacheTest, NotCacheable) {
+  FileStatLruCache<std::string> cache("test value", 10);
+
+  const std::string missing = tmpdir_util_->FullPath("missing");
+  EXPECT_FALSE(IsCacheableFileStat("test value", missing, FileStat(missing)));
+  EXPECT_FALSE(cache.Insert(missing, FileStat(missing), "missing value"));
+
+  // Just created file can be modified without changing FileStat.
+  tmpdir_util_->CreateTmpFile("new", "new");
+  const std::string path = tmpdir_util_->FullPath("new");
+  EXPECT_FALSE(IsCacheableFileStat("test value", path, FileStat(path)));
+  EXPECT_FALSE(cache.Insert(path, FileStat(path), "new value"));
+
+  EXPECT_EQ(0U, cache.size());
+}
+
+TEST_F(FileStatLruCacheTest, LookupWithValidator) {
+  FileStatLruCache<std::vector<std::string>> cache("test value", 10);
+  const std::string foo = tmpdir_util_->CreateTmpFileWithOldMtime("foo", "a");
+  const FileStat foo_stat(foo);
+  auto is_valid = [&foo, &foo_stat](const std::vector<std::string>& value) {
+    return FileStat(foo) == foo_stat;
+  };
+
+  std::vector<std::string> value;
+  EXPECT_FALSE(cache.Lookup("key", is_valid, &value));
+  EXPECT_EQ(1, cache.miss());
+
+  cache.Insert("key", {"foo", "bar"});
+  ASSERT_TRUE(cache.Lookup("key", is_valid, &value));
+  EXPECT_EQ(std::vector<std::string>({"foo", "bar"}), value);
+  EXPECT_EQ(1, cache.hit());
+
+  tmpdir_util_->CreateTmpFileWithOldMtime("foo", "modified a");
+  EXPECT_FALSE(cache.Lookup("key", is_valid, &value));
+  EXPECT_EQ(1, cache.invalidated());
+  EXPECT_EQ(1, cache.miss());
+}
+
+TEST_F(FileStatLruCacheTest, Evict) {
+  FileStatLruCache<std::string> cache("test value", 2);
+  const std::string a = tmpdir_util_->CreateTmpFileWithOldMtime("a", "a");
+  const std::string b = tmpdir_util_->CreateTmpFileWithOldMtime("b", "b");
+  const std::string c = tmpdir_util_->CreateTmpFileWithOldMtime("c", "c");
+
+  std::string value;
+  EXPECT_TRUE(cache.Insert(a, FileStat(a), "a value"));
+  EXPECT_TRUE(cache.Insert(b, FileStat(b), "b value"));
+  // Makes |a| recently used.
+  EXPECT_TRUE(cache.Lookup(a, FileStat(a), &value));
+  EXPECT_TRUE(cache.Insert(c, FileStat(c), "c value"));
+
+  EXPECT_EQ(2U, cache.size());
+  EXPECT_TRUE(cache.Lookup(a, FileStat(a), &value));
+  EXPECT_FALSE(cache.Lookup(b, FileStat(b), &value));
+  EXPECT_TRUE(cache.Lookup(c, FileStat(c), &value));
+}
+
+TEST_F(FileStatLruCacheTest, ForEach) {
+  FileStatLruCache<std::string> cache("test value", 10);
+  const std::string a = tmpdir_util_->CreateTmpFileWithOldMtime("a", "a");
+  const std::string b = tmpdir_util_->CreateTmpFileWithOldMtime("b", "b");
+
+  EXPECT_TRUE(cache.Insert(a, FileStat(a), "a value"));
+  EXPECT_TRUE(cache.Insert(b, FileStat(b), "b value"));
+  std::string value;
+  // Makes |a| recently used.
+  EXPECT_TRUE(cache.Lookup(a, FileStat(a), &value));
+
+  // From the least recently used, so that InsertUnchecked in the same order
+  // keeps it.
+  FileStatLruCache<std::string> copied("test value", 10);
+  std::vector<std::string> keys;
+  cache.ForEach([&keys, &copied](const std::string& key,
+                                 const FileStat& file_stat,
+                                 const std::string& value) {
+    keys.push_back(key);
+    copied.InsertUnchecked(key, file_stat, value);
+  });
+  EXPECT_EQ(std::vector<std::string>({b, a}), keys);
+
+  ASSERT_TRUE(copied.Lookup(a, FileStat(a), &value));
+  EXPECT_EQ("a value", value);
+  ASSERT_TRUE(copied.Lookup(b, FileStat(b), &value));
+  EXPECT_EQ("b value", value);
+}
+
+}  // namespace devtools_goma
@@ -12,6 +12,7 @@
 #include "compiler_specific.h"
 #include "file_helper.h"
 #include "goma_file_http.h"
+#include "lib/goma_data_util.h"
 MSVC_PUSH_DISABLE_WARNING_FOR_PROTO()
 #include "lib/goma_data.pb.h"
 MSVC_POP_WARNING()
@@ -256,4 +257,72 @@ TEST(FileBlobClient, ExampleDownloadEmbedded) {
             info_string.content);
 }
 
+// FakeStoreFileServiceClient responds to async store requests with
+// at most |max_hash_keys| hash keys per request.
+class FakeStoreFileServiceClient : public ExampleFileServiceHttpClient {
+ public:
+  class StoreTask : public AsyncTask<StoreFileReq, StoreFileResp> {
+   public:
+    explicit StoreTask(FakeStoreFileServiceClient* client) : client_(client) {}
+
+    void Run() override {
+      for (int i = 0; i < req_.blob_size() && i < client_->max_hash_keys_;
+           ++i) {
+        resp_.add_hash_key(ComputeFileBlobHashKey(req_.blob(i)));
+        ++client_->num_stored_;
+      }
+    }
+    void Wait() override {}
+    bool IsSuccess() const override { return true; }
+
+   private:
+    FakeStoreFileServiceClient* client_;
+  };
+
+  explicit FakeStoreFileServiceClient(int max_hash_keys)
+      : max_hash_keys_(max_hash_keys) {}
+
+  std::unique_ptr<AsyncTask<StoreFileReq, StoreFileResp>>
+  NewAsyncStoreFileTask() override {
+    return absl::make_unique<StoreTask>(this);
+  }
+
+  int num_stored() const { return num_stored_; }
+
+ private:
+  const int max_hash_keys_;
+  int num_stored_ = 0;
+};
+
+class FileServiceClientStoreChunksTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    tmp_file_ = absl::make_unique<ScopedTmpFile>("chunks");
+    ASSERT_TRUE(tmp_file_->valid());
+    // 6 chunks, which are sent in 2 requests.
+    const std::string content(5 * 2 * 1024 * 1024 + 1, 'x');
+    ASSERT_EQ(static_cast<ssize_t>(content.size()),
+              tmp_file_->Write(content.data(), content.size()));
+    ASSERT_TRUE(tmp_file_->Close());
+  }
+
+  std::unique_ptr<ScopedTmpFile> tmp_file_;
+};
+
+TEST_F(FileServiceClientStoreChunksTest, StoreMultipleChunks) {
+  FakeStoreFileServiceClient client(5);
+  FileBlob blob;
+  EXPECT_TRUE(client.CreateFileBlob(tmp_file_->filename(), true, &blob));
+  EXPECT_EQ(FileBlob::FILE_META, blob.blob_type());
+  EXPECT_EQ(6, blob.hash_key_size());
+  EXPECT_EQ(6, client.num_stored());
+}
+
+TEST_F(FileServiceClientStoreChunksTest, FailIfSomeChunksAreNotStored) {
+  // Only the first chunk of each request is stored.
+  FakeStoreFileServiceClient client(1);
+  FileBlob blob;
+  EXPECT_FALSE(client.CreateFileBlob(tmp_file_->filename(), true, &blob));
+}
+
 }  // namespace devtools_goma
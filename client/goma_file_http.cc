@@ -94,6 +94,8 @@ FileServiceHttpClient::WithRequesterInfoAndTraceId(
   cloned->requester_info_ = absl::make_unique<RequesterInfo>();
   *cloned->requester_info_ = requester_info;
   cloned->trace_id_ = trace_id;
+  cloned->SetChunkConcurrency(max_in_flight_chunk_tasks_per_file_,
+                              chunk_concurrency_limiter_);
   return cloned;
 }
 
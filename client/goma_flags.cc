@@ -50,6 +50,15 @@ static int NumDefaultProxyHttpThreads() {
   return 4;
 }
 
+static int NumDefaultFileIOThreads() {
+  // File I/O mostly waits for disks, so it does not need many threads.
+  int num_cpus = devtools_goma::GetNumCPUs();
+  if (num_cpus > 0)
+    return std::max(num_cpus / 2, 2);
+
+  return 4;
+}
+
 static int MaxSubProcsLow() {
   int cpus = devtools_goma::GetNumCPUs();
   if (cpus > 0)
@@ -230,11 +239,22 @@ GOMA_DEFINE_AUTOCONF_int32(COMPILER_PROXY_HTTP_THREADS,
                            "http/ipc request.");
 GOMA_DEFINE_AUTOCONF_int32(INCLUDE_PROCESSOR_THREADS, NumDefaultProxyThreads,
                            "Number of threads for include processor.");
+GOMA_DEFINE_AUTOCONF_int32(FILE_IO_THREADS, NumDefaultFileIOThreads,
+                           "Number of threads for blocking file I/O, "
+                           "i.e. reading/hashing input files, writing output "
+                           "files and local output cache. "
+                           "If 0, file I/O runs on threads that also handle "
+                           "network I/O.");
 #ifdef _WIN32
 #define DEFAULT_MAX_OVERCOMIT_INCOMING_SOCKETS 64
 #else
 #define DEFAULT_MAX_OVERCOMIT_INCOMING_SOCKETS 0
 #endif
+#ifdef __linux__
+GOMA_DEFINE_bool(COMPILER_PROXY_USE_IO_URING, false,
+                 "Experimental: Use io_uring to poll descriptors in worker "
+                 "threads. Falls back to epoll if io_uring is not available.");
+#endif
 GOMA_DEFINE_int32(MAX_OVERCOMMIT_INCOMING_SOCKETS,
                   DEFAULT_MAX_OVERCOMIT_INCOMING_SOCKETS,
                   "Number of overcommitted incoming sockets per threads on "
@@ -314,12 +334,20 @@ GOMA_DEFINE_AUTOCONF_int32(BURST_MAX_SUBPROCS_HEAVY, MaxBurstSubProcsHeavy,
                            "when remote server is not available.");
 GOMA_DEFINE_int32(MAX_SUBPROCS_PENDING, 3,
                   "Threshold to prefer local run to remote goma.");
+GOMA_DEFINE_int32(COMPILER_FLAGS_TEMPLATE_CACHE_SIZE, 1024,
+                  "The max number of parsed compiler flags kept to reuse for "
+                  "commands that differ only in input and output files. "
+                  "0 disables the cache.");
 // TODO: autoconf
 GOMA_DEFINE_int32(MAX_SUM_OUTPUT_SIZE_IN_MB, 64,
                   "The max size for output buffer in MB.");
 GOMA_DEFINE_bool(STORE_LOCAL_RUN_OUTPUT, false,
                  "Store local run output in goma cache.");
 GOMA_DEFINE_bool(ENABLE_REMOTE_LINK, false, "Enable remote link.");
+GOMA_DEFINE_bool(ARFILE_USE_MMAP, false,
+                 "Experimental: Map archive files to memory to upload "
+                 "their entries without copying. The compiler_proxy may "
+                 "crash if an archive file is truncated while uploading.");
 GOMA_DEFINE_bool(USE_RELATIVE_PATHS_IN_ARGV, false,
                  "Use relative paths in argv, except system directories.");
 GOMA_DEFINE_bool(SEND_EXPECTED_OUTPUTS,
@@ -343,6 +371,13 @@ GOMA_DEFINE_int32(MULTI_STORE_THRESHOLD_SIZE_IN_CALL, 12 * 1024 * 1024,
                   "Threshold size to issue StoreFileReq");
 GOMA_DEFINE_int32(MULTI_STORE_PENDING_MS, 100,
                   "Pending time in ms to issue StoreFileReq.");
+GOMA_DEFINE_int32(FILE_CHUNK_CONCURRENCY_PER_FILE, 4,
+                  "Max number of in-flight chunk store/lookup requests "
+                  "for each large (chunked) file.");
+GOMA_DEFINE_int32(FILE_CHUNK_CONCURRENCY, 32,
+                  "Max number of in-flight chunk store/lookup requests "
+                  "for all large (chunked) files. Each file can always have "
+                  "one in-flight request regardless of this limit.");
 GOMA_DEFINE_int32(NUM_LOG_IN_SAVE_LOG, 512,
                   "Number of ExecLog in SaveLogReq");
 GOMA_DEFINE_int32(LOG_PENDING_MS, 30 * 1000,
@@ -362,14 +397,67 @@ GOMA_DEFINE_bool(ENABLE_GCH_HACK, false,
 GOMA_DEFINE_int32(MAX_INCLUDE_CACHE_ENTRIES,
                   140000,
                   "The max count of include cache.");
+GOMA_DEFINE_string(INCLUDE_CACHE_DIR, "",
+                   "Directory to keep parsed include files across "
+                   "compiler_proxy restarts. If empty, include cache is "
+                   "kept only in memory. "
+                   "If not absolute path, it will be in GOMA_CACHE_DIR.");
+GOMA_DEFINE_int32(INCLUDE_CACHE_DIR_MAX_SIZE_IN_MB, 1024,
+                  "The max size of GOMA_INCLUDE_CACHE_DIR. Older entries "
+                  "are removed at compiler_proxy startup if the total size "
+                  "exceeds this.");
+GOMA_DEFINE_int32(INCLUDE_PREFETCH_THREADS, 0,
+                  "Experimental: Number of threads to read and parse "
+                  "include files speculatively while include processor "
+                  "walks a translation unit. If 0, include files are not "
+                  "prefetched.");
 GOMA_DEFINE_int32(MAX_LIST_DIR_CACHE_ENTRY_NUM, 32768,
                   "The entry limit in list dir cache.");
+GOMA_DEFINE_int32(MAX_LINKER_DRIVER_DUMP_CACHE_ENTRIES,
+                  1024,
+                  "The max number of linker driver (gcc -###) outputs kept "
+                  "for links. 0 disables the cache.");
+GOMA_DEFINE_int32(MAX_DYNAMIC_DEP_INDEX_ENTRIES,
+                  8192,
+                  "The max number of shared libraries and executables whose "
+                  "needed libraries are kept in memory. 0 disables the "
+                  "index.");
+GOMA_DEFINE_string(DYNAMIC_DEP_INDEX_FILE, "",
+                   "Filename to save needed libraries of shared libraries "
+                   "and executables. If empty, the index is not saved. "
+                   "If not absolute path, it will be in GOMA_CACHE_DIR.");
+GOMA_DEFINE_int32(MAX_JAR_MANIFEST_CACHE_ENTRIES,
+                  4096,
+                  "The max number of .jar files whose MANIFEST class path "
+                  "is kept for javac. 0 disables the cache.");
+GOMA_DEFINE_int32(MAX_RUSTC_DEPS_CACHE_ENTRIES,
+                  4096,
+                  "The max number of crates whose required files listed by "
+                  "rustc --emit=dep-info are kept. 0 disables the cache.");
+GOMA_DEFINE_int32(MAX_DART_IMPORT_CACHE_ENTRIES,
+                  32768,
+                  "The max number of dart sources whose imports are kept "
+                  "for dart_analyzer. 0 disables the cache.");
+GOMA_DEFINE_int32(DART_IMPORT_THREADS,
+                  2,
+                  "Number of threads to read dart sources in parallel while "
+                  "resolving imports for dart_analyzer. Used only if "
+                  "MAX_DART_IMPORT_CACHE_ENTRIES > 0.");
 GOMA_DEFINE_bool(ENABLE_REMOTE_CLANG_MODULES,
                  false,
                  "Experimental: Enable clang modules (-fmodules) support.");
 GOMA_DEFINE_int32(MAX_MODULEMAP_CACHE_ENTRIES,
                   32768,
                   "The max number of entries for modulemap cache.");
+GOMA_DEFINE_string(MODULEMAP_CACHE_FILE, "",
+                   "Filename to save parsed module map files. If empty, "
+                   "they are not saved. "
+                   "If not absolute path, it will be in GOMA_CACHE_DIR.");
+GOMA_DEFINE_int32(MAX_CPP_PREAMBLE_CACHE_ENTRIES,
+                  256,
+                  "The max number of C/C++ parser states kept after "
+                  "processing predefined macros, command line macros and "
+                  "forced include files. 0 disables the cache.");
 GOMA_DEFINE_string(CONTENT_TYPE_FOR_PROTOBUF, "binary/x-protocol-buffer",
                    "Content-Type for goma's HttpRPC requests.");
 GOMA_DEFINE_bool(BACKEND_SOFT_STICKINESS, false,
@@ -467,6 +555,14 @@ GOMA_DEFINE_int32(COMPILER_INFO_CACHE_HOLDING_TIME_SEC, 60 * 60 * 24 * 30,
 GOMA_DEFINE_string(DUMP_STATS_FILE, "",
                    "Filename to dump stats at the end of compiler_proxy."
                    "If empty, nothing will be dumped.");
+GOMA_DEFINE_int32(MAX_TRACE_EVENTS, 200000,
+                  "The max number of trace events of recently finished "
+                  "compile tasks kept for /api/tracez and "
+                  "DUMP_TRACE_EVENT_FILE. 0 disables recording.");
+GOMA_DEFINE_string(DUMP_TRACE_EVENT_FILE, "",
+                   "Filename to dump trace events in Chrome trace event "
+                   "format at the end of compiler_proxy. "
+                   "If empty, nothing will be dumped.");
 #ifdef HAVE_COUNTERZ
 GOMA_DEFINE_string(DUMP_COUNTERZ_FILE, "",
                    "Filename to dump counterz stat at the end of "
@@ -491,6 +587,11 @@ GOMA_DEFINE_int32(LOCAL_OUTPUT_CACHE_THRESHOLD_ITEMS, 80000,
                   "When LocalOutputCache garbage collection run, entries will "
                   "be removed until the number of entries are below of this "
                   "value");
+GOMA_DEFINE_bool(LOCAL_OUTPUT_CACHE_USE_HARDLINK, false,
+                 "If true, LocalOutputCache hits are materialized by hard "
+                 "links to cache files when possible. Output files then share "
+                 "inode with cache files, so tools modifying outputs in place "
+                 "would break the cache.");
 
 #ifdef _WIN32
 #define DEFAULT_CTL_SCRIPT_NAME "goma_ctl.bat"
@@ -0,0 +1,361 @@
+// Copyright 2021 The Goma Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "hdr_histogram.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <limits>
+#include <sstream>
+
+#include "absl/strings/str_cat.h"
+#include "compiler_specific.h"
+#include "glog/logging.h"
+MSVC_PUSH_DISABLE_WARNING_FOR_PROTO()
+#include "lib/goma_stats.pb.h"
+MSVC_POP_WARNING()
+
+namespace devtools_goma {
+
+namespace {
+
+constexpr int64_t kGraphWidth = 50;
+constexpr int64_t kMaxValue = (int64_t{1} << HdrHistogram::kMaxValueBits) - 1;
+constexpr int kHalfSubBucketCount = 1 << (HdrHistogram::kSubBucketBits - 1);
+
+// Returns the position of the most significant bit of |value| > 0.
+int MostSignificantBit(uint64_t value) {
+  int n = 0;
+  for (int shift = 32; shift > 0; shift /= 2) {
+    if (value >> shift) {
+      value >>= shift;
+      n += shift;
+    }
+  }
+  return n;
+}
+
+// Returns the bucket of Histogram for |value|, i.e.
+// 0 for [0, 1), n for [2^(n-1), 2^n).
+int Log2Bucket(int64_t value) {
+  if (value < 1) {
+    return 0;
+  }
+  return MostSignificantBit(value) + 1;
+}
+
+// Returns counts in Histogram's buckets, up to the bucket of max.
+std::vector<int64_t> Log2Buckets(const HdrHistogram::Snapshot& snapshot) {
+  std::vector<int64_t> log2_buckets(Log2Bucket(snapshot.max) + 1);
+  for (int i = 0; i < HdrHistogram::kNumBuckets; ++i) {
+    if (snapshot.buckets[i] == 0) {
+      continue;
+    }
+    // A bucket of HdrHistogram doesn't span powers of two.
+    const int log2_bucket = Log2Bucket(HdrHistogram::BucketLowerBound(i));
+    if (log2_bucket >= static_cast<int>(log2_buckets.size())) {
+      // Values added while taking the snapshot.
+      log2_buckets.resize(log2_bucket + 1);
+    }
+    log2_buckets[log2_bucket] += snapshot.buckets[i];
+  }
+  return log2_buckets;
+}
+
+int64_t StandardDeviation(int64_t count, int64_t sum, double sum_of_squares) {
+  if (count <= 0) {
+    return 0;
+  }
+  double squared_mean = static_cast<double>(sum) * sum / count / count;
+  double variance = sum_of_squares / count - squared_mean;
+  if (variance < 0) {
+    // Rounding error, or values added while taking the snapshot.
+    return 0;
+  }
+  return static_cast<int64_t>(std::sqrt(variance));
+}
+
+void AppendPercentiles(const HdrHistogram::Snapshot& snapshot,
+                       std::ostream* ss) {
+  *ss << " p50: " << snapshot.Percentile(50)
+      << " p90: " << snapshot.Percentile(90)
+      << " p99: " << snapshot.Percentile(99)
+      << " p999: " << snapshot.Percentile(99.9);
+}
+
+}  // namespace
+
+int64_t HdrHistogram::Snapshot::standard_deviation() const {
+  return devtools_goma::StandardDeviation(count, sum, sum_of_squares);
+}
+
+int64_t HdrHistogram::Snapshot::Percentile(double percentile) const {
+  if (count <= 0) {
+    return 0;
+  }
+  int64_t rank = static_cast<int64_t>(std::ceil(percentile / 100 * count));
+  rank = std::max<int64_t>(rank, 1);
+  int64_t seen = 0;
+  for (int i = 0; i < kNumBuckets; ++i) {
+    seen += buckets[i];
+    if (seen < rank) {
+      continue;
+    }
+    // Use the middle of the bucket, which is within the range of recorded
+    // values.
+    const int64_t lower = BucketLowerBound(i);
+    const int64_t upper =
+        i + 1 < kNumBuckets ? BucketLowerBound(i + 1) - 1 : kMaxValue;
+    const int64_t value = lower + (upper - lower) / 2;
+    return std::min(std::max(value, min), max);
+  }
+  return max;
+}
+
+HdrHistogram::Counts::Counts() {
+  Clear();
+}
+
+void HdrHistogram::Counts::Add(int64_t value, int index) {
+  count.fetch_add(1, std::memory_order_relaxed);
+  sum.fetch_add(value, std::memory_order_relaxed);
+  const double square = static_cast<double>(value) * value;
+  double old_sum_of_squares = sum_of_squares.load(std::memory_order_relaxed);
+  while (!sum_of_squares.compare_exchange_weak(old_sum_of_squares,
+                                               old_sum_of_squares + square,
+                                               std::memory_order_relaxed)) {
+  }
+  int64_t old_min = min.load(std::memory_order_relaxed);
+  while (value < old_min &&
+         !min.compare_exchange_weak(old_min, value,
+                                    std::memory_order_relaxed)) {
+  }
+  int64_t old_max = max.load(std::memory_order_relaxed);
+  while (value > old_max &&
+         !max.compare_exchange_weak(old_max, value,
+                                    std::memory_order_relaxed)) {
+  }
+  buckets[index].fetch_add(1, std::memory_order_relaxed);
+}
+
+void HdrHistogram::Counts::Clear() {
+  count.store(0, std::memory_order_relaxed);
+  sum.store(0, std::memory_order_relaxed);
+  sum_of_squares.store(0, std::memory_order_relaxed);
+  min.store(std::numeric_limits<int64_t>::max(), std::memory_order_relaxed);
+  max.store(std::numeric_limits<int64_t>::min(), std::memory_order_relaxed);
+  for (auto& bucket : buckets) {
+    bucket.store(0, std::memory_order_relaxed);
+  }
+}
+
+void HdrHistogram::Counts::AddTo(Snapshot* snapshot) const {
+  const int64_t n = count.load(std::memory_order_relaxed);
+  if (n == 0) {
+    return;
+  }
+  const int64_t min_value = min.load(std::memory_order_relaxed);
+  const int64_t max_value = max.load(std::memory_order_relaxed);
+  if (snapshot->count == 0) {
+    snapshot->min = min_value;
+    snapshot->max = max_value;
+  } else {
+    snapshot->min = std::min(snapshot->min, min_value);
+    snapshot->max = std::max(snapshot->max, max_value);
+  }
+  snapshot->count += n;
+  snapshot->sum += sum.load(std::memory_order_relaxed);
+  snapshot->sum_of_squares += sum_of_squares.load(std::memory_order_relaxed);
+  for (int i = 0; i < kNumBuckets; ++i) {
+    snapshot->buckets[i] += buckets[i].load(std::memory_order_relaxed);
+  }
+}
+
+HdrHistogram::HdrHistogram(absl::Duration window, int num_slots)
+    : slot_duration_(window / num_slots),
+      num_slots_(num_slots),
+      slots_(new Slot[num_slots]) {
+  CHECK_GT(num_slots, 0);
+  CHECK_GT(slot_duration_, absl::ZeroDuration());
+}
+
+HdrHistogram::~HdrHistogram() = default;
+
+// static
+int HdrHistogram::BucketIndex(int64_t value) {
+  value = std::min(std::max<int64_t>(value, 0), kMaxValue);
+  if (value < (1 << kSubBucketBits)) {
+    return static_cast<int>(value);
+  }
+  const int msb = MostSignificantBit(value);
+  const int shift = msb - (kSubBucketBits - 1);
+  // |sub_bucket| is in [kHalfSubBucketCount, 2 * kHalfSubBucketCount).
+  const int sub_bucket = static_cast<int>(value >> shift);
+  return (1 << kSubBucketBits) + (msb - kSubBucketBits) * kHalfSubBucketCount +
+         (sub_bucket - kHalfSubBucketCount);
+}
+
+// static
+int64_t HdrHistogram::BucketLowerBound(int index) {
+  if (index < (1 << kSubBucketBits)) {
+    return index;
+  }
+  index -= 1 << kSubBucketBits;
+  const int msb = index / kHalfSubBucketCount + kSubBucketBits;
+  const int64_t sub_bucket = index % kHalfSubBucketCount + kHalfSubBucketCount;
+  return sub_bucket << (msb - (kSubBucketBits - 1));
+}
+
+int64_t HdrHistogram::Epoch(absl::Time now) const {
+  return absl::ToUnixNanos(now) / absl::ToInt64Nanoseconds(slot_duration_);
+}
+
+void HdrHistogram::AddAt(int64_t value, absl::Time now) {
+  if (value < 0) {
+    LOG(WARNING) << "value is negative:" << value << " for " << name_;
+    value = 0;
+  }
+  // Clamp the value to the range of buckets, so that min, max and sum don't
+  // have values the buckets can't represent.
+  value = std::min(value, kMaxValue);
+  const int index = BucketIndex(value);
+  total_.Add(value, index);
+
+  const int64_t epoch = Epoch(now);
+  Slot& slot = slots_[epoch % num_slots_];
+  int64_t slot_epoch = slot.epoch.load(std::memory_order_acquire);
+  if (slot_epoch < epoch &&
+      slot.epoch.compare_exchange_strong(slot_epoch, epoch,
+                                         std::memory_order_acq_rel)) {
+    // Values added by other threads while clearing may be lost, which is
+    // acceptable for recent stats.
+    slot.counts.Clear();
+  } else if (slot_epoch > epoch) {
+    // |now| is too old. It is counted only in total.
+    return;
+  }
+  slot.counts.Add(value, index);
+}
+
+int64_t HdrHistogram::Mean() const {
+  const int64_t count = total_.count.load(std::memory_order_relaxed);
+  if (count <= 0) {
+    return 0;
+  }
+  return total_.sum.load(std::memory_order_relaxed) / count;
+}
+
+int64_t HdrHistogram::StandardDeviation() const {
+  return devtools_goma::StandardDeviation(
+      total_.count.load(std::memory_order_relaxed),
+      total_.sum.load(std::memory_order_relaxed),
+      total_.sum_of_squares.load(std::memory_order_relaxed));
+}
+
+HdrHistogram::Snapshot HdrHistogram::GetSnapshot() const {
+  Snapshot snapshot;
+  total_.AddTo(&snapshot);
+  return snapshot;
+}
+
+HdrHistogram::Snapshot HdrHistogram::GetWindowSnapshot(absl::Time now) const {
+  Snapshot snapshot;
+  const int64_t epoch = Epoch(now);
+  for (int i = 0; i < num_slots_; ++i) {
+    const int64_t slot_epoch =
+        slots_[i].epoch.load(std::memory_order_acquire);
+    if (slot_epoch > epoch - num_slots_ && slot_epoch <= epoch) {
+      slots_[i].counts.AddTo(&snapshot);
+    }
+  }
+  return snapshot;
+}
+
+void HdrHistogram::Reset() {
+  total_.Clear();
+  for (int i = 0; i < num_slots_; ++i) {
+    slots_[i].epoch.store(-1, std::memory_order_release);
+    slots_[i].counts.Clear();
+  }
+}
+
+std::string HdrHistogram::DebugStringAt(absl::Time now) const {
+  // Use the same snapshot for all output, since values may be added or
+  // reset concurrently.
+  const Snapshot snapshot = GetSnapshot();
+  if (snapshot.count == 0) {
+    return std::string();
+  }
+
+  std::stringstream ss;
+  ss << name_ << ": "
+     << " Basic stats: count: " << snapshot.count
+     << " sum: " << snapshot.sum
+     << " min: " << snapshot.min
+     << " max: " << snapshot.max
+     << " mean: " << snapshot.mean()
+     << " stddev: " << snapshot.standard_deviation();
+  AppendPercentiles(snapshot, &ss);
+  ss << "\n";
+
+  const Snapshot window_snapshot = GetWindowSnapshot(now);
+  ss << " Last " << absl::FormatDuration(window()) << ":"
+     << " count: " << window_snapshot.count;
+  if (window_snapshot.count > 0) {
+    ss << " min: " << window_snapshot.min
+       << " max: " << window_snapshot.max;
+    AppendPercentiles(window_snapshot, &ss);
+  }
+  ss << "\n";
+
+  const std::vector<int64_t> log2_buckets = Log2Buckets(snapshot);
+  const int64_t largest =
+      *std::max_element(log2_buckets.begin(), log2_buckets.end());
+  const int first_bucket = Log2Bucket(snapshot.min);
+  const std::string longest_min_label =
+      absl::StrCat(log2_buckets.size() > 1
+                       ? int64_t{1} << (log2_buckets.size() - 2) : 0);
+  const std::string longest_max_label =
+      absl::StrCat(int64_t{1} << (log2_buckets.size() - 1));
+  for (size_t i = first_bucket; i < log2_buckets.size(); ++i) {
+    const int64_t min_key = i > 0 ? int64_t{1} << (i - 1) : 0;
+    const int64_t max_key = int64_t{1} << i;
+    ss << "["
+       << std::setw(longest_min_label.size()) << std::right << min_key
+       << "-"
+       << std::setw(longest_max_label.size()) << std::right << max_key
+       << "]: ";
+    if (log2_buckets[i] > 0) {
+      ss << std::left
+         << std::string(kGraphWidth * log2_buckets[i] / largest, '#')
+         << log2_buckets[i];
+    }
+    ss << '\n';
+  }
+  return ss.str();
+}
+
+void HdrHistogram::DumpToProto(DistributionProto* dist) const {
+  const Snapshot snapshot = GetSnapshot();
+  dist->set_count(snapshot.count);
+  dist->set_sum(snapshot.sum);
+  dist->set_sum_of_squares(snapshot.sum_of_squares);
+  if (snapshot.count == 0) {
+    return;
+  }
+  dist->set_min(snapshot.min);
+  dist->set_max(snapshot.max);
+
+  dist->set_logbase(2);
+  for (const auto& value : Log2Buckets(snapshot)) {
+    dist->add_bucket_value(value);
+  }
+  dist->set_p50(snapshot.Percentile(50));
+  dist->set_p90(snapshot.Percentile(90));
+  dist->set_p99(snapshot.Percentile(99));
+  dist->set_p999(snapshot.Percentile(99.9));
+}
+
+}  // namespace devtools_goma
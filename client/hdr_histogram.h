@@ -0,0 +1,137 @@
+// Copyright 2021 The Goma Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef DEVTOOLS_GOMA_CLIENT_HDR_HISTOGRAM_H_
+#define DEVTOOLS_GOMA_CLIENT_HDR_HISTOGRAM_H_
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+
+namespace devtools_goma {
+
+class DistributionProto;
+
+// HdrHistogram is a high dynamic range histogram, whose buckets have
+// bounded relative error, so that percentiles can be estimated.
+// Values in [0, 2^kSubBucketBits) are recorded exactly, and each
+// power-of-two range above is split into 2^(kSubBucketBits-1) buckets,
+// i.e. relative error of a bucket is less than 1/16.
+//
+// In addition to values recorded since the last Reset, it keeps values
+// recorded in the recent |window| in |num_slots| slots, to show recent
+// percentiles.
+//
+// Add is lock-free, so many threads can add values without contention.
+// Readers may see values being added partially, which is fine for stats.
+class HdrHistogram {
+ public:
+  static constexpr int kSubBucketBits = 5;
+  // Values not less than 2^kMaxValueBits are recorded as 2^kMaxValueBits-1.
+  static constexpr int kMaxValueBits = 40;
+  static constexpr int kNumBuckets =
+      (1 << kSubBucketBits) +
+      (kMaxValueBits - kSubBucketBits) * (1 << (kSubBucketBits - 1));
+
+  // Snapshot of values in HdrHistogram.
+  struct Snapshot {
+    Snapshot() : buckets(kNumBuckets) {}
+
+    int64_t mean() const { return count > 0 ? sum / count : 0; }
+    int64_t standard_deviation() const;
+    // Returns an estimated value at |percentile| in [0, 100].
+    // Returns 0 if no value is recorded.
+    int64_t Percentile(double percentile) const;
+
+    int64_t count = 0;
+    int64_t sum = 0;
+    double sum_of_squares = 0;
+    int64_t min = 0;
+    int64_t max = 0;
+    std::vector<int64_t> buckets;
+  };
+
+  explicit HdrHistogram(absl::Duration window = absl::Minutes(1),
+                        int num_slots = 6);
+  ~HdrHistogram();
+
+  HdrHistogram(const HdrHistogram&) = delete;
+  HdrHistogram& operator=(const HdrHistogram&) = delete;
+
+  void SetName(const std::string& name) { name_ = name; }
+  const std::string& name() const { return name_; }
+  absl::Duration window() const { return slot_duration_ * num_slots_; }
+
+  // Negative value is recorded as 0.
+  void Add(int64_t value) { AddAt(value, absl::Now()); }
+  void AddAt(int64_t value, absl::Time now);
+  void AddTimeAsMilliseconds(absl::Duration duration) {
+    Add(absl::ToInt64Milliseconds(duration));
+  }
+
+  // Returns mean and standard deviation of values recorded since the last
+  // Reset, without copying buckets.
+  int64_t Mean() const;
+  int64_t StandardDeviation() const;
+
+  // Returns values recorded since the last Reset.
+  Snapshot GetSnapshot() const;
+  // Returns values recorded in the recent window at |now|.
+  Snapshot GetWindowSnapshot(absl::Time now) const;
+
+  void Reset();
+
+  // Returns empty string if no value is recorded.
+  std::string DebugString() const { return DebugStringAt(absl::Now()); }
+  std::string DebugStringAt(absl::Time now) const;
+  // Dumps values in log base 2 buckets, as Histogram does.
+  void DumpToProto(DistributionProto* dist) const;
+
+  static int BucketIndex(int64_t value);
+  // Returns the smallest value recorded in the |index|-th bucket.
+  static int64_t BucketLowerBound(int index);
+
+ private:
+  // Counts are updated by atomic operations.
+  struct Counts {
+    Counts();
+
+    void Add(int64_t value, int index);
+    void Clear();
+    void AddTo(Snapshot* snapshot) const;
+
+    std::atomic<int64_t> count;
+    std::atomic<int64_t> sum;
+    std::atomic<double> sum_of_squares;
+    std::atomic<int64_t> min;
+    std::atomic<int64_t> max;
+    std::array<std::atomic<int64_t>, kNumBuckets> buckets;
+  };
+
+  struct Slot {
+    // Slot is used for values added at time in
+    // [epoch * slot_duration_, (epoch + 1) * slot_duration_).
+    std::atomic<int64_t> epoch{-1};
+    Counts counts;
+  };
+
+  int64_t Epoch(absl::Time now) const;
+
+  std::string name_;
+  const absl::Duration slot_duration_;
+  const int num_slots_;
+
+  Counts total_;
+  std::unique_ptr<Slot[]> slots_;
+};
+
+}  // namespace devtools_goma
+
+#endif  // DEVTOOLS_GOMA_CLIENT_HDR_HISTOGRAM_H_
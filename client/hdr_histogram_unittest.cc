@@ -0,0 +1,183 @@
+// Copyright 2021 The Goma Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "hdr_histogram.h"
+
+#include <cstdlib>
+#include <limits>
+#include <thread>
+#include <vector>
+
+#include "absl/time/time.h"
+#include "compiler_specific.h"
+#include "gtest/gtest.h"
+MSVC_PUSH_DISABLE_WARNING_FOR_PROTO()
+#include "lib/goma_stats.pb.h"
+MSVC_POP_WARNING()
+
+namespace devtools_goma {
+
+TEST(HdrHistogramTest, BucketIndex) {
+  for (int64_t i = 0; i < 32; ++i) {
+    EXPECT_EQ(i, HdrHistogram::BucketIndex(i));
+    EXPECT_EQ(i, HdrHistogram::BucketLowerBound(i));
+  }
+  // [32, 34) is the first bucket having two values.
+  EXPECT_EQ(32, HdrHistogram::BucketIndex(32));
+  EXPECT_EQ(32, HdrHistogram::BucketIndex(33));
+  EXPECT_EQ(33, HdrHistogram::BucketIndex(34));
+  EXPECT_EQ(47, HdrHistogram::BucketIndex(63));
+  EXPECT_EQ(48, HdrHistogram::BucketIndex(64));
+  EXPECT_EQ(32, HdrHistogram::BucketLowerBound(32));
+  EXPECT_EQ(34, HdrHistogram::BucketLowerBound(33));
+  EXPECT_EQ(64, HdrHistogram::BucketLowerBound(48));
+
+  // Negative value is treated as 0, and too large value is recorded in
+  // the last bucket.
+  EXPECT_EQ(0, HdrHistogram::BucketIndex(-1));
+  EXPECT_EQ(HdrHistogram::kNumBuckets - 1,
+            HdrHistogram::BucketIndex(int64_t{1} << 50));
+
+  // Relative error of a bucket is bounded.
+  for (int i = 32; i < HdrHistogram::kNumBuckets - 1; ++i) {
+    const int64_t lower = HdrHistogram::BucketLowerBound(i);
+    const int64_t next = HdrHistogram::BucketLowerBound(i + 1);
+    EXPECT_EQ(i, HdrHistogram::BucketIndex(lower));
+    EXPECT_EQ(i, HdrHistogram::BucketIndex(next - 1));
+    EXPECT_LE((next - lower) * 16, lower) << i;
+  }
+}
+
+TEST(HdrHistogramTest, Stats) {
+  HdrHistogram histogram;
+  for (int i = 1; i <= 1000; ++i) {
+    histogram.Add(i);
+  }
+  HdrHistogram::Snapshot snapshot = histogram.GetSnapshot();
+  EXPECT_EQ(1000, snapshot.count);
+  EXPECT_EQ(500500, snapshot.sum);
+  EXPECT_EQ(1, snapshot.min);
+  EXPECT_EQ(1000, snapshot.max);
+  EXPECT_EQ(500, snapshot.mean());
+  EXPECT_EQ(288, snapshot.standard_deviation());
+  EXPECT_EQ(500, histogram.Mean());
+  EXPECT_EQ(288, histogram.StandardDeviation());
+  EXPECT_FALSE(histogram.DebugString().empty());
+
+  const struct {
+    double percentile;
+    int64_t want;
+  } kTestCases[] = {
+      {0, 1}, {50, 500}, {90, 900}, {99, 990}, {99.9, 999}, {100, 1000},
+  };
+  for (const auto& tc : kTestCases) {
+    const int64_t got = snapshot.Percentile(tc.percentile);
+    EXPECT_LE(std::abs(got - tc.want), tc.want / 16)
+        << "p" << tc.percentile << " got=" << got;
+  }
+
+  histogram.Reset();
+  snapshot = histogram.GetSnapshot();
+  EXPECT_EQ(0, snapshot.count);
+  EXPECT_EQ(0, snapshot.Percentile(50));
+  EXPECT_EQ(0, histogram.Mean());
+  EXPECT_EQ(0, histogram.StandardDeviation());
+  EXPECT_EQ("", histogram.DebugString());
+}
+
+TEST(HdrHistogramTest, Window) {
+  HdrHistogram histogram(absl::Minutes(1), 6);
+  const absl::Time start = absl::FromUnixSeconds(1600000000);
+  histogram.AddAt(1000, start);
+  histogram.AddAt(10, start + absl::Seconds(30));
+  histogram.AddAt(20, start + absl::Seconds(70));
+
+  EXPECT_EQ(3, histogram.GetSnapshot().count);
+
+  HdrHistogram::Snapshot snapshot =
+      histogram.GetWindowSnapshot(start + absl::Seconds(50));
+  EXPECT_EQ(2, snapshot.count);
+  EXPECT_EQ(1000, snapshot.max);
+
+  // The value added at |start| is out of the window.
+  snapshot = histogram.GetWindowSnapshot(start + absl::Seconds(75));
+  EXPECT_EQ(2, snapshot.count);
+  EXPECT_EQ(10, snapshot.min);
+  EXPECT_EQ(20, snapshot.max);
+
+  snapshot = histogram.GetWindowSnapshot(start + absl::Minutes(10));
+  EXPECT_EQ(0, snapshot.count);
+
+  // A slot is reused for new values.
+  histogram.AddAt(5, start + absl::Seconds(60));
+  snapshot = histogram.GetWindowSnapshot(start + absl::Seconds(60));
+  EXPECT_EQ(2, snapshot.count);
+  EXPECT_EQ(5, snapshot.min);
+}
+
+TEST(HdrHistogramTest, LargeValue) {
+  HdrHistogram histogram;
+  histogram.Add(std::numeric_limits<int64_t>::max());
+  histogram.Add(std::numeric_limits<int64_t>::max());
+
+  constexpr int64_t kMaxValue =
+      (int64_t{1} << HdrHistogram::kMaxValueBits) - 1;
+  HdrHistogram::Snapshot snapshot = histogram.GetSnapshot();
+  EXPECT_EQ(2, snapshot.count);
+  EXPECT_EQ(2 * kMaxValue, snapshot.sum);
+  EXPECT_EQ(kMaxValue, snapshot.min);
+  EXPECT_EQ(kMaxValue, snapshot.max);
+  EXPECT_EQ(2, snapshot.buckets[HdrHistogram::kNumBuckets - 1]);
+  EXPECT_FALSE(histogram.DebugString().empty());
+}
+
+TEST(HdrHistogramTest, ConcurrentAdd) {
+  HdrHistogram histogram;
+  constexpr int kNumThreads = 4;
+  constexpr int kNumValues = 10000;
+  std::vector<std::thread> threads;
+  for (int i = 0; i < kNumThreads; ++i) {
+    threads.emplace_back([&histogram]() {
+      for (int j = 0; j < kNumValues; ++j) {
+        histogram.Add(j);
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  const HdrHistogram::Snapshot snapshot = histogram.GetSnapshot();
+  EXPECT_EQ(kNumThreads * kNumValues, snapshot.count);
+  EXPECT_EQ(int64_t{kNumThreads} * kNumValues * (kNumValues - 1) / 2,
+            snapshot.sum);
+  EXPECT_EQ(0, snapshot.min);
+  EXPECT_EQ(kNumValues - 1, snapshot.max);
+}
+
+TEST(HdrHistogramTest, DumpToProto) {
+  HdrHistogram histogram;
+  histogram.Add(0);
+  histogram.Add(1);
+  histogram.Add(5);
+  histogram.Add(100);
+
+  DistributionProto dist;
+  histogram.DumpToProto(&dist);
+  EXPECT_EQ(4, dist.count());
+  EXPECT_EQ(106, dist.sum());
+  EXPECT_EQ(0, dist.min());
+  EXPECT_EQ(100, dist.max());
+  EXPECT_EQ(2, dist.logbase());
+  // [0,1), [1,2), [2,4), [4,8), ..., [64,128)
+  ASSERT_EQ(8, dist.bucket_value_size());
+  EXPECT_EQ(1, dist.bucket_value(0));
+  EXPECT_EQ(1, dist.bucket_value(1));
+  EXPECT_EQ(0, dist.bucket_value(2));
+  EXPECT_EQ(1, dist.bucket_value(3));
+  EXPECT_EQ(1, dist.bucket_value(7));
+  EXPECT_EQ(1, dist.p50());
+  EXPECT_EQ(100, dist.p999());
+}
+
+}  // namespace devtools_goma
@@ -0,0 +1,47 @@
+// Copyright 2021 The Goma Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "jar_manifest_cache.h"
+
+#include <utility>
+
+#include "counterz.h"
+
+namespace devtools_goma {
+
+JarManifestCache* JarManifestCache::instance_;
+
+// static
+void JarManifestCache::Init(size_t max_entries) {
+  instance_ = new JarManifestCache(max_entries);
+}
+
+// static
+void JarManifestCache::Quit() {
+  delete instance_;
+  instance_ = nullptr;
+}
+
+JarManifestCache::JarManifestCache(size_t max_entries)
+    : entries_("jar manifest", max_entries) {}
+
+std::shared_ptr<const JarManifestCache::Manifest> JarManifestCache::Lookup(
+    const std::string& jar_path,
+    const FileStat& file_stat) {
+  GOMA_COUNTERZ("JarManifestCache::Lookup");
+
+  std::shared_ptr<const Manifest> manifest;
+  if (!entries_.Lookup(jar_path, file_stat, &manifest)) {
+    return nullptr;
+  }
+  return manifest;
+}
+
+bool JarManifestCache::Insert(const std::string& jar_path,
+                              const FileStat& file_stat,
+                              std::shared_ptr<const Manifest> manifest) {
+  return entries_.Insert(jar_path, file_stat, std::move(manifest));
+}
+
+}  // namespace devtools_goma
@@ -0,0 +1,71 @@
+// Copyright 2021 The Goma Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef DEVTOOLS_GOMA_CLIENT_JAVA_JAR_MANIFEST_CACHE_H_
+#define DEVTOOLS_GOMA_CLIENT_JAVA_JAR_MANIFEST_CACHE_H_
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "basictypes.h"
+#include "file_stat.h"
+#include "file_stat_lru_cache.h"
+
+namespace devtools_goma {
+
+// JarManifestCache keeps the result of reading MANIFEST of .jar files by
+// JarParser, so that a .jar file used by many javac tasks (e.g. android.jar
+// or dependency jars in Android build) is opened only once while it is not
+// modified.
+class JarManifestCache {
+ public:
+  struct Manifest {
+    // True if the file could be opened as a zip archive.
+    bool is_zip = false;
+    // True if the archive has META-INF/MANIFEST.MF.
+    bool has_manifest = false;
+    // .jar files in Class-Path of MANIFEST, as written in MANIFEST,
+    // i.e. relative to the directory of the .jar file.
+    std::vector<std::string> class_path;
+  };
+
+  static JarManifestCache* instance() { return instance_; }
+  static bool IsEnabled() { return instance_ != nullptr; }
+
+  // Initializes JarManifestCache.
+  // If the number of entries exceeds |max_entries|, the least recently used
+  // entry will be evicted.
+  static void Init(size_t max_entries);
+  static void Quit();
+
+  // Returns the manifest of |jar_path| if it was stored with |file_stat|.
+  // Returns nullptr otherwise.
+  std::shared_ptr<const Manifest> Lookup(const std::string& jar_path,
+                                         const FileStat& file_stat);
+
+  // Stores |manifest| of |jar_path| read when its FileStat is |file_stat|.
+  // Returns false if |file_stat| is invalid or can be stale.
+  bool Insert(const std::string& jar_path,
+              const FileStat& file_stat,
+              std::shared_ptr<const Manifest> manifest);
+
+  size_t size() const { return entries_.size(); }
+  int64_t hit() const { return entries_.hit(); }
+  int64_t miss() const { return entries_.miss(); }
+
+ private:
+  explicit JarManifestCache(size_t max_entries);
+  ~JarManifestCache() = default;
+
+  static JarManifestCache* instance_;
+
+  FileStatLruCache<std::shared_ptr<const Manifest>> entries_;
+
+  DISALLOW_COPY_AND_ASSIGN(JarManifestCache);
+};
+
+}  // namespace devtools_goma
+
+#endif  // DEVTOOLS_GOMA_CLIENT_JAVA_JAR_MANIFEST_CACHE_H_
@@ -0,0 +1,55 @@
+// Copyright 2021 The Goma Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "jar_manifest_cache.h"
+
+#include <memory>
+#include <string>
+
+#include "absl/memory/memory.h"
+#include "client/unittest_util.h"
+#include "gtest/gtest.h"
+
+namespace devtools_goma {
+
+class JarManifestCacheTest : public testing::Test {
+ public:
+  JarManifestCacheTest() {
+    JarManifestCache::Init(2);
+    tmpdir_util_ = absl::make_unique<TmpdirUtil>("jar_manifest_cache");
+  }
+
+  ~JarManifestCacheTest() override { JarManifestCache::Quit(); }
+
+ protected:
+  static std::shared_ptr<JarManifestCache::Manifest> MakeManifest(
+      const std::string& class_path) {
+    auto manifest = std::make_shared<JarManifestCache::Manifest>();
+    manifest->is_zip = true;
+    manifest->has_manifest = true;
+    manifest->class_path.push_back(class_path);
+    return manifest;
+  }
+
+  std::unique_ptr<TmpdirUtil> tmpdir_util_;
+};
+
+TEST_F(JarManifestCacheTest, Manifest) {
+  JarManifestCache* cache = JarManifestCache::instance();
+  const std::string jar =
+      tmpdir_util_->CreateTmpFileWithOldMtime("foo.jar", "foo");
+  const FileStat file_stat(jar);
+
+  EXPECT_TRUE(cache->Insert(jar, file_stat, MakeManifest("bar.jar")));
+
+  std::shared_ptr<const JarManifestCache::Manifest> manifest =
+      cache->Lookup(jar, FileStat(jar));
+  ASSERT_NE(nullptr, manifest);
+  EXPECT_TRUE(manifest->is_zip);
+  EXPECT_TRUE(manifest->has_manifest);
+  ASSERT_EQ(1U, manifest->class_path.size());
+  EXPECT_EQ("bar.jar", manifest->class_path[0]);
+}
+
+}  // namespace devtools_goma
@@ -5,15 +5,16 @@
 
 #include "jar_parser.h"
 
-#include <limits.h>
-#include <string.h>
-
 #include <memory>
+#include <vector>
 
 #include "absl/strings/match.h"
 #include "absl/strings/str_split.h"
+#include "absl/strings/strip.h"
 #include "basictypes.h"
+#include "file_stat.h"
 #include "glog/logging.h"
+#include "jar_manifest_cache.h"
 #include "minizip/unzip.h"
 #include "path.h"
 
@@ -25,46 +26,34 @@ namespace devtools_goma {
 
 JarParser::JarParser() {}
 
-static void AddJarFile(absl::string_view jar_file,
-                       absl::string_view cwd,
-                       std::set<std::string>* checked_files,
-                       std::set<std::string>* jar_files);
-
-static void ReadManifest(absl::string_view source_file,
-                         char* content,
-                         absl::string_view cwd,
-                         std::set<std::string>* checked_files,
-                         std::set<std::string>* jar_files) {
+// Parses MANIFEST |content| and appends .jar files in its Class-Path
+// to |class_path|.
+static void ParseManifest(absl::string_view content,
+                          std::vector<std::string>* class_path) {
   // The format of manifest files is similar to HTTP header
   // (i.e., "key1: value1<CRLF>key2: value2<CRLF>")
   // We need only the value of Class-Path.
-  char* p = content;
   static const char kClassPathHeader[] = "Class-Path: ";
-  const size_t kClassPathHeaderSize = strlen(kClassPathHeader);
   for (;;) {
-    if (!strncmp(p, kClassPathHeader, kClassPathHeaderSize)) {
-      p += kClassPathHeaderSize;
+    if (absl::ConsumePrefix(&content, kClassPathHeader)) {
       break;
     }
 
-    p = strchr(p, '\n');
-    if (!p) {
+    absl::string_view::size_type pos = content.find('\n');
+    if (pos == absl::string_view::npos) {
       return;
     }
-    p++;
+    content.remove_prefix(pos + 1);
   }
 
-  char* end = strchr(p, '\r');
-  if (end) {
-    *end = '\0';
+  absl::string_view::size_type end = content.find('\r');
+  if (end != absl::string_view::npos) {
+    content = content.substr(0, end);
   }
 
-  for (auto&& path : absl::StrSplit(p, ' ', absl::SkipEmpty())) {
+  for (auto&& path : absl::StrSplit(content, ' ', absl::SkipEmpty())) {
     if (absl::EndsWith(path, ".jar")) {
-      LOG(INFO) << ".jar file depends on other .jar file."
-                << " source=" << source_file
-                << " dependency=" << path;
-      AddJarFile(path, cwd, checked_files, jar_files);
+      class_path->emplace_back(path);
     }
   }
 }
@@ -87,8 +76,11 @@ class ScopedUnzFile {
 
   bool IsValid() const { return unz_file_ != 0; }
 
-  int GetGlobalInfo64(unz_global_info64* info) {
-    return unzGetGlobalInfo64(unz_file_, info);
+  // Sets the current file to |filename|.
+  // Returns UNZ_END_OF_LIST_OF_FILE if not found.
+  int LocateFile(const char* filename) {
+    DCHECK(!open_current_) << path_;
+    return unzLocateFile(unz_file_, filename, /* case sensitive */ 1);
   }
 
   int GetCurrentFileInfo64(unz_file_info64* fileinfo,
@@ -121,11 +113,6 @@ class ScopedUnzFile {
     return unzCloseCurrentFile(unz_file_);
   }
 
-  int GoToNextFile() {
-    DCHECK(!open_current_) << path_;
-    return unzGoToNextFile(unz_file_);
-  }
-
  private:
   const std::string path_;
   unzFile unz_file_;
@@ -133,6 +120,84 @@ class ScopedUnzFile {
   DISALLOW_COPY_AND_ASSIGN(ScopedUnzFile);
 };
 
+// Reads MANIFEST of |jar_path|.
+// Only the central directory and MANIFEST are read; other entries are
+// not inflated.
+static std::shared_ptr<const JarManifestCache::Manifest> ReadJarManifest(
+    const std::string& jar_path) {
+  LOG(INFO) << "Reading jar file: " << jar_path;
+
+  auto manifest = std::make_shared<JarManifestCache::Manifest>();
+
+  ScopedUnzFile scoped_jar(jar_path.c_str());
+  if (!scoped_jar.IsValid()) {
+    LOG(WARNING) << "Not jar archive? (unzOpen64):" << jar_path;
+    return manifest;
+  }
+  manifest->is_zip = true;
+
+  static const char kManifestFileName[] = "META-INF/MANIFEST.MF";
+  int err = scoped_jar.LocateFile(kManifestFileName);
+  if (err == UNZ_END_OF_LIST_OF_FILE) {
+    return manifest;
+  }
+  if (err) {
+    LOG(WARNING) << "Broken jar archive? (unzLocateFile): " << jar_path
+                 << " err=" << err;
+    return manifest;
+  }
+  manifest->has_manifest = true;
+
+  unz_file_info64 fileinfo;
+  err = scoped_jar.GetCurrentFileInfo64(&fileinfo, nullptr, 0, nullptr, 0,
+                                        nullptr, 0);
+  if (err) {
+    LOG(WARNING) << "Broken jar archive? (unzGetCurrentFileInfo64): "
+                 << jar_path << " err=" << err;
+    return manifest;
+  }
+
+  err = scoped_jar.OpenCurrentFile();
+  if (err) {
+    LOG(WARNING) << "Broken jar archive? (unzOpenCurrentFile): " << jar_path
+                 << " err=" << err;
+    return manifest;
+  }
+
+  std::string content(static_cast<size_t>(fileinfo.uncompressed_size), '\0');
+  err = scoped_jar.ReadCurrentFile(&content[0], content.size());
+  if (err < 0) {
+    LOG(WARNING) << "Broken jar archive? (unzReadCurrentFile): " << jar_path
+                 << " err=" << err;
+    return manifest;
+  }
+  content.resize(err);
+  ParseManifest(content, &manifest->class_path);
+  err = scoped_jar.CloseCurrentFile();
+  LOG_IF(WARNING, err != UNZ_OK)
+      << "CloseCurrentFile: " << jar_path << " err=" << err;
+  return manifest;
+}
+
+// Returns MANIFEST of |jar_path| from JarManifestCache if |jar_path| is not
+// modified. Otherwise, reads |jar_path|.
+static std::shared_ptr<const JarManifestCache::Manifest> GetJarManifest(
+    const std::string& jar_path) {
+  if (!JarManifestCache::IsEnabled()) {
+    return ReadJarManifest(jar_path);
+  }
+
+  const FileStat file_stat(jar_path);
+  std::shared_ptr<const JarManifestCache::Manifest> manifest =
+      JarManifestCache::instance()->Lookup(jar_path, file_stat);
+  if (manifest) {
+    return manifest;
+  }
+  manifest = ReadJarManifest(jar_path);
+  JarManifestCache::instance()->Insert(jar_path, file_stat, manifest);
+  return manifest;
+}
+
 static void AddJarFile(absl::string_view jar_file,
                        absl::string_view cwd,
                        std::set<std::string>* checked_files,
@@ -142,13 +207,9 @@ static void AddJarFile(absl::string_view jar_file,
     return;
   }
 
-  LOG(INFO) << "Reading jar file: " << jar_path;
-
-  const absl::string_view basedir(file::Dirname(jar_path));
-
-  ScopedUnzFile scoped_jar(jar_path.c_str());
-  if (!scoped_jar.IsValid()) {
-    LOG(WARNING) << "Not jar archive? (unzOpen64):" << jar_path;
+  std::shared_ptr<const JarManifestCache::Manifest> manifest =
+      GetJarManifest(jar_path);
+  if (!manifest->is_zip) {
     return;
   }
   // Sometimes .jar file specifies non-existing .jar file in its manifest.
@@ -158,64 +219,18 @@ static void AddJarFile(absl::string_view jar_file,
       << "jar file has already been stored to jar_files."
       << " jar_path=" << jar_path;
 
-  int err;
-  unz_global_info64 jar_info;
-  err = scoped_jar.GetGlobalInfo64(&jar_info);
-  if (err) {
-    LOG(WARNING) << "Broken jar archive? (unzGetGlobalInfo64): " << jar_path
-                 << " err=" << err;
+  if (!manifest->has_manifest) {
+    LOG_IF(WARNING, !absl::EndsWith(jar_file, ".zip"))
+        << jar_file << " doesn't contain manifest";
     return;
   }
 
-  for (ZPOS64_T i = 0; i < jar_info.number_entry; i++) {
-    unz_file_info64 fileinfo;
-    char filename[PATH_MAX];
-    err = scoped_jar.GetCurrentFileInfo64(&fileinfo, filename, sizeof(filename),
-                                          nullptr, 0, nullptr, 0);
-    if (err) {
-      LOG(WARNING) << "Broken jar archive? (unzGetCurrentFileInfo64): "
-                   << jar_path << " err=" << err;
-      return;
-    }
-
-    static const char kManifestFileName[] = "META-INF/MANIFEST.MF";
-    if (!strcmp(filename, kManifestFileName)) {
-      err = scoped_jar.OpenCurrentFile();
-      if (err) {
-        LOG(WARNING) << "Broken jar archive? (unzOpenCurrentFile): " << jar_path
-                     << " err=" << err;
-        return;
-      }
-
-      size_t sz = static_cast<size_t>(fileinfo.uncompressed_size);
-      std::unique_ptr<char[]> buf(new char[sz + 1]);
-      err = scoped_jar.ReadCurrentFile(buf.get(), sz);
-      if (err < 0) {
-        LOG(WARNING) << "Broken jar archive? (unzReadCurrentFile): " << jar_path
-                     << " err=" << err;
-        return;
-      }
-      buf.get()[fileinfo.uncompressed_size] = '\0';
-      ReadManifest(jar_file, buf.get(), basedir, checked_files, jar_files);
-      err = scoped_jar.CloseCurrentFile();
-      LOG_IF(WARNING, err != UNZ_OK)
-          << "CloseCurrentFile: " << jar_path << " err=" << err;
-      return;
-    }
-
-    err = scoped_jar.GoToNextFile();
-    if (err == UNZ_END_OF_LIST_OF_FILE) {
-      break;
-    }
-    if (err) {
-      LOG(WARNING) << "Broken jar archive? (unzGoToNextFile): " << jar_path
-                   << " err=" << err;
-      return;
-    }
-  }
-
-  if (!absl::EndsWith(jar_file, ".zip")) {
-    LOG(WARNING) << jar_file << " doesn't contain manifest";
+  const absl::string_view basedir(file::Dirname(jar_path));
+  for (const auto& path : manifest->class_path) {
+    LOG(INFO) << ".jar file depends on other .jar file."
+              << " source=" << jar_file
+              << " dependency=" << path;
+    AddJarFile(path, basedir, checked_files, jar_files);
   }
 }
 
@@ -14,8 +14,11 @@
 #include <gtest/gtest.h>
 
 #include "absl/memory/memory.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
 #include "filesystem.h"
 #include "ioutil.h"
+#include "jar_manifest_cache.h"
 #include "jar_parser.h"
 #include "mypath.h"
 #include "options.h"
@@ -112,4 +115,39 @@ TEST_F(JarParserTest, GetJarFilesShouldIgnoreNonExistJarFiles) {
   EXPECT_EQ(expected_jar_files_set, jar_files_set);
 }
 
+TEST_F(JarParserTest, UseJarManifestCache) {
+  JarManifestCache::Init(10);
+
+  // ReadManifest.jar has foo.jar and bar.jar in MANIFEST class-path.
+  const std::string& base_jar =
+      CopyArchiveIntoTestDir("ReadManifest", "base.jar");
+  const std::string& foo_jar = CopyArchiveIntoTestDir("Basic", "foo.jar");
+  // Just copied files are not cached since they can be modified without
+  // changing FileStat.
+  for (const auto& path : {base_jar, foo_jar}) {
+    ASSERT_TRUE(UpdateMtime(path, absl::Now() - absl::Seconds(10)));
+  }
+
+  const std::vector<std::string> input_jar_files{base_jar};
+  const std::set<std::string> expected_jar_files_set{
+      base_jar,
+      foo_jar,
+  };
+
+  JarParser parser;
+  std::set<std::string> jar_files_set;
+  parser.GetJarFiles(input_jar_files, tmpdir_util_->tmpdir(), &jar_files_set);
+  EXPECT_EQ(expected_jar_files_set, jar_files_set);
+  EXPECT_EQ(0, JarManifestCache::instance()->hit());
+  // bar.jar doesn't exist, so it is not cached.
+  EXPECT_EQ(2U, JarManifestCache::instance()->size());
+
+  jar_files_set.clear();
+  parser.GetJarFiles(input_jar_files, tmpdir_util_->tmpdir(), &jar_files_set);
+  EXPECT_EQ(expected_jar_files_set, jar_files_set);
+  EXPECT_EQ(2, JarManifestCache::instance()->hit());
+
+  JarManifestCache::Quit();
+}
+
 }  // namespace devtools_goma
@@ -4,6 +4,7 @@
 
 #include "jarfile_reader.h"
 
+#include <algorithm>
 #include <cstring>
 
 #include "absl/base/macros.h"
@@ -26,6 +27,12 @@ static uint32_t ToUInt32(const char* ptr) {
 
 namespace devtools_goma {
 
+namespace {
+
+const size_t kBufSize = 1 << 20;
+
+}  // namespace
+
 /* static */
 std::unique_ptr<FileReader> JarFileReader::Create(const std::string& filename) {
   if (!CanHandle(filename)) {
@@ -49,9 +56,11 @@ bool JarFileReader::CanHandle(const std::string& filename) {
 
 JarFileReader::JarFileReader(const std::string& filename)
     : FileReader(filename),
+      chunk_size_(kBufSize),
       buffer_head_pos_(0),
-      last_normalized_absolute_pos_(0),
-      is_buffer_normalized_(false),
+      read_pos_(0),
+      scan_pos_(0),
+      is_eof_(false),
       is_central_directory_started_(false),
       is_valid_(false),
       detected_zip_normalized_time_(false),
@@ -101,16 +110,25 @@ JarFileReader::JarFileReader(const std::string& filename)
   NormalizeBuffer();
 }
 
-ssize_t JarFileReader::ReadDataToBuffer(size_t size) {
+ssize_t JarFileReader::ReadDataToBuffer() {
+  // Drop data already returned by Read.  Data not normalized yet is at most
+  // a header, so it is cheap to move.
+  buffer_.erase(0, read_pos_);
+  buffer_head_pos_ += read_pos_;
+  scan_pos_ -= read_pos_;
+  read_pos_ = 0;
+
   size_t orig_size = buffer_.size();
-  buffer_.resize(orig_size + size);
-  ssize_t read_bytes = FileReader::Read(&buffer_[orig_size], size);
-  if (read_bytes >= 0) {
-    buffer_.resize(orig_size + read_bytes);
+  buffer_.resize(orig_size + chunk_size_);
+  ssize_t read_bytes = FileReader::Read(&buffer_[orig_size], chunk_size_);
+  buffer_.resize(orig_size + std::max<ssize_t>(read_bytes, 0));
+  if (read_bytes >= 0 && static_cast<size_t>(read_bytes) < chunk_size_) {
+    // Should be end of the file.
+    is_eof_ = true;
   }
   VLOG(2) << "input_filename=" << input_filename_
-          << " read buffer_.size()=" << buffer_.size() << " size=" << size
-          << " read_bytes=" << read_bytes;
+          << " read buffer_.size()=" << buffer_.size()
+          << " read_bytes=" << read_bytes << " is_eof=" << is_eof_;
   return read_bytes;
 }
 
@@ -129,49 +147,38 @@ ssize_t JarFileReader::ReadDataToBuffer(size_t size) {
 // See Also: https://en.wikipedia.org/wiki/Zip_(file_format)#File_headers
 // Note that header structure is the same between ZIP and ZIP64.
 void JarFileReader::NormalizeBuffer() {
-  // TODO: return error instead?
-  DCHECK_LE(buffer_head_pos_, last_normalized_absolute_pos_)
-      << "buffer_head_pos must be smaller than or equals to "
-      << "last_normalized_absolute_pos_"
-      << " input_filename=" << input_filename_
-      << " buffer_head_pos=" << buffer_head_pos_
-      << " last_normalized_absolute_pos=" << last_normalized_absolute_pos_;
-  // Normalize the buffer from the last normalized position.
-  size_t cur = last_normalized_absolute_pos_ - buffer_head_pos_;
-  is_buffer_normalized_ = true;
   for (;;) {
-    cur = buffer_.find("PK", cur);
+    size_t cur = buffer_.find("PK", scan_pos_);
     if (cur == std::string::npos) {
-      // 'K' may come just after 'P'.  Let me mark this not normalized.
-      if (!buffer_.empty() && buffer_[buffer_.size() - 1] == 'P') {
-        is_buffer_normalized_ = false;
-      } else {
-        last_normalized_absolute_pos_ = buffer_head_pos_ + buffer_.size();
+      // 'K' may come just after 'P'.  Let me check it with the next data.
+      scan_pos_ = buffer_.size();
+      if (!is_eof_ && !buffer_.empty() && buffer_.back() == 'P') {
+        --scan_pos_;
       }
       return;
     }
     if (cur + 4 > buffer_.size()) {
-      // Will cause buffer overrun.
+      // Will cause buffer overrun.  Check it with the next data.
       VLOG(1) << "would cause buffer overrun."
               << " input_filename=" << input_filename_ << " cur=" << cur
               << " buffer_head_pos=" << buffer_head_pos_
               << " buffer_.size()=" << buffer_.size();
-      is_buffer_normalized_ = false;
+      scan_pos_ = is_eof_ ? buffer_.size() : cur;
       return;
     }
     ssize_t offset = GetTimestampOffset(&buffer_[cur]);
     VLOG(3) << "offset:" << offset;
     if (offset < 0) {
-      cur += 4;
+      scan_pos_ = cur + 4;
       continue;
     }
     if (cur + offset + 4 > buffer_.size()) {
-      // Will cause buffer overrun.
+      // Will cause buffer overrun.  Check it with the next data.
       VLOG(1) << "would cause buffer overrun."
               << " input_filename=" << input_filename_ << " cur=" << cur
               << " buffer_head_pos=" << buffer_head_pos_ << " offset=" << offset
               << " buffer_.size()=" << buffer_.size();
-      is_buffer_normalized_ = false;
+      scan_pos_ = is_eof_ ? buffer_.size() : cur;
       return;
     }
     // Set timestamp to the epoch time. 1980-01-01T00:00:00
@@ -182,8 +189,7 @@ void JarFileReader::NormalizeBuffer() {
     buffer_[cur + offset + 3] = 0;
     // offset from the head of the header + timestamp (4bytes) to go to just
     // next to timestamp.
-    cur += offset + 4;
-    last_normalized_absolute_pos_ = buffer_head_pos_ + cur;
+    scan_pos_ = cur + offset + 4;
   }
 }
 
@@ -197,7 +203,7 @@ ssize_t JarFileReader::GetTimestampOffset(const char* signature) {
   VLOG(3) << "signature:" << std::hex << u32_signature
           << " input_filename=" << input_filename_
           << " buffer_head_pos=" << buffer_head_pos_
-          << " last_normalized_absolute_pos=" << last_normalized_absolute_pos_
+          << " scan_pos=" << scan_pos_
           << " offset=" << offset_ << " buffer_.size()=" << buffer_.size();
   if (u32_signature == kLocalFileHeaderSignature) {
     DCHECK(!is_central_directory_started_)
@@ -205,7 +211,7 @@ ssize_t JarFileReader::GetTimestampOffset(const char* signature) {
         << "entry."
         << " input_filename=" << input_filename_
         << " buffer_head_pos=" << buffer_head_pos_
-        << " last_normalized_absolute_pos=" << last_normalized_absolute_pos_
+        << " scan_pos=" << scan_pos_
         << " offset_=" << offset_;
     return 10;
   }
@@ -219,51 +225,36 @@ ssize_t JarFileReader::GetTimestampOffset(const char* signature) {
 }
 
 ssize_t JarFileReader::Read(void* ptr, size_t len) {
-  // TODO: increase kBufSize when it works fine.
-  // small buffer size is good for checking code but not good for real world.
-  static const size_t kBufSize = 128;
   // https://en.wikipedia.org/wiki/Zip_(file_format)
   // Central directory file header should be the largest.
   static const size_t kMaxHeaderSize = 46;
   static_assert(kBufSize > kMaxHeaderSize,
                 "Buffer size should be larger than ZIP header size.");
 
-  off_t buffer_head_pos_at_beginning = buffer_head_pos_;
-  if (is_buffer_normalized_) {
-    buffer_head_pos_ += FileReader::FlushDataInBuffer(&buffer_, &ptr, &len);
-  }
-  while (len > 0) {
-    ssize_t read_bytes = ReadDataToBuffer(kBufSize);
-    if (read_bytes < 0) {  // Return error soon.
-      return read_bytes;
-    }
-    if (read_bytes != kBufSize) {  // Should be end of the file.
-      VLOG(1) << "input_filename=" << input_filename_
-              << " buffer_head_pos=" << buffer_head_pos_
-              << " buffer_.size()=" << buffer_.size();
-      NormalizeBuffer();
-      // No more data. i.e. no possibility that next buffer may contain the
-      // data that need to be normalized.
-      buffer_head_pos_ += FileReader::FlushDataInBuffer(&buffer_, &ptr, &len);
+  char* out = static_cast<char*>(ptr);
+  size_t read_bytes = 0;
+  for (;;) {
+    // Data before |scan_pos_| won't be modified by NormalizeBuffer.
+    size_t n = std::min(len - read_bytes, scan_pos_ - read_pos_);
+    memcpy(out + read_bytes, buffer_.data() + read_pos_, n);
+    read_pos_ += n;
+    read_bytes += n;
+    if (read_bytes == len || is_eof_) {
       break;
     }
-
-    VLOG(1) << "input_filename=" << input_filename_
-            << " buffer_head_pos=" << buffer_head_pos_
-            << " buffer_.size()=" << buffer_.size();
-    NormalizeBuffer();
-    if (is_buffer_normalized_) {
-      buffer_head_pos_ += FileReader::FlushDataInBuffer(&buffer_, &ptr, &len);
+    ssize_t r = ReadDataToBuffer();
+    if (r < 0) {  // Return error soon.
+      return r;
     }
+    NormalizeBuffer();
   }
 
-  size_t read_bytes = buffer_head_pos_ - buffer_head_pos_at_beginning;
   offset_ += read_bytes;
   VLOG(1) << "input_filename=" << input_filename_
           << " read_bytes=" << read_bytes << " offset_=" << offset_
           << " buffer_head_pos=" << buffer_head_pos_
           << " buffer_.size()=" << buffer_.size()
-          << " is_buffer_normalized=" << is_buffer_normalized_;
+          << " scan_pos=" << scan_pos_;
   return read_bytes;
 }
 
@@ -20,8 +20,11 @@ namespace devtools_goma {
 // Limitation:
 // The normalization will be done with heuristics that may fail with
 // 2/2**32 possibility.  If that become large issues, we need to fix.
-// Also, I suppose |len| to Read is usually 2MB size.  Performance
-// may suffer if |len| is usually smaller than internal buffer length.
+//
+// The file is read in |chunk_size_| chunks, and timestamps are normalized in
+// the chunk before copied to the buffer given to Read.  Only a few bytes
+// that might be a part of a header are kept until the next chunk is read,
+// so memory usage doesn't depend on the file size.
 class JarFileReader : public FileReader {
  public:
   ~JarFileReader() override {}
@@ -44,7 +47,10 @@ class JarFileReader : public FileReader {
   static bool CanHandle(const std::string& filename);
   explicit JarFileReader(const std::string& filename);
 
-  ssize_t ReadDataToBuffer(size_t size);
+  // Reads the next chunk of the file to |buffer_|.
+  ssize_t ReadDataToBuffer();
+  // Normalizes timestamps in |buffer_| from |scan_pos_|, and advances
+  // |scan_pos_| to the position where normalization would need more data.
   void NormalizeBuffer();
   ssize_t GetTimestampOffset(const char* signature);
 
@@ -53,10 +59,17 @@ class JarFileReader : public FileReader {
   FRIEND_TEST(JarFileReaderTest, valid);
 
   // Fields for buffer management.
+  // |buffer_| has data of the file in [buffer_head_pos_,
+  // buffer_head_pos_ + buffer_.size()).
+  // Data before |scan_pos_| are normalized, and data before |read_pos_|
+  // are already returned by Read.
   std::string buffer_;
+  // Size of data read from the file at once.
+  size_t chunk_size_;
   off_t buffer_head_pos_;
-  off_t last_normalized_absolute_pos_;
-  bool is_buffer_normalized_;
+  size_t read_pos_;
+  size_t scan_pos_;
+  bool is_eof_;
   bool is_central_directory_started_;
 
   // Fields for user facing part.
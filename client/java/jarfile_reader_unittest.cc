@@ -62,9 +62,12 @@ class JarFileReaderTest : public testing::Test {
     ASSERT_NE(content1, content2);
   }
 
+  // If |chunk_size| is not 0, JarFileReader reads |chunk_size| bytes from
+  // |orig_file| at once.
   void RunTest(const std::string& expected_file,
                const std::string& orig_file,
-               size_t buf_size) {
+               size_t buf_size,
+               size_t chunk_size = 0) {
     EnsureDifferentFiles(expected_file, orig_file);
 
     ScopedFd fd(ScopedFd::OpenForRead(expected_file));
@@ -72,6 +75,9 @@ class JarFileReaderTest : public testing::Test {
 
     JarFileReader reader(orig_file);
     ASSERT_TRUE(reader.valid());
+    if (chunk_size > 0) {
+      reader.chunk_size_ = chunk_size;
+    }
 
     off_t offset = 0;
     for (int cnt = 0;; ++cnt) {
@@ -151,6 +157,19 @@ TEST_F(JarFileReaderTest, ConfirmItNormalizedComplicated) {
   }
 }
 
+TEST_F(JarFileReaderTest, ConfirmItNormalizedSmallChunk) {
+  const std::string jar_original =
+      CopyArchiveIntoTestDir("signapk", "original.jar");
+  const std::string jar_expected =
+      CopyArchiveIntoTestDir("signapk_expected", "expected.jar");
+
+  // Headers should be normalized even if they are split into chunks.
+  for (size_t chunk_size : {1, 2, 3, 4, 7, 16, 45, 46, 47, 128}) {
+    SCOPED_TRACE(chunk_size);
+    RunTest(jar_expected, jar_original, 4096, chunk_size);
+  }
+}
+
 #if GTEST_HAS_DEATH_TEST && DCHECK_IS_ON()
 TEST_F(JarFileReaderTest, ShouldDieIfLocalFileComesAfterCentralDirectory) {
   const std::string jar_broken = CopyArchiveIntoTestDir("Broken", "broken.jar");
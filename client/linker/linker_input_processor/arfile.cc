@@ -13,6 +13,7 @@
 #include <ar.h>
 #include <fcntl.h>
 #include <stdlib.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <unistd.h>
 #ifdef __MACH__
@@ -41,6 +42,8 @@ extern "C" {
 
 #endif
 
+#include <algorithm>
+#include <atomic>
 #include <sstream>
 #include <utility>
 
@@ -66,10 +69,17 @@ static const char* kThinArMagic = "!<thin>\n";
 static const char* kSymbolTableName = "/               ";
 static const char* kSym64TableName = "/SYM64/         ";
 static const char* kLongnameTableName = "//              ";
+#ifdef __MACH__
+// It is known that mac has a special pattern at the beginning of ranlib.
+// The magic is given as BSD 4.4 style long name.
+static const char* kRanlibName = "#1/20           ";
+#endif
 
 // BSD variant support? "#1/<length>" and name will come after ar_hdr.
 // but BSD variant doesn't support thin archive?
 
+static std::atomic<bool> g_use_mmap{false};
+
 static std::string DumpArHdr(const struct ar_hdr& ar_hdr) {
   std::stringstream ss;
   ss << "name: " << std::hex;
@@ -147,7 +157,10 @@ ArFile::ArFile(std::string filename, off_t offset)
     : filename_(std::move(filename)),
       thin_archive_(false),
       valid_(true),
-      offset_(offset) {
+      offset_(offset),
+      mapped_(nullptr),
+      mapped_size_(0),
+      map_tried_(false) {
   Init();
 }
 
@@ -155,11 +168,29 @@ ArFile::ArFile(std::string filename)
     : filename_(std::move(filename)),
       thin_archive_(false),
       valid_(true),
-      offset_(0) {
+      offset_(0),
+      mapped_(nullptr),
+      mapped_size_(0),
+      map_tried_(false) {
   Init();
 }
 
+// static
+void ArFile::SetUseMmap(bool use_mmap) {
+  g_use_mmap.store(use_mmap, std::memory_order_relaxed);
+}
+
+// static
+bool ArFile::use_mmap() {
+  return g_use_mmap.load(std::memory_order_relaxed);
+}
+
 ArFile::~ArFile() {
+#ifndef _WIN32
+  if (mapped_ != nullptr) {
+    munmap(const_cast<char*>(mapped_), mapped_size_);
+  }
+#endif
 }
 
 void ArFile::Init() {
@@ -190,6 +221,45 @@ void ArFile::Init() {
   valid_ = false;
 }
 
+bool ArFile::Map() {
+  if (map_tried_) {
+    return mapped_ != nullptr;
+  }
+  map_tried_ = true;
+#ifndef _WIN32
+  if (!fd_.valid() || !valid_) {
+    return false;
+  }
+  size_t file_size = 0;
+  if (!fd_.GetFileSize(&file_size) || file_size == 0) {
+    return false;
+  }
+  void* addr = mmap(nullptr, file_size, PROT_READ, MAP_PRIVATE, fd_.fd(), 0);
+  if (addr == MAP_FAILED) {
+    PLOG(WARNING) << "mmap failed, fallback to read:" << filename_;
+    return false;
+  }
+  // Entries are read sequentially.
+  (void)madvise(addr, file_size, MADV_SEQUENTIAL);
+  mapped_ = static_cast<const char*>(addr);
+  mapped_size_ = file_size;
+  return true;
+#else
+  return false;
+#endif
+}
+
+bool ArFile::IsMappedRangeValid(size_t end) const {
+  if (end > mapped_size_) {
+    return false;
+  }
+  size_t file_size = 0;
+  if (!fd_.GetFileSize(&file_size)) {
+    return false;
+  }
+  return end <= file_size;
+}
+
 bool ArFile::Exists() const {
   return fd_.valid();
 }
@@ -262,6 +332,96 @@ bool ArFile::ReadEntry(EntryHeader* header, std::string* body) {
   return true;
 }
 
+bool ArFile::ReadEntryRef(EntryHeader* header,
+                          absl::string_view* body,
+                          std::string* body_buffer) {
+  DCHECK(header);
+  DCHECK(body);
+  DCHECK(body_buffer);
+  if (!use_mmap() || !Map()) {
+    if (!ReadEntry(header, body_buffer)) {
+      return false;
+    }
+    *body = *body_buffer;
+    return true;
+  }
+
+  const off_t offset = fd_.Seek(0, ScopedFd::SeekRelative);
+  VLOG(3) << "offset=" << offset;
+  LOG_IF(WARNING, (offset & 1) != 0)
+      << "ar_hdr must be on even boundary: offset:" << offset;
+  if (offset < 0 ||
+      !IsMappedRangeValid(static_cast<size_t>(offset) +
+                          sizeof(struct ar_hdr))) {
+    LOG(ERROR) << "failed to read."
+               << " offset=" << offset;
+    return false;
+  }
+
+  struct ar_hdr hdr;
+  memcpy(&hdr, mapped_ + offset, sizeof(hdr));
+  if (!ConvertArHeader(hdr, header)) {
+    LOG(ERROR) << "failed to convert."
+               << " offset=" << offset;
+    return false;
+  }
+
+  const size_t body_offset = offset + sizeof(hdr);
+  size_t next_offset = body_offset;
+  *body = absl::string_view();
+  if (IsSymbolTableEntry(*header) ||
+      IsLongnameEntry(*header) ||
+      !thin_archive_) {
+    // Checks the file size again, since the file might be truncated after
+    // the header was read.
+    size_t end = body_offset + header->ar_size;
+    if (header->ar_size & 1) {
+      end = std::min(end + 1, mapped_size_);
+    }
+    if (body_offset + header->ar_size > mapped_size_ ||
+        !IsMappedRangeValid(end)) {
+      LOG(ERROR) << "read failed:" << header->ar_name
+                 << " offset=" << offset
+                 << " ar_size=" << header->ar_size;
+      return false;
+    }
+    *body = absl::string_view(mapped_ + body_offset, header->ar_size);
+    next_offset += header->ar_size;
+    if (header->ar_size & 1) {
+      ++next_offset;
+      // ReadEntry pads the body with '\n'.  Use the padding in the file
+      // if it is '\n', which is almost always the case.
+      if (next_offset <= mapped_size_ && mapped_[next_offset - 1] == '\n') {
+        *body = absl::string_view(body->data(), body->size() + 1);
+      } else {
+        body_buffer->assign(body->data(), body->size());
+        body_buffer->append(1, '\n');
+        *body = *body_buffer;
+      }
+    }
+  }
+#ifdef __MACH__
+  if (header->orig_ar_name == kRanlibName) {
+    if (body->data() != body_buffer->data()) {
+      body_buffer->assign(body->data(), body->size());
+    }
+    if (!CleanIfRanlib(*header, body_buffer)) {
+      LOG(WARNING) << "failed to clean ranlib:"
+                   << " filename=" << filename_;
+    }
+    *body = *body_buffer;
+  }
+#endif
+
+  if (fd_.Seek(next_offset, ScopedFd::SeekAbsolute) ==
+      static_cast<off_t>(-1)) {
+    PLOG(ERROR) << "seek failed:" << header->ar_name
+                << " offset=" << next_offset;
+    return false;
+  }
+  return true;
+}
+
 void ArFile::GetEntries(std::vector<EntryHeader>* entries) {
   if (fd_.Seek(offset_ + SARMAG, ScopedFd::SeekAbsolute)
       == static_cast<off_t>(-1)) {
@@ -401,11 +561,8 @@ bool ArFile::CleanIfRanlib(const EntryHeader& hdr, std::string* body) {
   // Only support ar files on Intel mac (little endian).
   // You need to convert endian if you need support of big endian such as ppc.
   //
-  // It is known that mac has a special pattern at the beginning of ranlib.
-  // The magic is given as BSD 4.4 style long name.
-  // However, I do not provide full-spec parser of BSD 4.4 style long name
+  // I do not provide full-spec parser of BSD 4.4 style long name
   // because thin archive might not be used on mac.
-  static const char* kRanlibName = "#1/20           ";
   static const size_t kSymdefMagicSize = 20;  // size of SYMDEF magic.
   if (hdr.orig_ar_name != kRanlibName ||
       body->size() <= kSymdefMagicSize || !absl::StartsWith(*body, SYMDEF)) {
@@ -11,6 +11,7 @@
 #include <string>
 #include <vector>
 
+#include "absl/strings/string_view.h"
 #include "basictypes.h"
 #include "gtest/gtest_prod.h"
 #include "scoped_fd.h"
@@ -40,6 +41,12 @@ class ArFile {
   explicit ArFile(std::string filename, off_t offset);
   virtual ~ArFile();
 
+  // Experimental: if true, ReadEntryRef maps the archive file to memory and
+  // refers entry bodies in the mapping.  Default is false, and entry bodies
+  // are read into a buffer.
+  static void SetUseMmap(bool use_mmap);
+  static bool use_mmap();
+
   virtual const std::string& filename() const { return filename_; }
   virtual bool Exists() const;
   virtual bool IsThinArchive() const;
@@ -59,6 +66,16 @@ class ArFile {
   // The entry body is stored to |body|.  For thin archive, body could be set to
   // empty string.
   virtual bool ReadEntry(EntryHeader* header, std::string* body);
+  // Read an entry in an archive file like ReadEntry, but without copying
+  // the entry body if use_mmap() is true.
+  // |body| refers to the entry body in the mapped archive file, which is
+  // valid while this ArFile is alive.  If the entry body can't be referred
+  // as is (e.g. use_mmap() is false), the entry body is stored in
+  // |body_buffer| and |body| refers to it.
+  // Returns false if the archive file is truncated while it is mapped.
+  virtual bool ReadEntryRef(EntryHeader* header,
+                            absl::string_view* body,
+                            std::string* body_buffer);
 
  private:
   friend class StubArFile;
@@ -66,13 +83,25 @@ class ArFile {
   FRIEND_TEST(ArFileTest, CleanIfRanlibTest);
 #endif
   // ArFile() is provided only for testing. You SHOULD NOT use this.
-  ArFile() : thin_archive_(false) {}
+  ArFile()
+      : thin_archive_(false),
+        mapped_(nullptr),
+        mapped_size_(0),
+        map_tried_(false) {}
   static bool ConvertArHeader(const struct ar_hdr& hdr,
                               EntryHeader* entry_header);
   bool SkipEntryData(const EntryHeader& entry_header);
   bool ReadEntryData(const EntryHeader& entry_header, std::string* data);
   bool FixEntryName(std::string* name);
   void Init();
+  // Maps the archive file to memory for ReadEntryRef.
+  // Returns false if it is not mapped.
+  bool Map();
+  // Returns true if the archive file is still large enough to access
+  // [0, |end|) of the mapping.  Accessing the mapping beyond the end of
+  // file would raise SIGBUS.  This can't help if the file is truncated
+  // between the check and the access, which is why mmap is opt-in.
+  bool IsMappedRangeValid(size_t end) const;
 
 #ifdef __MACH__
   // Clean garbages in ranlib entry.
@@ -88,6 +117,11 @@ class ArFile {
   std::string longnames_;
   bool valid_;
   off_t offset_;
+  // The whole archive file mapped by Map(), or nullptr if not mapped.
+  const char* mapped_;
+  size_t mapped_size_;
+  // true if Map() has been tried.
+  bool map_tried_;
 
   DISALLOW_COPY_AND_ASSIGN(ArFile);
 };
@@ -5,6 +5,9 @@
 
 #include "arfile_reader.h"
 
+#include <string.h>
+
+#include <algorithm>
 #include <memory>
 
 #include "absl/strings/match.h"
@@ -71,14 +74,15 @@ bool ArFileReader::CanHandle(const std::string& filename) {
 ssize_t ArFileReader::Read(void* ptr, size_t len) {
   size_t read_bytes = 0;
   read_bytes += FileReader::FlushDataInBuffer(&read_buffer_, &ptr, &len);
+  read_bytes += FlushEntry(&ptr, &len);
   while (len > 0) {
     VLOG(3) << "reading ...:"
             << " read_bytes=" << read_bytes
             << " len=" << len
             << " total_off=" << read_bytes + current_offset_;
     ArFile::EntryHeader entry_header;
-    std::string entry_body;
-    if (!arfile_->ReadEntry(&entry_header, &entry_body)) {
+    if (!arfile_->ReadEntryRef(&entry_header, &entry_body_,
+                               &entry_body_buffer_)) {
       LOG(ERROR) << "failed to read entry."
                  << " current_offset_=" << current_offset_
                  << " read_bytes=" << read_bytes
@@ -86,15 +90,30 @@ ssize_t ArFileReader::Read(void* ptr, size_t len) {
       return -1;
     }
     NormalizeArHdr(&entry_header);
-    entry_header.SerializeToString(&read_buffer_);
-    read_buffer_.append(entry_body);
-    read_bytes += FileReader::FlushDataInBuffer(&read_buffer_, &ptr, &len);
+    entry_header.SerializeToString(&entry_header_);
+    read_bytes += FlushEntry(&ptr, &len);
   }
   current_offset_ += read_bytes;
 
   return read_bytes;
 }
 
+size_t ArFileReader::FlushEntry(void** ptr, size_t* len) {
+  size_t copied = FileReader::FlushDataInBuffer(&entry_header_, ptr, len);
+  if (!entry_header_.empty()) {
+    return copied;
+  }
+  const size_t size = std::min(*len, entry_body_.size());
+  if (size > 0) {
+    memcpy(*ptr, entry_body_.data(), size);
+    *ptr = static_cast<char*>(*ptr) + size;
+    *len -= size;
+    entry_body_.remove_prefix(size);
+    copied += size;
+  }
+  return copied;
+}
+
 off_t ArFileReader::Seek(off_t offset, ScopedFd::Whence whence) const {
   // ArFileReader should be asked to seek just next to the last read.
   DCHECK_EQ(whence, ScopedFd::SeekAbsolute)
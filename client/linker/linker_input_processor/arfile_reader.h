@@ -9,6 +9,9 @@
 // are different. That is because ar file contains information that
 // comes from file stat's. For the better cache hit, we want the same ar file
 // for the same objects. ArFileReader normalize it during reading.
+// Only entry headers are rewritten. If ArFile::use_mmap() is true, entry
+// bodies are copied from the mapped archive file to the buffer given to Read
+// directly.
 // The class is thread-unsafe.
 
 #ifndef DEVTOOLS_GOMA_CLIENT_LINKER_LINKER_INPUT_PROCESSOR_ARFILE_READER_H_
@@ -17,6 +20,7 @@
 #include <memory>
 #include <string>
 
+#include "absl/strings/string_view.h"
 #include "arfile.h"
 #ifdef _WIN32
 #include "config_win.h"
@@ -58,11 +62,24 @@ class ArFileReader : public FileReader {
   // else.
   static void NormalizeArHdr(ArFile::EntryHeader* hdr);
 
+  // Copies the remaining data of the current entry to |*ptr| with |*len|.
+  // |*ptr| is incremented and |*len| is decremented.
+  // Returns the number of copied bytes.
+  size_t FlushEntry(void** ptr, size_t* len);
+
   off_t current_offset_;
   // Data to be copied by Read function is stored to |read_buffer_|.
   // If |len| of Read function is less than |read_buffer_|, remained data will
   // be kept here until next call of Read.
   std::string read_buffer_;
+  // Remaining data of the current entry, which are copied by Read function
+  // in this order.
+  // |entry_header_| is the normalized entry header.
+  std::string entry_header_;
+  // |entry_body_| refers to the entry body in the mapped archive file, or
+  // |entry_body_buffer_|.
+  absl::string_view entry_body_;
+  std::string entry_body_buffer_;
   std::unique_ptr<ArFile> arfile_;
   bool is_valid_;
 
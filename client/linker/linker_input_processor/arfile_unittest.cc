@@ -12,7 +12,6 @@
 #ifndef _WIN32
 #include <unistd.h>
 #else
-# include "absl/strings/string_view.h"
 # include "config_win.h"
 #endif
 #ifdef __MACH__
@@ -28,7 +27,10 @@
 #include <gtest/gtest.h>
 
 #include "absl/memory/memory.h"
+#include "absl/strings/match.h"
+#include "absl/strings/string_view.h"
 #include "arfile.h"
+#include "file_helper.h"
 #include "mypath.h"
 #include "unittest_util.h"
 #include "util.h"
@@ -182,6 +184,80 @@ TEST_F(ArFileTest, ThinArchiveLongName) {
 }
 #endif  // __MACH__
 
+#ifndef _WIN32
+TEST_F(ArFileTest, ReadEntryRef) {
+  std::vector<std::string> files;
+  files.push_back("long_long_long_long_name.o");
+  files.push_back("odd.txt");
+  files.push_back("even.txt");
+  Compile("long_long_long_long_name.o");
+  ASSERT_TRUE(WriteStringToFile("odd", "odd.txt"));
+  ASSERT_TRUE(WriteStringToFile("even", "even.txt"));
+
+  for (const bool use_mmap : {false, true}) {
+    SCOPED_TRACE(use_mmap);
+    ArFile::SetUseMmap(use_mmap);
+    for (const auto& op : {"rcu", "rcuT"}) {
+      SCOPED_TRACE(op);
+      remove("t.a");
+      Archive(op, "t.a", files);
+
+      ArFile expected("t.a");
+      ArFile a("t.a");
+      std::string header;
+      ASSERT_TRUE(expected.ReadHeader(&header));
+      ASSERT_TRUE(a.ReadHeader(&header));
+
+      // symbol table, long name table and 3 entries.
+      for (int i = 0; i < 5; ++i) {
+        SCOPED_TRACE(i);
+        ArFile::EntryHeader expected_header;
+        std::string expected_body;
+        ASSERT_TRUE(expected.ReadEntry(&expected_header, &expected_body));
+
+        ArFile::EntryHeader entry_header;
+        absl::string_view body;
+        std::string body_buffer;
+        ASSERT_TRUE(a.ReadEntryRef(&entry_header, &body, &body_buffer));
+        EXPECT_EQ(expected_header.DebugString(), entry_header.DebugString());
+        EXPECT_EQ(expected_body, body);
+      }
+      ArFile::EntryHeader entry_header;
+      absl::string_view body;
+      std::string body_buffer;
+      EXPECT_FALSE(a.ReadEntryRef(&entry_header, &body, &body_buffer));
+    }
+  }
+  ArFile::SetUseMmap(false);
+}
+
+TEST_F(ArFileTest, ReadEntryRefTruncated) {
+  std::vector<std::string> files;
+  files.push_back("first.txt");
+  files.push_back("second.txt");
+  ASSERT_TRUE(WriteStringToFile("first", "first.txt"));
+  ASSERT_TRUE(WriteStringToFile(std::string(8192, 'x'), "second.txt"));
+  Archive("rcS", "t.a", files);
+
+  ArFile::SetUseMmap(true);
+  ArFile a("t.a");
+  std::string header;
+  ASSERT_TRUE(a.ReadHeader(&header));
+  ArFile::EntryHeader entry_header;
+  absl::string_view body;
+  std::string body_buffer;
+  ASSERT_TRUE(a.ReadEntryRef(&entry_header, &body, &body_buffer));
+  EXPECT_TRUE(absl::StartsWith(entry_header.ar_name, "first.txt"))
+      << entry_header.ar_name;
+
+  // Keeps the header of second.txt, but truncates its body.
+  // Accessing the truncated part of the mapping would raise SIGBUS.
+  ASSERT_EQ(0, truncate("t.a", 200));
+  EXPECT_FALSE(a.ReadEntryRef(&entry_header, &body, &body_buffer));
+  ArFile::SetUseMmap(false);
+}
+#endif
+
 TEST_F(ArFileTest, ArEntryHeaderSize) {
   ArFile::EntryHeader entry_header;
   std::string buf;
@@ -0,0 +1,61 @@
+// Copyright 2021 The Goma Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "linker_driver_dump_cache.h"
+
+#include <utility>
+
+#include "counterz.h"
+#include "glog/logging.h"
+
+namespace devtools_goma {
+
+LinkerDriverDumpCache* LinkerDriverDumpCache::instance_;
+
+// static
+void LinkerDriverDumpCache::Init(size_t max_entries) {
+  instance_ = new LinkerDriverDumpCache(max_entries);
+}
+
+// static
+void LinkerDriverDumpCache::Quit() {
+  delete instance_;
+  instance_ = nullptr;
+}
+
+LinkerDriverDumpCache::LinkerDriverDumpCache(size_t max_entries)
+    : entries_("driver dump", max_entries) {}
+
+std::shared_ptr<const LinkerDriverDumpCache::Dump>
+LinkerDriverDumpCache::Lookup(const std::string& key) {
+  GOMA_COUNTERZ("LinkerDriverDumpCache::Lookup");
+
+  auto is_valid = [](const std::shared_ptr<const Dump>& dump) {
+    for (const auto& file : dump->files) {
+      if (FileStat(file.first) != file.second) {
+        VLOG(1) << "driver dump is invalidated by " << file.first;
+        return false;
+      }
+    }
+    return true;
+  };
+  std::shared_ptr<const Dump> dump;
+  if (!entries_.Lookup(key, is_valid, &dump)) {
+    return nullptr;
+  }
+  return dump;
+}
+
+bool LinkerDriverDumpCache::Insert(const std::string& key,
+                                   std::shared_ptr<const Dump> dump) {
+  for (const auto& file : dump->files) {
+    if (!IsCacheableFileStat("driver dump", file.first, file.second)) {
+      return false;
+    }
+  }
+  entries_.Insert(key, std::move(dump));
+  return true;
+}
+
+}  // namespace devtools_goma
@@ -0,0 +1,74 @@
+// Copyright 2021 The Goma Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef DEVTOOLS_GOMA_CLIENT_LINKER_LINKER_INPUT_PROCESSOR_LINKER_DRIVER_DUMP_CACHE_H_
+#define DEVTOOLS_GOMA_CLIENT_LINKER_LINKER_INPUT_PROCESSOR_LINKER_DRIVER_DUMP_CACHE_H_
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "basictypes.h"
+#include "file_stat.h"
+#include "file_stat_lru_cache.h"
+
+namespace devtools_goma {
+
+// LinkerDriverDumpCache stores the parsed output of "gcc -### ..." run by
+// LinkerInputProcessor, so that a link with the same compiler, flags and
+// environment doesn't need to run the driver again.
+//
+// A dump is identified by a key made from compiler info, link flags and
+// environment (see LinkerInputProcessor), and is invalidated when any
+// file the driver resolved by itself (e.g. crt1.o, collect2) is modified.
+// Like CppPreambleCache, it doesn't detect a newly created file that would
+// shadow a file resolved by the driver.
+class LinkerDriverDumpCache {
+ public:
+  struct Dump {
+    std::vector<std::string> driver_args;
+    std::vector<std::string> driver_envs;
+    // Files in |driver_args| that are not in the link flags, with their
+    // FileStat. paths are absolute.
+    std::vector<std::pair<std::string, FileStat>> files;
+  };
+
+  static LinkerDriverDumpCache* instance() { return instance_; }
+  static bool IsEnabled() { return instance_ != nullptr; }
+
+  // Initializes LinkerDriverDumpCache.
+  // If the number of entries exceeds |max_entries|, the least recently used
+  // entry will be evicted.
+  static void Init(size_t max_entries);
+  static void Quit();
+
+  // Returns the dump for |key| if no file in it is modified.
+  // Returns nullptr otherwise.
+  std::shared_ptr<const Dump> Lookup(const std::string& key);
+
+  // Stores |dump| for |key|.
+  // Returns false if |dump| is not cacheable, e.g. some file might be
+  // modified while running the driver.
+  bool Insert(const std::string& key, std::shared_ptr<const Dump> dump);
+
+  size_t size() const { return entries_.size(); }
+  int64_t hit() const { return entries_.hit(); }
+  int64_t miss() const { return entries_.miss(); }
+  int64_t invalidated() const { return entries_.invalidated(); }
+
+ private:
+  explicit LinkerDriverDumpCache(size_t max_entries);
+  ~LinkerDriverDumpCache() = default;
+
+  static LinkerDriverDumpCache* instance_;
+
+  FileStatLruCache<std::shared_ptr<const Dump>> entries_;
+
+  DISALLOW_COPY_AND_ASSIGN(LinkerDriverDumpCache);
+};
+
+}  // namespace devtools_goma
+
+#endif  // DEVTOOLS_GOMA_CLIENT_LINKER_LINKER_INPUT_PROCESSOR_LINKER_DRIVER_DUMP_CACHE_H_
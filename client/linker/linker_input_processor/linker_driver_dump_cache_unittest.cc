@@ -0,0 +1,71 @@
+// Copyright 2021 The Goma Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "linker_driver_dump_cache.h"
+
+#include <memory>
+#include <string>
+
+#include "absl/memory/memory.h"
+#include "client/unittest_util.h"
+#include "gtest/gtest.h"
+
+namespace devtools_goma {
+
+class LinkerDriverDumpCacheTest : public testing::Test {
+ public:
+  LinkerDriverDumpCacheTest() {
+    LinkerDriverDumpCache::Init(2);
+    tmpdir_util_ = absl::make_unique<TmpdirUtil>("linker_driver_dump_cache");
+  }
+
+  ~LinkerDriverDumpCacheTest() override { LinkerDriverDumpCache::Quit(); }
+
+ protected:
+  std::shared_ptr<LinkerDriverDumpCache::Dump> MakeDump(
+      const std::string& crt1,
+      const std::string& crtn) {
+    auto dump = std::make_shared<LinkerDriverDumpCache::Dump>();
+    dump->driver_args = {"/usr/bin/ld", crt1, "foo.o", crtn};
+    dump->driver_envs = {"LIBRARY_PATH=/usr/lib"};
+    dump->files.emplace_back(crt1, FileStat(crt1));
+    dump->files.emplace_back(crtn, FileStat(crtn));
+    return dump;
+  }
+
+  std::unique_ptr<TmpdirUtil> tmpdir_util_;
+};
+
+TEST_F(LinkerDriverDumpCacheTest, InvalidatedByAnyFile) {
+  LinkerDriverDumpCache* cache = LinkerDriverDumpCache::instance();
+  const std::string crt1 =
+      tmpdir_util_->CreateTmpFileWithOldMtime("crt1.o", "crt1");
+  const std::string crtn =
+      tmpdir_util_->CreateTmpFileWithOldMtime("crtn.o", "crtn");
+
+  EXPECT_TRUE(cache->Insert("key", MakeDump(crt1, crtn)));
+  std::shared_ptr<const LinkerDriverDumpCache::Dump> dump =
+      cache->Lookup("key");
+  ASSERT_NE(nullptr, dump);
+  EXPECT_EQ(4U, dump->driver_args.size());
+  EXPECT_EQ(1U, dump->driver_envs.size());
+
+  tmpdir_util_->CreateTmpFileWithOldMtime("crtn.o", "modified crtn");
+  EXPECT_EQ(nullptr, cache->Lookup("key"));
+  EXPECT_EQ(1, cache->invalidated());
+}
+
+TEST_F(LinkerDriverDumpCacheTest, NotCacheableIfAnyFileIsNew) {
+  LinkerDriverDumpCache* cache = LinkerDriverDumpCache::instance();
+  const std::string crt1 =
+      tmpdir_util_->CreateTmpFileWithOldMtime("crt1.o", "crt1");
+  // Newly created file might be modified in the same second.
+  tmpdir_util_->CreateTmpFile("crtn.o", "crtn");
+  const std::string crtn = tmpdir_util_->FullPath("crtn.o");
+
+  EXPECT_FALSE(cache->Insert("key", MakeDump(crt1, crtn)));
+  EXPECT_EQ(0U, cache->size());
+}
+
+}  // namespace devtools_goma
@@ -29,16 +29,19 @@
 #include "absl/strings/match.h"
 #include "absl/strings/string_view.h"
 #include "arfile.h"
+#include "binutils/dynamic_dep_index.h"
 #include "cmdline_parser.h"
 #include "compiler_flags.h"
 #include "compiler_flags_parser.h"
 #include "compiler_info.h"
 #include "compiler_specific.h"
 #include "content.h"
+#include "file_stat.h"
 #include "framework_path_resolver.h"
 #include "gcc_flags.h"
 #include "ioutil.h"
 #include "library_path_resolver.h"
+#include "linker_driver_dump_cache.h"
 #include "linker_script_parser.h"
 #include "path.h"
 #include "util.h"
@@ -47,12 +50,6 @@ MSVC_PUSH_DISABLE_WARNING_FOR_PROTO()
 #include "lib/goma_data.pb.h"
 MSVC_POP_WARNING()
 
-#ifdef __linux
-// TODO: port elf.h in MacOSX and eliminate this ifdef.
-// we want to run android cross compile (which uses ELF) on MacOSX.
-#include "binutils/elf_parser.h"
-#endif
-
 #ifdef __MACH__
 #include <mach-o/fat.h>
 #include <mach-o/loader.h>
@@ -98,7 +95,7 @@ LinkerInputProcessor::~LinkerInputProcessor() {
 }
 
 bool LinkerInputProcessor::GetInputFilesAndLibraryPath(
-    const CompilerInfo& /* compiler_info */,
+    const CompilerInfo& compiler_info,
     const CommandSpec& command_spec,
     std::set<std::string>* input_files,
     std::vector<std::string>* library_paths) {
@@ -107,7 +104,8 @@ bool LinkerInputProcessor::GetInputFilesAndLibraryPath(
   }
   std::vector<std::string> driver_args;
   std::vector<std::string> driver_envs;
-  if (!CaptureDriverCommandLine(command_spec, &driver_args, &driver_envs)) {
+  if (!CaptureDriverCommandLine(compiler_info, command_spec, &driver_args,
+                                &driver_envs)) {
     return false;
   }
   VLOG(1) << "driver command line:" << driver_args;
@@ -159,6 +157,7 @@ bool LinkerInputProcessor::GetInputFilesAndLibraryPath(
 }
 
 bool LinkerInputProcessor::CaptureDriverCommandLine(
+    const CompilerInfo& compiler_info,
     const CommandSpec& command_spec,
     std::vector<std::string>* driver_args,
     std::vector<std::string>* driver_envs) {
@@ -171,6 +170,20 @@ bool LinkerInputProcessor::CaptureDriverCommandLine(
   }
   std::vector<std::string> env;
   env.push_back("LC_ALL=C");
+
+  std::string dump_key;
+  if (LinkerDriverDumpCache::IsEnabled()) {
+    dump_key = MakeDriverDumpKey(compiler_info, dump_args, env, flags_->cwd());
+    std::shared_ptr<const LinkerDriverDumpCache::Dump> dump =
+        LinkerDriverDumpCache::instance()->Lookup(dump_key);
+    if (dump) {
+      VLOG(1) << "use cached driver dump";
+      *driver_args = dump->driver_args;
+      *driver_envs = dump->driver_envs;
+      return true;
+    }
+  }
+
   int32_t status = -1;
   const std::string dump_output =
       ReadCommandOutput(dump_args[0], dump_args, env, flags_->cwd(),
@@ -183,7 +196,53 @@ bool LinkerInputProcessor::CaptureDriverCommandLine(
     return false;
   }
 
-  return ParseDumpOutput(dump_output, driver_args, driver_envs);
+  if (!ParseDumpOutput(dump_output, driver_args, driver_envs)) {
+    return false;
+  }
+
+  if (!dump_key.empty()) {
+    auto dump = std::make_shared<LinkerDriverDumpCache::Dump>();
+    dump->driver_args = *driver_args;
+    dump->driver_envs = *driver_envs;
+    // Files given in the flags are passed through to the linker as is, so
+    // only files resolved by the driver need to be checked.
+    const std::set<std::string> flag_args(flags_->args().begin(),
+                                          flags_->args().end());
+    for (const auto& arg : *driver_args) {
+      if (!file::IsAbsolutePath(arg) || flag_args.count(arg)) {
+        continue;
+      }
+      FileStat file_stat(arg);
+      if (!file_stat.IsValid() || file_stat.is_directory) {
+        continue;
+      }
+      dump->files.emplace_back(arg, std::move(file_stat));
+    }
+    LinkerDriverDumpCache::instance()->Insert(dump_key, std::move(dump));
+  }
+  return true;
+}
+
+// static
+std::string LinkerInputProcessor::MakeDriverDumpKey(
+    const CompilerInfo& compiler_info,
+    const std::vector<std::string>& dump_args,
+    const std::vector<std::string>& env,
+    const std::string& cwd) {
+  // Use '\0' as a separator since it never appears in args.
+  std::string key = compiler_info.local_compiler_hash();
+  key += '\0';
+  key += cwd;
+  for (const auto& arg : dump_args) {
+    key += '\0';
+    key += arg;
+  }
+  key += '\0';
+  for (const auto& e : env) {
+    key += '\0';
+    key += e;
+  }
+  return key;
 }
 
 /* static */
@@ -440,13 +499,12 @@ void LinkerInputProcessor::TryParseElfNeeded(
     const std::string& filename,
     std::vector<std::string>* input_paths) {
 #ifdef __linux__
-  std::unique_ptr<ElfParser> elf(ElfParser::NewElfParser(filename));
-  if (elf == nullptr) {
-    return;
-  }
   std::vector<std::string> needed;
-  if (!elf->ReadDynamicNeeded(&needed))
+  std::vector<std::string> rpaths;
+  if (!DynamicDepIndex::ReadElfDynamicNeededAndRpath(filename, &needed,
+                                                     &rpaths)) {
     return;
+  }
   for (const auto& path : needed) {
     std::string pathname = library_path_resolver_->FindBySoname(path);
     if (pathname.empty()) {
@@ -469,16 +527,36 @@ void LinkerInputProcessor::TryParseMachONeeded(
     const std::string& filename,
     const int max_recursion,
     std::set<std::string>* input_files) {
-  MachO macho(filename);
-  if (!macho.valid())
-    return;
-
-  std::vector<MachO::DylibEntry> needed;
-  if (!macho.GetDylibs(arch_, &needed))
-    return;
+  std::vector<std::string> needed;
+  const std::string index_key = arch_ + ":" + filename;
+  FileStat file_stat;
+  DynamicDepIndex::Deps deps;
+  if (DynamicDepIndex::IsEnabled()) {
+    file_stat = FileStat(filename);
+  }
+  if (DynamicDepIndex::IsEnabled() &&
+      DynamicDepIndex::instance()->Lookup(index_key, file_stat, &deps)) {
+    needed = std::move(deps.needed);
+  } else {
+    MachO macho(filename);
+    if (!macho.valid())
+      return;
+
+    std::vector<MachO::DylibEntry> dylibs;
+    if (!macho.GetDylibs(arch_, &dylibs))
+      return;
+    for (const auto& dylib : dylibs) {
+      needed.push_back(dylib.name);
+    }
+    if (DynamicDepIndex::IsEnabled()) {
+      deps.needed = needed;
+      DynamicDepIndex::instance()->Insert(index_key, file_stat,
+                                          std::move(deps));
+    }
+  }
 
   for (size_t i = 0; i < needed.size(); ++i) {
-    std::string dylib_name = needed[i].name;
+    std::string dylib_name = needed[i];
 
     if (dylib_name[0] == '/')
       dylib_name = file::JoinPath(library_path_resolver_->syslibroot(),
@@ -40,6 +40,7 @@ class LinkerInputProcessor {
   // Gets input files for command specified by args and library paths.
   // It runs command with -### flag, which dumps command line arguments
   // of collect2 or ld, and collects input files and library paths.
+  // The dumped command line is cached in LinkerDriverDumpCache if enabled.
   // It also checks libraries specified by -L and -l.
   // If a library is a thin archive, it also includes files listed in the
   // thin archive as input files.
@@ -57,10 +58,20 @@ class LinkerInputProcessor {
   friend class LinkerInputProcessorTest;
   // Provided for test.
   explicit LinkerInputProcessor(const std::string& current_directory);
-  bool CaptureDriverCommandLine(const CommandSpec& command_spec,
+  // Runs the driver with -### and parses its output.
+  // The parsed output is stored in LinkerDriverDumpCache if enabled.
+  bool CaptureDriverCommandLine(const CompilerInfo& compiler_info,
+                                const CommandSpec& command_spec,
                                 std::vector<std::string>* driver_args,
                                 std::vector<std::string>* driver_envs);
 
+  // Returns a key of LinkerDriverDumpCache.
+  static std::string MakeDriverDumpKey(
+      const CompilerInfo& compiler_info,
+      const std::vector<std::string>& dump_args,
+      const std::vector<std::string>& env,
+      const std::string& cwd);
+
   // Parses outputs of "gcc -### ..."
   static bool ParseDumpOutput(const std::string& dump_output,
                               std::vector<std::string>* driver_args,
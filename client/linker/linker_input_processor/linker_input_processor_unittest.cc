@@ -16,15 +16,24 @@
 #include <vector>
 
 #include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
 #include "compiler_info.h"
+#include "compiler_specific.h"
+#include "cxx/cxx_compiler_info.h"
 #include "glog/logging.h"
 #include "gtest/gtest.h"
 #include "ioutil.h"
 #include "library_path_resolver.h"
+#include "linker_driver_dump_cache.h"
 #include "linker_input_processor.h"
 #include "path.h"
 #include "path_util.h"
 #include "unittest_util.h"
+#include "util.h"
+
+MSVC_PUSH_DISABLE_WARNING_FOR_PROTO()
+#include "lib/goma_data.pb.h"
+MSVC_POP_WARNING()
 
 namespace devtools_goma {
 
@@ -39,6 +48,24 @@ static const char *kMachMagic64 = "\xfe\xed\xfa\xcf blahblahblah";
 static const char *kMachCigam64 = "\xcf\xfa\xed\xfe blahblahblah";
 #endif
 
+// Fake of ReadCommandOutput for "gcc -### ...", which counts the calls and
+// dumps a linker command line with crt1.o resolved by the driver.
+static int g_read_command_output_count = 0;
+static std::string g_crt1_path;
+
+static std::string FakeReadCommandOutput(const std::string& prog,
+                                         const std::vector<std::string>& argv,
+                                         const std::vector<std::string>& env,
+                                         const std::string& cwd,
+                                         CommandOutputOption option,
+                                         int32_t* status) {
+  ++g_read_command_output_count;
+  *status = 0;
+  return absl::StrCat("Thread model: posix\n",
+                      " \"/usr/bin/ld\" \"-o\" \"a.out\" \"", g_crt1_path,
+                      "\" \"foo.o\"");
+}
+
 class LinkerInputProcessorTest : public testing::Test {
  public:
   void SetUp() override {
@@ -78,6 +105,21 @@ class LinkerInputProcessorTest : public testing::Test {
          back_inserter(*searchdirs));
   }
 
+  bool CaptureDriverCommandLine(const std::vector<std::string>& args,
+                                std::vector<std::string>* driver_args) {
+    LinkerInputProcessor linker_input_processor(args, tmpdir_);
+    std::unique_ptr<CompilerInfoData> data(new CompilerInfoData);
+    data->set_found(true);
+    data->set_local_compiler_hash("gcc_hash");
+    data->mutable_cxx();
+    CxxCompilerInfo compiler_info(std::move(data));
+    CommandSpec command_spec;
+    command_spec.set_local_compiler_path("/usr/bin/gcc");
+    std::vector<std::string> driver_envs;
+    return linker_input_processor.CaptureDriverCommandLine(
+        compiler_info, command_spec, driver_args, &driver_envs);
+  }
+
   LinkerInputProcessor::FileType CheckFileType(const std::string& path) {
     return LinkerInputProcessor::CheckFileType(
         tmpdir_util_->FullPath(path));
@@ -1045,6 +1087,38 @@ TEST_F(LinkerInputProcessorTest, CheckFileType) {
 #endif
 }
 
+TEST_F(LinkerInputProcessorTest, CaptureDriverCommandLineWithCache) {
+  LinkerDriverDumpCache::Init(10);
+  InstallReadCommandOutputFunc(FakeReadCommandOutput);
+  g_read_command_output_count = 0;
+  g_crt1_path = tmpdir_util_->CreateTmpFileWithOldMtime("lib/crt1.o", "crt1");
+  const std::vector<std::string> args{"gcc", "-o", "a.out", "foo.o"};
+  const std::vector<std::string> expected_args{"/usr/bin/ld", "-o", "a.out",
+                                               g_crt1_path, "foo.o"};
+
+  std::vector<std::string> driver_args;
+  EXPECT_TRUE(CaptureDriverCommandLine(args, &driver_args));
+  EXPECT_EQ(expected_args, driver_args);
+  EXPECT_EQ(1, g_read_command_output_count);
+
+  // The same flags use the cached dump without running the driver.
+  driver_args.clear();
+  EXPECT_TRUE(CaptureDriverCommandLine(args, &driver_args));
+  EXPECT_EQ(expected_args, driver_args);
+  EXPECT_EQ(1, g_read_command_output_count);
+
+  // crt1.o is not in the flags, but is resolved by the driver, so
+  // modifying it runs the driver again.
+  tmpdir_util_->CreateTmpFileWithOldMtime("lib/crt1.o", "modified crt1");
+  driver_args.clear();
+  EXPECT_TRUE(CaptureDriverCommandLine(args, &driver_args));
+  EXPECT_EQ(expected_args, driver_args);
+  EXPECT_EQ(2, g_read_command_output_count);
+
+  InstallReadCommandOutputFunc(nullptr);
+  LinkerDriverDumpCache::Quit();
+}
+
 #ifdef __linux__
 // TODO: investigate reason why this fails.
 TEST_F(LinkerInputProcessorTest, ParseThinArchive) {
@@ -30,6 +30,10 @@
 //
 // proto_file = <cache dir>/<first 2 chars of key>/<key>
 //   <key> is always hex notation of SHA256.
+// content_file = <cache dir>/<first 2 chars of key>/<key>.<index>
+//   content of <index>-th output file, if it is not in proto_file.
+//   content_file is cloned from/to output file if filesystem supports it.
+//   The size of content files is accounted in the cache entry of <key>.
 
 #include "local_output_cache.h"
 
@@ -40,6 +44,10 @@
 #include <memory>
 #include <vector>
 
+#include "absl/container/flat_hash_map.h"
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_cat.h"
+
 #include "absl/time/clock.h"
 #include "callback.h"
 #include "compiler_flag_type_specific.h"
@@ -48,6 +56,7 @@
 #include "file_stat.h"
 #include "filesystem.h"
 #include "glog/logging.h"
+#include "goma_data_util.h"
 #include "goma_hash.h"
 #include "histogram.h"
 #include "options.h"
@@ -89,6 +98,7 @@ LocalOutputCache::LocalOutputCache(std::string cache_dir,
       threshold_cache_amount_byte_(threshold_cache_amount_byte),
       max_cache_items_(max_cache_items),
       threshold_cache_items_(threshold_cache_items),
+      use_hardlink_(false),
       ready_(false),
       entries_total_cache_amount_(0),
       gc_should_done_(false),
@@ -213,6 +223,11 @@ void LocalOutputCache::LoadCacheEntries() {
       }
     }
 
+    // content file size by key.
+    absl::flat_hash_map<std::string, std::int64_t> content_file_sizes;
+    // cache entries found in this directory, by key.
+    absl::flat_hash_map<std::string, size_t> entry_index;
+
     for (const auto& key_entry : key_entries) {
       if (key_entry.name == "." || key_entry.name == "..") {
         continue;
@@ -230,8 +245,18 @@ void LocalOutputCache::LoadCacheEntries() {
         continue;
       }
 
+      absl::string_view name = key_entry.name;
+      absl::string_view content_index;
+      size_t dot = name.find('.');
+      if (dot != absl::string_view::npos) {
+        content_index = name.substr(dot + 1);
+        name = name.substr(0, dot);
+      }
+      int index = 0;
       SHA256HashValue key;
-      if (!SHA256HashValue::ConvertFromHexString(key_entry.name, &key)) {
+      if (!SHA256HashValue::ConvertFromHexString(std::string(name), &key) ||
+          (dot != absl::string_view::npos &&
+           !absl::SimpleAtoi(content_index, &index))) {
         LOG(WARNING) << "Invalid filename found. remove: filename="
                      << cache_file_path;
         ::util::Status status = file::Delete(cache_file_path, file::Defaults());
@@ -259,9 +284,34 @@ void LocalOutputCache::LoadCacheEntries() {
       }
 
       total_file_size += file_stat.size;
+      if (dot != absl::string_view::npos) {
+        content_file_sizes[std::string(name)] += file_stat.size;
+        continue;
+      }
+      entry_index[key_entry.name] = cache_entries.size();
       cache_entries.emplace_back(
           key, CacheEntry(*file_stat.mtime, file_stat.size));
     }
+
+    for (const auto& content_file_size : content_file_sizes) {
+      auto found = entry_index.find(content_file_size.first);
+      if (found != entry_index.end()) {
+        cache_entries[found->second].second.amount_byte +=
+            content_file_size.second;
+        continue;
+      }
+      // content files without proto file. e.g. compiler_proxy was killed
+      // during SaveOutput.
+      LOG(INFO) << "orphan content files found. remove: key="
+                << content_file_size.first;
+      total_file_size -= content_file_size.second;
+      for (int i = 0;
+           remove(file::JoinPath(cache_dir_with_key_prefix,
+                                 absl::StrCat(content_file_size.first, ".",
+                                              i)).c_str()) == 0;
+           ++i) {
+      }
+    }
   }
 
   LOG(INFO) << "walk_time=" << walk_timer.GetDuration() << " "
@@ -457,6 +507,8 @@ void LocalOutputCache::RunGarbageCollection(GarbageCollectionStat* stat) {
       LOG(ERROR) << "failed to remove cache: path=" << cache_file_path;
       break;
     }
+    for (int i = 0; remove(ContentFilePath(key_string, i).c_str()) == 0; ++i) {
+    }
 
     stat->num_removed += 1;
     stat->removed_bytes += entry.amount_byte;
@@ -480,10 +532,12 @@ void LocalOutputCache::SetReady(bool ready) {
   ready_ = ready;
 }
 
-bool LocalOutputCache::SaveOutput(const std::string& key,
-                                  const ExecReq* req,
-                                  const ExecResp* resp,
-                                  const std::string& trace_id) {
+bool LocalOutputCache::SaveOutput(
+    const std::string& key,
+    const ExecReq* req,
+    const ExecResp* resp,
+    const std::vector<std::string>& output_hash_keys,
+    const std::string& trace_id) {
   WaitUntilReady();
   SimpleTimer timer(SimpleTimer::START);
 
@@ -504,10 +558,12 @@ bool LocalOutputCache::SaveOutput(const std::string& key,
     return false;
   }
 
-  // --- Make cache_entry.
+  // --- Make cache_entry, and clone output files to content files.
   LocalOutputCacheEntry cache_entry;
+  std::int64_t content_amount_in_byte = 0;
   const ExecResult& result = resp->result();
-  for (const auto& output : result.output()) {
+  for (int i = 0; i < result.output_size(); ++i) {
+    const ExecResult_Output& output = result.output(i);
     std::string src_path =
         file::JoinPathRespectAbsolute(req->cwd(), output.filename());
     if (req->has_original_cwd()) {
@@ -515,16 +571,31 @@ bool LocalOutputCache::SaveOutput(const std::string& key,
           file::JoinPathRespectAbsolute(req->original_cwd(), output.filename());
     }
 
-    std::string output_file_content;
-    if (!ReadFileToString(src_path, &output_file_content)) {
-      LOG(ERROR) << " failed to read file: " << src_path;
+    const std::string content_file = ContentFilePath(key, i);
+    std::int64_t size = 0;
+    CloneFileMethod method =
+        CloneFile(src_path, content_file,
+                  output.is_executable() ? 0755 : 0644,
+                  /*allow_hardlink=*/false, &size);
+    if (method == CloneFileMethod::kFailed) {
+      LOG(ERROR) << trace_id << " failed to save file: " << src_path;
+      for (int j = 0; j <= i; ++j) {
+        remove(ContentFilePath(key, j).c_str());
+      }
+      stats_save_failure_.Add(1);
       return false;
     }
+    RecordCloneFile(method, size);
+    content_amount_in_byte += size;
 
     LocalOutputCacheFile* cache_file = cache_entry.add_files();
     cache_file->set_filename(output.filename());
-    cache_file->set_content(std::move(output_file_content));
     cache_file->set_is_executable(output.is_executable());
+    cache_file->set_content_in_file(true);
+    cache_file->set_size(size);
+    if (static_cast<size_t>(i) < output_hash_keys.size()) {
+      cache_file->set_hash_key(output_hash_keys[i]);
+    }
   }
 
   // --- Serialize LocalOutputCacheEntry to a file.
@@ -559,7 +630,7 @@ bool LocalOutputCache::SaveOutput(const std::string& key,
       return false;
     }
 
-    cache_amount_in_byte = serialized.size();
+    cache_amount_in_byte = serialized.size() + content_amount_in_byte;
   }
 
   AddCacheEntry(key_hash, cache_amount_in_byte);
@@ -572,6 +643,7 @@ bool LocalOutputCache::SaveOutput(const std::string& key,
 
 bool LocalOutputCache::Lookup(const std::string& key,
                               ExecResp* resp,
+                              std::vector<std::string>* content_files,
                               const std::string& trace_id) {
   WaitUntilReady();
   SimpleTimer timer(SimpleTimer::START);
@@ -609,20 +681,46 @@ bool LocalOutputCache::Lookup(const std::string& key,
     return false;
   }
 
-  UpdateCacheEntry(key_hash);
-
   // Create dummy ExecResp from LocalOutputCacheEntry.
-  resp->set_cache_hit(ExecResp::LOCAL_OUTPUT_CACHE);
-  ExecResult* result = resp->mutable_result();
+  ExecResp cache_resp;
+  std::vector<std::string> cache_content_files;
+  cache_resp.set_cache_hit(ExecResp::LOCAL_OUTPUT_CACHE);
+  ExecResult* result = cache_resp.mutable_result();
   result->set_exit_status(0);
-  for (auto&& file : cache_entry.files()) {
+  for (int i = 0; i < cache_entry.files_size(); ++i) {
+    LocalOutputCacheFile* file = cache_entry.mutable_files(i);
     ExecResult_Output* output = result->add_output();
-    output->set_filename(file.filename());
-    output->set_is_executable(file.is_executable());
+    output->set_filename(file->filename());
+    output->set_is_executable(file->is_executable());
     FileBlob* blob = output->mutable_blob();
-    blob->set_blob_type(FileBlob::FILE);  // Always FILE.
-    blob->set_file_size(file.content().size());
-    blob->set_content(std::move(file.content()));
+    std::string content_file;
+    if (file->content_in_file()) {
+      content_file = ContentFilePath(key, i);
+      if (content_files != nullptr && !file->hash_key().empty()) {
+        // Content will be cloned by MaterializeOutput.
+        blob->set_blob_type(FileBlob::FILE_REF);
+        blob->set_file_size(file->size());
+        blob->add_hash_key(file->hash_key());
+        cache_content_files.push_back(std::move(content_file));
+        continue;
+      }
+      if (!ReadFileToString(content_file, file->mutable_content())) {
+        LOG(ERROR) << trace_id << " LocalOutputCache: failed to read:"
+                   << " path=" << content_file;
+        stats_lookup_failure_.Add(1);
+        return false;
+      }
+    }
+    blob->set_blob_type(FileBlob::FILE);
+    blob->set_file_size(file->content().size());
+    blob->set_content(std::move(*file->mutable_content()));
+    cache_content_files.emplace_back();
+  }
+
+  UpdateCacheEntry(key_hash);
+  *resp = std::move(cache_resp);
+  if (content_files != nullptr) {
+    *content_files = std::move(cache_content_files);
   }
 
   stats_lookup_success_.Add(1);
@@ -631,6 +729,47 @@ bool LocalOutputCache::Lookup(const std::string& key,
   return true;
 }
 
+bool LocalOutputCache::MaterializeOutput(const std::string& content_file,
+                                         const std::string& dst,
+                                         int mode,
+                                         const std::string& trace_id) {
+  SimpleTimer timer(SimpleTimer::START);
+  std::int64_t size = 0;
+  CloneFileMethod method =
+      CloneFile(content_file, dst, mode, use_hardlink_.load(), &size);
+  if (method == CloneFileMethod::kFailed) {
+    LOG(WARNING) << trace_id << " LocalOutputCache: failed to materialize:"
+                 << " path=" << content_file << " dst=" << dst;
+    stats_commit_failure_.Add(1);
+    return false;
+  }
+  VLOG(1) << trace_id << " LocalOutputCache: materialized " << dst
+          << " by " << CloneFileMethodName(method) << " size=" << size;
+  RecordCloneFile(method, size);
+  stats_commit_success_.Add(1);
+  stats_commit_success_time_ms_.Add(
+      absl::ToInt64Milliseconds(timer.GetDuration()));
+  return true;
+}
+
+void LocalOutputCache::RecordCloneFile(CloneFileMethod method,
+                                       std::int64_t size) {
+  switch (method) {
+    case CloneFileMethod::kHardLink:
+      stats_hardlinked_bytes_.Add(size);
+      break;
+    case CloneFileMethod::kReflink:
+      stats_cloned_bytes_.Add(size);
+      break;
+    case CloneFileMethod::kCopyFileRange:
+    case CloneFileMethod::kCopy:
+      stats_copied_bytes_.Add(size);
+      break;
+    case CloneFileMethod::kFailed:
+      break;
+  }
+}
+
 std::string LocalOutputCache::CacheDirWithKeyPrefix(
     absl::string_view key) const {
   return file::JoinPath(cache_dir_, key.substr(0, 2));
@@ -640,6 +779,11 @@ std::string LocalOutputCache::CacheFilePath(absl::string_view key) const {
   return file::JoinPath(cache_dir_, key.substr(0, 2), key);
 }
 
+std::string LocalOutputCache::ContentFilePath(absl::string_view key,
+                                              int index) const {
+  return absl::StrCat(CacheFilePath(key), ".", index);
+}
+
 void LocalOutputCache::DumpStatsToProto(LocalOutputCacheStats* stats) {
   stats->set_save_success(stats_save_success_.value());
   stats->set_save_success_time_ms(stats_save_success_time_ms_.value());
@@ -656,6 +800,10 @@ void LocalOutputCache::DumpStatsToProto(LocalOutputCacheStats* stats) {
 
   stats->set_gc_count(stats_gc_count_.value());
   stats->set_gc_total_time_ms(stats_gc_total_time_ms_.value());
+
+  stats->set_cloned_bytes(stats_cloned_bytes_.value());
+  stats->set_copied_bytes(stats_copied_bytes_.value());
+  stats->set_hardlinked_bytes(stats_hardlinked_bytes_.value());
 }
 
 size_t LocalOutputCache::TotalCacheCount() {
@@ -6,14 +6,17 @@
 #ifndef DEVTOOLS_GOMA_CLIENT_LOCAL_OUTPUT_CACHE_H_
 #define DEVTOOLS_GOMA_CLIENT_LOCAL_OUTPUT_CACHE_H_
 
+#include <atomic>
 #include <cstdint>
 #include <string>
+#include <vector>
 
 #include "absl/strings/string_view.h"
 #include "absl/time/time.h"
 #include "atomic_stats_counter.h"
 #include "autolock_timer.h"
 #include "compiler_specific.h"
+#include "file_helper.h"
 #include "goma_hash.h"
 #include "linked_unordered_map.h"
 #include "worker_thread_manager.h"
@@ -58,20 +61,56 @@ class LocalOutputCache {
   static std::string MakeCacheKey(const ExecReq& req);
 
   // SaveOutput copies output files to cache.
+  // Output files are cloned to cache files if filesystem supports it.
+  // |output_hash_keys| are hash keys of output file blobs, in the same order
+  // with |resp|'s outputs, if known.  It may be empty.
   // |trace_id| is just used for logging.
   bool SaveOutput(const std::string& key,
                   const ExecReq* req,
                   const ExecResp* resp,
+                  const std::vector<std::string>& output_hash_keys,
                   const std::string& trace_id);
+  bool SaveOutput(const std::string& key,
+                  const ExecReq* req,
+                  const ExecResp* resp,
+                  const std::string& trace_id) {
+    return SaveOutput(key, req, resp, std::vector<std::string>(), trace_id);
+  }
 
   // Finds cache with |key|.
   // Returns true when a cache is found and read correctly. In this case,
   // |resp| will be filled with output data.
   // Otherwise, false is returned.
+  // If |content_files| is not nullptr, it will have the same number of
+  // entries as |resp|'s outputs. When an output content is stored in a cache
+  // file and its hash key is known, the output blob will be FILE_REF without
+  // content, and the corresponding |content_files| entry will be the cache
+  // file path, which should be materialized by MaterializeOutput().
+  // Otherwise, the output blob will have content and the entry is empty.
   // |trace_id| is just used for logging.
   bool Lookup(const std::string& key,
               ExecResp* resp,
+              std::vector<std::string>* content_files,
               const std::string& trace_id);
+  bool Lookup(const std::string& key,
+              ExecResp* resp,
+              const std::string& trace_id) {
+    return Lookup(key, resp, nullptr, trace_id);
+  }
+
+  // Makes |dst| from |content_file| returned by Lookup().
+  // It uses hard link if enabled, or clone/copy.
+  // Note that |content_file| might be removed by garbage collection after
+  // Lookup(), then this returns false.
+  bool MaterializeOutput(const std::string& content_file,
+                         const std::string& dst,
+                         int mode,
+                         const std::string& trace_id);
+
+  // If true, MaterializeOutput uses hard link to cache files.
+  // It is the fastest, but output files share the inode with cache files,
+  // so a tool modifying output files in place would break the cache.
+  void SetUseHardLink(bool use_hardlink) { use_hardlink_ = use_hardlink; }
 
   // Dumps stats.
   void DumpStatsToProto(LocalOutputCacheStats* stats);
@@ -136,6 +175,11 @@ class LocalOutputCache {
   std::string CacheDirWithKeyPrefix(absl::string_view key) const;
   // Full path of cache directory + key prefix + key.
   std::string CacheFilePath(absl::string_view key) const;
+  // Full path of cache file for |index|-th output content of |key|.
+  std::string ContentFilePath(absl::string_view key, int index) const;
+
+  // Records bytes saved/materialized by |method| in stats.
+  void RecordCloneFile(CloneFileMethod method, std::int64_t size);
 
   static LocalOutputCache* instance_;
 
@@ -145,6 +189,7 @@ class LocalOutputCache {
   const std::int64_t threshold_cache_amount_byte_;
   const size_t max_cache_items_;
   const size_t threshold_cache_items_;
+  std::atomic<bool> use_hardlink_;
 
   // Using in initial load of cache entries.
   // After loading all cache entries, |ready_| will become true.
@@ -180,6 +225,10 @@ class LocalOutputCache {
   StatsCounter stats_gc_count_;
   StatsCounter stats_gc_total_time_ms_;
 
+  StatsCounter stats_cloned_bytes_;
+  StatsCounter stats_copied_bytes_;
+  StatsCounter stats_hardlinked_bytes_;
+
   StatsCounter stats_gc_removed_items_;
   StatsCounter stats_gc_removed_bytes_;
   StatsCounter stats_gc_failed_items_;
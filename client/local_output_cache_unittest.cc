@@ -13,6 +13,7 @@
 #include "absl/memory/memory.h"
 #include "absl/strings/string_view.h"
 #include "content.h"
+#include "file_helper.h"
 #include "path.h"
 #include "unittest_util.h"
 
@@ -131,6 +132,50 @@ TEST_F(LocalOutputCacheTest, Match) {
   EXPECT_EQ(1, looked_up_resp.result().output_size());
   EXPECT_EQ("output.o",
             looked_up_resp.result().output(0).filename());
+  EXPECT_EQ(FileBlob::FILE,
+            looked_up_resp.result().output(0).blob().blob_type());
+  EXPECT_EQ("(output)", looked_up_resp.result().output(0).blob().content());
+}
+
+TEST_F(LocalOutputCacheTest, MatchWithContentFiles) {
+  InitLocalOutputCache();
+
+  const std::string trace_id = "(test-match-content-files)";
+
+  ExecReq req = MakeFakeExecReq();
+  ExecResp resp = MakeFakeExecResp();
+
+  tmpdir_->CreateTmpFile("build/output.o", "(output)");
+  std::string key = LocalOutputCache::MakeCacheKey(req);
+  const std::vector<std::string> hash_keys = {"(hash key)"};
+
+  EXPECT_TRUE(LocalOutputCache::instance()->SaveOutput(
+                  key, &req, &resp, hash_keys, trace_id));
+
+  tmpdir_->RemoveTmpFile("build/output.o");
+
+  ExecResp looked_up_resp;
+  std::vector<std::string> content_files;
+  EXPECT_TRUE(LocalOutputCache::instance()->Lookup(key,
+                                                   &looked_up_resp,
+                                                   &content_files,
+                                                   trace_id));
+
+  ASSERT_EQ(1, looked_up_resp.result().output_size());
+  const FileBlob& blob = looked_up_resp.result().output(0).blob();
+  EXPECT_EQ(FileBlob::FILE_REF, blob.blob_type());
+  EXPECT_EQ(8, blob.file_size());
+  ASSERT_EQ(1, blob.hash_key_size());
+  EXPECT_EQ("(hash key)", blob.hash_key(0));
+  ASSERT_EQ(1U, content_files.size());
+  EXPECT_FALSE(content_files[0].empty());
+
+  const std::string output_path = tmpdir_->FullPath("build/output.o");
+  EXPECT_TRUE(LocalOutputCache::instance()->MaterializeOutput(
+      content_files[0], output_path, 0644, trace_id));
+  std::string content;
+  EXPECT_TRUE(ReadFileToString(output_path, &content));
+  EXPECT_EQ("(output)", content);
 }
 
 TEST_F(LocalOutputCacheTest, NoMatch) {
@@ -183,6 +228,8 @@ TEST_F(LocalOutputCacheTest, CollectGarbage) {
     LocalOutputCache::GarbageCollectionStat stat;
     RunGarbageCollection(&stat);
     EXPECT_NE(0, access(path.c_str(), F_OK));
+    // content file should be removed too.
+    EXPECT_NE(0, access((path + ".0").c_str(), F_OK));
     EXPECT_EQ(1U, stat.num_removed);
     EXPECT_EQ(0U, stat.num_failed);
   }
@@ -0,0 +1,121 @@
+// Copyright 2021 The Goma Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "rust/rustc_deps_cache.h"
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "counterz.h"
+#include "glog/logging.h"
+#include "goma_hash.h"
+#include "path.h"
+
+namespace devtools_goma {
+
+RustcDepsCache* RustcDepsCache::instance_;
+
+// static
+void RustcDepsCache::Init(size_t max_entries) {
+  instance_ = new RustcDepsCache(max_entries);
+}
+
+// static
+void RustcDepsCache::Quit() {
+  delete instance_;
+  instance_ = nullptr;
+}
+
+RustcDepsCache::RustcDepsCache(size_t max_entries)
+    : entries_("rustc deps", max_entries) {}
+
+// static
+bool RustcDepsCache::IsValidFile(const FileInfo& file, FileStat* file_stat) {
+  *file_stat = FileStat(file.path);
+  if (*file_stat == file.file_stat) {
+    return true;
+  }
+  if (!file_stat->IsValid()) {
+    return false;
+  }
+  // FileStat is changed, but the content might be the same.
+  std::string content_hash;
+  if (!GomaSha256FromFile(file.path, &content_hash)) {
+    return false;
+  }
+  return content_hash == file.content_hash;
+}
+
+std::shared_ptr<const RustcDepsCache::Deps> RustcDepsCache::Lookup(
+    const std::string& key) {
+  GOMA_COUNTERZ("RustcDepsCache::Lookup");
+
+  // Current FileStat of deps->files.
+  std::vector<FileStat> file_stats;
+  auto is_valid = [&file_stats](const std::shared_ptr<const Deps>& deps) {
+    file_stats.clear();
+    for (const auto& file : deps->files) {
+      FileStat file_stat;
+      if (!IsValidFile(file, &file_stat)) {
+        VLOG(1) << "rustc deps is invalidated by " << file.path;
+        return false;
+      }
+      file_stats.push_back(std::move(file_stat));
+    }
+    return true;
+  };
+  std::shared_ptr<const Deps> deps;
+  if (!entries_.Lookup(key, is_valid, &deps)) {
+    return nullptr;
+  }
+
+  // Store FileStat of files whose content is verified by hash, so that
+  // the next lookup doesn't compute the hash again.
+  std::shared_ptr<Deps> refreshed;
+  for (size_t i = 0; i < deps->files.size(); ++i) {
+    const FileInfo& file = deps->files[i];
+    if (file_stats[i] == file.file_stat ||
+        !IsCacheableFileStat("rustc deps", file.path, file_stats[i])) {
+      continue;
+    }
+    if (!refreshed) {
+      refreshed = std::make_shared<Deps>(*deps);
+    }
+    refreshed->files[i].file_stat = file_stats[i];
+  }
+  if (refreshed) {
+    entries_.Insert(key, refreshed);
+    deps = std::move(refreshed);
+  }
+  return deps;
+}
+
+bool RustcDepsCache::Insert(const std::string& key,
+                            const std::string& cwd,
+                            const std::set<std::string>& required_files) {
+  GOMA_COUNTERZ("RustcDepsCache::Insert");
+
+  auto deps = std::make_shared<Deps>();
+  deps->required_files = required_files;
+  deps->files.reserve(required_files.size());
+  for (const auto& filename : required_files) {
+    FileInfo file;
+    file.path = file::JoinPathRespectAbsolute(cwd, filename);
+    file.file_stat = FileStat(file.path);
+    if (!IsCacheableFileStat("rustc deps", file.path, file.file_stat)) {
+      return false;
+    }
+    if (!GomaSha256FromFile(file.path, &file.content_hash)) {
+      LOG(WARNING) << "failed to compute hash of " << file.path;
+      return false;
+    }
+    deps->files.push_back(std::move(file));
+  }
+
+  entries_.Insert(key, std::move(deps));
+  return true;
+}
+
+}  // namespace devtools_goma
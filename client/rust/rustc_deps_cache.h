@@ -0,0 +1,89 @@
+// Copyright 2021 The Goma Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef DEVTOOLS_GOMA_CLIENT_RUST_RUSTC_DEPS_CACHE_H_
+#define DEVTOOLS_GOMA_CLIENT_RUST_RUSTC_DEPS_CACHE_H_
+
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "basictypes.h"
+#include "file_stat.h"
+#include "file_stat_lru_cache.h"
+
+namespace devtools_goma {
+
+// RustcDepsCache keeps required files of a crate listed by
+// "rustc --emit=dep-info", so that RustcIncludeProcessor doesn't need to
+// run rustc locally for a crate whose sources are not modified.
+//
+// Like DepsCache, an entry is identified by a key made from compiler info,
+// flags and the crate root (see RustcIncludeProcessor), and is invalidated
+// when the content of any required file is modified.
+// A required file whose FileStat is changed but whose content is the same
+// (e.g. a generated file written again) doesn't invalidate the entry.
+class RustcDepsCache {
+ public:
+  struct FileInfo {
+    // Absolute path of the file.
+    std::string path;
+    FileStat file_stat;
+    // SHA256 hex string of the file content.
+    std::string content_hash;
+  };
+
+  struct Deps {
+    // Required files as listed in deps info.
+    std::set<std::string> required_files;
+    std::vector<FileInfo> files;
+  };
+
+  static RustcDepsCache* instance() { return instance_; }
+  static bool IsEnabled() { return instance_ != nullptr; }
+
+  // Initializes RustcDepsCache.
+  // If the number of entries exceeds |max_entries|, the least recently used
+  // entry will be evicted.
+  static void Init(size_t max_entries);
+  static void Quit();
+
+  // Returns the deps for |key| if no required file is modified.
+  // Returns nullptr otherwise.
+  // If FileStat of a file is changed but its content is not, the entry is
+  // updated with the new FileStat.
+  std::shared_ptr<const Deps> Lookup(const std::string& key);
+
+  // Stores |required_files| for |key|. Relative paths in |required_files|
+  // are resolved from |cwd|.
+  // Returns false if they are not cacheable, e.g. some file might be
+  // modified while running rustc.
+  bool Insert(const std::string& key,
+              const std::string& cwd,
+              const std::set<std::string>& required_files);
+
+  size_t size() const { return entries_.size(); }
+  int64_t hit() const { return entries_.hit(); }
+  int64_t miss() const { return entries_.miss(); }
+  int64_t invalidated() const { return entries_.invalidated(); }
+
+ private:
+  explicit RustcDepsCache(size_t max_entries);
+  ~RustcDepsCache() = default;
+
+  // Returns true if |file| is not modified since it was stored.
+  // Sets the current FileStat of |file| in |file_stat|.
+  static bool IsValidFile(const FileInfo& file, FileStat* file_stat);
+
+  static RustcDepsCache* instance_;
+
+  FileStatLruCache<std::shared_ptr<const Deps>> entries_;
+
+  DISALLOW_COPY_AND_ASSIGN(RustcDepsCache);
+};
+
+}  // namespace devtools_goma
+
+#endif  // DEVTOOLS_GOMA_CLIENT_RUST_RUSTC_DEPS_CACHE_H_
@@ -0,0 +1,109 @@
+// Copyright 2021 The Goma Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "rust/rustc_deps_cache.h"
+
+#include <memory>
+#include <set>
+#include <string>
+
+#include "absl/memory/memory.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "client/unittest_util.h"
+#include "gtest/gtest.h"
+#include "path.h"
+
+namespace devtools_goma {
+
+class RustcDepsCacheTest : public testing::Test {
+ public:
+  RustcDepsCacheTest() {
+    RustcDepsCache::Init(2);
+    tmpdir_util_ = absl::make_unique<TmpdirUtil>("rustc_deps_cache");
+  }
+
+  ~RustcDepsCacheTest() override { RustcDepsCache::Quit(); }
+
+ protected:
+  void CreateTmpFileWithMtime(const std::string& name,
+                              const std::string& content,
+                              absl::Time mtime) {
+    tmpdir_util_->CreateTmpFile(name, content);
+    EXPECT_TRUE(UpdateMtime(tmpdir_util_->FullPath(name), mtime));
+  }
+
+  std::unique_ptr<TmpdirUtil> tmpdir_util_;
+};
+
+TEST_F(RustcDepsCacheTest, Basic) {
+  RustcDepsCache* cache = RustcDepsCache::instance();
+  const absl::Time mtime = absl::Now() - absl::Seconds(10);
+  CreateTmpFileWithMtime("main.rs", "mod foo;", mtime);
+  CreateTmpFileWithMtime("foo.rs", "fn foo() {}", mtime);
+  const std::set<std::string> required_files{"./main.rs", "./foo.rs"};
+
+  EXPECT_TRUE(cache->Insert("key", tmpdir_util_->realcwd(), required_files));
+
+  std::shared_ptr<const RustcDepsCache::Deps> deps = cache->Lookup("key");
+  ASSERT_NE(nullptr, deps);
+  EXPECT_EQ(required_files, deps->required_files);
+  // Relative paths are resolved from cwd.
+  ASSERT_EQ(2U, deps->files.size());
+  for (const auto& file : deps->files) {
+    EXPECT_TRUE(file::IsAbsolutePath(file.path)) << file.path;
+    EXPECT_FALSE(file.content_hash.empty());
+  }
+}
+
+TEST_F(RustcDepsCacheTest, ContentModified) {
+  RustcDepsCache* cache = RustcDepsCache::instance();
+  const absl::Time mtime = absl::Now() - absl::Seconds(10);
+  CreateTmpFileWithMtime("main.rs", "mod foo;", mtime);
+
+  EXPECT_TRUE(cache->Insert("key", tmpdir_util_->realcwd(), {"main.rs"}));
+
+  CreateTmpFileWithMtime("main.rs", "mod bar;", mtime + absl::Seconds(1));
+  EXPECT_EQ(nullptr, cache->Lookup("key"));
+  EXPECT_EQ(1, cache->invalidated());
+}
+
+TEST_F(RustcDepsCacheTest, FileStatModifiedWithSameContent) {
+  RustcDepsCache* cache = RustcDepsCache::instance();
+  const absl::Time mtime = absl::Now() - absl::Seconds(10);
+  CreateTmpFileWithMtime("main.rs", "mod foo;", mtime);
+
+  EXPECT_TRUE(cache->Insert("key", tmpdir_util_->realcwd(), {"main.rs"}));
+
+  // e.g. generated file is written again.
+  CreateTmpFileWithMtime("main.rs", "mod foo;", mtime + absl::Seconds(1));
+  std::shared_ptr<const RustcDepsCache::Deps> deps = cache->Lookup("key");
+  ASSERT_NE(nullptr, deps);
+  EXPECT_EQ(0, cache->invalidated());
+
+  // The new FileStat is stored, so the next lookup doesn't need the hash.
+  const FileStat file_stat(tmpdir_util_->FullPath("main.rs"));
+  ASSERT_EQ(1U, deps->files.size());
+  EXPECT_EQ(file_stat, deps->files[0].file_stat);
+  deps = cache->Lookup("key");
+  ASSERT_NE(nullptr, deps);
+  EXPECT_EQ(file_stat, deps->files[0].file_stat);
+  EXPECT_EQ(1U, cache->size());
+}
+
+TEST_F(RustcDepsCacheTest, FileRemoved) {
+  RustcDepsCache* cache = RustcDepsCache::instance();
+  const absl::Time mtime = absl::Now() - absl::Seconds(10);
+  CreateTmpFileWithMtime("main.rs", "mod foo;", mtime);
+  CreateTmpFileWithMtime("foo.rs", "fn foo() {}", mtime);
+
+  EXPECT_TRUE(
+      cache->Insert("key", tmpdir_util_->realcwd(), {"main.rs", "foo.rs"}));
+
+  tmpdir_util_->RemoveTmpFile("foo.rs");
+  EXPECT_EQ(nullptr, cache->Lookup("key"));
+  EXPECT_EQ(1, cache->invalidated());
+}
+
+}  // namespace devtools_goma
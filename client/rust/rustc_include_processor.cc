@@ -15,6 +15,7 @@
 #include "glog/stl_logging.h"
 #include "options.h"
 #include "path.h"
+#include "rust/rustc_deps_cache.h"
 #include "util.h"
 
 namespace devtools_goma {
@@ -86,6 +87,20 @@ bool RustcIncludeProcessor::Run(const RustcFlags& rustc_flags,
     return false;
   }
 
+  std::string deps_cache_key;
+  if (RustcDepsCache::IsEnabled()) {
+    deps_cache_key =
+        MakeDepsCacheKey(rustc_compiler_info, args, rustc_flags.cwd());
+    std::shared_ptr<const RustcDepsCache::Deps> deps =
+        RustcDepsCache::instance()->Lookup(deps_cache_key);
+    if (deps) {
+      VLOG(1) << "use cached rustc deps for " << input_rs;
+      required_files->insert(deps->required_files.begin(),
+                             deps->required_files.end());
+      return true;
+    }
+  }
+
   int32_t status = 0;
   const std::string& rustc_path = rustc_compiler_info.local_compiler_path();
   // run with empty env. maybe envs must be stored in CompilerFlags or
@@ -103,13 +118,38 @@ bool RustcIncludeProcessor::Run(const RustcFlags& rustc_flags,
     return false;
   }
 
-  if (!AnalyzeDepsFile(deps_file, required_files)) {
+  std::set<std::string> deps_files;
+  if (!AnalyzeDepsFile(deps_file, &deps_files)) {
     *error_reason = "failed to analyze " + deps_file;
     return false;
   }
+
+  if (!deps_cache_key.empty()) {
+    RustcDepsCache::instance()->Insert(deps_cache_key, rustc_flags.cwd(),
+                                       deps_files);
+  }
+  required_files->insert(deps_files.begin(), deps_files.end());
   return true;
 }
 
+// static
+std::string RustcIncludeProcessor::MakeDepsCacheKey(
+    const CompilerInfo& compiler_info,
+    const std::vector<std::string>& args,
+    const std::string& cwd) {
+  // Use '\0' as a separator since it never appears in args.
+  // |args| has the crate root and the deps file, which is derived from
+  // the crate root.
+  std::string key = compiler_info.local_compiler_hash();
+  key += '\0';
+  key += cwd;
+  for (const auto& arg : args) {
+    key += '\0';
+    key += arg;
+  }
+  return key;
+}
+
 // static
 bool RustcIncludeProcessor::ParseRustcDeps(
     absl::string_view deps_info,
@@ -7,6 +7,7 @@
 
 #include <set>
 #include <string>
+#include <vector>
 
 #include "rust/rustc_compiler_info.h"
 #include "rustc_flags.h"
@@ -24,6 +25,12 @@ class RustcIncludeProcessor {
                              std::set<std::string>* required_files,
                              std::string* error_reason);
 
+  // Returns the key of RustcDepsCache for rustc invoked with |args|
+  // (rewritten by RewriteArgs) in |cwd|.
+  static std::string MakeDepsCacheKey(const CompilerInfo& compiler_info,
+                                      const std::vector<std::string>& args,
+                                      const std::string& cwd);
+
   static bool RewriteArgs(const std::vector<std::string>& old_args,
                           const std::string& dep_file,
                           std::vector<std::string>* new_args,
@@ -4,6 +4,7 @@
 
 #include "rustc_include_processor.h"
 
+#include "absl/memory/memory.h"
 #include "glog/logging.h"
 #include "gtest/gtest.h"
 
@@ -119,4 +120,33 @@ TEST(RustcIncludeProcessorTest, RewriteArgsTest) {
   EXPECT_EQ(returned_args, expected_args);
 }
 
+TEST(RustcIncludeProcessorTest, MakeDepsCacheKey) {
+  auto data = absl::make_unique<CompilerInfoData>();
+  data->set_local_compiler_hash("rustc_hash");
+  const RustcCompilerInfo compiler_info(std::move(data));
+
+  const std::vector<std::string> args{
+      "rustc", "main.rs", "--emit=dep-info", "-o", "main.d",
+  };
+  const std::string key =
+      RustcIncludeProcessor::MakeDepsCacheKey(compiler_info, args, "/cwd");
+  EXPECT_EQ(key,
+            RustcIncludeProcessor::MakeDepsCacheKey(compiler_info, args,
+                                                    "/cwd"));
+  EXPECT_NE(key,
+            RustcIncludeProcessor::MakeDepsCacheKey(compiler_info, args,
+                                                    "/other"));
+
+  std::vector<std::string> other_args = args;
+  other_args.insert(other_args.begin() + 2, "--cfg=feature=\"foo\"");
+  EXPECT_NE(key, RustcIncludeProcessor::MakeDepsCacheKey(compiler_info,
+                                                         other_args, "/cwd"));
+
+  auto other_data = absl::make_unique<CompilerInfoData>();
+  other_data->set_local_compiler_hash("other_rustc_hash");
+  const RustcCompilerInfo other_compiler_info(std::move(other_data));
+  EXPECT_NE(key, RustcIncludeProcessor::MakeDepsCacheKey(other_compiler_info,
+                                                         args, "/cwd"));
+}
+
 }  // namespace devtools_goma
@@ -42,7 +42,12 @@ void OutputFileTask::Run(OneshotClosure* closure) {
   success_ = blob_downloader_->Download(output_, info_);
   if (success_) {
     // TODO: fix to support cas digest.
-    info_->hash_key = ComputeFileBlobHashKey(output_.blob());
+    if (output_.blob().blob_type() == FileBlob::FILE_REF) {
+      // hash key of referred blob.
+      info_->hash_key = output_.blob().hash_key(0);
+    } else {
+      info_->hash_key = ComputeFileBlobHashKey(output_.blob());
+    }
   } else {
     LOG(WARNING) << task_->trace_id() << " "
                  << (task_->cache_hit() ? "cached" : "no-cached")
@@ -0,0 +1,182 @@
+// Copyright 2021 The Goma Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "trace_event_recorder.h"
+
+#include <algorithm>
+#include <functional>
+#include <map>
+#include <queue>
+
+#include "absl/time/clock.h"
+#include "autolock_timer.h"
+#include "file_helper.h"
+#include "glog/logging.h"
+#include "util.h"
+
+namespace devtools_goma {
+
+namespace {
+
+// Events of a task to be put in the same lane.
+struct EventGroup {
+  int task_id;
+  absl::Time start;
+  absl::Time end;
+  std::vector<const TraceEventRecorder::Event*> events;
+};
+
+// Assigns lanes to |groups| sorted by start time, so that groups in the same
+// lane don't overlap. A lane freed earliest is not necessarily reused;
+// the smallest free lane is used to keep the number of lanes small.
+std::vector<int> AssignLanes(const std::vector<EventGroup>& groups) {
+  using LaneEnd = std::pair<absl::Time, int>;
+  std::priority_queue<LaneEnd, std::vector<LaneEnd>, std::greater<LaneEnd>>
+      busy_lanes;
+  std::priority_queue<int, std::vector<int>, std::greater<int>> free_lanes;
+  int num_lanes = 0;
+
+  std::vector<int> lanes;
+  lanes.reserve(groups.size());
+  for (const auto& group : groups) {
+    while (!busy_lanes.empty() && busy_lanes.top().first <= group.start) {
+      free_lanes.push(busy_lanes.top().second);
+      busy_lanes.pop();
+    }
+    int lane;
+    if (free_lanes.empty()) {
+      lane = num_lanes++;
+    } else {
+      lane = free_lanes.top();
+      free_lanes.pop();
+    }
+    busy_lanes.emplace(group.end, lane);
+    lanes.push_back(lane);
+  }
+  return lanes;
+}
+
+}  // namespace
+
+TraceEventRecorder* TraceEventRecorder::instance_;
+
+// static
+void TraceEventRecorder::Init(size_t max_events) {
+  CHECK(instance_ == nullptr);
+  instance_ = new TraceEventRecorder(max_events);
+}
+
+// static
+void TraceEventRecorder::Quit() {
+  delete instance_;
+  instance_ = nullptr;
+}
+
+// static
+void TraceEventRecorder::Dump(const std::string& filename) {
+  if (!IsEnabled()) {
+    return;
+  }
+
+  Json::Value json;
+  instance_->DumpToJson(&json);
+  Json::FastWriter writer;
+  if (!WriteStringToFile(writer.write(json), filename)) {
+    LOG(ERROR) << "failed to dump trace events to " << filename;
+  } else {
+    LOG(INFO) << "dumped trace events to " << filename;
+  }
+}
+
+TraceEventRecorder::TraceEventRecorder(size_t max_events)
+    : max_events_(max_events), start_time_(absl::Now()) {}
+
+void TraceEventRecorder::AddTask(Task task) {
+  AUTOLOCK(lock, &mu_);
+  num_events_ += task.events.size();
+  tasks_.push_back(std::move(task));
+  while (num_events_ > max_events_) {
+    num_events_ -= tasks_.front().events.size();
+    tasks_.pop_front();
+    dropped_.Add(1);
+  }
+}
+
+void TraceEventRecorder::DumpToJson(Json::Value* json) const {
+  // Copies tasks not to block AddTask while building JSON.
+  std::deque<Task> tasks;
+  {
+    AUTOLOCK(lock, &mu_);
+    tasks = tasks_;
+  }
+
+  std::vector<EventGroup> groups;
+  for (const auto& task : tasks) {
+    std::map<int, size_t> track_groups;
+    for (const auto& event : task.events) {
+      const absl::Time end = event.start + event.duration;
+      if (event.track != kUntracked) {
+        auto inserted = track_groups.emplace(event.track, groups.size());
+        if (!inserted.second) {
+          EventGroup* group = &groups[inserted.first->second];
+          group->start = std::min(group->start, event.start);
+          group->end = std::max(group->end, end);
+          group->events.push_back(&event);
+          continue;
+        }
+      }
+      groups.push_back(EventGroup{task.id, event.start, end, {&event}});
+    }
+  }
+  std::sort(groups.begin(), groups.end(),
+            [](const EventGroup& a, const EventGroup& b) {
+              return a.start < b.start;
+            });
+  const std::vector<int> lanes = AssignLanes(groups);
+
+  const Json::Int64 pid = Getpid();
+  Json::Value trace_events(Json::arrayValue);
+  Json::Value process_name;
+  process_name["name"] = "process_name";
+  process_name["ph"] = "M";
+  process_name["pid"] = pid;
+  process_name["args"]["name"] = "compiler_proxy";
+  trace_events.append(std::move(process_name));
+
+  for (size_t i = 0; i < groups.size(); ++i) {
+    for (const auto* event : groups[i].events) {
+      Json::Value trace_event;
+      trace_event["name"] = event->name;
+      trace_event["cat"] = event->category;
+      trace_event["ph"] = "X";
+      trace_event["ts"] = Json::Int64(
+          absl::ToInt64Microseconds(event->start - start_time_));
+      trace_event["dur"] =
+          Json::Int64(absl::ToInt64Microseconds(event->duration));
+      trace_event["pid"] = pid;
+      trace_event["tid"] = lanes[i] + 1;
+      trace_event["args"]["task_id"] = groups[i].task_id;
+      if (!event->detail.empty()) {
+        trace_event["args"]["detail"] = event->detail;
+      }
+      trace_events.append(std::move(trace_event));
+    }
+  }
+
+  (*json)["traceEvents"] = std::move(trace_events);
+  (*json)["displayTimeUnit"] = "ms";
+  (*json)["otherData"]["dropped_tasks"] = Json::Int64(dropped());
+}
+
+size_t TraceEventRecorder::num_tasks() const {
+  AUTOLOCK(lock, &mu_);
+  return tasks_.size();
+}
+
+size_t TraceEventRecorder::num_events() const {
+  AUTOLOCK(lock, &mu_);
+  return num_events_;
+}
+
+}  // namespace devtools_goma
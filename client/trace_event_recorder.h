@@ -0,0 +1,105 @@
+// Copyright 2021 The Goma Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef DEVTOOLS_GOMA_CLIENT_TRACE_EVENT_RECORDER_H_
+#define DEVTOOLS_GOMA_CLIENT_TRACE_EVENT_RECORDER_H_
+
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/time/time.h"
+#include "atomic_stats_counter.h"
+#include "json/json.h"
+#include "lockhelper.h"
+
+namespace devtools_goma {
+
+// TraceEventRecorder keeps timelines of recently finished tasks, and exports
+// them in Chrome trace event format, which can be loaded by
+// chrome://tracing or https://ui.perfetto.dev/.
+// https://docs.google.com/document/d/1CvAClvFfyA5R-PhYUmn5OOQtYMH4h6I0nSsKchNAySU
+//
+// Tasks are packed into lanes (tid in trace events) so that the number of
+// lanes at a time shows how many tasks were running concurrently.
+// Thread-safe.
+class TraceEventRecorder {
+ public:
+  // Events on the same track of a task are put in the same lane, so they
+  // must not overlap unless one is nested in another.
+  // kUntracked events may overlap with any event, and each of them is put
+  // in a lane by itself.
+  static constexpr int kUntracked = -1;
+
+  struct Event {
+    Event(const char* name,
+          const char* category,
+          int track,
+          absl::Time start,
+          absl::Duration duration,
+          std::string detail = std::string())
+        : name(name),
+          category(category),
+          track(track),
+          start(start),
+          duration(duration),
+          detail(std::move(detail)) {}
+
+    // |name| and |category| must be string literals.
+    const char* name;
+    const char* category;
+    int track;
+    absl::Time start;
+    absl::Duration duration;
+    // Shown in args of the event if not empty.
+    std::string detail;
+  };
+
+  struct Task {
+    int id = 0;
+    std::vector<Event> events;
+  };
+
+  static void Init(size_t max_events);
+  static void Quit();
+  static bool IsEnabled() { return instance_ != nullptr; }
+  static TraceEventRecorder* instance() { return instance_; }
+
+  // Dumps trace events to |filename| if the recorder is enabled.
+  static void Dump(const std::string& filename);
+
+  // Adds events of a finished task. The oldest tasks are dropped while more
+  // than |max_events| events are kept.
+  void AddTask(Task task) LOCKS_EXCLUDED(mu_);
+
+  // Dumps kept tasks as a JSON object in trace event format.
+  void DumpToJson(Json::Value* json) const LOCKS_EXCLUDED(mu_);
+
+  size_t num_tasks() const LOCKS_EXCLUDED(mu_);
+  size_t num_events() const LOCKS_EXCLUDED(mu_);
+  std::int64_t dropped() const { return dropped_.value(); }
+
+ private:
+  explicit TraceEventRecorder(size_t max_events);
+  TraceEventRecorder(const TraceEventRecorder&) = delete;
+  TraceEventRecorder& operator=(const TraceEventRecorder&) = delete;
+
+  static TraceEventRecorder* instance_;
+
+  const size_t max_events_;
+  // Timestamps of events are relative to |start_time_|.
+  const absl::Time start_time_;
+
+  mutable Lock mu_;
+  std::deque<Task> tasks_ GUARDED_BY(mu_);
+  size_t num_events_ GUARDED_BY(mu_) = 0;
+
+  StatsCounter dropped_;
+};
+
+}  // namespace devtools_goma
+
+#endif  // DEVTOOLS_GOMA_CLIENT_TRACE_EVENT_RECORDER_H_
@@ -0,0 +1,145 @@
+// Copyright 2021 The Goma Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "trace_event_recorder.h"
+
+#include <map>
+#include <string>
+#include <utility>
+
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "gtest/gtest.h"
+
+namespace devtools_goma {
+
+class TraceEventRecorderTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    TraceEventRecorder::Init(10);
+    start_ = absl::Now();
+  }
+
+  void TearDown() override { TraceEventRecorder::Quit(); }
+
+  TraceEventRecorder::Task NewTask(int id, absl::Duration offset) {
+    TraceEventRecorder::Task task;
+    task.id = id;
+    const absl::Time start = start_ + offset;
+    task.events.emplace_back("task", "compile_task", 0, start,
+                             absl::Milliseconds(100), "input.cc");
+    task.events.emplace_back("SETUP", "compile_task", 0, start,
+                             absl::Milliseconds(30));
+    task.events.emplace_back("local_run", "subprocess", 1,
+                             start + absl::Milliseconds(10),
+                             absl::Milliseconds(50));
+    return task;
+  }
+
+  // Returns lanes of events keyed by (task_id, name).
+  static std::map<std::pair<int, std::string>, int> Lanes(
+      const Json::Value& json) {
+    std::map<std::pair<int, std::string>, int> lanes;
+    for (const auto& event : json["traceEvents"]) {
+      if (event["ph"].asString() != "X") {
+        continue;
+      }
+      lanes[std::make_pair(event["args"]["task_id"].asInt(),
+                           event["name"].asString())] = event["tid"].asInt();
+    }
+    return lanes;
+  }
+
+  absl::Time start_;
+};
+
+TEST_F(TraceEventRecorderTest, DumpToJson) {
+  TraceEventRecorder* recorder = TraceEventRecorder::instance();
+  recorder->AddTask(NewTask(1, absl::ZeroDuration()));
+
+  Json::Value json;
+  recorder->DumpToJson(&json);
+  ASSERT_TRUE(json["traceEvents"].isArray());
+  // process_name metadata and 3 events.
+  ASSERT_EQ(4U, json["traceEvents"].size());
+  EXPECT_EQ("M", json["traceEvents"][0]["ph"].asString());
+
+  bool found_task = false;
+  for (const auto& event : json["traceEvents"]) {
+    if (event["name"].asString() != "task") {
+      continue;
+    }
+    found_task = true;
+    EXPECT_EQ("X", event["ph"].asString());
+    EXPECT_EQ("compile_task", event["cat"].asString());
+    EXPECT_EQ(100000, event["dur"].asInt64());
+    EXPECT_GE(event["ts"].asInt64(), 0);
+    EXPECT_EQ("input.cc", event["args"]["detail"].asString());
+  }
+  EXPECT_TRUE(found_task);
+
+  // Subprocess overlaps with SETUP, so it is put in another lane.
+  std::map<std::pair<int, std::string>, int> lanes = Lanes(json);
+  EXPECT_EQ(lanes[std::make_pair(1, std::string("task"))],
+            lanes[std::make_pair(1, std::string("SETUP"))]);
+  EXPECT_NE(lanes[std::make_pair(1, std::string("task"))],
+            lanes[std::make_pair(1, std::string("local_run"))]);
+}
+
+TEST_F(TraceEventRecorderTest, ReuseLanes) {
+  TraceEventRecorder* recorder = TraceEventRecorder::instance();
+  recorder->AddTask(NewTask(1, absl::ZeroDuration()));
+  // Overlaps with task 1.
+  recorder->AddTask(NewTask(2, absl::Milliseconds(50)));
+  // Starts after task 1 finished.
+  recorder->AddTask(NewTask(3, absl::Milliseconds(100)));
+
+  Json::Value json;
+  recorder->DumpToJson(&json);
+  std::map<std::pair<int, std::string>, int> lanes = Lanes(json);
+  const int lane1 = lanes[std::make_pair(1, std::string("task"))];
+  const int lane2 = lanes[std::make_pair(2, std::string("task"))];
+  const int lane3 = lanes[std::make_pair(3, std::string("task"))];
+  EXPECT_NE(lane1, lane2);
+  EXPECT_EQ(lane1, lane3);
+}
+
+TEST_F(TraceEventRecorderTest, Untracked) {
+  TraceEventRecorder* recorder = TraceEventRecorder::instance();
+  TraceEventRecorder::Task task;
+  task.id = 1;
+  task.events.emplace_back("input_file", "file",
+                           TraceEventRecorder::kUntracked, start_,
+                           absl::Milliseconds(10), "a.h");
+  task.events.emplace_back("input_file", "file",
+                           TraceEventRecorder::kUntracked, start_,
+                           absl::Milliseconds(10), "b.h");
+  recorder->AddTask(std::move(task));
+
+  Json::Value json;
+  recorder->DumpToJson(&json);
+  ASSERT_EQ(3U, json["traceEvents"].size());
+  EXPECT_NE(json["traceEvents"][1]["tid"].asInt(),
+            json["traceEvents"][2]["tid"].asInt());
+}
+
+TEST_F(TraceEventRecorderTest, DropOldTasks) {
+  TraceEventRecorder* recorder = TraceEventRecorder::instance();
+  for (int i = 0; i < 5; ++i) {
+    recorder->AddTask(NewTask(i, absl::Milliseconds(i * 100)));
+  }
+  // Each task has 3 events, and at most 10 events are kept.
+  EXPECT_EQ(3U, recorder->num_tasks());
+  EXPECT_EQ(9U, recorder->num_events());
+  EXPECT_EQ(2, recorder->dropped());
+
+  Json::Value json;
+  recorder->DumpToJson(&json);
+  std::map<std::pair<int, std::string>, int> lanes = Lanes(json);
+  EXPECT_EQ(0U, lanes.count(std::make_pair(1, std::string("task"))));
+  EXPECT_EQ(1U, lanes.count(std::make_pair(2, std::string("task"))));
+  EXPECT_EQ(2, json["otherData"]["dropped_tasks"].asInt());
+}
+
+}  // namespace devtools_goma
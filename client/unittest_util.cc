@@ -21,6 +21,7 @@
 #include <glog/logging.h>
 #include <gtest/gtest.h>
 
+#include "absl/time/clock.h"
 #include "file_helper.h"
 #include "filesystem.h"
 #include "mypath.h"
@@ -76,6 +77,14 @@ void TmpdirUtil::CreateEmptyFile(const std::string& path) {
   CreateTmpFile(path, "");
 }
 
+std::string TmpdirUtil::CreateTmpFileWithOldMtime(const std::string& path,
+                                                  const std::string& data) {
+  CreateTmpFile(path, data);
+  const std::string full_path = FullPath(path);
+  EXPECT_TRUE(UpdateMtime(full_path, absl::Now() - absl::Seconds(10)));
+  return full_path;
+}
+
 void TmpdirUtil::RemoveTmpFile(const std::string& path) {
   file::Delete(FullPath(path), file::Defaults());
 }
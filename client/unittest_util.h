@@ -19,6 +19,10 @@ class TmpdirUtil {
   // Note: avoid CreateFile not to see "CreateFileW not found" on Win.
   virtual void CreateTmpFile(const std::string& path, const std::string& data);
   virtual void CreateEmptyFile(const std::string& path);
+  // Creates |path| with |data|, and sets its mtime to the past, so that its
+  // FileStat can't be stale. Returns the full path.
+  std::string CreateTmpFileWithOldMtime(const std::string& path,
+                                        const std::string& data);
   virtual void MkdirForPath(const std::string& path, bool is_dir);
 
   virtual void RemoveTmpFile(const std::string& path);
@@ -14,6 +14,7 @@
 #endif
 
 #include <memory>
+#include <string>
 
 #include <glog/logging.h>
 #include <gtest/gtest.h>
@@ -22,6 +23,7 @@
 #include "absl/time/time.h"
 #include "callback.h"
 #include "compiler_specific.h"
+#include "descriptor_poller.h"
 #include "lockhelper.h"
 #include "mock_socket_factory.h"
 #include "platform_thread.h"
@@ -30,6 +32,10 @@
 #include "socket_descriptor.h"
 #include "worker_thread.h"
 
+#ifdef __linux__
+#include "descriptor_poller_uring.h"
+#endif
+
 namespace devtools_goma {
 
 class WorkerThreadManagerTest : public ::testing::Test {
@@ -81,6 +87,23 @@ class WorkerThreadManagerTest : public ::testing::Test {
     DISALLOW_COPY_AND_ASSIGN(TestWriteContext);
   };
 
+  // Echoes back data read from |fd_|.
+  class TestEchoContext {
+   public:
+    explicit TestEchoContext(int fd)
+        : fd_(fd), num_echoed_(0), socket_descriptor_(nullptr) {}
+    ~TestEchoContext() {
+    }
+    const int fd_;
+    int num_echoed_;
+    SocketDescriptor* socket_descriptor_;
+    // Accessed only on the worker thread.
+    std::string pending_;
+
+   private:
+    DISALLOW_COPY_AND_ASSIGN(TestEchoContext);
+  };
+
   void SetUp() override {
     wm_ = absl::make_unique<WorkerThreadManager>();
     test_threadid_ = 0;
@@ -405,6 +428,179 @@ class WorkerThreadManagerTest : public ::testing::Test {
     }
   }
 
+  OneshotClosure* NewTestDescriptorEcho(TestEchoContext* tc) {
+    {
+      AutoLock lock(&mu_);
+      EXPECT_TRUE(tc->socket_descriptor_ == nullptr);
+    }
+    return NewCallback(
+        this, &WorkerThreadManagerTest::TestDescriptorEcho, tc);
+  }
+
+  void TestDescriptorEcho(TestEchoContext* tc) {
+    ScopedSocket sock(tc->fd_);
+    SocketDescriptor* descriptor = wm_->RegisterSocketDescriptor(
+        std::move(sock), WorkerThread::PRIORITY_HIGH);
+    descriptor->NotifyWhenReadable(
+        NewPermanentCallback(this, &WorkerThreadManagerTest::DoEchoRead, tc));
+    descriptor->NotifyWhenWritable(
+        NewPermanentCallback(this, &WorkerThreadManagerTest::DoEchoWrite, tc));
+    // Nothing to write yet.
+    descriptor->StopWrite();
+    descriptor->UnregisterWritable();
+    AutoLock lock(&mu_);
+    tc->socket_descriptor_ = descriptor;
+    cond_.Signal();
+  }
+
+  void DoEchoRead(TestEchoContext* tc) {
+    SocketDescriptor* descriptor = nullptr;
+    {
+      AutoLock lock(&mu_);
+      descriptor = tc->socket_descriptor_;
+    }
+    // Reads in small chunks, so that a message needs several readable
+    // events.
+    char buf[4];
+    ssize_t n = descriptor->Read(buf, sizeof(buf));
+    if (n > 0) {
+      tc->pending_.append(buf, n);
+      descriptor->RestartWrite();
+      return;
+    }
+    if (n < 0 && descriptor->NeedRetry()) {
+      return;
+    }
+    descriptor->StopRead();
+    wm_->RunClosureInThread(
+        FROM_HERE,
+        wm_->GetCurrentThreadId(),
+        NewCallback(
+            this, &WorkerThreadManagerTest::DoStopEcho, tc),
+        WorkerThread::PRIORITY_IMMEDIATE);
+  }
+
+  void DoEchoWrite(TestEchoContext* tc) {
+    SocketDescriptor* descriptor = nullptr;
+    {
+      AutoLock lock(&mu_);
+      descriptor = tc->socket_descriptor_;
+    }
+    ssize_t n = 0;
+    if (!tc->pending_.empty()) {
+      n = descriptor->Write(tc->pending_.data(), tc->pending_.size());
+    }
+    if (n > 0) {
+      tc->pending_.erase(0, n);
+    }
+    if (tc->pending_.empty()) {
+      descriptor->StopWrite();
+      descriptor->UnregisterWritable();
+    }
+    AutoLock lock(&mu_);
+    if (n > 0) {
+      tc->num_echoed_ += n;
+    }
+    cond_.Signal();
+  }
+
+  void DoStopEcho(TestEchoContext* tc) {
+    SocketDescriptor* descriptor = nullptr;
+    {
+      AutoLock lock(&mu_);
+      descriptor = tc->socket_descriptor_;
+    }
+    descriptor->ClearReadable();
+    descriptor->ClearWritable();
+    ScopedSocket sock(wm_->DeleteSocketDescriptor(descriptor));
+    EXPECT_EQ(tc->fd_, sock.get());
+    sock.Close();
+    AutoLock lock(&mu_);
+    tc->socket_descriptor_ = nullptr;
+    cond_.Signal();
+  }
+
+  void WaitTestEchoStart(TestEchoContext* tc) {
+    AutoLock lock(&mu_);
+    while (tc->socket_descriptor_ == nullptr) {
+      cond_.Wait(&mu_);
+    }
+  }
+
+  void WaitTestEcho(TestEchoContext* tc, int n) {
+    AutoLock lock(&mu_);
+    while (tc->num_echoed_ < n) {
+      cond_.Wait(&mu_);
+    }
+  }
+
+  void WaitTestEchoFinish(TestEchoContext* tc) {
+    AutoLock lock(&mu_);
+    while (tc->socket_descriptor_ != nullptr) {
+      cond_.Wait(&mu_);
+    }
+  }
+
+  // Sends |kNumRounds| messages to echo server on |tc|, and checks they
+  // are echoed back.
+  void RunEchoTest(TestEchoContext* tc, ScopedSocket* client) {
+    wm_->RunClosure(FROM_HERE, NewTestDescriptorEcho(tc),
+                    WorkerThread::PRIORITY_LOW);
+    WaitTestEchoStart(tc);
+    constexpr int kNumRounds = 10;
+    int total = 0;
+    for (int i = 0; i < kNumRounds; ++i) {
+      const std::string msg = "hello " + std::to_string(i);
+      ASSERT_EQ(static_cast<ssize_t>(msg.size()),
+                client->Write(msg.data(), msg.size()));
+      total += msg.size();
+      WaitTestEcho(tc, total);
+      std::string echoed;
+      while (echoed.size() < msg.size()) {
+        char buf[16];
+        ssize_t n = client->Read(buf, sizeof(buf));
+        ASSERT_GT(n, 0);
+        echoed.append(buf, n);
+      }
+      EXPECT_EQ(msg, echoed);
+    }
+    client->Close();
+    WaitTestEchoFinish(tc);
+    AutoLock lock(&mu_);
+    EXPECT_EQ(total, tc->num_echoed_);
+  }
+
+  // Blocks the worker thread until UnblockWorker is called.
+  void BlockWorker() {
+    {
+      AutoLock lock(&mu_);
+      worker_blocked_ = false;
+      unblock_worker_ = false;
+    }
+    wm_->RunClosure(FROM_HERE,
+                    NewCallback(this, &WorkerThreadManagerTest::DoBlock),
+                    WorkerThread::PRIORITY_LOW);
+    AutoLock lock(&mu_);
+    while (!worker_blocked_) {
+      cond_.Wait(&mu_);
+    }
+  }
+
+  void DoBlock() {
+    AutoLock lock(&mu_);
+    worker_blocked_ = true;
+    cond_.Signal();
+    while (!unblock_worker_) {
+      cond_.Wait(&mu_);
+    }
+  }
+
+  void UnblockWorker() {
+    AutoLock lock(&mu_);
+    unblock_worker_ = true;
+    cond_.Signal();
+  }
+
   WorkerThread::ThreadId test_threadid() const {
     AutoLock lock(&mu_);
     return test_threadid_;
@@ -428,6 +624,8 @@ class WorkerThreadManagerTest : public ::testing::Test {
   WorkerThread::ThreadId test_threadid_;
   int num_test_threadid_;
   int periodic_counter_;
+  bool worker_blocked_ = false;
+  bool unblock_worker_ = false;
   DISALLOW_COPY_AND_ASSIGN(WorkerThreadManagerTest);
 };
 
@@ -631,4 +829,78 @@ TEST_F(WorkerThreadManagerTest, DescriptorTimeout) {
   wm_->Finish();
 }
 
+TEST_F(WorkerThreadManagerTest, DescriptorEcho) {
+  wm_->Start(1);
+  int socks[2];
+  ASSERT_EQ(0, OpenSocketPairForTest(socks));
+  TestEchoContext tc(socks[0]);
+  ScopedSocket s(socks[1]);
+  RunEchoTest(&tc, &s);
+  wm_->Finish();
+}
+
+#ifdef __linux__
+TEST_F(WorkerThreadManagerTest, DescriptorsReadableAtOnceWithIoUring) {
+  if (!IsIoUringDescriptorPollerSupported()) {
+    LOG(WARNING) << "io_uring is not supported. skipped.";
+    return;
+  }
+  DescriptorPoller::SetUseIoUring(true);
+  wm_->Start(1);
+  DescriptorPoller::SetUseIoUring(false);
+  int socks1[2];
+  int socks2[2];
+  ASSERT_EQ(0, OpenSocketPairForTest(socks1));
+  ASSERT_EQ(0, OpenSocketPairForTest(socks2));
+  TestReadContext tc1(socks1[0], absl::ZeroDuration());
+  TestReadContext tc2(socks2[0], absl::ZeroDuration());
+  ScopedSocket s1(socks1[1]);
+  ScopedSocket s2(socks2[1]);
+  wm_->RunClosure(FROM_HERE, NewTestDescriptorRead(&tc1),
+                  WorkerThread::PRIORITY_LOW);
+  wm_->RunClosure(FROM_HERE, NewTestDescriptorRead(&tc2),
+                  WorkerThread::PRIORITY_LOW);
+  WaitTestRead(&tc1, 0);
+  WaitTestRead(&tc2, 0);
+
+  // Both descriptors become readable in the same poll, so that one's
+  // callback is still queued when the other's callback runs.
+  BlockWorker();
+  char buf[1] = { 42 };
+  EXPECT_EQ(1, s1.Write(buf, 1));
+  EXPECT_EQ(1, s2.Write(buf, 1));
+  UnblockWorker();
+  WaitTestRead(&tc1, 1);
+  WaitTestRead(&tc2, 1);
+
+  // The polls must be re-armed without registering them again.
+  s1.Close();
+  s2.Close();
+  WaitTestReadFinish(&tc1);
+  WaitTestReadFinish(&tc2);
+  {
+    AutoLock lock(&mu_);
+    EXPECT_EQ(2, tc1.num_read_);
+    EXPECT_EQ(2, tc2.num_read_);
+  }
+  wm_->Finish();
+}
+
+TEST_F(WorkerThreadManagerTest, DescriptorEchoWithIoUring) {
+  if (!IsIoUringDescriptorPollerSupported()) {
+    LOG(WARNING) << "io_uring is not supported. skipped.";
+    return;
+  }
+  DescriptorPoller::SetUseIoUring(true);
+  wm_->Start(1);
+  DescriptorPoller::SetUseIoUring(false);
+  int socks[2];
+  ASSERT_EQ(0, OpenSocketPairForTest(socks));
+  TestEchoContext tc(socks[0]);
+  ScopedSocket s(socks[1]);
+  RunEchoTest(&tc, &s);
+  wm_->Finish();
+}
+#endif
+
 }  // namespace devtools_goma
@@ -144,7 +144,7 @@ class CompilerFlags {
   // e.g.
   // ["gcc", "-c", "foo.cc"]
   // ["clang-cl", "@foo.rsp", "/c", "foo.cc"]
-  const std::vector<std::string> args_;
+  std::vector<std::string> args_;
   // Expanded command line arguments if the command line contains @rsp.
   // arguments. If @rsp does not exist, this can be empty.
   // e.g.
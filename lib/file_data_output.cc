@@ -106,18 +106,16 @@ class FileOutputImpl : public FileDataOutput {
 
   bool IsValid() const override { return fd_.valid(); }
   bool WriteAt(off_t offset, const std::string& content) override {
-    off_t pos = fd_.Seek(offset, devtools_goma::ScopedFd::SeekAbsolute);
-    if (pos < 0 || pos != offset) {
-      PLOG(ERROR) << "seek failed? " << filename_ << " pos=" << pos
-                  << " offset=" << offset;
-      error_ = true;
-      return false;
-    }
+    // Use positional write, so chunks can be written in any order
+    // without seeking.
     size_t written = 0;
     while (written < content.size()) {
-      int n = fd_.Write(content.data() + written, content.size() - written);
-      if (n < 0) {
-        PLOG(WARNING) << "write failed " << filename_;
+      ssize_t n = fd_.WriteAt(content.data() + written,
+                              content.size() - written,
+                              offset + static_cast<off_t>(written));
+      if (n <= 0) {
+        PLOG(WARNING) << "write failed " << filename_
+                      << " offset=" << offset + written;
         error_ = true;
         return false;
       }
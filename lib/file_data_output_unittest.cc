@@ -4,7 +4,12 @@
 
 #include "lib/file_data_output.h"
 
+#include <stdio.h>
+
+#include <fstream>
 #include <memory>
+#include <sstream>
+#include <string>
 
 #include "gtest/gtest.h"
 
@@ -21,4 +26,23 @@ TEST(StringOutput, EmptyContent) {
   EXPECT_EQ(buf, content);
 }
 
+TEST(FileOutput, WriteAtOutOfOrder) {
+  const std::string filename =
+      ::testing::TempDir() + "/file_data_output_unittest_out_of_order";
+  remove(filename.c_str());
+  std::unique_ptr<FileDataOutput> output =
+      FileDataOutput::NewFileOutput(filename, 0644);
+  ASSERT_TRUE(output->IsValid());
+  // Chunks may arrive in any order when downloaded in parallel.
+  EXPECT_TRUE(output->WriteAt(6, "world"));
+  EXPECT_TRUE(output->WriteAt(0, "hello "));
+  EXPECT_TRUE(output->Close());
+
+  std::ifstream ifs(filename, std::ios::binary);
+  std::stringstream ss;
+  ss << ifs.rdbuf();
+  EXPECT_EQ("hello world", ss.str());
+  remove(filename.c_str());
+}
+
 }  // namespace devtools_goma
@@ -6,11 +6,26 @@
 #include "lib/file_helper.h"
 
 #include <errno.h>
+#include <stdio.h>
 
 #ifdef _WIN32
 # include "config_win.h"
+#else
+# include <sys/stat.h>
+# include <sys/types.h>
+# include <unistd.h>
 #endif  // _WIN32
 
+#ifdef __linux__
+# include <linux/fs.h>
+# include <sys/ioctl.h>
+# include <sys/syscall.h>
+#endif
+
+#ifdef __MACH__
+# include <sys/clonefile.h>
+#endif
+
 #include "absl/strings/string_view.h"
 #include "base/path.h"
 #include "glog/logging.h"
@@ -83,4 +98,176 @@ bool WriteStringToFile(absl::string_view data, absl::string_view filename) {
   return true;
 }
 
+const char* CloneFileMethodName(CloneFileMethod method) {
+  switch (method) {
+    case CloneFileMethod::kFailed:
+      return "failed";
+    case CloneFileMethod::kHardLink:
+      return "hardlink";
+    case CloneFileMethod::kReflink:
+      return "reflink";
+    case CloneFileMethod::kCopyFileRange:
+      return "copy_file_range";
+    case CloneFileMethod::kCopy:
+      return "copy";
+  }
+  return "unknown";
+}
+
+#ifndef _WIN32
+
+namespace {
+
+// Copies |size| bytes from |src| to |dst| in kernel.
+// Returns false without copying anything if it is not supported
+// (e.g. cross filesystem on old kernel), or on error.
+// |*copied| is set to the number of bytes copied.
+bool CopyFileRange(const ScopedFd& src, const ScopedFd& dst,
+                   std::int64_t size, std::int64_t* copied) {
+  *copied = 0;
+#if defined(__linux__) && defined(__NR_copy_file_range)
+  while (*copied < size) {
+    long r = syscall(__NR_copy_file_range, src.fd(), nullptr, dst.fd(),
+                     nullptr, static_cast<size_t>(size - *copied), 0);
+    if (r < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      if (*copied > 0) {
+        PLOG(WARNING) << "copy_file_range failed in the middle";
+      }
+      return false;
+    }
+    if (r == 0) {
+      // file was truncated?
+      return false;
+    }
+    *copied += r;
+  }
+  return true;
+#else
+  (void)src;
+  (void)dst;
+  (void)size;
+  return false;
+#endif
+}
+
+bool CopyFileContent(const ScopedFd& src, const ScopedFd& dst) {
+  char buf[64 * 1024];
+  for (;;) {
+    ssize_t n = src.Read(buf, sizeof(buf));
+    if (n < 0) {
+      return false;
+    }
+    if (n == 0) {
+      return true;
+    }
+    ssize_t written = 0;
+    while (written < n) {
+      ssize_t w = dst.Write(buf + written, n - written);
+      if (w <= 0) {
+        return false;
+      }
+      written += w;
+    }
+  }
+}
+
+}  // anonymous namespace
+
+#endif  // !_WIN32
+
+CloneFileMethod CloneFile(const std::string& src,
+                          const std::string& dst,
+                          int mode,
+                          bool allow_hardlink,
+                          std::int64_t* size) {
+  *size = 0;
+  // Never write into existing |dst|, which may be a hard link to other file.
+  remove(dst.c_str());
+
+#ifdef _WIN32
+  (void)mode;
+  if (allow_hardlink && CreateHardLinkA(dst.c_str(), src.c_str(), nullptr)) {
+    ScopedFd fd(ScopedFd::OpenForRead(dst));
+    size_t file_size = 0;
+    if (fd.valid() && fd.GetFileSize(&file_size)) {
+      *size = file_size;
+      return CloneFileMethod::kHardLink;
+    }
+    remove(dst.c_str());
+  }
+  if (!CopyFileA(src.c_str(), dst.c_str(), FALSE)) {
+    LOG_SYSRESULT(GetLastError());
+    LOG(WARNING) << "failed to copy " << src << " to " << dst;
+    return CloneFileMethod::kFailed;
+  }
+  ScopedFd fd(ScopedFd::OpenForRead(dst));
+  size_t file_size = 0;
+  if (!fd.valid() || !fd.GetFileSize(&file_size)) {
+    return CloneFileMethod::kFailed;
+  }
+  *size = file_size;
+  return CloneFileMethod::kCopy;
+#else
+  struct stat st;
+  if (allow_hardlink && link(src.c_str(), dst.c_str()) == 0) {
+    if (stat(dst.c_str(), &st) == 0) {
+      *size = st.st_size;
+      return CloneFileMethod::kHardLink;
+    }
+    remove(dst.c_str());
+  }
+
+#ifdef __MACH__
+  if (clonefile(src.c_str(), dst.c_str(), 0) == 0) {
+    if (chmod(dst.c_str(), mode) == 0 && stat(dst.c_str(), &st) == 0) {
+      *size = st.st_size;
+      return CloneFileMethod::kReflink;
+    }
+    remove(dst.c_str());
+  }
+#endif
+
+  ScopedFd src_fd(ScopedFd::OpenForRead(src));
+  if (!src_fd.valid()) {
+    PLOG(WARNING) << "failed to open " << src;
+    return CloneFileMethod::kFailed;
+  }
+  if (fstat(src_fd.fd(), &st) != 0) {
+    PLOG(WARNING) << "failed to stat " << src;
+    return CloneFileMethod::kFailed;
+  }
+  const std::int64_t file_size = st.st_size;
+  ScopedFd dst_fd(ScopedFd::Create(dst, mode));
+  if (!dst_fd.valid()) {
+    PLOG(WARNING) << "failed to create " << dst;
+    return CloneFileMethod::kFailed;
+  }
+
+  CloneFileMethod method = CloneFileMethod::kFailed;
+#if defined(__linux__) && defined(FICLONE)
+  if (ioctl(dst_fd.fd(), FICLONE, src_fd.fd()) == 0) {
+    method = CloneFileMethod::kReflink;
+  }
+#endif
+  if (method == CloneFileMethod::kFailed) {
+    std::int64_t copied = 0;
+    if (CopyFileRange(src_fd, dst_fd, file_size, &copied)) {
+      method = CloneFileMethod::kCopyFileRange;
+    } else if (copied == 0 && CopyFileContent(src_fd, dst_fd)) {
+      method = CloneFileMethod::kCopy;
+    }
+  }
+  if (method == CloneFileMethod::kFailed || !dst_fd.Close()) {
+    PLOG(WARNING) << "failed to copy " << src << " to " << dst;
+    remove(dst.c_str());
+    return CloneFileMethod::kFailed;
+  }
+  *size = file_size;
+  return method;
+#endif  // _WIN32
+}
+
 }  // namespace devtools_goma
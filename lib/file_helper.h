@@ -6,6 +6,7 @@
 #ifndef DEVTOOLS_GOMA_LIB_FILE_HELPER_H_
 #define DEVTOOLS_GOMA_LIB_FILE_HELPER_H_
 
+#include <cstdint>
 #include <string>
 
 #include "absl/strings/string_view.h"
@@ -15,6 +16,31 @@ namespace devtools_goma {
 bool ReadFileToString(absl::string_view filename, std::string* OUTPUT);
 bool WriteStringToFile(absl::string_view data, absl::string_view filename);
 
+// How CloneFile made the destination file.
+enum class CloneFileMethod {
+  kFailed,
+  kHardLink,       // link(2). dst shares inode with src.
+  kReflink,        // FICLONE ioctl or clonefile(2). copy-on-write clone.
+  kCopyFileRange,  // copy_file_range(2). in-kernel copy.
+  kCopy,           // user-space read/write copy.
+};
+
+const char* CloneFileMethodName(CloneFileMethod method);
+
+// CloneFile makes |dst| have the same content as |src| with the cheapest
+// method available on the filesystem, falling back to plain copy.
+// |dst| is removed first if it exists, so it never modifies a file shared
+// with |dst| by a hard link.
+// Hard link is used only if |allow_hardlink| is true.  Note that with hard
+// link, modification to |dst| in place would also modify |src|.
+// |mode| is used for new |dst| except for hard link.
+// On success, returns the method used and sets |*size| to file size.
+CloneFileMethod CloneFile(const std::string& src,
+                          const std::string& dst,
+                          int mode,
+                          bool allow_hardlink,
+                          std::int64_t* size);
+
 }  // namespace devtools_goma
 
 #endif  // DEVTOOLS_GOMA_LIB_FILE_HELPER_H_
@@ -0,0 +1,69 @@
+// Copyright 2021 The Goma Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "lib/file_helper.h"
+
+#include <stdio.h>
+
+#include <string>
+
+#include "gtest/gtest.h"
+
+namespace devtools_goma {
+
+TEST(FileHelperTest, CloneFile) {
+  const std::string src = ::testing::TempDir() + "/file_helper_clone_src";
+  const std::string dst = ::testing::TempDir() + "/file_helper_clone_dst";
+  const std::string content = "hello, world";
+  ASSERT_TRUE(WriteStringToFile(content, src));
+  // dst should be replaced.
+  ASSERT_TRUE(WriteStringToFile("old content that is longer", dst));
+
+  std::int64_t size = 0;
+  CloneFileMethod method = CloneFile(src, dst, 0644, false, &size);
+  EXPECT_NE(CloneFileMethod::kFailed, method) << CloneFileMethodName(method);
+  EXPECT_NE(CloneFileMethod::kHardLink, method);
+  EXPECT_EQ(static_cast<std::int64_t>(content.size()), size);
+
+  std::string got;
+  ASSERT_TRUE(ReadFileToString(dst, &got));
+  EXPECT_EQ(content, got);
+
+  remove(src.c_str());
+  remove(dst.c_str());
+}
+
+TEST(FileHelperTest, CloneFileHardLinkDoesNotModifyOldDestination) {
+  const std::string src = ::testing::TempDir() + "/file_helper_link_src";
+  const std::string dst = ::testing::TempDir() + "/file_helper_link_dst";
+  const std::string other = ::testing::TempDir() + "/file_helper_link_other";
+  ASSERT_TRUE(WriteStringToFile("new", src));
+  ASSERT_TRUE(WriteStringToFile("old", other));
+  std::int64_t size = 0;
+  ASSERT_NE(CloneFileMethod::kFailed, CloneFile(other, dst, 0644, true, &size));
+
+  // dst may be a hard link to other. Cloning to dst must not modify other.
+  EXPECT_NE(CloneFileMethod::kFailed, CloneFile(src, dst, 0644, false, &size));
+  EXPECT_EQ(3, size);
+
+  std::string got;
+  ASSERT_TRUE(ReadFileToString(dst, &got));
+  EXPECT_EQ("new", got);
+  ASSERT_TRUE(ReadFileToString(other, &got));
+  EXPECT_EQ("old", got);
+
+  remove(src.c_str());
+  remove(dst.c_str());
+  remove(other.c_str());
+}
+
+TEST(FileHelperTest, CloneFileMissingSource) {
+  const std::string src = ::testing::TempDir() + "/file_helper_missing_src";
+  const std::string dst = ::testing::TempDir() + "/file_helper_missing_dst";
+  remove(src.c_str());
+  std::int64_t size = 0;
+  EXPECT_EQ(CloneFileMethod::kFailed, CloneFile(src, dst, 0644, true, &size));
+}
+
+}  // namespace devtools_goma
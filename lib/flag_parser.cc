@@ -7,23 +7,175 @@
 
 #include <algorithm>
 #include <iterator>
+#include <map>
+#include <unordered_map>
 #include <utility>
 
+#include "absl/container/inlined_vector.h"
 #include "absl/strings/match.h"
 #include "absl/strings/str_replace.h"
 #include "absl/strings/string_view.h"
+#include "base/lockhelper.h"
 #include "glog/logging.h"
 
 namespace {
 
-struct FlagLengthComparator {
-  bool operator() (FlagParser::Flag* a, FlagParser::Flag* b) const {
-    return a->name().size() > b->name().size();
+// FNV-1a.
+constexpr std::uint64_t kFingerprintBasis = 14695981039346656037ULL;
+constexpr std::uint64_t kFingerprintPrime = 1099511628211ULL;
+
+std::uint64_t UpdateFingerprint(std::uint64_t fp, absl::string_view name) {
+  for (char c : name) {
+    fp ^= static_cast<unsigned char>(c);
+    fp *= kFingerprintPrime;
   }
-};
+  // terminator, so that {"ab", "c"} and {"a", "bc"} differ.
+  fp ^= 0xff;
+  fp *= kFingerprintPrime;
+  return fp;
+}
+
+// Distinct flag sets are a few (gcc, clang-cl, javac, ...), but limit
+// the number of cached schemas in case flags are added dynamically.
+constexpr size_t kMaxCachedSchemas = 64;
 
 }  // anonymous namespace
 
+// Flattened prefix trie of flag names.
+// nodes_[0] is the root, which corresponds to empty name (i.e. NonFlag).
+// Edges of a node are stored in edges_[edge_begin, edge_end), sorted by
+// character.
+class FlagParser::Schema {
+ public:
+  using Matches = absl::InlinedVector<int, 4>;
+
+  explicit Schema(const std::vector<std::unique_ptr<Flag>>& flags);
+
+  Schema(const Schema&) = delete;
+  Schema& operator=(const Schema&) = delete;
+
+  // Returns a Schema for |flags|, shared with other FlagParsers that have
+  // the same flag names in the same order.
+  static std::shared_ptr<const Schema> Get(
+      std::uint64_t fingerprint,
+      const std::vector<std::unique_ptr<Flag>>& flags);
+
+  // Sets indices of flags whose name is a prefix of |key| in |matches|,
+  // longest name first.
+  void Match(absl::string_view key, Matches* matches) const;
+
+  bool HasSameNames(const std::vector<std::unique_ptr<Flag>>& flags) const;
+
+ private:
+  struct Node {
+    int flag_index = -1;
+    std::uint32_t edge_begin = 0;
+    std::uint32_t edge_end = 0;
+  };
+  struct Edge {
+    char c;
+    std::uint32_t node;
+  };
+
+  std::vector<std::string> names_;
+  std::vector<Node> nodes_;
+  std::vector<Edge> edges_;
+};
+
+FlagParser::Schema::Schema(const std::vector<std::unique_ptr<Flag>>& flags) {
+  // Build pointer-less trie first, then flatten edges.
+  struct BuildNode {
+    int flag_index = -1;
+    std::map<char, std::uint32_t> children;
+  };
+  std::vector<BuildNode> build_nodes(1);
+  names_.reserve(flags.size());
+  for (size_t i = 0; i < flags.size(); ++i) {
+    const std::string& name = flags[i]->name();
+    names_.push_back(name);
+    std::uint32_t node = 0;
+    for (char c : name) {
+      auto p = build_nodes[node].children.emplace(c, build_nodes.size());
+      if (p.second) {
+        build_nodes.emplace_back();
+      }
+      node = p.first->second;
+    }
+    build_nodes[node].flag_index = static_cast<int>(i);
+  }
+
+  nodes_.resize(build_nodes.size());
+  edges_.reserve(build_nodes.size() - 1);
+  for (size_t i = 0; i < build_nodes.size(); ++i) {
+    nodes_[i].flag_index = build_nodes[i].flag_index;
+    nodes_[i].edge_begin = edges_.size();
+    for (const auto& child : build_nodes[i].children) {
+      edges_.push_back(Edge{child.first, child.second});
+    }
+    nodes_[i].edge_end = edges_.size();
+  }
+}
+
+// static
+std::shared_ptr<const FlagParser::Schema> FlagParser::Schema::Get(
+    std::uint64_t fingerprint,
+    const std::vector<std::unique_ptr<Flag>>& flags) {
+  static auto* mu = new devtools_goma::Lock();
+  static auto* cache =
+      new std::unordered_map<std::uint64_t, std::shared_ptr<const Schema>>();
+  {
+    devtools_goma::AutoLock lock(mu);
+    auto found = cache->find(fingerprint);
+    if (found != cache->end() && found->second->HasSameNames(flags)) {
+      return found->second;
+    }
+  }
+  auto schema = std::make_shared<const Schema>(flags);
+  devtools_goma::AutoLock lock(mu);
+  if (cache->size() < kMaxCachedSchemas) {
+    // If other thread has already inserted, or fingerprint collides, keep
+    // existing one. |schema| is still valid for |flags|.
+    cache->emplace(fingerprint, schema);
+  }
+  return schema;
+}
+
+void FlagParser::Schema::Match(absl::string_view key, Matches* matches) const {
+  matches->clear();
+  std::uint32_t node = 0;
+  if (nodes_[node].flag_index >= 0) {
+    matches->push_back(nodes_[node].flag_index);
+  }
+  for (char c : key) {
+    const Node& n = nodes_[node];
+    auto begin = edges_.begin() + n.edge_begin;
+    auto end = edges_.begin() + n.edge_end;
+    auto found = std::lower_bound(
+        begin, end, c, [](const Edge& e, char c) { return e.c < c; });
+    if (found == end || found->c != c) {
+      break;
+    }
+    node = found->node;
+    if (nodes_[node].flag_index >= 0) {
+      matches->push_back(nodes_[node].flag_index);
+    }
+  }
+  std::reverse(matches->begin(), matches->end());
+}
+
+bool FlagParser::Schema::HasSameNames(
+    const std::vector<std::unique_ptr<Flag>>& flags) const {
+  if (names_.size() != flags.size()) {
+    return false;
+  }
+  for (size_t i = 0; i < flags.size(); ++i) {
+    if (names_[i] != flags[i]->name()) {
+      return false;
+    }
+  }
+  return true;
+}
+
 FlagParser::Options::Options()
     : flag_prefix('-'),
       alt_flag_prefix('\0'),
@@ -216,59 +368,51 @@ void FlagParser::Flag::Output(int i,
   CHECK(parsed_args_.insert(std::make_pair(i, parsed_arg)).second);
 }
 
-FlagParser::FlagParser() {
+FlagParser::FlagParser() : names_fingerprint_(kFingerprintBasis) {
 }
 
 FlagParser::~FlagParser() {
 }
 
 FlagParser::Flag* FlagParser::AddBoolFlag(const char* name) {
-  std::pair<std::map<std::string, std::unique_ptr<Flag>>::iterator, bool> p =
-      flags_.emplace(name, nullptr);
-  if (p.second) {
-    p.first->second.reset(new Flag(name, false, false, opts_));
-  }
-  return p.first->second.get();
+  return AddFlagInternal(name, false, false);
 }
 
 FlagParser::Flag* FlagParser::AddPrefixFlag(const char* name) {
-  std::pair<std::map<std::string, std::unique_ptr<Flag>>::iterator, bool> p =
-      flags_.emplace(name, nullptr);
-  if (p.second) {
-    p.first->second.reset(new Flag(name, true, false, opts_));
-  }
-  return p.first->second.get();
+  return AddFlagInternal(name, true, false);
 }
 
 FlagParser::Flag* FlagParser::AddFlag(const char* name) {
-  std::pair<std::map<std::string, std::unique_ptr<Flag>>::iterator, bool> p =
-      flags_.emplace(name, nullptr);
-  if (p.second) {
-    p.first->second.reset(new Flag(name, true, true, opts_));
-  }
-  return p.first->second.get();
+  return AddFlagInternal(name, true, true);
 }
 
 FlagParser::Flag* FlagParser::AddNonFlag() {
-  std::pair<std::map<std::string, std::unique_ptr<Flag>>::iterator, bool> p =
-      flags_.emplace("", nullptr);
-  if (p.second) {
-    p.first->second.reset(new Flag("", true, false, opts_));
+  return AddFlagInternal("", true, false);
+}
+
+FlagParser::Flag* FlagParser::AddFlagInternal(const char* name,
+                                              bool require_value,
+                                              bool allows_space_arg) {
+  auto found = flags_by_name_.find(name);
+  if (found != flags_by_name_.end()) {
+    return found->second;
   }
-  return p.first->second.get();
+  flags_.emplace_back(new Flag(name, require_value, allows_space_arg, opts_));
+  Flag* flag = flags_.back().get();
+  flags_by_name_.emplace(flag->name(), flag);
+  names_fingerprint_ = UpdateFingerprint(names_fingerprint_, flag->name());
+  schema_.reset();
+  return flag;
 }
 
 void FlagParser::Parse(const std::vector<std::string>& args) {
   std::copy(args.begin(), args.end(), back_inserter(args_));
   parsed_flags_.resize(args_.size());
 
-  // Check longest flag name first.
-  std::vector<Flag*> flags;
-  for (const auto& iter : flags_) {
-    flags.push_back(iter.second.get());
+  if (!schema_) {
+    schema_ = Schema::Get(names_fingerprint_, flags_);
   }
-  FlagLengthComparator comp;
-  std::sort(flags.begin(), flags.end(), comp);
+  Schema::Matches matches;
 
   for (size_t i = opts_.has_command_name ? 1 : 0; i < args.size(); i++) {
     const std::string& arg = args[i];
@@ -278,14 +422,28 @@ void FlagParser::Parse(const std::vector<std::string>& args) {
       continue;
     }
 
+    // Same key as Flag::Parse() checks.
+    absl::string_view key;
+    if (!opts_.flag_prefix) {
+      key = arg;
+    } else if (arg.size() > 1 &&
+               (arg[0] == opts_.flag_prefix ||
+                (opts_.alt_flag_prefix && arg[0] == opts_.alt_flag_prefix))) {
+      key = absl::ClippedSubstr(absl::string_view(arg), 1);
+    }
+    // Only flags whose name is a prefix of key could match.
+    // Check longest flag name first.
+    schema_->Match(key, &matches);
+
     bool parsed = false;
-    for (size_t j = 0; j < flags.size(); ++j) {
+    for (int index : matches) {
+      Flag* flag = flags_[index].get();
       size_t last_i;
-      if (flags[j]->Parse(args_, i, &last_i)) {
-        VLOG(3) << "matched for flag '" << flags[j]->name() << "' for "
+      if (flag->Parse(args_, i, &last_i)) {
+        VLOG(3) << "matched for flag '" << flag->name() << "' for "
                 << args_[i];
         for (; i <= last_i; i++)
-          parsed_flags_[i] = flags[j];
+          parsed_flags_[i] = flag;
         i = last_i;
         parsed = true;
         break;
@@ -6,12 +6,13 @@
 #ifndef DEVTOOLS_GOMA_LIB_FLAG_PARSER_H_
 #define DEVTOOLS_GOMA_LIB_FLAG_PARSER_H_
 
-#include <map>
+#include <cstdint>
 #include <memory>
 #include <string>
 #include <vector>
 
 #include "absl/container/flat_hash_map.h"
+#include "absl/strings/string_view.h"
 
 class FlagParser {
  public:
@@ -141,6 +142,8 @@ class FlagParser {
   FlagParser(const FlagParser&) = delete;
   FlagParser& operator=(const FlagParser&) = delete;
 
+  // Options must be set before adding flags, since flags copy options
+  // when they are added.
   FlagParser::Options* mutable_options() {
     return &opts_;
   }
@@ -164,6 +167,9 @@ class FlagParser {
   // Argument that isn't prefixed with flag_prefix.
   Flag* AddNonFlag();
 
+  // Parses |args|.
+  // Each arg is matched with the flag whose name is the longest prefix of
+  // the arg (without flag prefix) and accepts the arg.
   void Parse(const std::vector<std::string>& args);
 
   // Returns parsed args.  Called once Parse() is called.
@@ -174,8 +180,24 @@ class FlagParser {
   }
 
  private:
+  // Schema is an immutable prefix trie of flag names.
+  // It is built once for the same sequence of flag names, and shared by
+  // FlagParsers, so Parse() can find candidate flags for an arg in single
+  // walk of the arg, instead of trying all flags.
+  class Schema;
+
+  Flag* AddFlagInternal(const char* name, bool require_value,
+                        bool allows_space_arg);
+
   Options opts_;
-  std::map<std::string, std::unique_ptr<Flag>> flags_;
+  // flags in the order of added. Index in Schema refers this.
+  std::vector<std::unique_ptr<Flag>> flags_;
+  // key is name of the flag owned by |flags_|.
+  absl::flat_hash_map<absl::string_view, Flag*> flags_by_name_;
+  // Fingerprint of names of |flags_| to find Schema.
+  std::uint64_t names_fingerprint_;
+  // Set by the first Parse() after flags are added.
+  std::shared_ptr<const Schema> schema_;
 
   // original args given by Parse().
   std::vector<std::string> args_;
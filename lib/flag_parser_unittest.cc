@@ -269,3 +269,60 @@ TEST(FlagParserTest, ClexeUnknownFlagsWeakAltPrefix) {
   ASSERT_EQ(0U, parser.unknown_flag_args().size())
       << parser.unknown_flag_args();
 }
+
+TEST(FlagParserTest, LongestMatchFallback) {
+  FlagParser parser;
+  parser.mutable_options()->flag_prefix = '-';
+  parser.mutable_options()->allows_nonspace_arg = true;
+
+  FlagParser::Flag* flag_f = parser.AddPrefixFlag("f");
+  FlagParser::Flag* flag_fno = parser.AddPrefixFlag("fno-");
+  bool fno_exceptions = false;
+  parser.AddBoolFlag("fno-exceptions")->SetSeenOutput(&fno_exceptions);
+  std::vector<std::string> non_flags;
+  parser.AddNonFlag()->SetOutput(&non_flags);
+
+  std::vector<std::string> args{
+      "clang",
+      "-fno-exceptions",
+      "-fno-exceptionsfoo",  // bool flag doesn't take value -> "fno-".
+      "-fPIC",
+      "foo.cc",
+  };
+  parser.Parse(args);
+
+  EXPECT_TRUE(fno_exceptions);
+  ASSERT_EQ(1U, flag_fno->values().size());
+  EXPECT_EQ("exceptionsfoo", flag_fno->value(0));
+  ASSERT_EQ(1U, flag_f->values().size());
+  EXPECT_EQ("PIC", flag_f->value(0));
+  EXPECT_EQ(std::vector<std::string>{"foo.cc"}, non_flags);
+  EXPECT_TRUE(parser.unknown_flag_args().empty())
+      << parser.unknown_flag_args();
+}
+
+TEST(FlagParserTest, SameFlagsInParsers) {
+  // FlagParsers with the same flags share the schema, but have their own
+  // outputs.
+  std::vector<std::string> outputs[2];
+  for (int i = 0; i < 2; ++i) {
+    FlagParser parser;
+    parser.mutable_options()->flag_prefix = '-';
+    parser.AddFlag("o")->SetOutput(&outputs[i]);
+    parser.AddBoolFlag("c");
+    parser.Parse(std::vector<std::string>{
+        "gcc", "-c", "-o", i == 0 ? "foo.o" : "bar.o"});
+  }
+  EXPECT_EQ((std::vector<std::string>{"-o", "foo.o"}), outputs[0]);
+  EXPECT_EQ((std::vector<std::string>{"-o", "bar.o"}), outputs[1]);
+
+  // Adding other flag should not use the schema for {"o", "c"}.
+  FlagParser parser;
+  parser.mutable_options()->flag_prefix = '-';
+  parser.AddFlag("o");
+  parser.AddBoolFlag("c");
+  bool seen_ob = false;
+  parser.AddBoolFlag("ob")->SetSeenOutput(&seen_ob);
+  parser.Parse(std::vector<std::string>{"gcc", "-ob"});
+  EXPECT_TRUE(seen_ob);
+}
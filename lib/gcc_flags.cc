@@ -4,8 +4,12 @@
 
 #include "lib/gcc_flags.h"
 
+#include <algorithm>
+#include <utility>
+
 #include "absl/strings/ascii.h"
 #include "absl/strings/match.h"
+#include "absl/strings/str_cat.h"
 #include "absl/strings/str_join.h"
 #include "absl/strings/str_split.h"
 #include "base/filesystem.h"
@@ -24,6 +28,44 @@
 
 namespace devtools_goma {
 
+namespace {
+
+// Returns .d file for -MD or -MMD without -MF.
+// Returns empty string if |output| doesn't have extension.
+std::string DepFileForOutput(absl::string_view output) {
+  size_t ext_start = output.rfind('.');
+  if (ext_start == absl::string_view::npos) {
+    return "";
+  }
+  return absl::StrCat(output.substr(0, ext_start), ".d");
+}
+
+// Returns .dwo file for -gsplit-dwarf.
+std::string DwoFileForOutput(absl::string_view output) {
+  return file::JoinPath(GetDirname(output), GetStem(output)) + ".dwo";
+}
+
+// Returns .json file for -ftime-trace.
+std::string TimeTraceFileForOutput(absl::string_view output) {
+  size_t ext_start = output.rfind('.');
+  if (ext_start == absl::string_view::npos) {
+    return absl::StrCat(output, ".json");
+  }
+  return absl::StrCat(output.substr(0, ext_start), ".json");
+}
+
+// Returns true if |filename| is a source file that GCCFlags treats
+// as an input of compile. Headers are excluded, since they would be
+// precompiled.
+bool IsCompileSourceFilename(absl::string_view filename) {
+  absl::string_view ext = GetExtension(filename);
+  return ext == "c" || ext == "cc" || ext == "cpp" || ext == "cxx" ||
+         ext == "cp" || ext == "c++" || ext == "C" || ext == "CPP" ||
+         ext == "m" || ext == "mm" || ext == "M" || ext == "s" || ext == "S";
+}
+
+}  // namespace
+
 /* static */
 std::string GCCFlags::GetCompilerName(absl::string_view arg) {
   absl::string_view name = GetBasename(arg);
@@ -597,16 +639,15 @@ GCCFlags::GCCFlags(const std::vector<std::string>& args, const std::string& cwd)
       // if -MD or -MMD flag was specified, and -MF flag was not specified,
       // assume .d file output.
       if ((flag_MD->seen() || flag_MMD->seen()) && !flag_MF->seen()) {
-        size_t ext_start = output.rfind('.');
-        if (ext_start != std::string::npos) {
-          output_files_.push_back(output.substr(0, ext_start) + ".d");
+        std::string dep_file = DepFileForOutput(output);
+        if (!dep_file.empty()) {
+          output_files_.push_back(std::move(dep_file));
         }
       }
 
       if (flag_gsplit_dwarf->seen()) {
         if (mode_ == COMPILE) {
-          output_files_.push_back(
-              file::JoinPath(GetDirname(output), GetStem(output)) + ".dwo");
+          output_files_.push_back(DwoFileForOutput(output));
         }
 
         const std::string& input0 = input_filenames_[0];
@@ -620,12 +661,7 @@ GCCFlags::GCCFlags(const std::vector<std::string>& args, const std::string& cwd)
         if (flag_M->seen() || flag_MM->seen()) {
           output_files_.push_back(".json");
         } else {
-          size_t ext_start = output.rfind('.');
-          if (ext_start != std::string::npos) {
-            output_files_.push_back(output.substr(0, ext_start) + ".json");
-          } else {
-            output_files_.push_back(output + ".json");
-          }
+          output_files_.push_back(TimeTraceFileForOutput(output));
         }
       }
     }
@@ -728,6 +764,135 @@ GCCFlags::GCCFlags(const std::vector<std::string>& args, const std::string& cwd)
   }
 }
 
+/* static */
+bool GCCFlags::GetPerFileArgIndices(const std::vector<std::string>& args,
+                                    std::vector<size_t>* per_file_arg_indices) {
+  per_file_arg_indices->clear();
+  size_t input_index = 0;
+  bool has_output = false;
+  for (size_t i = 1; i < args.size(); ++i) {
+    absl::string_view arg = args[i];
+    if (arg.empty()) {
+      continue;
+    }
+    // @rsp content may change between commands.
+    if (arg[0] == '@') {
+      return false;
+    }
+    // profile use flags may check file system.
+    if (absl::StartsWith(arg, "-fprofile-") &&
+        arg.find("use") != absl::string_view::npos) {
+      return false;
+    }
+    if (arg == "-o" || arg == "-MF") {
+      if (i + 1 >= args.size() || args[i + 1].empty() ||
+          args[i + 1][0] == '-') {
+        return false;
+      }
+      if (arg == "-o") {
+        if (has_output) {
+          return false;
+        }
+        has_output = true;
+      }
+      per_file_arg_indices->push_back(++i);
+      continue;
+    }
+    if (arg[0] != '-' && IsCompileSourceFilename(arg)) {
+      if (input_index != 0) {
+        // multiple inputs, or a flag value that looks like a source.
+        return false;
+      }
+      input_index = i;
+    }
+  }
+  if (input_index == 0 || !has_output) {
+    return false;
+  }
+  per_file_arg_indices->push_back(input_index);
+  std::sort(per_file_arg_indices->begin(), per_file_arg_indices->end());
+  return true;
+}
+
+std::unique_ptr<GCCFlags> GCCFlags::CloneWithPerFileArgs(
+    const std::vector<std::string>& args,
+    const std::vector<size_t>& per_file_arg_indices) const {
+  if (!is_successful_ || mode_ != COMPILE || !expanded_args_.empty() ||
+      args.size() != args_.size() || input_filenames_.size() != 1 ||
+      output_files_.empty()) {
+    return nullptr;
+  }
+
+  // per-file values in this flags, and in |args|.
+  std::string input, new_input;
+  std::string output, new_output;
+  std::vector<std::pair<std::string, std::string>> dep_files;
+  for (size_t i : per_file_arg_indices) {
+    if (i >= args_.size() || i == 0) {
+      return nullptr;
+    }
+    if (args_[i - 1] == "-o") {
+      output = args_[i];
+      new_output = args[i];
+    } else if (args_[i - 1] == "-MF") {
+      dep_files.emplace_back(args_[i], args[i]);
+    } else {
+      input = args_[i];
+      new_input = args[i];
+    }
+  }
+  // The arg must be recognized as we expected.
+  if (input != input_filenames_[0] || output != output_files_[0] ||
+      GetExtension(input) != GetExtension(new_input)) {
+    return nullptr;
+  }
+  // .d file is added only if output has extension.
+  if (DepFileForOutput(output).empty() !=
+      DepFileForOutput(new_output).empty()) {
+    return nullptr;
+  }
+
+  // Derived output files in this flags, and how they should be for |args|.
+  std::vector<std::pair<std::string, std::string>> replacements;
+  replacements.emplace_back(output, new_output);
+  for (auto& dep_file : dep_files) {
+    replacements.push_back(std::move(dep_file));
+  }
+  std::string dep_file = DepFileForOutput(output);
+  if (!dep_file.empty()) {
+    replacements.emplace_back(std::move(dep_file),
+                              DepFileForOutput(new_output));
+  }
+  replacements.emplace_back(DwoFileForOutput(output),
+                            DwoFileForOutput(new_output));
+  replacements.emplace_back(TimeTraceFileForOutput(output),
+                            TimeTraceFileForOutput(new_output));
+  for (size_t i = 0; i < replacements.size(); ++i) {
+    if (replacements[i].first == input) {
+      return nullptr;
+    }
+    for (size_t j = 0; j < i; ++j) {
+      if (replacements[i].first == replacements[j].first) {
+        // ambiguous.
+        return nullptr;
+      }
+    }
+  }
+
+  std::unique_ptr<GCCFlags> flags(new GCCFlags(*this));
+  flags->args_ = args;
+  flags->input_filenames_[0] = new_input;
+  for (auto& output_file : flags->output_files_) {
+    for (const auto& replacement : replacements) {
+      if (output_file == replacement.first) {
+        output_file = replacement.second;
+        break;
+      }
+    }
+  }
+  return flags;
+}
+
 const std::vector<std::string> GCCFlags::include_dirs() const {
   std::vector<std::string> dirs(non_system_include_dirs_);
   std::copy(framework_dirs_.begin(), framework_dirs_.end(),
@@ -88,6 +88,23 @@ class GCCFlags : public CxxFlags {
   }
   bool has_emit_module() const { return has_emit_module_; }
 
+  // Returns true if |args| looks like a simple compile command, whose parsed
+  // result can be shared with other commands that differ only in the input
+  // filename, and the values of "-o" and "-MF".
+  // |per_file_arg_indices| will have sorted indices of these args.
+  // Note that this doesn't parse |args|, so the parsed result must be checked
+  // with CloneWithPerFileArgs.
+  static bool GetPerFileArgIndices(const std::vector<std::string>& args,
+                                   std::vector<size_t>* per_file_arg_indices);
+
+  // Returns parsed result of |args| derived from this without parsing.
+  // |args| must be the same as args() except at |per_file_arg_indices|,
+  // which is given by GetPerFileArgIndices(args()).
+  // Returns nullptr if this can't be used for other commands.
+  std::unique_ptr<GCCFlags> CloneWithPerFileArgs(
+      const std::vector<std::string>& args,
+      const std::vector<size_t>& per_file_arg_indices) const;
+
   CompilerFlagType type() const override { return CompilerFlagType::Gcc; }
 
   bool IsClientImportantEnv(const char* env) const override;
@@ -3074,4 +3074,62 @@ TEST_F(GCCFlagsTest, ClangFfileCompilationDir) {
   EXPECT_EQ(flags.ffile_compilation_dir(), ".");
 }
 
+TEST_F(GCCFlagsTest, GetPerFileArgIndices) {
+  std::vector<size_t> indices;
+  EXPECT_TRUE(GCCFlags::GetPerFileArgIndices(
+      std::vector<std::string>{"clang++", "-MMD", "-MF", "obj/foo.o.d", "-c",
+                               "../../foo.cc", "-o", "obj/foo.o"},
+      &indices));
+  EXPECT_EQ((std::vector<size_t>{3, 5, 7}), indices);
+
+  // no -o.
+  EXPECT_FALSE(GCCFlags::GetPerFileArgIndices(
+      std::vector<std::string>{"clang", "-c", "foo.c"}, &indices));
+  // multiple inputs.
+  EXPECT_FALSE(GCCFlags::GetPerFileArgIndices(
+      std::vector<std::string>{"clang", "-c", "foo.c", "bar.c", "-o", "x.o"},
+      &indices));
+  // response file.
+  EXPECT_FALSE(GCCFlags::GetPerFileArgIndices(
+      std::vector<std::string>{"clang", "@foo.rsp", "-c", "foo.c", "-o",
+                               "foo.o"},
+      &indices));
+  // profile input may depend on file system.
+  EXPECT_FALSE(GCCFlags::GetPerFileArgIndices(
+      std::vector<std::string>{"clang", "-fprofile-use=foo", "-c", "foo.c",
+                               "-o", "foo.o"},
+      &indices));
+}
+
+TEST_F(GCCFlagsTest, CloneWithPerFileArgs) {
+  const std::vector<std::string> foo_args{
+      "clang++", "-MMD", "-gsplit-dwarf", "-ftime-trace", "-DFOO",
+      "-c",      "../../foo.cc",         "-o",           "obj/foo.o",
+  };
+  const std::vector<std::string> bar_args{
+      "clang++", "-MMD", "-gsplit-dwarf", "-ftime-trace", "-DFOO",
+      "-c",      "../../bar/bar.cc",     "-o",           "obj/bar/bar.o",
+  };
+  std::vector<size_t> indices;
+  ASSERT_TRUE(GCCFlags::GetPerFileArgIndices(foo_args, &indices));
+
+  GCCFlags foo(foo_args, "/src/out");
+  GCCFlags bar(bar_args, "/src/out");
+  std::unique_ptr<GCCFlags> cloned =
+      foo.CloneWithPerFileArgs(bar_args, indices);
+  ASSERT_TRUE(cloned);
+  EXPECT_EQ(bar.args(), cloned->args());
+  EXPECT_EQ(bar.input_filenames(), cloned->input_filenames());
+  EXPECT_EQ(bar.output_files(), cloned->output_files());
+  EXPECT_EQ(bar.commandline_macros(), cloned->commandline_macros());
+  EXPECT_EQ(bar.lang(), cloned->lang());
+
+  // not a compile.
+  GCCFlags preprocess(
+      std::vector<std::string>{"clang", "-E", "foo.c", "-o", "foo.i"},
+      "/src/out");
+  ASSERT_TRUE(GCCFlags::GetPerFileArgIndices(preprocess.args(), &indices));
+  EXPECT_FALSE(preprocess.CloneWithPerFileArgs(preprocess.args(), indices));
+}
+
 }  // namespace devtools_goma
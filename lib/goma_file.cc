@@ -14,6 +14,9 @@
 #include <unistd.h>
 #endif
 
+#include <algorithm>
+#include <deque>
+#include <functional>
 #include <memory>
 #include <stack>
 #include <utility>
@@ -35,10 +38,119 @@ const off_t kFileChunkSize = 2 * 1024 * 1024L;
 
 const int kNumChunksInStreamRequest = 5;
 
+// For downloads, each lookup response is written to output as soon as it
+// arrives, so memory used by one OutputFileChunks is bounded by
+// max_in_flight_chunk_tasks_per_file_ * kNumChunksInLookupRequest *
+// kFileChunkSize, regardless of the output file size.
+const int kNumChunksInLookupRequest = 2;
+
 }  // anonymous namespace
 
 namespace devtools_goma {
 
+namespace {
+
+// AsyncTaskPipeline runs AsyncTasks of one file transfer concurrently,
+// and finishes them in the order they were run.
+// The first in-flight task can always run, so a transfer makes progress
+// even if |limiter| has no available permit.  Other tasks need a permit.
+template<typename Req, typename Resp>
+class AsyncTaskPipeline {
+ public:
+  using Task = FileServiceClient::AsyncTask<Req, Resp>;
+  using FinishFunc = std::function<bool(std::unique_ptr<Task>)>;
+
+  AsyncTaskPipeline(int max_in_flight,
+                    ChunkConcurrencyLimiter* limiter,
+                    FinishFunc finish)
+      : max_in_flight_(std::max(max_in_flight, 1)),
+        limiter_(limiter),
+        finish_(std::move(finish)) {}
+  ~AsyncTaskPipeline() {
+    FinishAll();
+  }
+  AsyncTaskPipeline(const AsyncTaskPipeline&) = delete;
+  AsyncTaskPipeline& operator=(const AsyncTaskPipeline&) = delete;
+
+  // Runs |task| after finishing in-flight tasks as needed to keep
+  // concurrency limits.
+  // Returns false if finishing in-flight task failed.  In this case,
+  // |task| is not run.
+  bool Run(std::unique_ptr<Task> task) {
+    bool has_permit = false;
+    while (!tasks_.empty()) {
+      if (static_cast<int>(tasks_.size()) < max_in_flight_ &&
+          (limiter_ == nullptr || (has_permit = limiter_->TryAcquire()))) {
+        break;
+      }
+      if (!FinishOldest()) {
+        return false;
+      }
+    }
+    task->Run();
+    tasks_.push_back(InFlightTask{std::move(task), has_permit});
+    return true;
+  }
+
+  // Finishes all in-flight tasks.
+  // Returns false if any of them failed.
+  bool FinishAll() {
+    bool ok = true;
+    while (!tasks_.empty()) {
+      if (!FinishOldest()) {
+        ok = false;
+      }
+    }
+    return ok;
+  }
+
+ private:
+  struct InFlightTask {
+    std::unique_ptr<Task> task;
+    bool has_permit;
+  };
+
+  bool FinishOldest() {
+    InFlightTask in_flight = std::move(tasks_.front());
+    tasks_.pop_front();
+    bool ok = finish_(std::move(in_flight.task));
+    if (in_flight.has_permit) {
+      limiter_->Release();
+    }
+    return ok;
+  }
+
+  const int max_in_flight_;
+  ChunkConcurrencyLimiter* limiter_;
+  FinishFunc finish_;
+  std::deque<InFlightTask> tasks_;
+};
+
+}  // anonymous namespace
+
+bool ChunkConcurrencyLimiter::TryAcquire() {
+  int available = available_.load(std::memory_order_relaxed);
+  while (available > 0) {
+    if (available_.compare_exchange_weak(available, available - 1,
+                                         std::memory_order_acquire,
+                                         std::memory_order_relaxed)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void ChunkConcurrencyLimiter::Release() {
+  available_.fetch_add(1, std::memory_order_release);
+}
+
+void FileServiceClient::SetChunkConcurrency(
+    int max_in_flight_per_file,
+    std::shared_ptr<ChunkConcurrencyLimiter> limiter) {
+  max_in_flight_chunk_tasks_per_file_ = max_in_flight_per_file;
+  chunk_concurrency_limiter_ = std::move(limiter);
+}
+
 static std::string GetHashKeyInLookupFileReq(const LookupFileReq& req, int i) {
   CHECK_GE(i, 0);
   if (i < req.hash_key_size())
@@ -234,6 +346,11 @@ bool FileServiceClient::FinishStoreFileTask(
     LOG(WARNING) << "Finish StoreFileTask failed.";
     return false;
   }
+  if (task->resp().hash_key_size() != task->req().blob_size()) {
+    LOG(WARNING) << "StoreFileTask got " << task->resp().hash_key_size()
+                 << " hash_keys for " << task->req().blob_size() << " chunks";
+    return false;
+  }
   int num_failed = 0;
   for (int i = 0; i < task->resp().hash_key_size(); ++i) {
     if (task->resp().hash_key(i).empty()) {
@@ -258,11 +375,18 @@ bool FileServiceClient::CreateFileChunks(
   if (store && task.get()) {
     // Streaming available.
     VLOG(1) << "Streaming mode";
-    if (requester_info_ != nullptr) {
-      *task->mutable_req()->mutable_requester_info() = *requester_info_;
-    }
-    std::unique_ptr<AsyncTask<StoreFileReq, StoreFileResp> > in_flight_task;
+    AsyncTaskPipeline<StoreFileReq, StoreFileResp> pipeline(
+        max_in_flight_chunk_tasks_per_file_, chunk_concurrency_limiter_.get(),
+        [this](std::unique_ptr<AsyncTask<StoreFileReq, StoreFileResp>> t) {
+          return FinishStoreFileTask(std::move(t));
+        });
     for (off_t offset = 0; offset < size; offset += kFileChunkSize) {
+      if (task == nullptr) {
+        task = NewAsyncStoreFileTask();
+      }
+      if (requester_info_ != nullptr && !task->req().has_requester_info()) {
+        *task->mutable_req()->mutable_requester_info() = *requester_info_;
+      }
       FileBlob* chunk = task->mutable_req()->add_blob();
       int chunk_size = std::min(kFileChunkSize, size - offset);
       if (!ReadFileContent(fr, offset, chunk_size, chunk)) {
@@ -277,26 +401,18 @@ bool FileServiceClient::CreateFileChunks(
       LOG(INFO) << "chunk hash_key:" << hash_key;
       blob->add_hash_key(hash_key);
       if (task->req().blob_size() >= kNumChunksInStreamRequest) {
-        if (!FinishStoreFileTask(std::move(in_flight_task)))
+        if (!pipeline.Run(std::move(task))) {
           return false;
-        task->Run();
-        in_flight_task = std::move(task);
-        task = NewAsyncStoreFileTask();
-        if (requester_info_ != nullptr) {
-          *task->mutable_req()->mutable_requester_info() = *requester_info_;
         }
       }
     }
     VLOG(1) << "ReadFile done";
-    if (task->req().blob_size() > 0)
-      task->Run();
-    else
-      task.reset(nullptr);
-    if (!FinishStoreFileTask(std::move(in_flight_task))) {
-      FinishStoreFileTask(std::move(task));
-      return false;
+    if (task != nullptr && task->req().blob_size() > 0) {
+      if (!pipeline.Run(std::move(task))) {
+        return false;
+      }
     }
-    return FinishStoreFileTask(std::move(task));
+    return pipeline.FinishAll();
   }
 
   for (off_t offset = 0; offset < size; offset += kFileChunkSize) {
@@ -416,36 +532,34 @@ bool FileServiceClient::OutputFileChunks(const FileBlob& blob,
       NewAsyncLookupFileTask());
   if (task.get()) {
     // Streaming available.
+    // Each lookup response is written at chunk offsets when its task is
+    // finished, so that we don't need to hold whole file content.
     VLOG(1) << "Streaming mode";
-    if (requester_info_ != nullptr) {
-      *task->mutable_req()->mutable_requester_info() = *requester_info_;
-    }
-    std::unique_ptr<AsyncTask<LookupFileReq, LookupFileResp> > in_flight_task;
-    for (const auto& key : blob.hash_key()) {
+    AsyncTaskPipeline<LookupFileReq, LookupFileResp> pipeline(
+        max_in_flight_chunk_tasks_per_file_, chunk_concurrency_limiter_.get(),
+        [this, output](
+            std::unique_ptr<AsyncTask<LookupFileReq, LookupFileResp>> t) {
+          return FinishLookupFileTask(std::move(t), output);
+        });
+    for (int i = 0; i < blob.hash_key_size(); ++i) {
+      if (task == nullptr) {
+        task = NewAsyncLookupFileTask();
+      }
+      if (requester_info_ != nullptr && !task->req().has_requester_info()) {
+        *task->mutable_req()->mutable_requester_info() = *requester_info_;
+      }
+      const std::string& key = blob.hash_key(i);
       task->mutable_req()->add_hash_key(key);
       VLOG(1) << "chunk hash_key:" << key;
-      if (task->req().hash_key_size() >= kNumChunksInStreamRequest) {
-        if (!FinishLookupFileTask(std::move(in_flight_task), output))
+      if (task->req().hash_key_size() >= kNumChunksInLookupRequest ||
+          i + 1 == blob.hash_key_size()) {
+        if (!pipeline.Run(std::move(task))) {
           return false;
-        task->Run();
-        in_flight_task = std::move(task);
-        task = NewAsyncLookupFileTask();
-        if (requester_info_ != nullptr) {
-          *task->mutable_req()->mutable_requester_info() = *requester_info_;
         }
       }
     }
     VLOG(1) << "LookupFile done";
-    if (task->req().hash_key_size() > 0)
-      task->Run();
-    else
-      task.reset(nullptr);
-    if (!FinishLookupFileTask(std::move(in_flight_task), output)) {
-      FinishLookupFileTask(std::move(task), output);
-      return false;
-    }
-
-    return FinishLookupFileTask(std::move(task), output);
+    return pipeline.FinishAll();
   }
 
   for (const auto& key : blob.hash_key()) {
@@ -6,6 +6,7 @@
 #ifndef DEVTOOLS_GOMA_LIB_GOMA_FILE_H_
 #define DEVTOOLS_GOMA_LIB_GOMA_FILE_H_
 
+#include <atomic>
 #include <memory>
 #include <string>
 #include <vector>
@@ -31,6 +32,25 @@ class LookupFileReq;
 class LookupFileResp;
 class ScopedFd;
 
+// ChunkConcurrencyLimiter limits the total number of in-flight chunk
+// store/lookup requests shared among FileServiceClients.
+// This class is thread-safe.
+class ChunkConcurrencyLimiter {
+ public:
+  explicit ChunkConcurrencyLimiter(int max_in_flight)
+      : available_(max_in_flight) {}
+  ChunkConcurrencyLimiter(const ChunkConcurrencyLimiter&) = delete;
+  ChunkConcurrencyLimiter& operator=(const ChunkConcurrencyLimiter&) = delete;
+
+  // Returns true if it could take one permit. It never blocks.
+  bool TryAcquire();
+  // Returns a permit taken by TryAcquire.
+  void Release();
+
+ private:
+  std::atomic<int> available_;
+};
+
 class FileServiceClient {
  public:
   // Asynchronous support on old synchronous http rpc.
@@ -101,6 +121,15 @@ class FileServiceClient {
   // this method.
   bool OutputFileBlob(const FileBlob& blob, FileDataOutput* output);
 
+  // Sets concurrency of chunk store/lookup requests for FILE_META blobs.
+  // Each file may have at most |max_in_flight_per_file| requests in flight,
+  // and extra requests beyond the first one of each file need a permit from
+  // |limiter|, which may be shared by multiple clients.
+  // |limiter| may be nullptr, which means no global limit.
+  void SetChunkConcurrency(
+      int max_in_flight_per_file,
+      std::shared_ptr<ChunkConcurrencyLimiter> limiter);
+
   virtual std::unique_ptr<AsyncTask<StoreFileReq, StoreFileResp>>
   NewAsyncStoreFileTask() = 0;
   virtual std::unique_ptr<AsyncTask<LookupFileReq, LookupFileResp>>
@@ -113,6 +142,8 @@ class FileServiceClient {
   FileReaderFactory* reader_factory_;
   std::unique_ptr<RequesterInfo> requester_info_;
   std::string trace_id_;
+  int max_in_flight_chunk_tasks_per_file_ = 4;
+  std::shared_ptr<ChunkConcurrencyLimiter> chunk_concurrency_limiter_;
 
  private:
   bool FinishStoreFileTask(
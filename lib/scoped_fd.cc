@@ -227,6 +227,27 @@ ssize_t ScopedFd::Write(const void* ptr, size_t len) const {
 #endif
 }
 
+ssize_t ScopedFd::WriteAt(const void* ptr, size_t len, off_t offset) const {
+#ifndef _WIN32
+  ssize_t r = 0;
+  while ((r = pwrite(fd_, ptr, len, offset)) < 0) {
+    if (errno != EINTR) break;
+  }
+  return r;
+#else
+  OVERLAPPED overlapped = {};
+  const uint64_t offset64 = static_cast<uint64_t>(offset);
+  overlapped.Offset = static_cast<DWORD>(offset64);
+  overlapped.OffsetHigh = static_cast<DWORD>(offset64 >> 32);
+  DWORD bytes_written = 0;
+  if (!WriteFile(fd_, ptr, len, &bytes_written, &overlapped)) {
+    LOG_SYSRESULT(GetLastError());
+    return -1;
+  }
+  return bytes_written;
+#endif
+}
+
 off_t ScopedFd::Seek(off_t offset, Whence whence) const {
 #ifndef _WIN32
   return lseek(fd_, offset, whence);
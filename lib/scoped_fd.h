@@ -69,6 +69,9 @@ class ScopedFd {
 
   ssize_t Read(void* ptr, size_t len) const;
   ssize_t Write(const void* ptr, size_t len) const;
+  // Writes len bytes at offset without using the file position, so it can
+  // be used concurrently for disjoint ranges of the same file.
+  ssize_t WriteAt(const void* ptr, size_t len, off_t offset) const;
   off_t Seek(off_t offset, Whence whence) const;
   bool GetFileSize(size_t* file_size) const;
 